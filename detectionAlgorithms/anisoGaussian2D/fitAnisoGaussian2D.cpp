@@ -0,0 +1,176 @@
+/* [prmVect prmStd covarianceMatrix residuals Jacobian] = fitAnisoGaussian2D(data, prmVect, mode, options);
+ *
+ * (c) Sylvain Berlemont, 2011 (last modified Jul 29, 2011)
+ *
+ * 'data' can be a cell array of windows, with 'prmVect' a matrix (one row per window);
+ * the windows are then fitted in parallel. See batchFit.h.
+ *
+ * Compilation:
+ * Mac/Linux: mex -I/usr/local/include -I../../mex/include /usr/local/lib/libgsl.a /usr/local/lib/libgslcblas.a CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" fitAnisoGaussian2D.cpp
+ * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT /openmp" -I"..\..\..\extern\mex\include\gsl-1.14" -I"..\..\mex\include" "..\..\..\extern\mex\lib\gsl.lib" "..\..\..\extern\mex\lib\cblas.lib" -output fitAnisoGaussian2D fitAnisoGaussian2D.cpp
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "batchFit.h"
+
+#define SIGN(x)	(x > 0 ? 1 : (x < 0 ? -1.0 : 0.0))
+
+#define NPARAMS	7
+#define REFMODE	"xyarstc"	/* r = sigma_x (along the feature),
+				   s = sigma_y (aside the feature) */
+
+class AnisoGaussian2D : public FitModel
+{
+public:
+  static const int nd = 2;
+  static const int stop = STOP_DELTA;
+  static const int residualFormat = RES_STRUCT_KS;
+
+  AnisoGaussian2D() : cacheWindow_(NULL) {}
+
+  static bool readParameters(const double* v, const int n, std::vector<double>& prm)
+  {
+    if (n != NPARAMS)
+      return false;
+    prm.assign(v, v + NPARAMS);
+    return true;
+  }
+
+  static bool selectParameters(const char* mode, const int np, std::vector<int>& estIdx)
+  {
+    estIdx.clear();
+    for (int i = 0; i < NPARAMS; ++i)
+      if (strchr(mode, REFMODE[i])!=NULL)
+	estIdx.push_back(i);
+    return !estIdx.empty();
+  }
+
+  static void finalize(double* prm, const int np)
+  {
+    /* Make sure the angle parameter lies in -pi/2...pi/2 */
+    double t = prm[5];
+    if (t > M_PI_2 || t < -M_PI_2)
+      {
+	t = fmod(t + M_PI_2, M_PI);
+	t -= SIGN(t) * M_PI_2;
+	prm[5] = t;
+      }
+
+    /* Make sure sigma_x and sigma_y are positive */
+    prm[3] = fabs(prm[3]);
+    prm[4] = fabs(prm[4]);
+  }
+
+  void evaluate(const FitWindow& w, const double* prm, const int np, const int* estIdx, const int nparam,
+		double* f, double* J)
+  {
+    int i, k;
+    int nx_div2 = (w.nx-1) >> 1;
+    int ny_div2 = (w.ny-1) >> 1;
+
+    double xp = prm[0];
+    double yp = prm[1];
+    double A = prm[2];
+    double sx = fabs(prm[3]);
+    double sy = fabs(prm[4]);
+    double t = prm[5];
+    double C = prm[6];
+
+    double ct = cos(t);
+    double st = sin(t);
+    double c2t = cos(2 * t);
+    double s2t = sin(2 * t);
+    double sx2 = sx * sx;
+    double sy2 = sy * sy;
+    double sx3 = sx2 * sx;
+    double sy3 = sy2 * sy;
+    double a = ct * ct / (2 * sx2) + st * st / (2 * sy2);
+    double b = s2t / (4 * sx2) - s2t / (4 * sy2);
+    double c = st * st / (2 * sx2) + ct * ct / (2 * sy2);
+
+    double xi, yi, g, r, *Ji;
+    int nValid = w.nValid();
+
+    /* The Gaussian only depends on the parameters: GSL evaluates the
+       Jacobian at the last accepted point, for which it has just been
+       computed. */
+    if (!cached(w, prm))
+      {
+	g_.resize(nValid);
+	for (i = 0; i < nValid; ++i)
+	  {
+	    xi = w.x[i] - nx_div2 - xp;
+	    yi = w.y[i] - ny_div2 - yp;
+	    g_[i] = exp(-a * xi * xi - yi * (2 * b * xi + c * yi));
+	  }
+
+	cacheWindow_ = &w;
+	std::copy(prm, prm + NPARAMS, cachePrm_);
+      }
+
+    if (f != NULL)
+      for (i = 0; i < nValid; ++i)
+	f[i] = A * g_[i] + C - w.pixels[w.idx[i]];
+
+    if (J == NULL)
+      return;
+
+    for (i = 0; i < nValid; ++i)
+      {
+	xi = w.x[i] - nx_div2 - xp;
+	yi = w.y[i] - ny_div2 - yp;
+	g = g_[i];
+
+	Ji = J + i * nparam;
+	for (k = 0; k < nparam; ++k)
+	  switch (estIdx[k])
+	    {
+	    case 0: /* 2 A g (a xi + b yi) */
+	      Ji[k] = 2 * A * g * (a * xi + b * yi);
+	      break;
+	    case 1: /* 2 A g (b xi + c yi) */
+	      Ji[k] = 2 * A * g * (b * xi + c * yi);
+	      break;
+	    case 2: /* g */
+	      Ji[k] = g;
+	      break;
+	    case 3: /* (A g (xi ct + yi st)^2)/sx^3 */
+	      r = xi * ct + yi * st;
+	      Ji[k] = A * g * r * r / sx3;
+	      break;
+	    case 4: /* (A g (yi ct - xi st)^2)/sy^3 */
+	      r = yi * ct - xi * st;
+	      Ji[k] = A * g * r * r / sy3;
+	      break;
+	    case 5: /* -((A g (sx^2 - sy^2) (-2 xi yi c2t + (xi^2 - yi^2) s2t)) / (2 sx^2 sy^2)) */
+	      Ji[k] = -((A * g * (sx2 - sy2) *
+			 (-2 * xi * yi * c2t +
+			  (xi * xi - yi * yi) * s2t)) / (2 * sx2 * sy2));
+	      break;
+	    case 6: /* 1 */
+	      Ji[k] = 1;
+	      break;
+	    }
+      }
+  }
+
+private:
+  bool cached(const FitWindow& w, const double* prm) const
+  {
+    return cacheWindow_ == &w && std::equal(prm, prm + NPARAMS, cachePrm_);
+  }
+
+  /* Gaussian of the last evaluation */
+  const FitWindow* cacheWindow_;
+  double cachePrm_[NPARAMS];
+  std::vector<double> g_;
+};
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+  fitWindows<AnisoGaussian2D>(nlhs, plhs, nrhs, prhs);
+}
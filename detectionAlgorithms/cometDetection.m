@@ -100,9 +100,12 @@ stdR = zeros(size(P,1),1);
 
 kLevel = norminv(1 - alpha / 2.0, 0, 1); % ~2 std above background
 
-success = false(numel(xmin),1);
+nf = numel(xmin);
+success = false(nf,1);
 
-for iFeature = 1:numel(xmin)
+crops = cell(nf,1);
+anisoMasks = cell(nf,1);
+for iFeature = 1:nf
     mask =labels(ymin(iFeature):ymax(iFeature), xmin(iFeature):xmax(iFeature));
     mask(mask==labels(yRange{iFeature}(fix(end/2)),xRange{iFeature}(fix(end/2)))) = 0;
     
@@ -116,10 +119,23 @@ for iFeature = 1:numel(xmin)
     
     P(iFeature,7) = min(crop(:)); % background
     P(iFeature,3) = P(iFeature,3) - P(iFeature,7); % amplitude above background
-        
-    [params, stdParams, ~, res] = fitAnisoGaussian2D(crop, ...
-        [0, 0, P(iFeature,3), 3 * P(iFeature,4), P(iFeature,5), ...
-        P(iFeature,6), P(iFeature,7)], mode);
+    
+    crops{iFeature} = crop;
+    anisoMasks{iFeature} = anisoMask;
+end
+
+% fit all candidates in a single (parallel) call
+if nf > 0
+    [prmAll, stdAll, ~, resAll] = fitAnisoGaussian2D(crops, ...
+        [zeros(nf,2), P(:,3), 3 * P(:,4), P(:,5), P(:,6), P(:,7)], mode);
+end
+
+for iFeature = 1:nf
+    crop = crops{iFeature};
+    anisoMask = anisoMasks{iFeature};
+    params = prmAll(iFeature,:);
+    stdParams = stdAll(iFeature,:);
+    res = resAll(iFeature);
         
     % TEST: position must remain in a confined area
     px = floor(floor(size(crop)/2)+1+params(1:2));
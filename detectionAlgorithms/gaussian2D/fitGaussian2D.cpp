@@ -0,0 +1,18 @@
+/* [prmVect prmStd covarianceMatrix residuals Jacobian] = fitGaussian2D(data, prmVect, mode, options);
+ *
+ * (c) Francois Aguet & Sylvain Berlemont, 2011 (last modified Feb 23, 2011)
+ *
+ * 'data' can be a cell array of windows, with 'prmVect' a matrix (one row per window);
+ * the windows are then fitted in parallel. See batchFit.h.
+ *
+ * Compilation:
+ * Mac/Linux: mex -I/usr/local/include -I../../mex/include /usr/local/lib/libgsl.a /usr/local/lib/libgslcblas.a CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" fitGaussian2D.cpp
+ * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT /openmp" -I"..\..\..\extern\mex\include\gsl-1.15" -I"..\..\mex\include" "..\..\..\extern\mex\lib\gsl.lib" "..\..\..\extern\mex\lib\cblas.lib" -output fitGaussian2D fitGaussian2D.cpp
+ */
+
+#include "gaussian2DModel.h"
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+    fitWindows<Gaussian2D>(nlhs, plhs, nrhs, prhs);
+}
@@ -0,0 +1,130 @@
+/* [prmVect, prmStd, covarianceMatrix, residuals, Jacobian] = fitGaussian3D(data, prmVect, mode, options);
+ *
+ * Copyright (c) 2013 Francois Aguet
+ *
+ * 'data' can be a cell array of windows, with 'prmVect' a matrix (one row per window);
+ * the windows are then fitted in parallel. See batchFit.h.
+ *
+ * Compilation:
+ * Mac/Linux: mex -I/usr/local/include -I../../mex/include /usr/local/lib/libgsl.a /usr/local/lib/libgslcblas.a CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" fitGaussian3D.cpp
+ * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT /openmp" -I"..\..\..\extern\mex\include\gsl-1.15" -I"..\..\mex\include" "..\..\..\extern\mex\lib\gsl.lib" "..\..\..\extern\mex\lib\cblas.lib" -output fitGaussian3D fitGaussian3D.cpp
+ */
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "batchFit.h"
+
+#define NPARAMS 7
+#define refMode "xyzasrc" // s = x,y sigma; r = z sigma = rho
+
+
+class Gaussian3D : public FitModel {
+
+public:
+    static const int nd = 3;
+    static const int stop = STOP_DELTA_AND_GRADIENT;
+    static const int residualFormat = RES_STRUCT_AD;
+
+    // [x y z A s c] (isotropic) or [x y z A s r c]
+    static bool readParameters(const double* v, const int n, std::vector<double>& prm) {
+        if (n==NPARAMS) {
+            prm.assign(v, v+NPARAMS);
+        } else if (n==NPARAMS-1) {
+            prm.assign(v, v+5);
+            prm.push_back(v[4]);
+            prm.push_back(v[5]);
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    static bool selectParameters(const char* mode, const int np, std::vector<int>& estIdx) {
+        estIdx.clear();
+        for (int i=0; i<NPARAMS; ++i) {
+            if (strchr(mode, refMode[i])!=NULL) {
+                estIdx.push_back(i);
+            }
+        }
+        return !estIdx.empty();
+    }
+
+    static void finalize(double* prm, const int np) {
+        prm[4] = fabs(prm[4]);
+        prm[5] = fabs(prm[5]);
+    }
+
+    void evaluate(const FitWindow& w, const double* prm, const int np, const int* estIdx, const int nparam,
+                  double* f, double* J) {
+
+        int i, k;
+        double xp = prm[0];
+        double yp = prm[1];
+        double zp = prm[2];
+        double A = prm[3];
+        double sigma = fabs(prm[4]);
+        double rho = fabs(prm[5]);
+        double c = prm[6];
+
+        double sigma2 = sigma*sigma;
+        double sigma3 = sigma2*sigma;
+        double rho2 = rho*rho;
+        double rho3 = rho2*rho;
+        double s = 2.0*sigma2;
+        double r = 2.0*rho2;
+
+        // separable Gaussian kernel (0-based window coordinates)
+        gx_.resize(w.nx);
+        gy_.resize(w.ny);
+        gz_.resize(w.nz);
+        double d;
+        for (i=0; i<w.nx; ++i) {
+            d = i-xp;
+            gx_[i] = exp(-d*d/s);
+        }
+        for (i=0; i<w.ny; ++i) {
+            d = i-yp;
+            gy_[i] = exp(-d*d/s);
+        }
+        for (i=0; i<w.nz; ++i) {
+            d = i-zp;
+            gz_[i] = exp(-d*d/r);
+        }
+
+        double xi, yi, zi, g, *Ji;
+        int nValid = w.nValid();
+        for (i=0; i<nValid; ++i) {
+            g = gx_[w.x[i]]*gy_[w.y[i]]*gz_[w.z[i]];
+            if (f!=NULL) {
+                f[i] = A*g+c - w.pixels[w.idx[i]];
+            }
+            if (J!=NULL) {
+                xi = w.x[i] - xp;
+                yi = w.y[i] - yp;
+                zi = w.z[i] - zp;
+                Ji = J + i*nparam;
+                for (k=0; k<nparam; ++k) {
+                    switch (estIdx[k]) {
+                        case 0: Ji[k] = A/sigma2*xi*g; break;
+                        case 1: Ji[k] = A/sigma2*yi*g; break;
+                        case 2: Ji[k] = A/rho2*zi*g; break;
+                        case 3: Ji[k] = g; break;
+                        case 4: Ji[k] = (xi*xi + yi*yi)*A/sigma3*g; break;
+                        case 5: Ji[k] = zi*zi*A/rho3*g; break;
+                        case 6: Ji[k] = 1.0; break;
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    std::vector<double> gx_, gy_, gz_; // 1-D separated components of the Gaussian
+};
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+    fitWindows<Gaussian3D>(nlhs, plhs, nrhs, prhs);
+}
@@ -35,6 +35,11 @@
 %
 % Note: Pixels in 'data' that are set to NaN are ignored
 %
+%    Batch mode: if 'data' is a cell array of windows, 'prmVect' must be a matrix with one row
+%    per window. All windows are fitted in parallel; prmVect and prmStd are returned as matrices
+%    (one row per window), C and J as cell arrays, and res as a structure array. Windows with
+%    fewer valid pixels than parameters to estimate return NaN.
+%
 % Axis conventions: image processing, see meshgrid
 % For Gaussian mixture fitting, use fitGaussianMixture3D()
 %
@@ -0,0 +1,183 @@
+/* [prmVect prmStd covarianceMatrix residuals Jacobian] = fitGaussianMixture3D(image, prmVect, mode, options, search);
+ *
+ * (c) Francois Aguet, 2014 (last modified 02/25/2014)
+ *
+ * If 'search' is specified, components are added one at a time (model order search): the (n+1)-component
+ * fit is initialized with the n-component solution and a new component at the peak of the residual,
+ * and is retained if it significantly improves the fit (F-test) and all components lie within the search radius.
+ *
+ * 'image' can be a cell array of windows, with 'prmVect' a matrix (one row per window) or a cell array;
+ * the windows are then fitted in parallel. See batchFit.h.
+ *
+ * Compilation:
+ * Mac/Linux: mex -I/usr/local/include -I../../mex/include -lgsl -lgslcblas CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" fitGaussianMixture3D.cpp
+ * Mac/Linux (static): mex -I/usr/local/include -I../../mex/include /usr/local/lib/libgsl.a /usr/local/lib/libgslcblas.a CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" fitGaussianMixture3D.cpp
+ * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT /openmp" -I"..\..\..\extern\mex\include\gsl-1.15" -I"..\..\mex\include" "..\..\..\extern\mex\lib\gsl.lib" "..\..\..\extern\mex\lib\cblas.lib" -output fitGaussianMixture3D fitGaussianMixture3D.cpp
+ *
+ * UTSW BioHPC instructions (terminal shell):
+ * cd ~/matlab/common/detectionAlgorithms/gaussian3D/
+ * module add gsl
+ * mex -I../../mex/include -L$GSL_LIB -lgsl -lgslcblas -I$GSL_DIR/include CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" fitGaussianMixture3D.cpp
+ */
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "batchFit.h"
+
+
+#define refMode "xyzasrc" // s = x,y sigma; r = z sigma = rho
+
+
+// Parameter vector: [x1 y1 z1 A1 ... xn yn zn An sigma rho c], in 0-based window coordinates
+class GaussianMixture3D : public FitModel {
+
+public:
+    static const int nd = 3;
+    static const int stop = STOP_DELTA_OR_GRADIENT;
+    static const int residualFormat = RES_STRUCT_AD_DOUBLE;
+    static const bool expandStd = true;
+    static const int componentSize = 4;
+    static const int sharedSize = 3;
+
+    static bool readParameters(const double* v, const int n, std::vector<double>& prm) {
+        if (n%4 != 3) return false;
+        prm.assign(v, v+n);
+        return true;
+    }
+
+    static bool selectParameters(const char* mode, const int np, std::vector<int>& estIdx) {
+        int ng = np/4;
+        estIdx.clear();
+        for (int i=0; i<ng; ++i) {
+            for (int k=0; k<4; ++k) {
+                if (strchr(mode, refMode[k])!=NULL) {
+                    estIdx.push_back(4*i+k);
+                }
+            }
+        }
+        if (strchr(mode, 's')!=NULL) estIdx.push_back(4*ng);
+        if (strchr(mode, 'r')!=NULL) estIdx.push_back(4*ng+1);
+        if (strchr(mode, 'c')!=NULL) estIdx.push_back(4*ng+2);
+        return !estIdx.empty();
+    }
+
+    static const char* componentModes() { return "xyza"; }
+    static const char* searchFormat() { return "[maxM alpha {x0 y0 z0 rxy rz}]"; }
+    static bool checkSearch(const int ns) { return ns==1 || ns==2 || ns==7; }
+
+    static void initComponent(const FitWindow& w, const int i, const double A, double* comp) {
+        comp[0] = w.x[i];
+        comp[1] = w.y[i];
+        comp[2] = w.z[i];
+        comp[3] = A;
+    }
+
+    // search region: bounds = [x0 y0 z0 rxy rz]; otherwise neighboring signals are
+    // considered part of the mixture
+    static bool inBounds(const double* prm, const int ng, const std::vector<double>& bounds) {
+        if (bounds.size() != 5) {
+            return true;
+        }
+        for (int i=0; i<ng; ++i) {
+            if (fabs(prm[4*i]-bounds[0]) > bounds[3] ||
+                fabs(prm[4*i+1]-bounds[1]) > bounds[3] ||
+                fabs(prm[4*i+2]-bounds[2]) > bounds[4]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void evaluate(const FitWindow& w, const double* prm, const int np, const int* estIdx, const int nparam,
+                  double* f, double* J) {
+
+        int nx = w.nx;
+        int ny = w.ny;
+        int nz = w.nz;
+        int i, k, gi;
+        int ng = np/4;
+
+        double sigma = fabs(prm[np-3]);
+        double rho = fabs(prm[np-2]);
+        double c = prm[np-1];
+        double sigma2 = sigma*sigma;
+        double sigma3 = sigma2*sigma;
+        double rho2 = rho*rho;
+        double rho3 = rho2*rho;
+        double s = 2.0*sigma2;
+        double r = 2.0*rho2;
+
+        // Jacobian column of each parameter, -1 if fixed
+        col_.assign(np, -1);
+        for (k=0; k<nparam; ++k) {
+            col_[estIdx[k]] = k;
+        }
+        int cs = col_[np-3];
+        int cr = col_[np-2];
+        int cc = col_[np-1];
+
+        // Gaussian kernels
+        gx_.resize(ng*nx);
+        gy_.resize(ng*ny);
+        gz_.resize(ng*nz);
+        double d;
+        for (gi=0; gi<ng; ++gi) {
+            for (i=0; i<nx; ++i) {
+                d = i-prm[4*gi];
+                gx_[gi*nx+i] = exp(-d*d/s);
+            }
+            for (i=0; i<ny; ++i) {
+                d = i-prm[4*gi+1];
+                gy_[gi*ny+i] = exp(-d*d/s);
+            }
+            for (i=0; i<nz; ++i) {
+                d = i-prm[4*gi+2];
+                gz_[gi*nz+i] = exp(-d*d/r);
+            }
+        }
+
+        double A, g, fi, xi, yi, zi, *Ji;
+        const int *cg;
+        int nValid = w.nValid();
+        for (i=0; i<nValid; ++i) {
+            fi = c - w.pixels[w.idx[i]]; // cost = Sum(Ai*gi)+c - pixels
+            Ji = J!=NULL ? J + i*nparam : NULL;
+            if (J!=NULL) {
+                if (cs>=0) Ji[cs] = 0.0;
+                if (cr>=0) Ji[cr] = 0.0;
+                if (cc>=0) Ji[cc] = 1.0;
+            }
+            for (gi=0; gi<ng; ++gi) {
+                A = fabs(prm[4*gi+3]);
+                g = gx_[gi*nx+w.x[i]]*gy_[gi*ny+w.y[i]]*gz_[gi*nz+w.z[i]];
+                fi += A*g;
+                if (J!=NULL) {
+                    xi = w.x[i] - prm[4*gi];
+                    yi = w.y[i] - prm[4*gi+1];
+                    zi = w.z[i] - prm[4*gi+2];
+                    cg = &col_[4*gi];
+                    if (cg[0]>=0) Ji[cg[0]] = A/sigma2*xi*g;
+                    if (cg[1]>=0) Ji[cg[1]] = A/sigma2*yi*g;
+                    if (cg[2]>=0) Ji[cg[2]] = A/rho2*zi*g;
+                    if (cg[3]>=0) Ji[cg[3]] = g;
+                    if (cs>=0) Ji[cs] += (xi*xi + yi*yi)*A/sigma3*g;
+                    if (cr>=0) Ji[cr] += zi*zi*A/rho3*g;
+                }
+            }
+            if (f!=NULL) {
+                f[i] = fi;
+            }
+        }
+    }
+
+private:
+    std::vector<double> gx_, gy_, gz_; // 1-D separated components of each Gaussian
+    std::vector<int> col_;
+};
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+    fitWindows<GaussianMixture3D>(nlhs, plhs, nrhs, prhs);
+}
@@ -1,5 +1,5 @@
 %FITGAUSSIANMIXTURE2D Fit a 3-D Gaussian mixture model to input volume
-%    [prmVect prmStd C res J] = fitGaussianMixture3D(data, prmVect, mode, options)
+%    [prmVect prmStd C res J] = fitGaussianMixture3D(data, prmVect, mode, options, search)
 %
 %    Symbols: xp : x-position
 %             yp : y-position
@@ -17,6 +17,11 @@
 %                       The number of tuples [xp yp zp A] determines the number of Gaussians. 
 %                mode : String that defines parameters to be optimized; any among 'xyzasrc'.
 %           {options} : Vector [maxIter eAbs eRel]; max. iterations, tolerances. See GSL documentation.
+%            {search} : Vector [maxM {alpha} {x0 y0 z0 rxy rz}]. Model order search: components are added
+%                       one at a time at the peak of the residual, starting from the solution of the
+%                       previous model, until the fit is no longer significantly improved (F-test at
+%                       level alpha, default 0.05), a component is further than rxy (x,y) or rz (z) from
+%                       (x0,y0,z0), or the model contains maxM components. The retained model is returned.
 %
 %    Voxels in 'data' that are set to NaN are ignored in the optimization.
 %
@@ -30,6 +35,12 @@
 %                         .std  : standard deviation of the residuals
 %                   J : Jacobian
 %
+%    Batch mode: if 'data' is a cell array of windows, 'prmVect' must be a matrix (one row per
+%    window) or a cell array. All windows are fitted in parallel; prmVect and prmStd are returned
+%    as matrices (one row per window), or as cell arrays if the model order search retained
+%    different numbers of components. C and J are returned as cell arrays, and res as a structure
+%    array. Windows with fewer valid pixels than parameters to estimate return NaN.
+%
 % Axis conventions: image processing, see meshgrid
 % For single Gaussian fitting, fitGaussian3D() is faster.
 %
@@ -152,55 +152,13 @@ for p = 1:np
     
     if npx >= 20 % only perform fit if window contains sufficient data points
 
-        % initial fit with a single Gaussian 
-        % Notation: reduced model: '_r', full model: '_f'
-        [prm_f, prmStd_f, ~, res_f] = fitGaussian3D(window, [X(p,1)-xi(p)+ox X(p,2)-yi(p)+oy X(p,3)-zi(p)+oz A(p) sigma(p,:) c(p)], mode);
-
-        % update standard deviations for xyzAc
-        prmStd_f = [prmStd_f(1:4) 0 0 prmStd_f(5)];
-        RSS_r = res_f.RSS;
-        
-        p_r = 5; % #parameters in the model (x,y,z,A,c)     
-        i = 1; % iteration
-        
-        pval = 0;
-        validBounds = true;
-        while i<ip.Results.maxM && pval<0.05 && validBounds % models are significantly different
-                
-            i = i+1;
-            prm_r = prm_f;
-            prmStd_r = prmStd_f;
-            res_r = res_f;
-            
-            % expanded model
-            % new component: initial values given by max. residual point
-            [maxRes, idx] = max(res_r.data(:));
-            [y0, x0, z0] = ind2sub(size(window), idx);
-            
-            initV = [x0-1 y0-1 z0-1 maxRes prm_r];
-            %initV(4:4:end-3) = sum(prm_r(4:4:end-3))/i; % may work better in some cases
-            [prm_f, prmStd_f, ~, res_f] = fitGaussianMixture3D(window, initV, mode);
-            
-            RSS_f = res_f.RSS;
-            p_f = p_r + 4; % 4 parameters (x,y,z,A) added at every iteration
-            
-            % test statistic (F-test)
-            T = (RSS_r-RSS_f)/RSS_f * (npx-p_f-1)/(p_f-p_r);
-            pval = 1-fcdf(T,p_f-p_r,npx-p_f-1);
-            
-            % update reduced model
-            p_r = p_f;
-            RSS_r = RSS_f;
-
-            % restrict radius; otherwise neighboring signals are considered part of mixture
-            dx = prm_f(1:4:end-3)-ox;
-            dy = prm_f(2:4:end-3)-oy;
-            dz = prm_f(3:4:end-3)-oz;
-            if min(dx)<-w2(1) || max(dx)>w2(1) || min(dy)<-w2(1) || max(dy)>w2(1) || min(dz)<-w2(2) || max(dz)>w2(2)
-                validBounds = false;
-            end
-        end
-        ng = i-1; % # gaussians in final model
+        % Fit with a single Gaussian, then add components at the residual peak as long as the
+        % fit improves significantly (F-test) and all components lie within w2 of (ox,oy,oz).
+        % Each model is initialized with the solution of the previous one.
+        [prm_r, prmStd_r, ~, res_r] = fitGaussianMixture3D(window,...
+            [X(p,1)-xi(p)+ox X(p,2)-yi(p)+oy X(p,3)-zi(p)+oz A(p) sigma(p,:) c(p)], mode,...
+            [], [ip.Results.maxM 0.05 ox oy oz w2(1) w2(2)]);
+        ng = (numel(prm_r)-3)/4; % # gaussians in final model
         
         % sigma, c are the same for each mixture
         x_est = prm_r(1:4:end-3)-ox;
@@ -135,8 +135,11 @@ elseif numel(ws)==1
     ws = [ws ws];
 end
 
-T = zeros(1,np);
-df2 = zeros(1,np);
+% extract the windows, then fit all of them in a single (parallel) call
+windows = cell(1,np);
+prmInit = zeros(np,7);
+npx = zeros(1,np);
+O = zeros(np,3);
 for p = 1:np
     
     % window boundaries
@@ -148,6 +151,7 @@ for p = 1:np
     ox = xi(p)-xa(1);
     oy = yi(p)-ya(1);
     oz = zi(p)-za(1);
+    O(p,:) = [ox oy oz];
     
     % label mask
     maskWindow = labels(ya, xa, za);
@@ -156,53 +160,63 @@ for p = 1:np
     window = vol(ya, xa, za);
     % set any other components to NaN
     window(maskWindow~=0) = NaN;
-    npx = sum(isfinite(window(:)));
+    npx(p) = sum(isfinite(window(:)));
     
-    if npx >= 20 % only perform fit if window contains sufficient data points
+    if npx(p) >= 20 % only perform fit if window contains sufficient data points
+        windows{p} = window;
+        prmInit(p,:) = [X(p,1)-xi(p)+ox X(p,2)-yi(p)+oy X(p,3)-zi(p)+oz A(p) sigma(p,:) c(p)];
+    end
+end
+fitIdx = find(~cellfun(@isempty, windows));
+[prmAll, prmStdAll, ~, resAll] = fitGaussian3D(windows(fitIdx), prmInit(fitIdx,:), mode);
+
+T = zeros(1,np);
+df2 = zeros(1,np);
+for k = 1:numel(fitIdx)
+    p = fitIdx(k);
+    prm = prmAll(k,:);
+    prmStd = prmStdAll(k,:);
+    res = resAll(k);
+    
+    dx = prm(1)-O(p,1);
+    dy = prm(2)-O(p,2);
+    dz = prm(3)-O(p,3);
+    
+    % exclude points where localization failed
+    if (dx > -w2(1) && dx < w2(1) && dy > -w2(1) && dy < w2(1) && dz > -w2(2) && dz < w2(2) && prm(4)<2*diff(iRange))
+        
+        pStruct.x(p) = xi(p) + dx;
+        pStruct.y(p) = yi(p) + dy;
+        pStruct.z(p) = zi(p) + dz;
+        pStruct.s(:,p) = prm(5:6);
+        pStruct.A(p) = prm(4);
+        pStruct.c(p) = prm(7);
+        
+        stdVect = zeros(1,7);
+        stdVect(estIdx) = prmStd;
+        
+        pStruct.x_pstd(p) = stdVect(1);
+        pStruct.y_pstd(p) = stdVect(2);
+        pStruct.z_pstd(p) = stdVect(3);
+        pStruct.A_pstd(p) = stdVect(4);
+        pStruct.s_pstd(:,p) = stdVect(5:6);
+        pStruct.c_pstd(p) = stdVect(7);
+        
+        pStruct.sigma_r(p) = res.std;
+        pStruct.RSS(p) = res.RSS;
         
-        % fit
-        [prm, prmStd, ~, res] = fitGaussian3D(window, [X(p,1)-xi(p)+ox X(p,2)-yi(p)+oy X(p,3)-zi(p)+oz A(p) sigma(p,:) c(p)], mode);
+        pStruct.SE_sigma_r(p) = res.std/sqrt(2*(npx(p)-1));
+        SE_sigma_r = pStruct.SE_sigma_r(p) * kLevel;
         
-        dx = prm(1)-ox;
-        dy = prm(2)-oy;
-        dz = prm(3)-oz;
+        pStruct.hval_AD(p) = res.hAD;
         
-        % exclude points where localization failed
-        if (dx > -w2(1) && dx < w2(1) && dy > -w2(1) && dy < w2(1) && dz > -w2(2) && dz < w2(2) && prm(4)<2*diff(iRange))
-            
-            pStruct.x(p) = xi(p) + dx;
-            pStruct.y(p) = yi(p) + dy;
-            pStruct.z(p) = zi(p) + dz;
-            pStruct.s(:,p) = prm(5:6);
-            pStruct.A(p) = prm(4);
-            pStruct.c(p) = prm(7);
-            
-            stdVect = zeros(1,7);
-            stdVect(estIdx) = prmStd;
-            
-            pStruct.x_pstd(p) = stdVect(1);
-            pStruct.y_pstd(p) = stdVect(2);
-            pStruct.z_pstd(p) = stdVect(3);
-            pStruct.A_pstd(p) = stdVect(4);
-            pStruct.s_pstd(:,p) = stdVect(5:6);
-            pStruct.c_pstd(p) = stdVect(7);
-            
-            pStruct.sigma_r(p) = res.std;
-            pStruct.RSS(p) = res.RSS;
-            
-            pStruct.SE_sigma_r(p) = res.std/sqrt(2*(npx-1));
-            SE_sigma_r = pStruct.SE_sigma_r(p) * kLevel;
-            
-            pStruct.hval_AD(p) = res.hAD;
-            
-            % H0: A <= k*sigma_r
-            % H1: A > k*sigma_r
-            sigma_A = stdVect(4);
-            A_est = prm(4);
-            df2(p) = (npx-1) * (sigma_A.^2 + SE_sigma_r.^2).^2 ./ (sigma_A.^4 + SE_sigma_r.^4);
-            scomb = sqrt((sigma_A.^2 + SE_sigma_r.^2)/npx);
-            T(p) = (A_est - res.std*kLevel) ./ scomb;
-        end
+        % H0: A <= k*sigma_r
+        % H1: A > k*sigma_r
+        sigma_A = stdVect(4);
+        A_est = prm(4);
+        df2(p) = (npx(p)-1) * (sigma_A.^2 + SE_sigma_r.^2).^2 ./ (sigma_A.^4 + SE_sigma_r.^4);
+        scomb = sqrt((sigma_A.^2 + SE_sigma_r.^2)/npx(p));
+        T(p) = (A_est - res.std*kLevel) ./ scomb;
     end
 end
 % 1-sided t-test: A_est must be greater than k*sigma_r
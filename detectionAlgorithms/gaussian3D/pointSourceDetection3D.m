@@ -20,7 +20,7 @@
 %   'RefineMaskValid' : true|{false}. Return only mask regions where a significant signal was localized.
 %        'ConfRadius' : Confidence radius for positions, beyond which the fit is rejected. Default: 2*sigma
 %        'WindowSize' : Window size for the fit. Default: 2*sigma, i.e., [-2*sigma ... 2*sigma]^2
-%'LocalMaxWindowSize' : Window size for locmax3d. Default: max(3,roundOddOrEven(ceil(2*sigma([1 1 2])),'odd'))
+%'LocalMaxWindowSize' : Window size for locmaxnd. Default: max(3,roundOddOrEven(ceil(2*sigma([1 1 2])),'odd'))
 %
 % Outputs:  
 %             pstruct : output structure with Gaussian parameters, standard deviations, p-values
@@ -141,34 +141,38 @@ mask([1 2 end-1 end],:,:) = 0;
 mask(:,[1 2 end-1 end],:) = 0;
 mask(:,:,[1 2 end-1 end]) = 0;
 
-% all local max
-allMax = locmax3d(imgLoG, localMaxWindowSize, 'ClearBorder', false);
-
-% local maxima above threshold in image domain
-imgLM = allMax .* mask;
+% local maxima above threshold in image domain (linear indexes)
+if ip.Results.RefineMaskLoG
+    % the mask is refined below from these maxima: keep all local maxima for the re-selection
+    [allMax, allVal] = locmaxnd(imgLoG, localMaxWindowSize, [], [], false, true);
+    lmIdx = allMax(mask(allMax));
+else
+    lmIdx = locmaxnd(imgLoG, localMaxWindowSize, mask, [], false, true);
+end
 
 pstruct = [];
-if sum(imgLM(:))~=0 % no local maxima found, likely a background image
+imgLM = zeros(size(vol));
+if ~isempty(lmIdx) % no local maxima found, likely a background image
     
     if ip.Results.RefineMaskLoG
         % -> set threshold in LoG domain
-        logThreshold = min(imgLoG(imgLM~=0));
+        logThreshold = min(allVal(mask(allMax)));
         logMask = imgLoG >= logThreshold;
         
         % combine masks
         mask = mask | logMask;
+        
+        % re-select local maxima
+        lmIdx = allMax(mask(allMax));
+        clear allMax allVal;
     end
     
-    % re-select local maxima
-    imgLM = allMax .* mask;
-    clear allMax;
-    
     % apply exclusion mask
     if ~isempty(ip.Results.Mask)
-        imgLM(ip.Results.Mask==0) = 0;
+        lmIdx = lmIdx(ip.Results.Mask(lmIdx)~=0);
     end
+    imgLM(lmIdx) = imgLoG(lmIdx);
     
-    lmIdx = find(imgLM~=0);
     [lmy,lmx,lmz] = ind2sub(size(vol), lmIdx);
     
     if ~isempty(lmIdx)
@@ -0,0 +1,165 @@
+/* [prmVect prmStd covarianceMatrix residuals Jacobian] = fitGaussianMixture2D(image, prmVect, mode, options, search);
+ *
+ * (c) Francois Aguet, 2011 (last modified 06/26/2012)
+ *
+ * If 'search' is specified, components are added one at a time (model order search): the (n+1)-component
+ * fit is initialized with the n-component solution and a new component at the peak of the residual,
+ * and is retained if it significantly improves the fit (F-test) and all components lie within the search radius.
+ *
+ * 'image' can be a cell array of windows, with 'prmVect' a matrix (one row per window) or a cell array;
+ * the windows are then fitted in parallel. See batchFit.h.
+ *
+ * Compilation:
+ * Mac/Linux: mex -I/usr/local/include -I../../mex/include -lgsl -lgslcblas CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" fitGaussianMixture2D.cpp
+ * Mac/Linux (static): mex -I/usr/local/include -I../../mex/include /usr/local/lib/libgsl.a /usr/local/lib/libgslcblas.a CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" fitGaussianMixture2D.cpp
+ * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT /openmp" -I"..\..\..\extern\mex\include\gsl-1.15" -I"..\..\mex\include" "..\..\..\extern\mex\lib\gsl.lib" "..\..\..\extern\mex\lib\cblas.lib" -output fitGaussianMixture2D fitGaussianMixture2D.cpp
+ */
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "batchFit.h"
+
+
+#define refMode "xyasc"
+
+
+// Parameter vector: [x1 y1 A1 ... xn yn An sigma c]
+class GaussianMixture2D : public FitModel {
+
+public:
+    static const int nd = 2;
+    static const int stop = STOP_DELTA_OR_GRADIENT;
+    static const int residualFormat = RES_STRUCT_AD_DOUBLE;
+    static const bool expandStd = true;
+    static const int componentSize = 3;
+    static const int sharedSize = 2;
+
+    static const char* checkWindow(const FitWindow& w) {
+        if (w.nx != w.ny) return "Input should be a square image.";
+        return NULL;
+    }
+
+    static bool readParameters(const double* v, const int n, std::vector<double>& prm) {
+        if (n < 2 || (n-2)%3 != 0) return false;
+        prm.assign(v, v+n);
+        return true;
+    }
+
+    static bool selectParameters(const char* mode, const int np, std::vector<int>& estIdx) {
+        int ng = (np-2)/3;
+        estIdx.clear();
+        for (int i=0; i<ng; ++i) {
+            for (int k=0; k<3; ++k) {
+                if (strchr(mode, refMode[k])!=NULL) {
+                    estIdx.push_back(3*i+k);
+                }
+            }
+        }
+        if (strchr(mode, 's')!=NULL) estIdx.push_back(3*ng);
+        if (strchr(mode, 'c')!=NULL) estIdx.push_back(3*ng+1);
+        return !estIdx.empty();
+    }
+
+    static const char* componentModes() { return "xya"; }
+    static const char* searchFormat() { return "[maxM alpha radius]"; }
+    static bool checkSearch(const int ns) { return ns >= 1 && ns <= 3; }
+
+    static void initComponent(const FitWindow& w, const int i, const double A, double* comp) {
+        int b = w.nx/2;
+        comp[0] = w.x[i]-b;
+        comp[1] = w.y[i]-b;
+        comp[2] = A;
+    }
+
+    // restrict radius (|x|,|y| <= radius; ignored if radius < 0); otherwise neighboring
+    // signals are considered part of the mixture
+    static bool inBounds(const double* prm, const int ng, const std::vector<double>& bounds) {
+        if (bounds.empty() || bounds[0] < 0.0) {
+            return true;
+        }
+        for (int i=0; i<ng; ++i) {
+            if (fabs(prm[3*i]) > bounds[0] || fabs(prm[3*i+1]) > bounds[0]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void evaluate(const FitWindow& w, const double* prm, const int np, const int* estIdx, const int nparam,
+                  double* f, double* J) {
+
+        int nx = w.nx;
+        int b = nx/2, i, k, gi;
+        int ng = (np-2)/3;
+
+        double sigma = fabs(prm[np-2]);
+        double sigma2 = sigma*sigma;
+        double sigma3 = sigma2*sigma;
+        double d = 2.0*sigma2;
+        double c = prm[np-1];
+
+        // Jacobian column of each parameter, -1 if fixed
+        col_.assign(np, -1);
+        for (k=0; k<nparam; ++k) {
+            col_[estIdx[k]] = k;
+        }
+        int cs = col_[np-2];
+        int cc = col_[np-1];
+
+        // x and y components of the Gaussian kernels
+        gx_.resize(ng*nx);
+        gy_.resize(ng*nx);
+        double xp, yp, xi, yi;
+        for (gi=0; gi<ng; ++gi) {
+            xp = prm[3*gi];
+            yp = prm[3*gi+1];
+            for (i=0; i<nx; ++i) {
+                k = i-b;
+                xi = k-xp;
+                yi = k-yp;
+                gx_[gi*nx+i] = exp(-xi*xi/d);
+                gy_[gi*nx+i] = exp(-yi*yi/d);
+            }
+        }
+
+        double A, g, fi, *Ji;
+        const int *cg;
+        int nValid = w.nValid();
+        for (i=0; i<nValid; ++i) {
+            fi = c - w.pixels[w.idx[i]];
+            Ji = J!=NULL ? J + i*nparam : NULL;
+            if (J!=NULL) {
+                if (cs>=0) Ji[cs] = 0.0;
+                if (cc>=0) Ji[cc] = 1.0;
+            }
+            for (gi=0; gi<ng; ++gi) {
+                A = fabs(prm[3*gi+2]);
+                g = gx_[gi*nx+w.x[i]]*gy_[gi*nx+w.y[i]];
+                fi += A*g;
+                if (J!=NULL) {
+                    xi = w.x[i]-b - prm[3*gi];
+                    yi = w.y[i]-b - prm[3*gi+1];
+                    cg = &col_[3*gi];
+                    if (cg[0]>=0) Ji[cg[0]] = A/sigma2*xi*g;
+                    if (cg[1]>=0) Ji[cg[1]] = A/sigma2*yi*g;
+                    if (cg[2]>=0) Ji[cg[2]] = g;
+                    if (cs>=0) Ji[cs] += (xi*xi + yi*yi)*A/sigma3*g;
+                }
+            }
+            if (f!=NULL) {
+                f[i] = fi;
+            }
+        }
+    }
+
+private:
+    std::vector<double> gx_, gy_; // 1-D separated components of each Gaussian: exp(-(x-x0)^2/(2*sigma^2))
+    std::vector<int> col_;
+};
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+    fitWindows<GaussianMixture2D>(nlhs, plhs, nrhs, prhs);
+}
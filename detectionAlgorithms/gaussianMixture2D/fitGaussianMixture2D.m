@@ -1,5 +1,5 @@
 %FITGAUSSIANMIXTURE2D Fit a 2-D Gaussian mixture model to data in a square image window.
-%    [prmVect prmStd C res J] = fitGaussianMixture2D(data, prmVect, mode, options)
+%    [prmVect prmStd C res J] = fitGaussianMixture2D(data, prmVect, mode, options, search)
 %
 %    Symbols: xp : x-position
 %             yp : y-position
@@ -14,6 +14,11 @@
 %                       The number of triplets [xp yp A] determines the number of Gaussians. 
 %                mode : String that defines parameters to be optimized; any among 'xyasc'.
 %           {options} : Vector [maxIter eAbs eRel]; max. iterations, tolerances. See GSL documentation.
+%            {search} : Vector [maxM {alpha} {radius}]. Model order search: components are added one at
+%                       a time at the peak of the residual, starting from the solution of the previous
+%                       model, until the fit is no longer significantly improved (F-test at level alpha,
+%                       default 0.05), a component is further than 'radius' from the origin in x or y,
+%                       or the model contains maxM components. The retained model is returned.
 %
 %    Pixels in 'data' that are set to NaN are masked in the optimization.
 %
@@ -27,6 +32,12 @@
 %                         .std  : standard deviation of the residuals
 %                   J : Jacobian
 %
+%    Batch mode: if 'data' is a cell array of windows, 'prmVect' must be a matrix (one row per
+%    window) or a cell array. All windows are fitted in parallel; prmVect and prmStd are returned
+%    as matrices (one row per window), or as cell arrays if the model order search retained
+%    different numbers of components. C and J are returned as cell arrays, and res as a structure
+%    array. Windows with fewer valid pixels than parameters to estimate return NaN.
+%
 % Axis conventions: image processing, see meshgrid
 % For single Gaussian mixture fitting, fitGaussian2D() is faster.
 %
@@ -144,54 +144,12 @@ for p = 1:np
             A0 = A(p);
         end
 
-        % initial fit with a single Gaussian 
-        % Notation: reduced model: '_r', full model: '_f'
-        [prm_f, prmStd_f, ~, res_f] = fitGaussian2D(window, [x(p)-xi(p) y(p)-yi(p) A0 sigma(p) c0], 'xyAc');
-        prmStd_f = [prmStd_f(1:3) 0 prmStd_f(4)]; % update standard deviations
-        RSS_r = res_f.RSS;
-        
-        p_r = 4; % #parameters in the model (x,y,A,c)     
-        i = 1; % iteration
-        
-        pval = 0;
-        validBounds = true;
-        while i<ip.Results.maxM && pval<0.05 && validBounds % models are significantly different
-                
-            i = i+1;
-            prm_r = prm_f;
-            prmStd_r = prmStd_f;
-            res_r = res_f;
-            
-            % expanded model
-            % new component: initial values given by max. residual point
-            [y0, x0] = find(res_r.data==max(res_r.data(:)), 1, 'first');
-            
-            % This initialization may work better in some cases:
-            %initV = [x0-w4-1 y0-w4-1 max(res_r.data(:)) prm_r];
-            %initV(3:3:end-2) = sum(prm_r(3:3:end-2))/i;
-            %[prm_f, prmStd_f, ~, res_f] = fitGaussianMixture2D(window, initV, 'xyAc');
-            
-            [prm_f, prmStd_f, ~, res_f] = fitGaussianMixture2D(window, [x0-w4-1 y0-w4-1 max(res_r.data(:)) prm_r], 'xyAc');
-            
-            RSS_f = res_f.RSS;
-            p_f = p_r + 3; % 3 parameters (x,y,A) added at every iteration
-            
-            % test statistic (F-test)
-            T = (RSS_r-RSS_f)/RSS_f * (npx-p_f-1)/(p_f-p_r);
-            pval = 1-fcdf(T,p_f-p_r,npx-p_f-1);
-            
-            % update reduced model
-            p_r = p_f;
-            RSS_r = RSS_f;
-            
-            % restrict radius; otherwise neighboring signals are considered part of mixture
-            if min(prm_f(1:3:end-2))<-w2 || max(prm_f(1:3:end-2))>w2 ||...
-                    min(prm_f(2:3:end-2))<-w2 || max(prm_f(2:3:end-2))>w2
-                validBounds = false;
-            end
-            
-        end
-        ng = i-1; % # gaussians in final model
+        % Fit with a single Gaussian, then add components at the residual peak as long as the
+        % fit improves significantly (F-test) and all components lie within w2 of the window center.
+        % Each model is initialized with the solution of the previous one.
+        [prm_r, prmStd_r, ~, res_r] = fitGaussianMixture2D(window, [x(p)-xi(p) y(p)-yi(p) A0 sigma(p) c0], 'xyAc',...
+            [], [ip.Results.maxM 0.05 w2]);
+        ng = (numel(prm_r)-2)/3; % # gaussians in final model
         
         % sigma, c are the same for each mixture
         x_est = prm_r(1:3:end-2);
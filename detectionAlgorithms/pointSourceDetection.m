@@ -110,35 +110,38 @@ else
     mask = true(size(img));
 end
 
-% all local max
-allMax = locmax2d(imgLoG, 2*ceil(sigma)+1);
-
-% local maxima above threshold in image domain
-imgLM = allMax .* mask;
+% local maxima above threshold in image domain (linear indexes)
+if ip.Results.RefineMaskLoG
+    % the mask is refined below from these maxima: keep all local maxima for the re-selection
+    [allMax, allVal] = locmaxnd(imgLoG, 2*ceil(sigma)+1);
+    lmIdx = allMax(mask(allMax));
+else
+    lmIdx = locmaxnd(imgLoG, 2*ceil(sigma)+1, mask);
+end
 
 pstruct = [];
-if sum(imgLM(:))~=0 % no local maxima found, likely a background image
+imgLM = zeros(size(img));
+if ~isempty(lmIdx) % no local maxima found, likely a background image
     
     if ip.Results.RefineMaskLoG
         % -> set threshold in LoG domain
-        logThreshold = min(imgLoG(imgLM~=0));
+        logThreshold = min(allVal(mask(allMax)));
         logMask = imgLoG >= logThreshold;
         
         % combine masks
         mask = mask | logMask;
+        
+        % re-select local maxima
+        lmIdx = allMax(mask(allMax));
     end
     
-    % re-select local maxima
-    imgLM = allMax .* mask;
-    
     % apply exclusion mask
     if ~isempty(ip.Results.Mask)
-        imgLM(ip.Results.Mask==0) = 0;
+        lmIdx = lmIdx(ip.Results.Mask(lmIdx)~=0);
     end
+    imgLM(lmIdx) = imgLoG(lmIdx);
     
-    
-    [lmy, lmx] = find(imgLM~=0);
-    lmIdx = sub2ind(size(img), lmy, lmx);    
+    [lmy, lmx] = ind2sub(size(img), lmIdx);
     
     if ~isempty(lmIdx)
         % run localization on local maxima
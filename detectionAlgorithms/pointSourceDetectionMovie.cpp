@@ -0,0 +1,855 @@
+/* movieInfo = pointSourceDetectionMovie(readFcn, maskFcn, nFrames, sigma, options);
+ *
+ * Frame-parallel implementation of pointSourceDetection (without mixture-model fitting)
+ * for an entire movie. Frames are read through 'readFcn' by the main thread (the only thread
+ * allowed to call MATLAB) into a bounded ring buffer, while worker threads run the filtering,
+ * local maxima and fitting stages. Completed frames are written to 'movieInfo' in order.
+ * When the ring buffer is full, the main thread processes frames itself.
+ * The filters are computed with separableConvolution.h, and the spots are fitted with the
+ * model of fitGaussian2D (gaussian2DModel.h, batchFit.h).
+ *
+ * See pointSourceDetectionMovie.m for documentation.
+ *
+ * Compilation:
+ * Mac/Linux: mex -I/usr/local/include -I../mex/include CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" /usr/local/lib/libgsl.a /usr/local/lib/libgslcblas.a pointSourceDetectionMovie.cpp
+ * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT /openmp" -I"..\..\extern\mex\include\gsl-1.15" -I"..\mex\include" "..\..\extern\mex\lib\gsl.lib" "..\..\extern\mex\lib\cblas.lib" -output pointSourceDetectionMovie pointSourceDetectionMovie.cpp
+ */
+
+#include <cstring>
+#include <cctype>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <gsl/gsl_cdf.h>
+
+#include "mex.h"
+#include "gaussian2DModel.h"
+#include "separableConvolution.h"
+#include "maxFilter.h"
+#include "connectedComponents.h"
+
+using namespace std;
+
+#define PI 3.14159265358979323846
+#define NPARAMS 5
+
+// output fields: 1xN double vectors, followed by logical vectors and Nx2 [value std] pairs
+#define NDFIELDS 17
+#define NLFIELDS 3
+#define NPFIELDS 6
+static const char* fieldNames[] = {"x", "y", "A", "s", "c",
+    "x_pstd", "y_pstd", "A_pstd", "s_pstd", "c_pstd",
+    "x_init", "y_init", "sigma_r", "SE_sigma_r", "RSS", "pval_Ar", "mask_Ar",
+    "hval_Ar", "hval_AD", "isPSF",
+    "xCoord", "yCoord", "amp", "sigmaX", "sigmaY", "bkg"};
+// field indexes of the value/std pairs
+static const int pairIdx[NPFIELDS][2] = {{0,5}, {1,6}, {2,7}, {3,8}, {3,8}, {4,9}};
+
+enum {F_X, F_Y, F_A, F_S, F_C, F_X_PSTD, F_Y_PSTD, F_A_PSTD, F_S_PSTD, F_C_PSTD, F_X_INIT, F_Y_INIT, F_SIGMA_R, F_SE_SIGMA_R, F_RSS, F_PVAL_AR, F_MASK_AR};
+enum {F_HVAL_AR, F_HVAL_AD, F_ISPSF};
+
+
+typedef struct parameters {
+    double sigma;
+    double alpha;
+    double kLevel;
+    char mode[NPARAMS+1];
+    int confRadius; // w2 in fitGaussians2D
+    int windowSize; // w4 in fitGaussians2D
+    bool prefilter;
+    bool refineMaskLoG;
+    bool removeRedundant;
+    double redundancyRadius;
+    double maxIter, eAbs, eRel;
+} parameters_t;
+
+
+// Detection results for one frame
+class FrameResult {
+public:
+    vector<double> dfield[NDFIELDS];
+    vector<bool> lfield[NLFIELDS];
+    size_t size() const { return dfield[F_X].size(); }
+};
+
+
+// The MEX API is not thread-safe: code run by the worker threads uses these instead of
+// mxGetNaN()/mxIsNaN()
+static const double NaN = numeric_limits<double>::quiet_NaN();
+
+static inline bool isNaN(const double v) {
+    return v!=v;
+}
+
+
+static double tcdf(const double t, const double df) {
+    if (isNaN(t) || !(df>0.0)) {
+        return NaN;
+    }
+    return gsl_cdf_tdist_P(t, df);
+}
+
+
+// pointSourceDetection for a single frame
+static void detectFrame(const double* img, const bool* userMask, const int ny, const int nx, const parameters_t& prm, FrameResult& result) {
+
+    size_t N = (size_t)nx*ny;
+    double sigma = prm.sigma;
+    double s2 = sigma*sigma;
+
+    // Gaussian kernel, as half-kernels (see separableConvolution.h)
+    int w = (int)ceil(4.0*sigma);
+    int nk = 2*w+1;
+    vector<double> g(w+1), u(w+1, 1.0), gx2(w+1);
+    double g1sum = 0.0, g1sum2 = 0.0;
+    for (int i=0; i<=w; ++i) {
+        g[i] = exp(-i*i/(2.0*s2));
+        gx2[i] = g[i]*i*i;
+        double m = i==0 ? 1.0 : 2.0;
+        g1sum += m*g[i];
+        g1sum2 += m*g[i]*g[i];
+    }
+
+    // convolutions with symmetric padding (cf. conv2 and padarrayXT): along columns, then rows
+    const int border = sepconv::SYMMETRIC;
+    vector<double> buffer(N), fg(N), fu(N), fu2(N), imgLoG(N), tmp(N), img2(N);
+    for (size_t i=0; i<N; ++i) {
+        img2[i] = img[i]*img[i];
+    }
+    const double* kernels[2] = {&g[0], &gx2[0]};
+    int nks[2] = {w+1, w+1};
+    bool odd[2] = {false, false};
+    double* outputs[2] = {&fg[0], &imgLoG[0]};
+    sepconv::convolve(img, ny, nx, 1, 0, &g[0], w+1, false, border, &buffer[0]);
+    sepconv::convolveMulti(&buffer[0], ny, nx, 1, 1, 2, kernels, nks, odd, border, outputs);
+    sepconv::convolve(img, ny, nx, 1, 0, &u[0], w+1, false, border, &buffer[0]);
+    sepconv::convolve(&buffer[0], ny, nx, 1, 1, &u[0], w+1, false, border, &fu[0]);
+    sepconv::convolve(&img2[0], ny, nx, 1, 0, &u[0], w+1, false, border, &buffer[0]);
+    sepconv::convolve(&buffer[0], ny, nx, 1, 1, &u[0], w+1, false, border, &fu2[0]);
+
+    // Laplacian of Gaussian: imgLoG holds the x^2 term, tmp the y^2 term
+    sepconv::convolve(img, ny, nx, 1, 0, &gx2[0], w+1, false, border, &buffer[0]);
+    sepconv::convolve(&buffer[0], ny, nx, 1, 1, &g[0], w+1, false, border, &tmp[0]);
+    for (size_t i=0; i<N; ++i) {
+        imgLoG[i] = (2.0*fg[i]/s2 - (imgLoG[i]+tmp[i])/(s2*s2)) / (2.0*PI*s2);
+    }
+
+    // 2-D kernel
+    double n = (double)nk*nk;
+    double gsum = g1sum*g1sum;
+    double g2sum = g1sum2*g1sum2;
+
+    // solution to linear system
+    vector<double> A_est(N), c_est(N);
+    for (size_t i=0; i<N; ++i) {
+        A_est[i] = (fg[i] - gsum*fu[i]/n) / (g2sum - gsum*gsum/n);
+        c_est[i] = (fu[i] - A_est[i]*gsum)/n;
+    }
+
+    vector<bool> mask(N, true);
+    if (prm.prefilter) {
+        double C11 = n/(n*g2sum - gsum*gsum); // inv(J'*J)(1,1)
+        for (size_t i=0; i<N; ++i) {
+            double f_c = fu2[i] - 2.0*c_est[i]*fu[i] + n*c_est[i]*c_est[i];
+            double RSS = A_est[i]*A_est[i]*g2sum - 2.0*A_est[i]*(fg[i] - c_est[i]*gsum) + f_c;
+            if (RSS<0.0) {
+                RSS = 0.0;
+            }
+            double sigma_A = sqrt(RSS/(n-3.0)*C11);
+            double sigma_res = sqrt(RSS/(n-1.0));
+            double SE_sigma_c = sigma_res/sqrt(2.0*(n-1.0)) * prm.kLevel;
+            double sA2 = sigma_A*sigma_A, SE2 = SE_sigma_c*SE_sigma_c;
+            double df2 = (n-1.0) * (sA2+SE2)*(sA2+SE2) / (sA2*sA2 + SE2*SE2);
+            double scomb = sqrt((sA2+SE2)/n);
+            double T = (A_est[i] - sigma_res*prm.kLevel) / scomb;
+            mask[i] = tcdf(-T, df2) < 0.05;
+        }
+    }
+
+    // all local maxima
+    int dims[2] = {ny, nx};
+    int r[2] = {(int)ceil(sigma), (int)ceil(sigma)};
+    vector<size_t> allMax, lmIdx;
+    findLocalMaxima(&imgLoG[0], 2, dims, r, (const bool*)NULL, -numeric_limits<double>::max(), true, false, &buffer[0], allMax);
+
+    // local maxima above threshold in image domain
+    for (size_t k=0; k<allMax.size(); ++k) {
+        if (mask[allMax[k]]) {
+            lmIdx.push_back(allMax[k]);
+        }
+    }
+    if (lmIdx.empty()) {
+        return;
+    }
+    if (prm.refineMaskLoG) {
+        // -> set threshold in LoG domain
+        double logThreshold = imgLoG[lmIdx[0]];
+        for (size_t k=1; k<lmIdx.size(); ++k) {
+            logThreshold = min(logThreshold, imgLoG[lmIdx[k]]);
+        }
+        for (size_t i=0; i<N; ++i) {
+            mask[i] = mask[i] || imgLoG[i]>=logThreshold;
+        }
+    }
+    // re-select local maxima, apply exclusion mask
+    lmIdx.clear();
+    for (size_t k=0; k<allMax.size(); ++k) {
+        if (mask[allMax[k]] && (userMask==NULL || userMask[allMax[k]])) {
+            lmIdx.push_back(allMax[k]);
+        }
+    }
+    size_t np = lmIdx.size();
+    if (np==0) {
+        return;
+    }
+
+    //-------------------------------------------------------------------------
+    // fitGaussians2D
+    //-------------------------------------------------------------------------
+    vector<int> labels;
+    labelComponents(mask, ny, nx, labels);
+
+    double iMin = numeric_limits<double>::max(), iMax = -numeric_limits<double>::max();
+    for (size_t i=0; i<N; ++i) {
+        if (!isNaN(img[i])) {
+            iMin = min(iMin, img[i]);
+            iMax = max(iMax, img[i]);
+        }
+    }
+    int w2 = prm.confRadius;
+    int w4 = prm.windowSize;
+    int wn = 2*w4+1;
+    vector<double> gw(wn*wn);
+    for (int i=0; i<wn; ++i) {
+        for (int j=0; j<wn; ++j) {
+            gw[i+j*wn] = exp(-((i-w4)*(i-w4))/(2.0*s2)) * exp(-((j-w4)*(j-w4))/(2.0*s2));
+        }
+    }
+
+    // fitGaussian2D, one workspace per frame
+    FitOptions opts;
+    opts.maxIter = (int)prm.maxIter;
+    opts.eAbs = prm.eAbs;
+    opts.eRel = prm.eRel;
+    opts.mode = prm.mode;
+    BatchFitter<Gaussian2D> fitter(opts);
+    FitWindow fw;
+    FitResult fr;
+    Gaussian2D::selectParameters(prm.mode, NPARAMS, fr.estIdx);
+    vector<double> stdVect;
+
+    vector<double> fit[NDFIELDS];
+    for (int f=0; f<NDFIELDS; ++f) {
+        fit[f].assign(np, NaN);
+    }
+    fit[F_MASK_AR].assign(np, 0.0);
+    vector<bool> hval_AD(np, false);
+    vector<double> T(np, 0.0), df2(np, 0.0);
+    vector<double> window(wn*wn);
+
+    for (size_t p=0; p<np; ++p) {
+        int yi = (int)(lmIdx[p] % ny); // 0-based
+        int xi = (int)(lmIdx[p] / ny);
+        fit[F_X_INIT][p] = xi+1;
+        fit[F_Y_INIT][p] = yi+1;
+
+        // ignore points in border
+        if (xi<w4 || xi>=nx-w4 || yi<w4 || yi>=ny-w4) {
+            continue;
+        }
+        // set any other components to NaN
+        int lc = labels[lmIdx[p]];
+        int npx = 0;
+        for (int j=0; j<wn; ++j) {
+            for (int i=0; i<wn; ++i) {
+                size_t k = (yi-w4+i) + (size_t)(xi-w4+j)*ny;
+                double v = img[k];
+                if (labels[k]!=0 && labels[k]!=lc) {
+                    v = NaN;
+                }
+                window[i+j*wn] = v;
+                npx += !isNaN(v);
+            }
+        }
+        // only perform fit if window contains sufficient data points
+        if (npx < 10) {
+            continue;
+        }
+        double init[NPARAMS] = {0.0, 0.0, A_est[lmIdx[p]], sigma, c_est[lmIdx[p]]};
+        fw.set(&window[0], wn, wn, 1);
+        fr.prm.assign(init, init+NPARAMS);
+        fitter.fit(fw, fr, true);
+        const double* prmVect = &fr.prm[0];
+        double resStd = fr.resStd;
+
+        double dx = prmVect[0];
+        double dy = prmVect[1];
+        // exclude points where localization failed
+        if (dx > -w2 && dx < w2 && dy > -w2 && dy < w2 && prmVect[2] < 2.0*(iMax-iMin)) {
+            fit[F_X][p] = xi+1 + dx;
+            fit[F_Y][p] = yi+1 + dy;
+            fit[F_A][p] = prmVect[2];
+            fit[F_S][p] = prmVect[3];
+            fit[F_C][p] = prmVect[4];
+
+            // standard deviations of all parameters, 0 for fixed parameters
+            getStd(fr, true, stdVect);
+            for (int k=0; k<NPARAMS; ++k) {
+                fit[F_X_PSTD+k][p] = stdVect[k];
+            }
+            fit[F_SIGMA_R][p] = resStd;
+            fit[F_RSS][p] = fr.RSS;
+            fit[F_SE_SIGMA_R][p] = resStd/sqrt(2.0*(npx-1));
+            double SE_sigma_r = fit[F_SE_SIGMA_R][p] * prm.kLevel;
+            hval_AD[p] = fr.hAD!=0;
+
+            // H0: A <= k*sigma_r
+            // H1: A > k*sigma_r
+            double sA2 = stdVect[2]*stdVect[2], SE2 = SE_sigma_r*SE_sigma_r;
+            df2[p] = (npx-1) * (sA2+SE2)*(sA2+SE2) / (sA2*sA2 + SE2*SE2);
+            double scomb = sqrt((sA2+SE2)/npx);
+            T[p] = (prmVect[2] - resStd*prm.kLevel) / scomb;
+            int count = 0;
+            for (int k=0; k<wn*wn; ++k) {
+                count += prmVect[2]*gw[k] > resStd*prm.kLevel;
+            }
+            fit[F_MASK_AR][p] = count;
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    // Selection (cf. pointSourceDetection)
+    //-------------------------------------------------------------------------
+    // remove NaN values
+    vector<size_t> valid;
+    for (size_t p=0; p<np; ++p) {
+        if (!isNaN(fit[F_X][p])) {
+            valid.push_back(p);
+        }
+    }
+    size_t nv = valid.size();
+    if (nv==0) {
+        return;
+    }
+
+    // 1-sided t-test: A_est must be greater than k*sigma_r
+    vector<bool> keep(nv);
+    for (size_t k=0; k<nv; ++k) {
+        size_t p = valid[k];
+        fit[F_PVAL_AR][p] = tcdf(-T[p], df2[p]);
+        keep[k] = fit[F_PVAL_AR][p] < 0.05;
+    }
+
+    // eliminate duplicate positions (resulting from localization)
+    if (prm.removeRedundant) {
+        double r2 = prm.redundancyRadius*prm.redundancyRadius;
+        vector< pair<double,size_t> > order(nv);
+        for (size_t k=0; k<nv; ++k) {
+            order[k] = make_pair(fit[F_X][valid[k]], k);
+        }
+        sort(order.begin(), order.end());
+        vector<size_t> group;
+        for (size_t a=0; a<nv; ++a) {
+            size_t ka = order[a].second;
+            size_t pa = valid[ka];
+            group.clear();
+            // ball query around point a, including itself
+            size_t b0 = a;
+            while (b0>0 && order[a].first-order[b0-1].first <= prm.redundancyRadius) {
+                b0--;
+            }
+            for (size_t b=b0; b<nv && order[b].first-order[a].first <= prm.redundancyRadius; ++b) {
+                size_t pb = valid[order[b].second];
+                double dx = fit[F_X][pa]-fit[F_X][pb];
+                double dy = fit[F_Y][pa]-fit[F_Y][pb];
+                if (dx*dx+dy*dy <= r2) {
+                    group.push_back(order[b].second);
+                }
+            }
+            if (group.size()>1) {
+                double minRSS = numeric_limits<double>::max();
+                for (size_t k=0; k<group.size(); ++k) {
+                    minRSS = min(minRSS, fit[F_RSS][valid[group[k]]]);
+                }
+                for (size_t k=0; k<group.size(); ++k) {
+                    if (fit[F_RSS][valid[group[k]]] != minRSS) {
+                        keep[group[k]] = false;
+                    }
+                }
+            }
+        }
+    }
+
+    for (size_t k=0; k<nv; ++k) {
+        if (keep[k]) {
+            size_t p = valid[k];
+            for (int f=0; f<NDFIELDS; ++f) {
+                result.dfield[f].push_back(fit[f][p]);
+            }
+            result.lfield[F_HVAL_AR].push_back(true);
+            result.lfield[F_HVAL_AD].push_back(hval_AD[p]);
+            result.lfield[F_ISPSF].push_back(!hval_AD[p]);
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Pipeline
+//-----------------------------------------------------------------------------
+
+enum slotState {FREE, READY, BUSY};
+
+typedef struct slot {
+    int frame;
+    slotState state;
+    vector<double> pixels;
+    vector<bool> maskData; // packed storage, expanded on processing
+    bool hasMask;
+} slot_t;
+
+
+static void waitBriefly() {
+#if defined(_WIN32) || defined(_WIN64)
+    Sleep(1);
+#else
+    usleep(200);
+#endif
+}
+
+
+class Pipeline {
+public:
+    Pipeline(int nSlots, int nFrames, const parameters_t& prm) : slots_(nSlots), results_(nFrames, (FrameResult*)NULL),
+        done_(nFrames, false), allRead_(false), abort_(false), prm_(prm), nx_(0), ny_(0) {
+        for (int i=0; i<nSlots; ++i) {
+            slots_[i].state = FREE;
+            slots_[i].frame = -1;
+        }
+#ifdef _OPENMP
+        omp_init_lock(&lock_);
+#endif
+    }
+
+    ~Pipeline() {
+        for (size_t t=0; t<results_.size(); ++t) {
+            delete results_[t];
+        }
+#ifdef _OPENMP
+        omp_destroy_lock(&lock_);
+#endif
+    }
+
+    void lock() {
+#ifdef _OPENMP
+        omp_set_lock(&lock_);
+#endif
+    }
+
+    void unlock() {
+#ifdef _OPENMP
+        omp_unset_lock(&lock_);
+#endif
+    }
+
+    // returns the index of a free slot, or -1
+    int freeSlot() {
+        int s = -1;
+        lock();
+        for (size_t i=0; i<slots_.size(); ++i) {
+            if (slots_[i].state==FREE) {
+                s = (int)i;
+                break;
+            }
+        }
+        unlock();
+        return s;
+    }
+
+    // claims the ready slot with the lowest frame index, or returns -1
+    int claimSlot() {
+        int s = -1;
+        lock();
+        for (size_t i=0; i<slots_.size(); ++i) {
+            if (slots_[i].state==READY && (s==-1 || slots_[i].frame<slots_[s].frame)) {
+                s = (int)i;
+            }
+        }
+        if (s!=-1) {
+            slots_[s].state = BUSY;
+        }
+        unlock();
+        return s;
+    }
+
+    void process(int s) {
+        slot_t& sl = slots_[s];
+        FrameResult* result = new FrameResult();
+        if (!aborted()) {
+            bool* mask = NULL;
+            if (sl.hasMask) {
+                mask = new bool[sl.maskData.size()];
+                for (size_t i=0; i<sl.maskData.size(); ++i) {
+                    mask[i] = sl.maskData[i];
+                }
+            }
+            detectFrame(&sl.pixels[0], mask, ny_, nx_, prm_, *result);
+            delete[] mask;
+        }
+        lock();
+        results_[sl.frame] = result;
+        done_[sl.frame] = true;
+        sl.state = FREE;
+        unlock();
+    }
+
+    // abort_ is set by the main thread while workers are running: always access it under the lock
+    bool aborted() {
+        lock();
+        bool a = abort_;
+        unlock();
+        return a;
+    }
+
+    void abort() {
+        lock();
+        abort_ = true;
+        unlock();
+    }
+
+    bool isDone(int t) {
+        lock();
+        bool d = done_[t];
+        unlock();
+        return d;
+    }
+
+    // worker threads: process frames until all frames have been read and processed
+    void work() {
+        while (true) {
+            int s = claimSlot();
+            if (s!=-1) {
+                process(s);
+            } else {
+                lock();
+                bool finished = allRead_ || abort_;
+                unlock();
+                if (finished && claimPending()==false) {
+                    break;
+                }
+                waitBriefly();
+            }
+        }
+    }
+
+    bool claimPending() {
+        lock();
+        bool pending = false;
+        for (size_t i=0; i<slots_.size(); ++i) {
+            pending = pending || slots_[i].state==READY;
+        }
+        unlock();
+        return pending;
+    }
+
+    vector<slot_t> slots_;
+    vector<FrameResult*> results_;
+    vector<bool> done_;
+    bool allRead_;
+    bool abort_;
+    string errorMsg_;
+    parameters_t prm_;
+    int nx_, ny_;
+#ifdef _OPENMP
+    omp_lock_t lock_;
+#endif
+};
+
+
+static void setErrorMessage(Pipeline& pl, const char* prefix, mxArray* exception) {
+    pl.errorMsg_ = prefix;
+    mxArray* msg = mxGetProperty(exception, 0, "message");
+    if (msg!=NULL) {
+        char* str = mxArrayToString(msg);
+        pl.errorMsg_ += str;
+        mxFree(str);
+        mxDestroyArray(msg);
+    }
+    mxDestroyArray(exception);
+}
+
+
+// Reads frame t into slot s; returns false on error (main thread only)
+static bool readFrame(Pipeline& pl, const mxArray* readFcn, const mxArray* maskFcn, int t, int s) {
+    slot_t& sl = pl.slots_[s];
+    mxArray* tArray = mxCreateDoubleScalar(t+1);
+    mxArray* rhs[2] = {(mxArray*)readFcn, tArray};
+    mxArray* frame = NULL;
+    mxArray* err = mexCallMATLABWithTrap(1, &frame, 2, rhs, "feval");
+    if (err!=NULL) {
+        setErrorMessage(pl, "Error while reading frame through readFcn: ", err);
+        mxDestroyArray(tArray);
+        return false;
+    }
+    if (mxGetNumberOfDimensions(frame)!=2 || !mxIsNumeric(frame)) {
+        pl.errorMsg_ = "readFcn must return a 2D numeric array.";
+        mxDestroyArray(frame);
+        mxDestroyArray(tArray);
+        return false;
+    }
+    int ny = (int)mxGetM(frame);
+    int nx = (int)mxGetN(frame);
+    if (pl.nx_==0) {
+        pl.nx_ = nx;
+        pl.ny_ = ny;
+    } else if (nx!=pl.nx_ || ny!=pl.ny_) {
+        pl.errorMsg_ = "All frames must have the same dimensions.";
+        mxDestroyArray(frame);
+        mxDestroyArray(tArray);
+        return false;
+    }
+    size_t N = (size_t)nx*ny;
+    sl.pixels.resize(N);
+    if (mxIsDouble(frame)) {
+        memcpy(&sl.pixels[0], mxGetPr(frame), N*sizeof(double));
+    } else {
+        // convert to double (cf. pointSourceDetection)
+        mxArray* dframe = NULL;
+        err = mexCallMATLABWithTrap(1, &dframe, 1, &frame, "double");
+        if (err!=NULL) {
+            setErrorMessage(pl, "Error while converting frame to double: ", err);
+            mxDestroyArray(frame);
+            mxDestroyArray(tArray);
+            return false;
+        }
+        memcpy(&sl.pixels[0], mxGetPr(dframe), N*sizeof(double));
+        mxDestroyArray(dframe);
+    }
+    mxDestroyArray(frame);
+
+    sl.hasMask = false;
+    if (maskFcn!=NULL) {
+        mxArray* maskArray = NULL;
+        rhs[0] = (mxArray*)maskFcn;
+        err = mexCallMATLABWithTrap(1, &maskArray, 2, rhs, "feval");
+        if (err!=NULL) {
+            setErrorMessage(pl, "Error while reading mask through maskFcn: ", err);
+            mxDestroyArray(tArray);
+            return false;
+        }
+        if (!mxIsEmpty(maskArray)) {
+            if (mxGetNumberOfElements(maskArray)!=N || !(mxIsLogical(maskArray) || mxIsDouble(maskArray))) {
+                pl.errorMsg_ = "maskFcn must return a logical array with the same size as the frame.";
+                mxDestroyArray(maskArray);
+                mxDestroyArray(tArray);
+                return false;
+            }
+            sl.maskData.resize(N);
+            if (mxIsLogical(maskArray)) {
+                mxLogical* m = mxGetLogicals(maskArray);
+                for (size_t i=0; i<N; ++i) {
+                    sl.maskData[i] = m[i];
+                }
+            } else {
+                double* m = mxGetPr(maskArray);
+                for (size_t i=0; i<N; ++i) {
+                    sl.maskData[i] = m[i]!=0.0;
+                }
+            }
+            sl.hasMask = true;
+        }
+        mxDestroyArray(maskArray);
+    }
+    mxDestroyArray(tArray);
+
+    pl.lock();
+    sl.frame = t;
+    sl.state = READY;
+    pl.unlock();
+    return true;
+}
+
+
+// Writes the results of frame t to movieInfo (main thread only)
+static void writeFrame(Pipeline& pl, mxArray* movieInfo, int t) {
+    FrameResult* r = pl.results_[t];
+    size_t n = r->size();
+    if (n>0) {
+        for (int f=0; f<NDFIELDS; ++f) {
+            mxArray* val = mxCreateDoubleMatrix(1, n, mxREAL);
+            memcpy(mxGetPr(val), &r->dfield[f][0], n*sizeof(double));
+            mxSetFieldByNumber(movieInfo, t, f, val);
+        }
+        for (int f=0; f<NLFIELDS; ++f) {
+            mxArray* val = mxCreateLogicalMatrix(1, n);
+            mxLogical* v = mxGetLogicals(val);
+            for (size_t i=0; i<n; ++i) {
+                v[i] = r->lfield[f][i];
+            }
+            mxSetFieldByNumber(movieInfo, t, NDFIELDS+f, val);
+        }
+        // [value std] pairs for compatibility with the tracker
+        for (int f=0; f<NPFIELDS; ++f) {
+            mxArray* val = mxCreateDoubleMatrix(n, 2, mxREAL);
+            double* v = mxGetPr(val);
+            memcpy(v, &r->dfield[pairIdx[f][0]][0], n*sizeof(double));
+            memcpy(v+n, &r->dfield[pairIdx[f][1]][0], n*sizeof(double));
+            mxSetFieldByNumber(movieInfo, t, NDFIELDS+NLFIELDS+f, val);
+        }
+    }
+    pl.lock();
+    delete pl.results_[t];
+    pl.results_[t] = NULL;
+    pl.unlock();
+}
+
+
+// case-insensitive field access
+static const mxArray* getField(const mxArray* s, const char* name) {
+    if (s==NULL || !mxIsStruct(s)) {
+        return NULL;
+    }
+    int nf = mxGetNumberOfFields(s);
+    for (int f=0; f<nf; ++f) {
+        const char* fname = mxGetFieldNameByNumber(s, f);
+        size_t k = 0;
+        while (fname[k]!='\0' && name[k]!='\0' && tolower(fname[k])==tolower(name[k])) {
+            ++k;
+        }
+        if (fname[k]=='\0' && name[k]=='\0') {
+            const mxArray* v = mxGetFieldByNumber(s, 0, f);
+            return (v==NULL || mxIsEmpty(v)) ? NULL : v;
+        }
+    }
+    return NULL;
+}
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+    if (nrhs < 4 || nrhs > 5)
+        mexErrMsgTxt("Inputs should be: readFcn, maskFcn, nFrames, sigma, {options}.");
+    if (mxGetClassID(prhs[0])!=mxFUNCTION_CLASS)
+        mexErrMsgTxt("readFcn must be a function handle.");
+    const mxArray* maskFcn = NULL;
+    if (!mxIsEmpty(prhs[1])) {
+        if (mxGetClassID(prhs[1])!=mxFUNCTION_CLASS)
+            mexErrMsgTxt("maskFcn must be a function handle or empty.");
+        maskFcn = prhs[1];
+    }
+    if (!mxIsDouble(prhs[2]) || mxGetNumberOfElements(prhs[2])!=1 || mxGetScalar(prhs[2])<1)
+        mexErrMsgTxt("nFrames must be a positive integer.");
+    int nFrames = (int)mxGetScalar(prhs[2]);
+    if (!mxIsDouble(prhs[3]) || mxGetNumberOfElements(prhs[3])!=1 || mxGetScalar(prhs[3])<=0)
+        mexErrMsgTxt("sigma must be a positive scalar.");
+
+    const mxArray* opts = nrhs > 4 ? prhs[4] : NULL;
+    if (opts!=NULL && !mxIsEmpty(opts) && !mxIsStruct(opts))
+        mexErrMsgTxt("Options must be a structure.");
+
+    parameters_t prm;
+    prm.sigma = mxGetScalar(prhs[3]);
+    const mxArray* v;
+    prm.alpha = (v = getField(opts, "Alpha")) ? mxGetScalar(v) : 0.05;
+    prm.kLevel = gsl_cdf_ugaussian_Pinv(1.0-prm.alpha/2.0);
+    strcpy(prm.mode, "xyac");
+    if ((v = getField(opts, "Mode"))) {
+        if (mxIsCell(v)) {
+            v = mxGetCell(v, 0);
+        }
+        if (v==NULL || !mxIsChar(v) || mxGetNumberOfElements(v)>NPARAMS)
+            mexErrMsgTxt("'Mode' must be a string with any of 'xyAsc'.");
+        mxGetString(v, prm.mode, NPARAMS+1);
+        for (int i=0; prm.mode[i]!='\0'; ++i) {
+            prm.mode[i] = tolower(prm.mode[i]);
+        }
+        vector<int> estIdx;
+        if (!Gaussian2D::selectParameters(prm.mode, NPARAMS, estIdx))
+            mexErrMsgTxt("'Mode' must be a string with any of 'xyAsc'.");
+    }
+    prm.confRadius = (v = getField(opts, "ConfRadius")) ? (int)mxGetScalar(v) : (int)ceil(2.0*prm.sigma);
+    prm.windowSize = (v = getField(opts, "WindowSize")) ? (int)mxGetScalar(v) : (int)ceil(4.0*prm.sigma);
+    prm.prefilter = (v = getField(opts, "Prefilter")) ? mxGetScalar(v)!=0.0 : true;
+    prm.refineMaskLoG = (v = getField(opts, "RefineMaskLoG")) ? mxGetScalar(v)!=0.0 : true;
+    prm.removeRedundant = (v = getField(opts, "RemoveRedundant")) ? mxGetScalar(v)!=0.0 : true;
+    prm.redundancyRadius = (v = getField(opts, "RedundancyRadius")) ? mxGetScalar(v) : 0.25;
+    prm.maxIter = 500;
+    prm.eAbs = 1e-8;
+    prm.eRel = 1e-8;
+    if ((v = getField(opts, "FitMixtures")) && mxGetScalar(v)!=0.0)
+        mexErrMsgTxt("Mixture-model fitting is not supported, use pointSourceDetection.");
+
+    int nThreads = 1;
+#ifdef _OPENMP
+    nThreads = omp_get_max_threads();
+#endif
+    int nSlots = (v = getField(opts, "BufferSize")) ? (int)mxGetScalar(v) : 2*nThreads;
+    if (nSlots < 1) {
+        nSlots = 1;
+    }
+
+    // output structure
+    const int nfields = NDFIELDS+NLFIELDS+NPFIELDS;
+    mwSize dims[2] = {1, (mwSize)nFrames};
+    mxArray* movieInfo = mxCreateStructArray(2, dims, nfields, fieldNames);
+
+    Pipeline pl(nSlots, nFrames, prm);
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nThreads)
+#endif
+    {
+        int tid = 0;
+#ifdef _OPENMP
+        tid = omp_get_thread_num();
+#endif
+        if (tid==0) {
+            // reader/writer thread
+            int nextRead = 0, nextWrite = 0;
+            while (nextWrite < nFrames && !pl.aborted()) {
+                // write completed frames in order
+                while (nextWrite < nFrames && pl.isDone(nextWrite)) {
+                    writeFrame(pl, movieInfo, nextWrite++);
+                }
+                int s;
+                if (nextRead < nFrames && (s = pl.freeSlot())!=-1) {
+                    if (!readFrame(pl, prhs[0], maskFcn, nextRead, s)) {
+                        pl.abort();
+                        break;
+                    }
+                    if (++nextRead==nFrames) {
+                        pl.lock();
+                        pl.allRead_ = true;
+                        pl.unlock();
+                    }
+                } else if ((s = pl.claimSlot())!=-1) {
+                    // ring buffer full or all frames read: help the workers
+                    pl.process(s);
+                } else if (nextWrite < nFrames && !pl.isDone(nextWrite)) {
+                    waitBriefly();
+                }
+            }
+        } else {
+            pl.work();
+        }
+    }
+
+    if (pl.aborted()) {
+        mxDestroyArray(movieInfo);
+        mexErrMsgTxt(pl.errorMsg_.c_str());
+    }
+    plhs[0] = movieInfo;
+}
@@ -0,0 +1,28 @@
+%movieInfo = pointSourceDetectionMovie(readFcn, maskFcn, nFrames, sigma, options) runs pointSourceDetection on all frames of a movie
+%
+% Frames are read by the calling thread into a bounded buffer, and filtered, detected and fitted
+% by worker threads (OpenMP), such that reading and computation overlap. Mixture-model fitting
+% is not supported.
+%
+% Inputs:
+%         readFcn : function handle, readFcn(t) returns frame t
+%         maskFcn : function handle, maskFcn(t) returns the exclusion mask for frame t (see 'Mask'
+%                   in pointSourceDetection). Use [] for no mask.
+%         nFrames : number of frames
+%           sigma : standard deviation of the Gaussian PSF
+%       {options} : structure with any of the following fields (case insensitive):
+%                   'Mode', 'Alpha', 'Prefilter', 'RefineMaskLoG', 'RemoveRedundant',
+%                   'RedundancyRadius', 'ConfRadius', 'WindowSize' (see pointSourceDetection)
+%                   'BufferSize' : number of frames buffered. Default: 2x the number of threads.
+%
+% Output:
+%       movieInfo : 1 x nFrames structure array with the fields of the pointSourceDetection output,
+%                   and the [value std] fields 'xCoord', 'yCoord', 'amp', 'sigmaX', 'sigmaY', 'bkg'.
+%                   Fields are empty for frames without detections.
+%
+% Example:
+% movieInfo = pointSourceDetectionMovie(@(t) MD.channels_(1).loadImage(t), [], MD.nFrames_, 1.5);
+%
+% See also pointSourceDetection, detectMoviePointSources
+
+function movieInfo = pointSourceDetectionMovie(readFcn, maskFcn, nFrames, sigma, options) %#ok<STOUT,INUSD>
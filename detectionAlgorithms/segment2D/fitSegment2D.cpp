@@ -0,0 +1,226 @@
+/* [prmVect prmStd covarianceMatrix residuals Jacobian] = fitSegment2D(data, prmVect, mode, options);
+ *
+ * (c) Sylvain Berlemont, 2011 (last modified Jan 22, 2011)
+ *
+ * 'data' can be a cell array of windows, with 'prmVect' a matrix (one row per window);
+ * the windows are then fitted in parallel. See batchFit.h.
+ *
+ * Mac/Linux: mex -I../../mex/include -I/usr/local/include /usr/local/lib/libgsl.a /usr/local/lib/libgslcblas.a CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" fitSegment2D.cpp
+ * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT /openmp" -I"..\..\..\extern\mex\include\gsl-1.14" -I"..\..\mex\include" "..\..\..\extern\mex\lib\gsl.lib" "..\..\..\extern\mex\lib\cblas.lib" -output fitSegment2D fitSegment2D.cpp
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "batchFit.h"
+
+#define SIGN(x)	(x > 0 ? 1 : (x < 0 ? -1.0 : 0.0))
+
+#define NPARAMS	7
+#define REFMODE	"xyalstc"
+
+/*
+  c1 = exp((-1/2)*s2*(Y*ct-X*st)^2);
+  c2 = erf((1/2)*2^(-1/2)*s1*(l+2*X*ct+2*Y*st));
+  c3 = erf((1/2)*2^(-1/2)*s1*(l-2*X*ct-2*Y*st));
+  c4 = exp((-1/8)*s2*(l-2*X*ct-2*Y*st)^2);
+  c5 = exp((-1/8)*s2*(l+2*X*ct+2*Y*st)^2);
+  c6 = erf(l / (2 2^(1/2) s))
+*/
+
+#define C7	0.797884560802865	/* C7 = (2/pi)^(1/2) */
+#define C8	0.398942280401433	/* C8 = (2*pi)^(-1/2) */
+
+class Segment2D : public FitModel
+{
+public:
+  static const int nd = 2;
+  static const int stop = STOP_DELTA;
+  static const int residualFormat = RES_ARRAY;
+
+  Segment2D() : cacheWindow_(NULL) {}
+
+  static bool readParameters(const double* v, const int n, std::vector<double>& prm)
+  {
+    if (n != NPARAMS)
+      return false;
+    prm.assign(v, v + NPARAMS);
+    return true;
+  }
+
+  static bool selectParameters(const char* mode, const int np, std::vector<int>& estIdx)
+  {
+    estIdx.clear();
+    for (int i = 0; i < NPARAMS; ++i)
+      if (strchr(mode, REFMODE[i])!=NULL)
+	estIdx.push_back(i);
+    return !estIdx.empty();
+  }
+
+  static void finalize(double* prm, const int np)
+  {
+    /* Make sure the angle parameter lies in -pi/2...pi/2 */
+    double t = prm[5];
+    if (t > M_PI_2 || t < -M_PI_2)
+      {
+	t = fmod(t + M_PI_2, M_PI);
+	t -= SIGN(t) * M_PI_2;
+	prm[5] = t;
+      }
+
+    /* Make sure sigma and length are positive */
+    prm[3] = fabs(prm[3]);
+    prm[4] = fabs(prm[4]);
+  }
+
+  void evaluate(const FitWindow& w, const double* prm, const int np, const int* estIdx, const int nparam,
+		double* f, double* J)
+  {
+    int i, k;
+    int nx_div2 = (w.nx-1) >> 1;
+    int ny_div2 = (w.ny-1) >> 1;
+
+    double xp = prm[0];
+    double yp = prm[1];
+    double A = prm[2];
+    double l = fabs(prm[3]);
+    double s = fabs(prm[4]);
+    double t = prm[5];
+    double C = prm[6];
+
+    double ct = cos(t);
+    double st = sin(t);
+    double s1 = 1.0 / s;
+    double s2 = 1.0 / (s * s);
+    double s3 = s1 * s2;
+    double c6 = erf(.5 * l * M_SQRT1_2 * s1);
+    double el = exp(-l * l * s2 / 8);
+
+    double xi, yi, u, v, c1, c23, c4, c5, *Ji;
+    int nValid = w.nValid();
+
+    /* The per-pixel terms only depend on the parameters: GSL evaluates
+       the Jacobian at the last accepted point, for which they have
+       just been computed. */
+    if (!cached(w, prm))
+      {
+	u_.resize(nValid);
+	v_.resize(nValid);
+	c1_.resize(nValid);
+	c23_.resize(nValid);
+
+	for (i = 0; i < nValid; ++i)
+	  {
+	    xi = w.x[i] - nx_div2 - xp;
+	    yi = w.y[i] - ny_div2 - yp;
+
+	    u_[i] = u = yi * ct - xi * st;
+	    v_[i] = v = xi * ct + yi * st;
+	    c1_[i] = exp(-.5 * s2 * u * u);
+	    c23_[i] = erf(.5 * M_SQRT1_2 * s1 * (l + 2 * v)) +
+	      erf(.5 * M_SQRT1_2 * s1 * (l - 2 * v));
+	  }
+
+	cacheWindow_ = &w;
+	std::copy(prm, prm + NPARAMS, cachePrm_);
+      }
+
+    if (f != NULL)
+      for (i = 0; i < nValid; ++i)
+	f[i] = .5 * A * c1_[i] * c23_[i] / c6 + C - w.pixels[w.idx[i]];
+
+    if (J == NULL)
+      return;
+
+    /* c4 and c5 are only needed for the x, y, l, s and t derivatives */
+    bool edges = false;
+    for (k = 0; k < nparam; ++k)
+      edges |= estIdx[k] == 0 || estIdx[k] == 1 || estIdx[k] == 3 || estIdx[k] == 4 || estIdx[k] == 5;
+
+    c4 = c5 = 0;
+    for (i = 0; i < nValid; ++i)
+      {
+	u = u_[i];
+	v = v_[i];
+	c1 = c1_[i];
+	c23 = c23_[i];
+
+	if (edges)
+	  {
+	    c4 = exp(-.125 * s2 * (l - 2 * v) * (l - 2 * v));
+	    c5 = exp(-.125 * s2 * (l + 2 * v) * (l + 2 * v));
+	  }
+	Ji = J + i * nparam;
+	for (k = 0; k < nparam; ++k)
+	  switch (estIdx[k])
+	    {
+	    case 0:
+	      /*
+		A * c1 * ((c4 - c5) * C7 * s * ct + c23 * st *
+		(xi * st - yi * ct)) * (1/2) * s2 / c6
+	      */
+	      Ji[k] = A * c1 * ((c4 - c5) * C7 * s * ct - c23 * st * u) * .5 * s2 / c6;
+	      break;
+	    case 1:
+	      /*
+		A * c1 * ((c4 - c5) * C7 * s * st + ct * c23 *
+		(yi * ct - xi * st)) * (1/2) * s2 / c6
+	      */
+	      Ji[k] = A * c1 * ((c4 - c5) * C7 * s * st + ct * c23 * u) * .5 * s2 / c6;
+	      break;
+	    case 2:
+	      /* c1 * c23 * .5 / c6 */
+	      Ji[k] = c1 * c23 * .5 / c6;
+	      break;
+	    case 3:
+	      /*
+		A * c1 * ((c4 + c5) * c6 - exp(-l^2 * s2 / 8) * c23) * C8 * s1
+		* (1/2) / c6^2
+	      */
+	      Ji[k] = .5 * A * c1 * ((c4 + c5) * c6 - el * c23) * C8 * s1 / (c6 * c6);
+	      break;
+	    case 4:
+	      /*
+		(s3 / (4 * c6^2)) * A * c1 * (exp(-l^2 * s2 / 8) * l * C7 * s *
+		c23 + 2 * c6 * c23 * (yi * ct - xi * st)^2 + C7 * s *
+		c6 * (c4 * (-l + 2 * xi * ct + 2 * yi * st) - c5 * (l + 2 * xi * ct +
+		2 * yi * st)))
+	      */
+	      Ji[k] = (s3 / (4 * c6 * c6)) * A * c1 *
+		(el * l * C7 * s * c23 + 2 * c6 * c23 * u * u +
+		 C7 * s * c6 * (c4 * (-l + 2 * v) - c5 * (l + 2 * v)));
+	      break;
+	    case 5:
+	      /*
+		(s2 * (1/2) / c6) * A * c1 * (c4 * C7 * s * (xi * st - yi * ct) + c5
+		* C7 * s * (yi * ct - xi * st) + c23 * (yi * ct - xi * st) *
+		(xi * ct + yi * st))
+	      */
+	      Ji[k] = (.5 * s2 / c6) * A * c1 * u *
+		(s * C7 * c5 + c23 * v - c4 * C7 * s);
+	      break;
+	    case 6: /* 1 */
+	      Ji[k] = 1;
+	      break;
+	    }
+      }
+  }
+
+private:
+  bool cached(const FitWindow& w, const double* prm) const
+  {
+    return cacheWindow_ == &w && std::equal(prm, prm + NPARAMS, cachePrm_);
+  }
+
+  /* per-pixel terms of the last evaluation */
+  const FitWindow* cacheWindow_;
+  double cachePrm_[NPARAMS];
+  std::vector<double> u_, v_, c1_, c23_;
+};
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+  fitWindows<Segment2D>(nlhs, plhs, nrhs, prhs);
+}
@@ -21,6 +21,11 @@
 %                 res : residuals
 %                   J : Jacobian
 %
+%    Batch mode: if 'data' is a cell array of windows, 'prmVect' must be a matrix with one row
+%    per window. All windows are fitted in parallel; prmVect and prmStd are returned as matrices
+%    (one row per window), C and J as cell arrays, and res as a cell array. Windows with
+%    fewer valid pixels than parameters to estimate return NaN.
+%
 % Axis conventions: image processing, see meshgrid
 %
 % Example: [prmVect prmStd C res J] = fitSegment2D(data, [0 0 max(data(:)) 10 1.5 pi/6 min(data(:))], 'xyalstc');
@@ -1,20 +1,56 @@
-/*
+/* D = geodesicDistance(X, Y, {metric})
+ *
+ * Geodesic distance to the points of X, along paths through the points
+ * of Y. metric: 'cityblock' (default, 4/6-neighbors) or 'chamfer'
+ * (5-7-11 in 2D, 3-4-5 with 26 neighbors in 3D).
+ *
+ * The distance is propagated by a wavefront (Dial's algorithm: bucket
+ * queue over the integer weights of the chamfer windows) until
+ * convergence, in parallel over the connected components of Y.
  *
  * Compilation:
- * Mac/Linux: mex -I/usr/local/include -I../../mex/include/c++ /usr/local/lib/libgsl.a /usr/local/lib/libgslcblas.a geodesicDistance.cpp
- * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT" -I"..\..\..\extern\mex\include\gsl-1.14" -I"..\..\mex\include\c++" "..\..\..\extern\mex\lib\gsl.lib" "..\..\..\extern\mex\lib\cblas.lib" -output geodesicDistance geodesicDistance.cpp
+ * Mac/Linux: mex -I/usr/local/include -I../../mex/include/c++ CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" /usr/local/lib/libgsl.a /usr/local/lib/libgslcblas.a geodesicDistance.cpp
+ * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT /openmp" -I"..\..\..\extern\mex\include\gsl-1.14" -I"..\..\mex\include\c++" "..\..\..\extern\mex\lib\gsl.lib" "..\..\..\extern\mex\lib\cblas.lib" -output geodesicDistance geodesicDistance.cpp
  */
 
 
 #include <mex.h>
 
+#include <cstring>
+#include <vector>
+#include <limits>
+
 #include <image.hpp>
 #include <mx_wrapper.hpp>
 #include <wwindow.hpp>
 
+// Weighted windows of each metric
+template <unsigned N>
+struct metric_windows;
+
+template <>
+struct metric_windows<2>
+{
+  static const wwindow<2,4,int,double> & cityblock() { return chanfrein11<int,double>(); }
+  static const wwindow<2,16,int,double> & chamfer() { return chanfrein5711<int,double>(); }
+};
+
+template <>
+struct metric_windows<3>
+{
+  static const wwindow<3,6,int,double> & cityblock() { return chanfrein111<int,double>(); }
+  static const wwindow<3,26,int,double> & chamfer() { return chanfrein345<int,double>(); }
+};
+
+template <int N, typename WIN, typename W>
+static void geodesic_distance(const image<N, unsigned char> & X,
+			      const image<N, unsigned char> & Y,
+			      const WIN & win,
+			      image<N, W> & D);
+
 template <unsigned N>
 static void dispatch(int nlhs, mxArray *plhs[],
-		     int nrhs, const mxArray *prhs[])
+		     int nrhs, const mxArray *prhs[], bool chamfer)
 {
   //////////////////////////
   // Get input parameters //
@@ -42,7 +78,10 @@ static void dispatch(int nlhs, mxArray *plhs[],
   // Compute geodesic distance //
   ///////////////////////////////
 
-  geodesic_distance(X,Y,D);
+  if (chamfer)
+    geodesic_distance(X, Y, metric_windows<N>::chamfer(), D);
+  else
+    geodesic_distance(X, Y, metric_windows<N>::cityblock(), D);
 
   //////////
   // Save //
@@ -52,137 +91,208 @@ static void dispatch(int nlhs, mxArray *plhs[],
     image2mxArray(D, plhs[0]);
 }
 
-template <typename W>
-static void geodesic_distance(const image<2,unsigned char> & X,
-							  const image<2, unsigned char> & Y,
-							  image<2,W> & D)
+// Point of linear index i (y is the fastest dimension, then x and z)
+template <int N>
+static vector<N,int> point_at(const int size[N], long i)
 {
-	// Initialize D
-	for (int i = 0; i < D.width(); ++i)
-		for (int j = 0; j < D.height(); ++j)
-			if (X(i,j))
-				D(i,j) = 0;
-	
-	const wwindow<2,2,int,W> & win_fwd = chanfrein11_fwd<int,W>();
-	const wwindow<2,2,int,W> & win_bkd = chanfrein11_bkd<int,W>();
-	
-	vector<2,int> p, q;
-
-  // Forward sweep
-  for (int i = 0; i < D.width(); ++i)
-    for (int j = 0; j < D.height(); ++j)
-      {
-	p[0] = i; p[1] = j;
-
-	W min = D[p];
-		  
-	if (min == 0)
-	  continue;
-	
-	for (int r = 0; r < win_fwd.size(); ++r)
-	  {
-	    q = p + win_fwd.point(r);
-
-	    W cur = D[q] + win_fwd.weight(r);
-
-	    if (cur < min && Y[q])
-	      min = cur;
-	  }
-		  
-	D[p] = min;
-      }
-
-  // Backward sweep
-  for (int i = D.width() - 1; i >= 0; --i)
-    for (int j = D.height() - 1; j >= 0; --j)
-      {
-	p[0] = i; p[1] = j;
-
-	W min = D[p];
-	      
-	if (min == 0)
-	  continue;
+  vector<N,int> p;
 
-	for (int r = 0; r < win_bkd.size(); ++r)
-	  {
-	    q = p + win_bkd.point(r);
+  p[1] = i % size[1];
+  i /= size[1];
+  p[0] = i % size[0];
+  if (N > 2)
+    p[N - 1] = i / size[0];
 
-	    W cur = D[q] + win_bkd.weight(r);
-
-	    if (cur < min && Y[q])
-	      min = cur;
-	  }
-
-	D[p] = min;
-      }
+  return p;
 }
 
-template <typename W>
-static void geodesic_distance(const image<3, unsigned char> & X,
-							  const image<3, unsigned char> & Y,
-							  image<3, W> & D)
+template <int N, typename WIN, typename W>
+static void geodesic_distance(const image<N, unsigned char> & X,
+			      const image<N, unsigned char> & Y,
+			      const WIN & win,
+			      image<N, W> & D)
 {
-	// Initialize D
-	for (int i = 0; i < D.width(); ++i)
-		for (int j = 0; j < D.height(); ++j)
-			for (int k = 0; k < D.depth(); ++k)
-				if (X(i,j,k))
-					D(i,j,k) = 0;
-	
-	const wwindow<3,3,int,W> & win_fwd = chanfrein111_fwd<int,W>();
-	const wwindow<3,3,int,W> & win_bkd = chanfrein111_bkd<int,W>();	
-	
-  vector<3,int> p, q;
-
-  // Forward sweep
-  for (int i = 0; i < D.width(); ++i)
-    for (int j = 0; j < D.height(); ++j)
-      for (int k = 0; k < D.depth(); ++k)
-      {
-	p[0] = i; p[1] = j; p[2] = k;
-
-	W min = D[p];
-	      
-	if (min == 0)
-	  continue;
+  const unsigned S = WIN::SIZE;
+  const int* size = D.size();
+  long n = 1;
+  for (int i = 0; i < N; ++i)
+    n *= size[i];
+
+  W wmin = win.weight(0);
+  W wmax = win.weight(0);
+  for (unsigned r = 1; r < S; ++r)
+    {
+      wmin = std::min(wmin, win.weight(r));
+      wmax = std::max(wmax, win.weight(r));
+    }
+
+  // Moves of 2 pixels along a dimension (knight moves of the 5-7-11
+  // chamfer) must not jump over one-pixel walls: one of the 2 points
+  // closest to the middle of the move (lo, hi) must be in Y.
+  bool jump[S];
+  vector<N,int> lo[S], hi[S];
+
+  for (unsigned r = 0; r < S; ++r)
+    {
+      jump[r] = false;
+      for (int i = 0; i < N; ++i)
+	{
+	  lo[r][i] = win.point(r)[i] / 2;
+	  hi[r][i] = win.point(r)[i] - lo[r][i];
+	  jump[r] = jump[r] || lo[r][i] != 0;
+	}
+    }
 
-	for (int r = 0; r < win_fwd.size(); ++r)
-	  {
-	    q = p + win_fwd.point(r);
+  ///////////////////////////////////////////////////////
+  // Connected components of Y and their points in X   //
+  ///////////////////////////////////////////////////////
 
-	    W cur = D[q] + win_fwd.weight(r);
+  image<N, int> L(size);
+  L.fill(-1);
 
-	    if (cur < min && Y[q])
-	      min = cur;
-	  }
+  std::vector<std::vector<vector<N,int> > > seeds;
+  std::vector<vector<N,int> > stack;
+
+  for (long i = 0; i < n; ++i)
+    {
+      vector<N,int> p = point_at<N>(size, i);
 
-	D[p] = min;
-      }
+      if (!Y[p] || L[p] >= 0)
+	continue;
+
+      int label = seeds.size();
+      seeds.push_back(std::vector<vector<N,int> >());
+
+      L[p] = label;
+      stack.push_back(p);
+
+      while (!stack.empty())
+	{
+	  vector<N,int> q = stack.back();
+	  stack.pop_back();
+
+	  if (X[q])
+	    seeds[label].push_back(q);
+
+	  for (unsigned r = 0; r < S; ++r)
+	    {
+	      vector<N,int> s = q + win.point(r);
+
+	      if (D.contains(s) && Y[s] && L[s] < 0)
+		{
+		  L[s] = label;
+		  stack.push_back(s);
+		}
+	    }
+	}
+    }
 
-  // Backward sweep
-  for (int i = D.width() - 1; i >= 0; --i)
-    for (int j = D.height() - 1; j >= 0; --j)
-      for (int k = D.depth() - 1; k >= 0; --k)
-      {
-	p[0] = i; p[1] = j; p[2] = k;
+  ////////////////////////////////////////////////////////////////
+  // Wavefront in each component: points are popped by          //
+  // increasing distance from a circular array of wmax + 1      //
+  // buckets; outdated entries are skipped.                     //
+  ////////////////////////////////////////////////////////////////
 
-	W min = D[p];
-	      
-	if (min == 0)
+  int nc = seeds.size();
+  long nb = (long) wmax + 1;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int c = 0; c < nc; ++c)
+    {
+      if (seeds[c].empty())
+	continue;
+
+      std::vector<std::vector<vector<N,int> > > buckets(nb);
+      buckets[0] = seeds[c];
+
+      for (unsigned k = 0; k < seeds[c].size(); ++k)
+	D[seeds[c][k]] = 0;
+
+      long count = seeds[c].size();
+
+      for (long d = 0; count > 0; ++d)
+	{
+	  std::vector<vector<N,int> > & bucket = buckets[d % nb];
+
+	  while (!bucket.empty())
+	    {
+	      vector<N,int> p = bucket.back();
+	      bucket.pop_back();
+	      --count;
+
+	      if (D[p] != d)
+		continue;
+
+	      for (unsigned r = 0; r < S; ++r)
+		{
+		  vector<N,int> q = p + win.point(r);
+
+		  if (!D.contains(q) || !Y[q] ||
+		      (jump[r] && !Y[p + lo[r]] && !Y[p + hi[r]]))
+		    continue;
+
+		  W cur = d + win.weight(r);
+
+		  if (cur < D[q])
+		    {
+		      D[q] = cur;
+		      buckets[(long) cur % nb].push_back(q);
+		      ++count;
+		    }
+		}
+	    }
+	}
+    }
+
+  //////////////////////////////////////////////////////////////
+  // Points outside Y: reached in one step from Y (or in X)   //
+  //////////////////////////////////////////////////////////////
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for (long i = 0; i < n; ++i)
+    {
+      vector<N,int> p = point_at<N>(size, i);
+
+      if (Y[p])
+	continue;
+
+      if (X[p])
+	{
+	  D[p] = 0;
 	  continue;
+	}
 
-	for (int r = 0; r < win_bkd.size(); ++r)
-	  {
-	    q = p + win_bkd.point(r);
+      for (unsigned r = 0; r < S; ++r)
+	{
+	  vector<N,int> q = p + win.point(r);
 
-	    W cur = D[q] + win_bkd.weight(r);
+	  if (!D.contains(q) || !Y[q] ||
+	      (jump[r] && !Y[p + lo[r]] && !Y[p + hi[r]]))
+	    continue;
 
-	    if (cur < min && Y[q])
-	      min = cur;
-	  }
+	  if (D[q] + win.weight(r) < D[p])
+	    D[p] = D[q] + win.weight(r);
+	}
+    }
 
-	D[p] = min;
-      }
+  // Distances in units of the axial step
+  if (wmin != 1)
+    {
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (long i = 0; i < n; ++i)
+	{
+	  vector<N,int> p = point_at<N>(size, i);
+
+	  if (D[p] != std::numeric_limits<W>::max())
+	    D[p] /= wmin;
+	}
+    }
 }
 
 void mexFunction(int nlhs, mxArray *plhs[],
@@ -195,6 +305,9 @@ void mexFunction(int nlhs, mxArray *plhs[],
   if (nrhs < 2)
     mexErrMsgTxt("Two input arguments required.");
 
+  if (nrhs > 3)
+    mexErrMsgTxt("Too many input arguments.");
+
   if (nlhs > 1)
     mexErrMsgTxt("Too many output arguments");
 
@@ -217,13 +330,31 @@ void mexFunction(int nlhs, mxArray *plhs[],
   if (!mxIsClass(prhs[1],"logical"))
     mexErrMsgTxt("Y is not a logical matrix.");
 
+  if (mxGetNumberOfElements(prhs[0]) != mxGetNumberOfElements(prhs[1]) ||
+      memcmp(mxGetDimensions(prhs[0]), mxGetDimensions(prhs[1]),
+	     ndim1 * sizeof(mwSize)) != 0)
+    mexErrMsgTxt("X and Y must have the same size.");
+
+  bool chamfer = false;
+
+  if (nrhs > 2)
+    {
+      char metric[16];
+
+      if (mxGetString(prhs[2], metric, sizeof(metric)) != 0 ||
+	  (strcmp(metric, "cityblock") != 0 && strcmp(metric, "chamfer") != 0))
+	mexErrMsgTxt("The metric must be 'cityblock' or 'chamfer'.");
+
+      chamfer = strcmp(metric, "chamfer") == 0;
+    }
+
   //////////////
   // Dispatch //
   //////////////
 
   switch (ndim1)
     {
-    case 2: dispatch<2>(nlhs, plhs, nrhs, prhs); break;
-    case 3: dispatch<3>(nlhs, plhs, nrhs, prhs); break;
+    case 2: dispatch<2>(nlhs, plhs, nrhs, prhs, chamfer); break;
+    case 3: dispatch<3>(nlhs, plhs, nrhs, prhs, chamfer); break;
     }
 }
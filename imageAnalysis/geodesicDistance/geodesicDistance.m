@@ -1 +1,11 @@
-function D = geodesicDistance(X,Y) %#ok<INUSD,STOUT>
\ No newline at end of file
+function D = geodesicDistance(X, Y, metric) %#ok<INUSD,STOUT>
+% D = geodesicDistance(X, Y, metric) computes the geodesic distance to the
+% points of X along paths through the points of Y (2D or 3D logical arrays).
+%
+% metric: 'cityblock' (default): 4-/6-connected steps of length 1.
+%         'chamfer': 5-7-11 chamfer in 2D (16 neighbors), 3-4-5 chamfer in
+%         3D (26 neighbors); closer to the Euclidean length of the paths.
+%
+% The distance is propagated until convergence (wavefront with a bucket
+% queue), so that winding masks are handled in a single call. Points
+% that cannot be reached are set to realmax.
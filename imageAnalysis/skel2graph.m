@@ -1,9 +1,10 @@
-function [vertices,edges,edgePaths] = skel2graph(skelIn,nConn)
+function [vertices,edges,edgePaths,edgeLengths] = skel2graph(skelIn,nConn,spacing)
 %SKEL2GRAPH converts a binary 3D skeleton matrix into a graph structure with nodes and edges 
 % 
 % [vertices,edges] = skel2graph(skelIn)
 % [vertices,edges,edgePaths] = skel2graph(skelIn)
 %                        ... = skel2graph(skelIn,nConn)
+% [vertices,edges,edgePaths,edgeLengths] = skel2graph(skelIn,nConn,spacing)
 % 
 % Input:
 % 
@@ -14,6 +15,9 @@ function [vertices,edges,edgePaths] = skel2graph(skelIn,nConn)
 %           WARNING: I have only tested this function with 26-connected
 %           skeletons (the kind produced by skeleton3D)!!
 %           Optional. Default is 26.
+%
+%   spacing - Optional. The voxel size along the rows, columns and slices,
+%   for the edge lengths. Default is [1 1 1].
 % 
 % Output:
 % 
@@ -27,6 +31,14 @@ function [vertices,edges,edgePaths] = skel2graph(skelIn,nConn)
 %   edgePaths - An Nx1 cell array containing the ordered coordinates of
 %   each point along each edge. NOTE: Requesting this output will make the
 %   processing quite a bit slower!
+%
+%   edgeLengths - An Nx1 vector of the length of each edge, from vertex
+%   voxel to vertex voxel, in the units of 'spacing'.
+%
+% For 26-connected skeletons, the graph is extracted by the compiled
+% skelGraph (imageProcessing/skeletonization/skelGraph.cpp) when it is
+% available: edgePaths then contain the edge voxels only, ordered from
+% vertex edges(:,1) to vertex edges(:,2), and the output is much faster.
 % 
 % Hunter Elliott
 % 4/2/2010
@@ -47,6 +59,20 @@ if nargin < 2 || isempty(nConn)
     nConn = 26;
 end
 
+if nargin < 3 || isempty(spacing)
+    spacing = [1 1 1];
+end
+
+if nConn == 26 && exist('skelGraph','file') == 3
+    [vertices,edges,edgeVox,edgeOffsets,edgeLengths] = skelGraph(skelIn,spacing);
+    if nargout > 2
+        edgeCoord = zeros(numel(edgeVox),3);
+        [edgeCoord(:,1),edgeCoord(:,2),edgeCoord(:,3)] = ind2sub(size(skelIn),edgeVox);
+        edgePaths = mat2cell(edgeCoord,diff(edgeOffsets),3);
+    end
+    return
+end
+
 
 %TEMP - should Validate that the input mask is in fact a skeleton(not too thick?)??-HLE
 
@@ -129,6 +155,9 @@ if nargout > 2
     edgePaths = cell(nEdges,1);
     edgeInit = zeros(3*max(size(skelIn)),3); %Matrix for over-initializing edge paths    
 end
+if nargout > 3
+    edgeLengths = nan(nEdges,1);
+end
 
 %Go through each edge...
 for j = 1:nEdges
@@ -191,6 +220,19 @@ for j = 1:nEdges
             end
             %Remove extra points from over-initialization.
             edgePaths{j} = edgePaths{j}(1:iVert,:);
+            
+            if nargout > 3
+                %Length from vertex voxel to vertex voxel, as in skelGraph:
+                %the path may start on a (single-voxel) vertex, which is
+                %then the first vertex of the edge
+                vStart = vertMat(edgePaths{j}(1,1),edgePaths{j}(1,2),edgePaths{j}(1,3));
+                if vStart > 0
+                    vEnd = edges(j,edges(j,:) ~= vStart);
+                    edgeLengths(j) = pathLength(edgePaths{j}(2:end,:),vertMat,vStart,vEnd,spacing);
+                else
+                    edgeLengths(j) = pathLength(edgePaths{j},vertMat,edges(j,1),edges(j,2),spacing);
+                end
+            end
         end
     end        
            
@@ -205,7 +247,12 @@ end
 %successfully detected tip edge. - HLE
 goodEdges = all(edges>0,2);
 edges = edges(goodEdges,:);
-edgePaths = edgePaths(goodEdges);
+if nargout > 2
+    edgePaths = edgePaths(goodEdges);
+end
+if nargout > 3
+    edgeLengths = edgeLengths(goodEdges);
+end
 
 
 
@@ -222,3 +269,26 @@ if showPlots && nargout > 2%shows plots of outputs, for debugging
     view(3)
 end
 
+
+
+function len = pathLength(path,vertMat,vStart,vEnd,spacing)
+%Length of an ordered path of edge voxels, including the shortest steps
+%from a voxel of vertex vStart to the first voxel, and from the last voxel
+%to a voxel of vertex vEnd. NaN if the path is empty.
+
+if isempty(path)
+    len = NaN;
+    return
+end
+spacing = spacing(:)';
+len = sum(sqrt(sum((diff(path,1,1) .* repmat(spacing,size(path,1)-1,1)).^2,2)));
+len = len + vertexStep(path(1,:),vertMat,vStart,spacing) + vertexStep(path(end,:),vertMat,vEnd,spacing);
+
+
+function d = vertexStep(pos,vertMat,iVert,spacing)
+%Distance from pos to the closest voxel of vertex iVert
+
+vertCoord = zeros(nnz(vertMat == iVert),3);
+[vertCoord(:,1),vertCoord(:,2),vertCoord(:,3)] = ind2sub(size(vertMat),find(vertMat == iVert));
+n = size(vertCoord,1);
+d = min(sqrt(sum(((vertCoord - repmat(pos,n,1)) .* repmat(spacing,n,1)).^2,2)));
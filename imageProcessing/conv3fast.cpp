@@ -1,36 +1,193 @@
 /* [response] = conv3fast(volume, kernel);
  * [response] = conv3fast(volume, xKernel, yKernel, zKernel);
+ * [response] = conv3fast(volume, 'gaussian', sigma, {order}, {accuracy});
+ * [response] = conv3fast(volume, kernel3D);
+ *
+ * 'volume' can be double, single, or uint16; the output is double for double input, single otherwise.
+ * The 'gaussian' mode uses recursive filters (recursiveGaussian.h), whose cost does not depend on sigma.
+ * Full (non-vector) kernels are applied with FFTs (fftConvolution.h); the FFT plans and the kernel
+ * spectrum are kept between calls until the MEX file is cleared.
  *
  * (c) Francois Aguet, 09/19/2013
  *
  * Compilation:
- * Mac/Linux: mex -I/usr/local/include -I../mex/include conv3fast.cpp
- * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT" -I"..\mex\include" -output conv3fast conv3fast.cpp
+ * Mac/Linux: mex -I/usr/local/include -I../mex/include /usr/local/lib/libfftw3_threads.a /usr/local/lib/libfftw3.a CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" conv3fast.cpp
+ * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT /openmp" -I"..\..\extern\mex\include\fftw-3.3" -I"..\mex\include" "..\..\extern\mex\lib\libfftw3-3.lib" -output conv3fast conv3fast.cpp
  */
 
-#include <cstring>
 #include <algorithm>
+#include <cstring>
+#include <vector>
 #include "mex.h"
 #include "convolver3D.h"
+#include "recursiveGaussian.h"
+#include "fftConvolution.h"
 
 using namespace std;
 
 
+// double input is filtered in double precision, single and uint16 input in single precision
+static mxClassID outputClass(const mxArray* input) {
+    return mxIsDouble(input) ? mxDOUBLE_CLASS : mxSINGLE_CLASS;
+}
+
+
+// x,y,z in Matlab correspond to dims 1,0,2 of the array
+template<class TI, class T>
+void conv3(const TI* input, const size_t* dims, const double* kx, const int nkx,
+           const double* ky, const int nky, const double* kz, const int nkz, T* output) {
+    int ny = dims[0]; // reversed: (m,n) -> (y,x)
+    int nx = dims[1];
+    int nz = dims[2];
+    vector<T> buffer((size_t)nx*ny*nz);
+
+    // convolve along 'x' first
+    convolveEvenY(input, kx, nkx, ny, nx, nz, output); // inverted x,y dims in Matlab
+    convolveEvenX(output, ky, nky, ny, nx, nz, &buffer[0]);
+    convolveEvenZ(&buffer[0], kz, nkz, ny, nx, nz, output);
+}
+
+
+// Gaussian (derivative) filtering with recursive filters; s, r: sigma and order along x, y, z
+template<class TI, class T>
+void gauss3(const TI* input, const size_t* dims, const double* s, const int* r, const bool accurate, T* output) {
+    int ny = dims[0]; // reversed: (m,n) -> (y,x)
+    int nx = dims[1];
+    int nz = dims[2];
+    vector<T> buffer((size_t)nx*ny*nz);
+
+    sepconv::RecursiveGaussian fx(s[0], r[0], accurate);
+    sepconv::RecursiveGaussian fy(s[1], r[1], accurate);
+    sepconv::RecursiveGaussian fz(s[2], r[2], accurate);
+    sepconv::filterRecursive(input, ny, nx, nz, 1, fx, sepconv::MIRROR, output);
+    sepconv::filterRecursive(output, ny, nx, nz, 0, fy, sepconv::MIRROR, &buffer[0]);
+    sepconv::filterRecursive(&buffer[0], ny, nx, nz, 2, fz, sepconv::MIRROR, output);
+}
+
+
+// conv3fast(volume, 'gaussian', sigma, {order}, {accuracy})
+void gaussianMode(mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+    if (nrhs < 3 || nrhs > 5)
+        mexErrMsgTxt("Required inputs: image, 'gaussian', sigma. Optional: order, accuracy ('fast' or 'accurate').");
+
+    // sigma: [s], [sxy sz], or [sx sy sz]
+    size_t ns = mxGetNumberOfElements(prhs[2]);
+    if (!mxIsDouble(prhs[2]) || (ns!=1 && ns!=2 && ns!=3))
+        mexErrMsgTxt("'sigma' must be a scalar, [sigmaXY sigmaZ], or [sigmaX sigmaY sigmaZ].");
+    double* sp = mxGetPr(prhs[2]);
+    double s[3] = {sp[0], ns==3 ? sp[1] : sp[0], sp[ns-1]};
+    for (int i=0;i<3;++i) {
+        if (s[i] < 0.5)
+            mexErrMsgTxt("'sigma' must be >= 0.5.");
+    }
+
+    // order: [o] or [ox oy oz], 0..2
+    int r[3] = {0, 0, 0};
+    if (nrhs > 3 && !mxIsEmpty(prhs[3])) {
+        size_t no = mxGetNumberOfElements(prhs[3]);
+        if (!mxIsDouble(prhs[3]) || (no!=1 && no!=3))
+            mexErrMsgTxt("'order' must be a scalar or [orderX orderY orderZ].");
+        double* op = mxGetPr(prhs[3]);
+        for (int i=0;i<3;++i) {
+            double o = op[no==3 ? i : 0];
+            if (o!=0 && o!=1 && o!=2)
+                mexErrMsgTxt("'order' must be 0, 1, or 2.");
+            r[i] = (int)o;
+        }
+    }
+
+    bool accurate = true;
+    if (nrhs > 4) {
+        char* str = mxArrayToString(prhs[4]);
+        if (str==NULL || (strcmp(str, "fast")!=0 && strcmp(str, "accurate")!=0))
+            mexErrMsgTxt("'accuracy' must be 'fast' or 'accurate'.");
+        accurate = strcmp(str, "accurate")==0;
+        mxFree(str);
+    }
+
+    const mwSize* dims = mxGetDimensions(prhs[0]);
+    size_t d[3] = {dims[0], dims[1], dims[2]};
+    plhs[0] = mxCreateNumericArray(3, dims, outputClass(prhs[0]), mxREAL);
+    if (mxIsDouble(prhs[0])) {
+        gauss3((double*)mxGetData(prhs[0]), d, s, r, accurate, (double*)mxGetData(plhs[0]));
+    } else if (mxIsSingle(prhs[0])) {
+        gauss3((float*)mxGetData(prhs[0]), d, s, r, accurate, (float*)mxGetData(plhs[0]));
+    } else {
+        gauss3((unsigned short*)mxGetData(prhs[0]), d, s, r, accurate, (float*)mxGetData(plhs[0]));
+    }
+}
+
+
+// FFT plans and kernel spectrum of the last call with a full kernel
+static sepconv::FFTConvolver3D* fftConvolver = NULL;
+
+static void clearFFTConvolver() {
+    delete fftConvolver;
+    fftConvolver = NULL;
+}
+
+
+// conv3fast(volume, kernel3D)
+void fftMode(mxArray *plhs[], const mxArray *prhs[]) {
+
+    if (!mxIsDouble(prhs[1]) || mxGetNumberOfDimensions(prhs[1]) > 3)
+        mexErrMsgTxt("The kernel must be a 2D or 3D double array.");
+
+    const mwSize* dims = mxGetDimensions(prhs[0]);
+    const mwSize* kdims = mxGetDimensions(prhs[1]);
+    size_t d[3] = {dims[0], dims[1], dims[2]};
+    size_t k[3] = {kdims[0], kdims[1], mxGetNumberOfDimensions(prhs[1])==3 ? kdims[2] : 1};
+
+    if (fftConvolver==NULL) {
+        fftConvolver = new sepconv::FFTConvolver3D();
+        mexAtExit(clearFFTConvolver);
+    }
+    plhs[0] = mxCreateNumericArray(3, dims, outputClass(prhs[0]), mxREAL);
+    if (mxIsDouble(prhs[0])) {
+        fftConvolver->convolve((double*)mxGetData(prhs[0]), d, mxGetPr(prhs[1]), k, (double*)mxGetData(plhs[0]));
+    } else if (mxIsSingle(prhs[0])) {
+        fftConvolver->convolve((float*)mxGetData(prhs[0]), d, mxGetPr(prhs[1]), k, (float*)mxGetData(plhs[0]));
+    } else {
+        fftConvolver->convolve((unsigned short*)mxGetData(prhs[0]), d, mxGetPr(prhs[1]), k, (float*)mxGetData(plhs[0]));
+    }
+}
+
+
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 
+    // check dimensions
+    if (nrhs < 2 || (!mxIsDouble(prhs[0]) && !mxIsSingle(prhs[0]) && !mxIsUint16(prhs[0])) || mxGetNumberOfDimensions(prhs[0]) != 3)
+        mexErrMsgTxt("Input must be a 3D double, single, or uint16 array.");
+
+    if (mxIsChar(prhs[1])) {
+        char* mode = mxArrayToString(prhs[1]);
+        bool isGaussian = mode!=NULL && strcmp(mode, "gaussian")==0;
+        mxFree(mode);
+        if (!isGaussian)
+            mexErrMsgTxt("Unknown mode; the only supported mode is 'gaussian'.");
+        gaussianMode(plhs, nrhs, prhs);
+        return;
+    }
+
+    // full kernel: at least two non-singleton dimensions
+    if (nrhs==2 && !mxIsEmpty(prhs[1]) && max(mxGetM(prhs[1]), mxGetN(prhs[1])) != mxGetNumberOfElements(prhs[1])) {
+        fftMode(plhs, prhs);
+        return;
+    }
+
     // check # inputs
     if (nrhs != 2 && nrhs != 4)
         mexErrMsgTxt("Required inputs: image, kernel -or- image, x-kernel, y-kernel, z-kernel.");
-    
-    // check dimensions
-    if (!mxIsDouble(prhs[0]) || mxGetNumberOfDimensions(prhs[0]) != 3)
-        mexErrMsgTxt("Input must be a 3D double array.");
+
     const mwSize* dims = mxGetDimensions(prhs[0]);
-    size_t ny = dims[0]; // reversed: (m,n) -> (y,x)
-    size_t nx = dims[1];
-    size_t nz = dims[2];
+    size_t d[3] = {dims[0], dims[1], dims[2]};
 
     // check kernel vectors
+    for (int i=1;i<nrhs;++i) {
+        if (!mxIsDouble(prhs[i]))
+            mexErrMsgTxt("Kernels must be double vectors.");
+    }
     size_t nkx = max(mxGetM(prhs[1]),mxGetN(prhs[1]));
     size_t nky, nkz;
     if (nrhs==4) {
@@ -43,51 +200,23 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 
     // check whether kernels are 1D
     if (nkx!=mxGetNumberOfElements(prhs[1]) ||
-            ((nrhs==4) && (nky != mxGetNumberOfElements(prhs[2]) || 
+            ((nrhs==4) && (nky != mxGetNumberOfElements(prhs[2]) ||
                            nkz != mxGetNumberOfElements(prhs[3]) )))
         mexErrMsgTxt("Kernels must be 1D vectors with an odd number of entries.");
+    if (nkx==0 || nky==0 || nkz==0)
+        mexErrMsgTxt("Kernels must not be empty.");
 
-    // check whether input is at least the size of the kernel
-    char cbuffer [100];
-    if (2*nkx-1>nx) {
-        sprintf (cbuffer, "x kernel can have %d elements at most for this volume (nx = %d).", (int)(nx+1)/2, (int)nx);
-        mexErrMsgTxt(cbuffer);
-    }
-    if (2*nky-1>ny) {
-        sprintf (cbuffer, "y kernel can have %d elements at most for this volume (ny = %d).", (int)(ny+1)/2, (int)ny);
-        mexErrMsgTxt(cbuffer);
-    }
-    if (2*nkz-1>nz) {
-        sprintf (cbuffer, "z kernel can have %d elements at most for this volume (nz = %d).", (int)(nz+1)/2, (int)nz);
-        mexErrMsgTxt(cbuffer);
-    }
-    
-    int N = nx*ny*nz;
-    double* input = mxGetPr(prhs[0]);
-    
+    // borders are mirrored repeatedly: kernels can be longer than the volume
     double* kx = mxGetPr(prhs[1]);
-    double* voxels = new double[N];
-    double* buffer = new double[N];
-    
-    // convolve along 'x' first
-    convolveEvenY(input, kx, nkx, ny, nx, nz, voxels); // inverted x,y dims in Matlab
-    if (nrhs==2) {
-        convolveEvenX(voxels, kx, nkx, ny, nx, nz, buffer);
-        convolveEvenZ(buffer, kx, nkx, ny, nx, nz, voxels);
+    double* ky = nrhs==4 ? mxGetPr(prhs[2]) : kx;
+    double* kz = nrhs==4 ? mxGetPr(prhs[3]) : kx;
+
+    plhs[0] = mxCreateNumericArray(3, dims, outputClass(prhs[0]), mxREAL);
+    if (mxIsDouble(prhs[0])) {
+        conv3((double*)mxGetData(prhs[0]), d, kx, nkx, ky, nky, kz, nkz, (double*)mxGetData(plhs[0]));
+    } else if (mxIsSingle(prhs[0])) {
+        conv3((float*)mxGetData(prhs[0]), d, kx, nkx, ky, nky, kz, nkz, (float*)mxGetData(plhs[0]));
     } else {
-        double* ky = mxGetPr(prhs[2]);
-        double* kz = mxGetPr(prhs[3]);
-        convolveEvenX(voxels, ky, nky, ny, nx, nz, buffer);
-        convolveEvenZ(buffer, kz, nkz, ny, nx, nz, voxels);
-    }
-    
-    if (nlhs > 0) {
-        plhs[0] =  mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
-        memcpy(mxGetPr(plhs[0]), voxels, N*sizeof(double));
+        conv3((unsigned short*)mxGetData(prhs[0]), d, kx, nkx, ky, nky, kz, nkz, (float*)mxGetData(plhs[0]));
     }
-    
-    // Free memory
-    delete[] buffer;
-    delete[] voxels;
 }
-    
\ No newline at end of file
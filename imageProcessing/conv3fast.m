@@ -3,9 +3,28 @@
 %  Usage:
 %    [F] = conv3fast(volume, kernel)
 %    [F] = conv3fast(volume, xKernel, yKernel, zKernel)
+%    [F] = conv3fast(volume, 'gaussian', sigma, {order}, {accuracy})
+%    [F] = conv3fast(volume, kernel3D)
+%
+%  Inputs:
+%     volume : 3D double, single, or uint16 array
+%     kernel : symmetric kernel, starting at the center (mirror borders)
+%
+%  Gaussian mode (recursive filters, the cost does not depend on sigma):
+%      sigma : standard deviation, [sigmaXY sigmaZ], or [sigmaX sigmaY sigmaZ]; >= 0.5
+%      order : derivative order, scalar or [orderX orderY orderZ], 0..2. Default: 0
+%   accuracy : 'fast' or 'accurate'. Default: 'accurate'
+%              Max. error relative to the peak of the filter, for orders 0/1/2:
+%              'fast': 5e-4/4e-3/4e-2, 'accurate': 2e-5/2e-4/2e-3
+%              For small sigma (< 2), kernels are more accurate.
+%
+%  Full kernels (FFT, overlap-save):
+%   kernel3D : 2D or 3D kernel, applied as convn(volume, kernel3D, 'same') with mirror borders.
+%              The FFT plans and the kernel spectrum are kept between calls, e.g., when
+%              filtering all frames of a time-lapse with the same PSF.
 %
 %  Outputs:
-%     F : filtered volume
+%     F : filtered volume, double for double input, single otherwise
 %
 %  Example: convolution with a Gaussian kernel
 %     s = 2;
@@ -13,6 +32,10 @@
 %     g = exp(-(0:w).^2/(2*s^2)); % symmetric kernel starts at '0'
 %     F = conv3fast(data, g);
 %
-%  Note: NaNs in input are allowed
+%  Example: second derivative along z of a Gaussian with large sigma
+%     F = conv3fast(data, 'gaussian', [10 5], [0 0 2]);
+%
+%  Notes: NaNs in input are allowed (except with full kernels, where they spread over FFT blocks)
+%         The convolutions are multi-threaded (OpenMP)
 
 % Francois Aguet, 09/19/2013
\ No newline at end of file
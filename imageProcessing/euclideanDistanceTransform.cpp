@@ -0,0 +1,213 @@
+/* [D, idx] = euclideanDistanceTransform(bw, {spacing});
+ *
+ * Exact Euclidean distance transform of N-D arrays, with anisotropic voxels: D is the distance
+ * from each element to the nearest nonzero element of 'bw' and 'idx' the linear index of that
+ * element (feature transform, as the second output of bwdist). Elements of an array without
+ * nonzero elements are at distance Inf, with index 0.
+ *
+ * 'spacing' is the size of the voxels along each dimension of 'bw' (rows, columns, slices, ...;
+ * missing values are 1). D is double; 'idx' is uint32, or uint64 for arrays of 2^32 elements or more.
+ *
+ * The squared distance is computed dimension by dimension, as the lower envelope of parabolas along
+ * each line (Felzenszwalb & Huttenlocher, Theory of Computing, 8, p. 415, 2012): the run time is
+ * linear in the number of elements, and the lines of a dimension are processed in parallel.
+ *
+ * Compilation:
+ * Mac/Linux: mex -I/usr/local/include CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" euclideanDistanceTransform.cpp
+ * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT /openmp" -output euclideanDistanceTransform euclideanDistanceTransform.cpp
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "mex.h"
+
+using namespace std;
+
+
+// Lower envelope of the parabolas h2*(q-p)^2 + f[p] along a line of n elements:
+// d[q] = min_p h2*(q-p)^2 + f[p] and ft[q] = ft[argmin]; ft[q] = -1 where all f are Inf.
+// v, z: buffers of n and n+1 elements.
+static void envelope1D(const double* f, const ptrdiff_t* ftIn, const int n, const double h2,
+                       double* d, ptrdiff_t* ft, int* v, double* z) {
+    const double inf = numeric_limits<double>::infinity();
+    int k = -1;
+    for (int q=0;q<n;++q) {
+        if (f[q]==inf) {
+            continue;
+        }
+        double s = -inf;
+        while (k>=0) {
+            int p = v[k];
+            s = ((f[q] + h2*q*q) - (f[p] + h2*p*p)) / (2.0*h2*(q-p));
+            if (s > z[k]) {
+                break;
+            }
+            --k;
+        }
+        ++k;
+        v[k] = q;
+        z[k] = k==0 ? -inf : s;
+        z[k+1] = inf;
+    }
+    if (k<0) {
+        for (int q=0;q<n;++q) {
+            d[q] = inf;
+            ft[q] = -1;
+        }
+        return;
+    }
+    int j = 0;
+    for (int q=0;q<n;++q) {
+        while (z[j+1] < q) {
+            ++j;
+        }
+        int p = v[j];
+        d[q] = h2*(q-p)*(q-p) + f[p];
+        ft[q] = ftIn[p];
+    }
+}
+
+
+// Squared distance transform along dimension 'dim' of the array 'dims', in place
+static void transformDimension(double* d2, ptrdiff_t* ft, const vector<size_t>& dims, const int dim, const double h) {
+    size_t stride = 1;
+    for (int k=0;k<dim;++k) {
+        stride *= dims[k];
+    }
+    int n = (int)dims[dim];
+    size_t N = stride;
+    for (size_t k=dim;k<dims.size();++k) {
+        N *= dims[k];
+    }
+    long nLines = (long)(N/n);
+    double h2 = h*h;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        vector<double> f(n), d(n), z(n+1);
+        vector<ptrdiff_t> ftIn(n), ftOut(n);
+        vector<int> v(n);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+        for (long t=0;t<nLines;++t) {
+            // first element of the line
+            size_t i0 = t % stride + (t / stride) * stride * n;
+            for (int q=0;q<n;++q) {
+                f[q] = d2[i0 + q*stride];
+                ftIn[q] = ft[i0 + q*stride];
+            }
+            envelope1D(&f[0], &ftIn[0], n, h2, &d[0], &ftOut[0], &v[0], &z[0]);
+            for (int q=0;q<n;++q) {
+                d2[i0 + q*stride] = d[q];
+                ft[i0 + q*stride] = ftOut[q];
+            }
+        }
+    }
+}
+
+
+template<class T>
+static void initFeatures(const T* bw, const size_t N, double* d2, ptrdiff_t* ft) {
+    const double inf = numeric_limits<double>::infinity();
+    for (size_t i=0;i<N;++i) {
+        bool on = bw[i]!=0;
+        d2[i] = on ? 0.0 : inf;
+        ft[i] = on ? (ptrdiff_t)i : -1;
+    }
+}
+
+
+template<class I>
+static void copyIndices(const vector<ptrdiff_t>& ft, I* idx) {
+    size_t N = ft.size();
+    for (size_t i=0;i<N;++i) {
+        idx[i] = (I)(ft[i] + 1);
+    }
+}
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+    if (nrhs < 1 || nrhs > 2)
+        mexErrMsgTxt("Usage: [D, idx] = euclideanDistanceTransform(bw, {spacing}).");
+    if (nlhs > 2)
+        mexErrMsgTxt("Too many output arguments.");
+
+    const mxArray* bw = prhs[0];
+    if (!(mxIsLogical(bw) || mxIsNumeric(bw)) || mxIsComplex(bw))
+        mexErrMsgTxt("The input must be a real numeric or logical array.");
+
+    int nd = (int)mxGetNumberOfDimensions(bw);
+    const mwSize* mdims = mxGetDimensions(bw);
+    vector<size_t> dims(mdims, mdims+nd);
+    size_t N = mxGetNumberOfElements(bw);
+
+    vector<double> spacing(nd, 1.0);
+    if (nrhs > 1 && !mxIsEmpty(prhs[1])) {
+        if (!mxIsDouble(prhs[1]))
+            mexErrMsgTxt("The spacing must be a double vector.");
+        const double* s = mxGetPr(prhs[1]);
+        int ns = (int)mxGetNumberOfElements(prhs[1]);
+        for (int k=0;k<ns;++k) {
+            if (!(s[k] > 0.0))
+                mexErrMsgTxt("The spacing must be positive.");
+            if (k < nd) {
+                spacing[k] = s[k];
+            }
+        }
+    }
+
+    plhs[0] = mxCreateNumericArray(nd, mdims, mxDOUBLE_CLASS, mxREAL);
+    if (N==0) {
+        if (nlhs > 1)
+            plhs[1] = mxCreateNumericArray(nd, mdims, mxUINT32_CLASS, mxREAL);
+        return;
+    }
+    double* D = mxGetPr(plhs[0]);
+    vector<ptrdiff_t> ft(N);
+
+    switch (mxGetClassID(bw)) {
+        case mxLOGICAL_CLASS: initFeatures(mxGetLogicals(bw), N, D, &ft[0]); break;
+        case mxDOUBLE_CLASS: initFeatures(mxGetPr(bw), N, D, &ft[0]); break;
+        case mxSINGLE_CLASS: initFeatures((const float*)mxGetData(bw), N, D, &ft[0]); break;
+        case mxINT8_CLASS: initFeatures((const signed char*)mxGetData(bw), N, D, &ft[0]); break;
+        case mxUINT8_CLASS: initFeatures((const unsigned char*)mxGetData(bw), N, D, &ft[0]); break;
+        case mxINT16_CLASS: initFeatures((const short*)mxGetData(bw), N, D, &ft[0]); break;
+        case mxUINT16_CLASS: initFeatures((const unsigned short*)mxGetData(bw), N, D, &ft[0]); break;
+        case mxINT32_CLASS: initFeatures((const int*)mxGetData(bw), N, D, &ft[0]); break;
+        case mxUINT32_CLASS: initFeatures((const unsigned int*)mxGetData(bw), N, D, &ft[0]); break;
+        case mxINT64_CLASS: initFeatures((const long long*)mxGetData(bw), N, D, &ft[0]); break;
+        case mxUINT64_CLASS: initFeatures((const unsigned long long*)mxGetData(bw), N, D, &ft[0]); break;
+        default: mexErrMsgTxt("Unsupported input class.");
+    }
+
+    // squared distances, one dimension after the other
+    for (int k=0;k<nd;++k) {
+        if (dims[k] > 1) {
+            transformDimension(D, &ft[0], dims, k, spacing[k]);
+        }
+    }
+
+    long nN = (long)N;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (long i=0;i<nN;++i) {
+        D[i] = sqrt(D[i]);
+    }
+
+    if (nlhs > 1) {
+        if ((unsigned long long)N < (1ULL << 32)) {
+            plhs[1] = mxCreateNumericArray(nd, mdims, mxUINT32_CLASS, mxREAL);
+            copyIndices(ft, (unsigned int*)mxGetData(plhs[1]));
+        } else {
+            plhs[1] = mxCreateNumericArray(nd, mdims, mxUINT64_CLASS, mxREAL);
+            copyIndices(ft, (unsigned long long*)mxGetData(plhs[1]));
+        }
+    }
+}
@@ -3,6 +3,7 @@ function [ imMultiscaleLoGResponse, varargout ] = filterMultiscaleLoGND( imInput
 % 
 %     [ imMultiscaleLoGResponse ] = filterMultiscaleLoGND(imInput, sigmaValues, varargin );
 %     [ imMultiscaleLoGResponse, pixelScaleMap ] = filterMultiscaleLoGND(imInput, sigmaValues, varargin );
+%     [ imMultiscaleLoGResponse, pixelScaleMap, blobCandidates ] = filterMultiscaleLoGND(imInput, sigmaValues, varargin );
 % 
 %     Required Input Arguments:
 % 
@@ -49,6 +50,16 @@ function [ imMultiscaleLoGResponse, varargout ] = filterMultiscaleLoGND( imInput
 %                                   True - Uses GPU if installed
 %                                   False - otherwise (default-value)
 % 
+%                        UseMex: true/false
+%                                For 2D/3D images with 'symmetric' or 
+%                                'replicate' borders, use the native
+%                                engine multiscaleLoG (if compiled), which
+%                                smoothes the image incrementally from one
+%                                scale to the next with discrete Gaussian
+%                                kernels. Its memory usage does not depend
+%                                on the number of scales.
+%                                Default: true
+% 
 %     Output Arguments:
 % 
 %       imMultiscaleLoGResponse: Response of the multiscale LoG Filter
@@ -57,6 +68,10 @@ function [ imMultiscaleLoGResponse, varargout ] = filterMultiscaleLoGND( imInput
 %                                scale/sigma at which the LoG response 
 %                                was optimal accross the scale space
 % 
+%                blobCandidates: linear indices of the negative local
+%                                minima of the response in their 3x3(x3)
+%                                neighborhood (bright blob candidates)
+% 
 %     Example: Application of LoG to flat 1D Ridges of varying widths
 %         
 %         step = @(x) ( double( x >= 0 ) ); % 1-D step edge
@@ -103,6 +118,7 @@ function [ imMultiscaleLoGResponse, varargout ] = filterMultiscaleLoGND( imInput
     p.addParamValue( 'UseNormalizedGaussian', true, @(x) (isscalar(x) && islogical(x)) );    
     p.addParamValue( 'debugMode', false, @(x) (isscalar(x) && islogical(x)) );    
     p.addParamValue( 'UseGPU', false, @(x) (isscalar(x) && islogical(x)) );
+    p.addParamValue( 'UseMex', true, @(x) (isscalar(x) && islogical(x)) );
     p.parse( imInput, sigmaValues, varargin{:} );
     
     spacing = p.Results.spacing;
@@ -110,6 +126,20 @@ function [ imMultiscaleLoGResponse, varargout ] = filterMultiscaleLoGND( imInput
     flagNormalizeGaussian = p.Results.UseNormalizedGaussian;
     flagDebugMode = p.Results.debugMode;
     flagUseGPU = p.Results.UseGPU;
+    flagUseMex = p.Results.UseMex;
+    
+    % native engine: all scales in a single pass, without keeping the response of each scale
+    if flagUseMex && ~flagUseGPU && flagNormalizeGaussian && ismember(ndims(imInput), [2 3]) && ...
+       ischar(borderCondition) && ismember(lower(borderCondition), {'symmetric', 'replicate'}) && ...
+       exist('multiscaleLoG', 'file')==3
+        
+        if ~isfloat(imInput)
+            imInput = double(imInput);
+        end
+        [ imMultiscaleLoGResponse, varargout{1:max(nargout-1,0)} ] = multiscaleLoG( imInput, sigmaValues, ...
+                                                                                  spacing, lower(borderCondition) );
+        return;
+    end
     
     % Run the LoG filter accross the scale space and record the optimal
     % response and the scale at which the optimal response was found for
@@ -159,5 +189,10 @@ function [ imMultiscaleLoGResponse, varargout ] = filterMultiscaleLoGND( imInput
         varargout{1} = pixelScaleMap;
     end
     
+    if nargout > 2
+        varargout{2} = find( imMultiscaleLoGResponse < 0 & ...
+                             imMultiscaleLoGResponse == imerode(imMultiscaleLoGResponse, ones(3*ones(1,ndims(imInput)))) );
+    end
+    
 end
 
@@ -1,14 +1,19 @@
-/* [] = binterp(signal, coords);
+/* [fi, ...] = binterp(signal, xi, {yi, zi}, {borderCondition});
+ * h = binterp('create', signal, {borderCondition});
+ * [fi, ...] = binterp(h, xi, {yi, zi});
+ * binterp('clear', {h});
  *
  * Francois Aguet, May 2012 (last modified May 11, 2012)
  *
  * Compilation:
- * Mac/Linux: mex -I/usr/local/include -I../../mex/include binterp.cpp
- * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT"  -I"..\..\mex\include" binterp.cpp
+ * Mac/Linux: mex -I/usr/local/include -I../../mex/include CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" binterp.cpp
+ * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT /openmp" -I"..\..\mex\include" binterp.cpp
  */
 
-#include <iostream>
-#include <cstring> // memcpy
+#include <cstdio> // sprintf
+#include <string>
+#include <vector>
+#include <map>
 #include <algorithm> // transform
 #include <math.h>
 #include "mex.h"
@@ -16,337 +21,248 @@
 
 using namespace std;
 
-void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
-    
-    //===========================================================
-    // Input checks 
-    //===========================================================
-    /* The required inputs are:
-        input: input signal (1D or 2D)
-        xi: x interpolation coordinates
-        yi: y interpolation coordinates
-       Other relevant variables:
-        N: number of points in input    
-        ni: number of interpolation points
-        vi: interpolated values
-    */
-    
-    if (nrhs<2) {
-        mexErrMsgTxt("Insufficient inputs.");
+
+// Interpolators (spline coefficients) kept between calls, see binterp('create', ...)
+static map<unsigned int, Interpolator*> handles;
+static unsigned int lastHandle = 0;
+
+static void clearHandles() {
+    for (map<unsigned int, Interpolator*>::iterator it=handles.begin();it!=handles.end();++it) {
+        delete it->second;
     }
-    
-    // check image/signal
-    if (!mxIsDouble(prhs[0]) || mxGetNumberOfDimensions(prhs[0]) != 2) // Matlab 1D signals have 2 dimensions
-        mexErrMsgTxt("Input must be a 1D or 2D signal (double array).");
-    int nx = (int)mxGetN(prhs[0]); // #cols
-    int ny = (int)mxGetM(prhs[0]);
-    int N = nx*ny;
-    double* input = mxGetPr(prhs[0]);
-    
-    int dims;
-    if (nx==1 || ny==1) {
-        dims = 1;
-        if (nx==1) { // use x coordinate as index
-            nx = ny;
-            ny = 1;
-        }
-    } else {
-        dims = 2;
+    handles.clear();
+}
+
+
+static int parseBorderCondition(const mxArray* a) {
+    if (!mxIsChar(a)) { // border condition
+        mexErrMsgTxt("Border condition must be identifier string: 'mirror' or 'periodic'.");
     }
-    
-    // check input number and type
-    if (dims==1 && nrhs!=2 && !(nrhs==3 && mxIsChar(prhs[2]))) {
-        mexErrMsgTxt("Incompatible input. For 1D signals, inputs should be:\nbinterp(signal, coordinates, {'mirror'|'periodic'})");
+    // parse border conditions
+    size_t nchar = mxGetNumberOfElements(a)+1;
+    char *ch = new char[nchar];
+    int f = mxGetString(a, ch,  nchar);
+    if (f!=0) {
+        mexErrMsgTxt("Error parsing border condition.");
     }
-    if (dims==2 && nrhs!=3 && !(nrhs==4 && mxIsChar(prhs[3]))) {
-        mexErrMsgTxt("Incompatible input. For 2D signals, inputs should be:\nbinterp(signal, x-coordinates, y-coordinates, {'mirror'|'periodic'})");
+    string str = ch;
+    delete[] ch;
+    int (*pf)(int) = tolower;
+    transform(str.begin(), str.end(), str.begin(), pf);
+    if (str.compare("mirror")==0 || str.compare("symmetric")==0) {
+        return Interpolator::MIRROR;
+    } else if (str.compare("periodic")==0) {
+        return Interpolator::PERIODIC;
+    }
+    mexErrMsgTxt("Unsupported border conditions.");
+    return Interpolator::MIRROR;
+}
+
+
+// Dimensionality of the signal and its size along each dimension of the Interpolator.
+// The Matlab array is not transposed: dimension 0 of the Interpolator runs along the rows (y).
+static int getSignalSize(const mxArray* signal, int n[]) {
+    int nd = (int)mxGetNumberOfDimensions(signal);
+    if (!mxIsDouble(signal) || nd > 3) // Matlab 1D signals have 2 dimensions
+        mexErrMsgTxt("Input must be a 1D, 2D or 3D signal (double array).");
+    const mwSize* dims = mxGetDimensions(signal);
+    n[0] = (int)dims[0];
+    n[1] = (int)dims[1];
+    n[2] = nd==3 ? (int)dims[2] : 1;
+    if (nd==3) {
+        return 3;
+    }
+    if (n[0]==1 || n[1]==1) {
+        n[0] = n[0]*n[1];
+        n[1] = 1;
+        return 1;
     }
-    
+    return 2;
+}
+
+
+static Interpolator* createInterpolator(const mxArray* signal, const int n[], const int borderCondition) {
+    size_t N = mxGetNumberOfElements(signal);
+    const double* input = mxGetPr(signal);
     // check for NaNs in input, as these will result in a crash
-    for (int i=0;i<N;++i) {
+    for (size_t i=0;i<N;++i) {
         if (mxIsNaN(input[i])) {
             mexErrMsgTxt("Input contains NaNs.");
             break;
         }
     }
-    
-    // get x interpolation coordinates
-    if (!mxIsDouble(prhs[1]) || mxGetNumberOfDimensions(prhs[1]) != 2)
-        mexErrMsgTxt("Interpolation coordinates must match dimensionality of input.");
-    int nx_X = (int)mxGetN(prhs[1]);
-    int ny_X = (int)mxGetM(prhs[1]);
-    int ni = nx_X*ny_X;
-    
-    const double* xin = mxGetPr(prhs[1]);
-    double* xi = new double[ni];
-    
-    // verify that coordinates are within correct range ([0 ... nx+1])
-    for (int i=0;i<ni;++i) {
-        if (mxIsNaN(xin[i]) || xin[i]<0.0 || xin[i]>nx+1.0) {
-            mexErrMsgTxt("x-interpolation coordinates must be real-valued in interval [0..nx+1] (data range: [1..nx]).");
-            break;
-        } else {
-            xi[i] = xin[i] - 1.0; // internal index starts at 0, Matlab at 1
-        }
-    }
-    
-    // get y interpolation coordinates
-    double* yi = NULL;
-    if (dims==2) {
-        if (!mxIsDouble(prhs[2]) || mxGetNumberOfDimensions(prhs[2]) != 2)
-        mexErrMsgTxt("Interpolation coordinates must match dimensionality of input.");
-        int nx_Y = (int)mxGetN(prhs[2]);
-        int ny_Y = (int)mxGetM(prhs[2]);
-        if (nx_X!=nx_Y || ny_X!=ny_Y) {
+    return new Interpolator(input, n[0], n[1], n[2], borderCondition, 3);
+}
+
+
+// Dimensions of the Interpolator along which xi, yi, zi run: for 2D and 3D signals,
+// xi runs along the columns (dimension 1) and yi along the rows (dimension 0)
+static void getAxes(const int dims, int axis[]) {
+    axis[0] = dims>1 ? 1 : 0;
+    axis[1] = dims>1 ? 0 : 1;
+    axis[2] = 2;
+}
+
+
+// Interpolation coordinates (Matlab: 1-based), converted to 0-based coordinates of the Interpolator
+static void getCoordinates(int nlhs, const mxArray* const coordArrays[], const int dims, const int n[], vector<vector<double> >& coords) {
+
+    if (nlhs > 1+2*dims)
+        mexErrMsgTxt("Too many output arguments.");
+
+    static const char names[] = "xyz";
+    char msg[200];
+    int axis[3];
+    getAxes(dims, axis);
+    size_t ni = mxGetNumberOfElements(coordArrays[0]);
+    coords.resize(dims);
+    for (int k=0;k<dims;++k) {
+        const mxArray* a = coordArrays[k];
+        if (!mxIsDouble(a))
+            mexErrMsgTxt("Interpolation coordinates must match dimensionality of input.");
+        if (mxGetNumberOfDimensions(a)!=mxGetNumberOfDimensions(coordArrays[0]) ||
+            !equal(mxGetDimensions(a), mxGetDimensions(a)+mxGetNumberOfDimensions(a), mxGetDimensions(coordArrays[0])))
             mexErrMsgTxt("Sizes of interpolation coordinate arrays must match.");
-        }
-        const double* yin = mxGetPr(prhs[2]);
-        yi = new double[ni];
-        // verify that coordinates are within signal range
-        for (int i=0;i<ni;++i) {
-            if (mxIsNaN(yin[i]) || yin[i]<0.0 || yin[i]>ny+1.0) {
-                mexErrMsgTxt("y-interpolation coordinates must be real-valued in interval [0..ny+1] (data range: [1..ny]).");
-                break;
-            } else {
-                yi[i] = yin[i] - 1.0;
+
+        // verify that coordinates are within correct range ([0 ... n+1])
+        int nk = n[axis[k]];
+        const double* in = mxGetPr(a);
+        vector<double>& out = coords[axis[k]];
+        out.resize(ni);
+        for (size_t i=0;i<ni;++i) {
+            if (mxIsNaN(in[i]) || in[i]<0.0 || in[i]>nk+1.0) {
+                sprintf(msg, "%c-interpolation coordinates must be real-valued in interval [0..n%c+1] (data range: [1..n%c]).", names[k], names[k], names[k]);
+                mexErrMsgTxt(msg);
             }
+            out[i] = in[i] - 1.0; // internal index starts at 0, Matlab at 1
         }
     }
-    
-    
-    // check border condition input
-    int bcIdx = 0;
-    if (dims==1 && nrhs==3) {
-        bcIdx = 2;
-    } else if (dims==2 && nrhs==4) {
-        bcIdx = 3;
-    }
-    
-    // default border conditions
-    int borderCondition = Interpolator::MIRROR;
-    if (bcIdx!=0) {
-        if (!mxIsChar(prhs[bcIdx])) { // border condition
-            mexErrMsgTxt("Border condition must be identifier string: 'mirror' or 'periodic'.");
-        }        
-        // parse border conditions
-        size_t nchar = mxGetNumberOfElements(prhs[bcIdx])+1;
-        char *ch = new char[nchar];
-        int f = mxGetString(prhs[bcIdx], ch,  nchar);
-        if (f!=0) {
-            mexErrMsgTxt("Error parsing border condition.");
-        }
-        string str = ch;
-        delete ch;
-        int (*pf)(int) = tolower;
-        transform(str.begin(), str.end(), str.begin(), pf);
-        if (str.compare("mirror")==0 || str.compare("symmetric")==0) {
-            borderCondition = Interpolator::MIRROR;
-        } else if (str.compare("periodic")==0) {
-            borderCondition = Interpolator::PERIODIC;
-        } else {
-            mexErrMsgTxt("Unsupported border conditions.");
-        }
-    }
-    
-    //===========================================================
-    // Perform interpolation
-    //===========================================================
-    // Transpose for row-major index (Matlab uses column-major)
-    double* pixels = new double[N];
-    div_t divRes;
-    for (int i=0;i<N;++i) {
-        divRes = div(i, ny);
-        pixels[divRes.quot+divRes.rem*nx] = input[i];
-    }
-    
-    // The 'xi' and 'yi' matrices do not need transposition, they contain independent indexes.
-    // As a result, the interpolated array 'vi' is already in the correct order for Matlab.
-    Interpolator ip = Interpolator(pixels, nx, ny, borderCondition);
-    double* vi = new double[ni]; // interpolated values
-    if (dims==1) {
-        ip.interp(xi, ni, vi);
-    } else if (dims==2) {
-        ip.interp(xi, yi, ni, vi);
-    }
+}
 
-    
-    //===========================================================
-    // Return results to Matlab
-    //===========================================================
-    if (nlhs > 0) {
-        plhs[0] = mxCreateDoubleMatrix(ny_X, nx_X, mxREAL);
-        memcpy(mxGetPr(plhs[0]), vi, ni*sizeof(double));
+
+// Outputs: interpolated values, then the 1st and the 2nd partial derivatives along x, y, z.
+// The interpolation coordinates contain independent indexes: the outputs have the size of 'xi'
+// and are already in the correct order for Matlab.
+static void interpolate(int nlhs, mxArray *plhs[], const Interpolator& ip, const vector<vector<double> >& coords, const mxArray* xi) {
+
+    int dims = ip.getDims();
+    int axis[3];
+    getAxes(dims, axis);
+    const double* c[3];
+    for (int d=0;d<dims;++d) {
+        c[d] = &coords[d][0];
     }
-    
-    if (nlhs>1 && dims==1) {
+    int ni = (int)mxGetNumberOfElements(xi);
+    mwSize nd = mxGetNumberOfDimensions(xi);
+    const mwSize* outDims = mxGetDimensions(xi);
 
-        double* xip = new double[ni];
-        double* xim = new double[ni];
-        double* vip = new double[ni];
-        double* vim = new double[ni];
-        for (int i=0;i<ni;++i) {
-            xip[i] = xi[i]+0.5; // some values will fall outside of signal range, 'wrap()' in interp takes care of that
-            xim[i] = xi[i]-0.5;
-        }
-        ip.interp(xip, ni, vip, 2); // compute using degree 2 spline (derivative of 3 -> 2)
-        ip.interp(xim, ni, vim, 2);
-        
-        //B1(x+0.5) - B1(x-0.5);
-        for (int i=0;i<ni;++i) {
-            vip[i] -= vim[i];
-        }
-        plhs[1] = mxCreateDoubleMatrix(ny_X, nx_X, mxREAL);
-        memcpy(mxGetPr(plhs[1]), vip, ni*sizeof(double));
-        
-        delete vim;
-        delete vip;
-        delete xim;
-        delete xip;
+    int order[3] = {0, 0, 0};
+    plhs[0] = mxCreateNumericArray(nd, outDims, mxDOUBLE_CLASS, mxREAL);
+    ip.interp(c, ni, order, mxGetPr(plhs[0]));
+    for (int k=1;k<nlhs;++k) {
+        int d = axis[(k-1) % dims];
+        order[d] = k<=dims ? 1 : 2;
+        plhs[k] = mxCreateNumericArray(nd, outDims, mxDOUBLE_CLASS, mxREAL);
+        ip.interp(c, ni, order, mxGetPr(plhs[k]));
+        order[d] = 0;
     }
-    
-    if (nlhs>2 && dims==1) {
-                
-        double* xip = new double[ni];
-        double* xim = new double[ni];
-        double* vip = new double[ni];
-        double* vi0 = new double[ni];
-        double* vim = new double[ni];
-        
-        for (int i=0;i<ni;++i) {
-            xip[i] = xi[i]+1.0; // some values will fall outside of signal range, 'wrap()' in interp takes care of that
-            xim[i] = xi[i]-1.0;
-        }
-        ip.interp(xip, ni, vip, 1); // compute using degree 1 spline (2nd derivative of 3 -> 1)
-        ip.interp(xim, ni, vim, 1);
-        ip.interp(xi, ni, vi0, 1);
-        
-        //B1(x-1) - 2*B1(x) + B1(x+1);
-        for (int i=0;i<ni;++i) {
-            vip[i] += vim[i] - 2.0*vi0[i];
-        }
-        
-        plhs[2] = mxCreateDoubleMatrix(ny_X, nx_X, mxREAL);
-        memcpy(mxGetPr(plhs[2]), vip, ni*sizeof(double));
-        
-        delete vim;
-        delete vi0;
-        delete vip;
-        delete xim;
-        delete xip;
+}
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+    if (nrhs<1) {
+        mexErrMsgTxt("Insufficient inputs.");
     }
-    
-    if (dims==2) {    
-        if (nlhs>1) {
 
-            double* xip = new double[ni];
-            double* xim = new double[ni];
-            double* vip = new double[ni];
-            double* vim = new double[ni];
-            
-            // dx
-            for (int i=0;i<ni;++i) {
-                xip[i] = xi[i]+0.5; // some values will fall outside of signal range, 'wrap()' in interp takes care of that
-                xim[i] = xi[i]-0.5;
-            }
-            ip.interp(xip, yi, ni, vip, 2); // compute using degree 2 spline (derivative of 3 -> 2)
-            ip.interp(xim, yi, ni, vim, 2);
-            for (int i=0;i<ni;++i) {
-                vip[i] -= vim[i];
-            }
-            plhs[1] = mxCreateDoubleMatrix(ny_X, nx_X, mxREAL);
-            memcpy(mxGetPr(plhs[1]), vip, ni*sizeof(double));
-            
-            if (nlhs>2) {
-                // dy
-                for (int i=0;i<ni;++i) {
-                    xip[i] = yi[i]+0.5;
-                    xim[i] = yi[i]-0.5;
-                }
-                ip.interp(xi, xip, ni, vip, 2);
-                ip.interp(xi, xim, ni, vim, 2);
-                for (int i=0;i<ni;++i) {
-                    vip[i] -= vim[i];
-                }
-                plhs[2] = mxCreateDoubleMatrix(ny_X, nx_X, mxREAL);
-                memcpy(mxGetPr(plhs[2]), vip, ni*sizeof(double));
-            }
-            
-            delete vim;
-            delete vip;
-            delete xim;
-            delete xip;
-        }
-        if (nlhs>3) {
-            double* xip = new double[ni];
-            double* xim = new double[ni];
-            double* vip = new double[ni];
-            double* vi0 = new double[ni];
-            double* vim = new double[ni];
-            
-            // d2x
-            for (int i=0;i<ni;++i) {
-                xip[i] = xi[i]+1.0;
-                xim[i] = xi[i]-1.0;
-            }
-            ip.interp(xip, yi, ni, vip, 1);
-            ip.interp(xim, yi, ni, vim, 1);
-            ip.interp(xi, yi, ni, vi0, 1);
-            for (int i=0;i<ni;++i) {
-                vip[i] += vim[i] - 2.0*vi0[i];
+    //===========================================================
+    // Handles: binterp('create', signal, {borderCondition}), binterp('clear', {h})
+    //===========================================================
+    if (mxIsChar(prhs[0])) {
+        char* cmd = mxArrayToString(prhs[0]);
+        string str = cmd==NULL ? "" : cmd;
+        mxFree(cmd);
+        if (str.compare("create")==0) {
+            if (nrhs<2 || nrhs>3)
+                mexErrMsgTxt("Usage: h = binterp('create', signal, {'mirror'|'periodic'})");
+            int n[3];
+            getSignalSize(prhs[1], n);
+            int borderCondition = nrhs==3 ? parseBorderCondition(prhs[2]) : Interpolator::MIRROR;
+            Interpolator* ip = createInterpolator(prhs[1], n, borderCondition);
+            if (handles.empty()) {
+                mexAtExit(clearHandles);
             }
-            plhs[3] = mxCreateDoubleMatrix(ny_X, nx_X, mxREAL);
-            memcpy(mxGetPr(plhs[3]), vip, ni*sizeof(double));
-            
-            if (nlhs>4) {
-                // d2y
-                for (int i=0;i<ni;++i) {
-                    xip[i] = yi[i]+1.0;
-                    xim[i] = yi[i]-1.0;
-                }
-                ip.interp(xi, xip, ni, vip, 1);
-                ip.interp(xi, xim, ni, vim, 1);
-                ip.interp(xi, yi, ni, vi0, 1);
-                for (int i=0;i<ni;++i) {
-                    vip[i] += vim[i] - 2.0*vi0[i];
+            handles[++lastHandle] = ip;
+            plhs[0] = mxCreateNumericMatrix(1, 1, mxUINT32_CLASS, mxREAL);
+            *(unsigned int*)mxGetData(plhs[0]) = lastHandle;
+        } else if (str.compare("clear")==0) {
+            if (nrhs==1) {
+                clearHandles();
+            } else {
+                if (!mxIsUint32(prhs[1]))
+                    mexErrMsgTxt("Invalid interpolator handle.");
+                const unsigned int* h = (const unsigned int*)mxGetData(prhs[1]);
+                for (size_t i=0;i<mxGetNumberOfElements(prhs[1]);++i) {
+                    map<unsigned int, Interpolator*>::iterator it = handles.find(h[i]);
+                    if (it!=handles.end()) {
+                        delete it->second;
+                        handles.erase(it);
+                    }
                 }
-                plhs[4] = mxCreateDoubleMatrix(ny_X, nx_X, mxREAL);
-                memcpy(mxGetPr(plhs[4]), vip, ni*sizeof(double));
             }
-            
-            delete vim;
-            delete vi0;
-            delete vip;
-            delete xim;
-            delete xip;
-            
+        } else {
+            mexErrMsgTxt("Unsupported command. Use 'create' or 'clear'.");
         }
+        return;
     }
-    
+
     //===========================================================
-    // De-allocate
+    // Interpolation with the coefficients of a handle
     //===========================================================
-    delete xi;
-    delete vi;
-    
-    if (dims>1) {
-        delete yi;
+    if (mxIsUint32(prhs[0])) {
+        map<unsigned int, Interpolator*>::iterator it = handles.end();
+        if (mxGetNumberOfElements(prhs[0])==1) {
+            it = handles.find(*(const unsigned int*)mxGetData(prhs[0]));
+        }
+        if (it==handles.end())
+            mexErrMsgTxt("Invalid interpolator handle.");
+        const Interpolator& ip = *it->second;
+        int dims = ip.getDims();
+        if (nrhs!=1+dims)
+            mexErrMsgTxt("Incompatible input. The number of coordinate arrays must match the dimensionality of the signal.");
+        int n[3] = {ip.getSize(0), ip.getSize(1), ip.getSize(2)};
+        vector<vector<double> > coords;
+        getCoordinates(nlhs, prhs+1, dims, n, coords);
+        interpolate(nlhs, plhs, ip, coords, prhs[1]);
+        return;
     }
-    
-}
 
-// compiled with:
-// export DYLD_LIBRARY_PATH=/Applications/MATLAB_R2012a.app/bin/maci64 && g++ -Wall -g -DARRAY_ACCESS_INLINING -I. -L/Applications/MATLAB_R2012a.app/bin/maci64 -I../../mex/include/ -I/Applications/MATLAB_R2012a.app/extern/include binterp.cpp -lmx -lmex
-// tested with:
-// valgrind --tool=memcheck --leak-check=full --show-reachable=yes ./a.out 2>&1 | grep binterp
+    //===========================================================
+    // Interpolation of a signal
+    //===========================================================
+    int n[3];
+    int dims = getSignalSize(prhs[0], n);
 
-/*int main(void) {
-    double f[] = {1.0, 2.0, 3.0};
-    double xi[] = {1.0, 1.5, 2.0, 2.5, 3.0};
-    
-    Interpolator ip = Interpolator(f, 3, 1);
-    int nxi = 5;
-    double* vi = new double[nxi];
+    // check input number and type
+    if (dims==1 && nrhs!=2 && !(nrhs==3 && mxIsChar(prhs[2]))) {
+        mexErrMsgTxt("Incompatible input. For 1D signals, inputs should be:\nbinterp(signal, coordinates, {'mirror'|'periodic'})");
+    }
+    if (dims==2 && nrhs!=3 && !(nrhs==4 && mxIsChar(prhs[3]))) {
+        mexErrMsgTxt("Incompatible input. For 2D signals, inputs should be:\nbinterp(signal, x-coordinates, y-coordinates, {'mirror'|'periodic'})");
+    }
+    if (dims==3 && nrhs!=4 && !(nrhs==5 && mxIsChar(prhs[4]))) {
+        mexErrMsgTxt("Incompatible input. For 3D signals, inputs should be:\nbinterp(signal, x-coordinates, y-coordinates, z-coordinates, {'mirror'|'periodic'})");
+    }
 
-    ip.interp(xi, nxi, vi);
-    //ip.interp(xi, yi, ni, vi);
-}*/
+    // default border conditions
+    int borderCondition = Interpolator::MIRROR;
+    if (nrhs==dims+2) {
+        borderCondition = parseBorderCondition(prhs[dims+1]);
+    }
+
+    vector<vector<double> > coords;
+    getCoordinates(nlhs, prhs+1, dims, n, coords);
+    Interpolator* ip = createInterpolator(prhs[0], n, borderCondition);
+    interpolate(nlhs, plhs, *ip, coords, prhs[1]);
+    delete ip;
+}
@@ -1,17 +1,23 @@
-%[fi, fi_dx, fi_d2x] = binterp(f, xi, borderCondition) returns the cubic spline interpolation of 1D or 2D input signal.
+%[fi, fi_dx, fi_d2x] = binterp(f, xi, borderCondition) returns the cubic spline interpolation of 1D, 2D, or 3D input signal.
 %
 %   1D: [fi, fi_dx, fi_d2x] = binterp(f, xi, {borderCondition})
 %   2D: [fi, fi_dx, fi_dy, fi_d2x, fi_d2y] = binterp(f, xi, yi, {borderCondition})
+%   3D: [fi, fi_dx, fi_dy, fi_dz, fi_d2x, fi_d2y, fi_d2z] = binterp(f, xi, yi, zi, {borderCondition})
+%
+% The spline coefficients can be computed once and kept for subsequent interpolations:
+%   h = binterp('create', f, {borderCondition});
+%   [fi, ...] = binterp(h, xi, {yi, zi});
+%   binterp('clear', h); % or binterp('clear') to release all handles
 %
 % Inputs: 
-%                  f : input signal or image
-%             xi, yi : interpolation coordinates (must be of same size)
+%                  f : input signal, image, or volume
+%         xi, yi, zi : interpolation coordinates (must be of same size)
 %  {borderCondition} : 'mirror' (default) or 'periodic'
 %
 % Outputs: 
-%                 fi : interpolated signal/image
-%       fi_dx, fi_dy : 1st partial derivatives of input signal/image at interpolation coordinates
-%     fi_d2x, fi_d2y : 2nd partial derivatives of input signal/image at interpolation coordinates
+%                 fi : interpolated signal/image/volume
+%   fi_dx, fi_dy, .. : 1st partial derivatives of input at interpolation coordinates
+% fi_d2x, fi_d2y, .. : 2nd partial derivatives of input at interpolation coordinates
 %
 % For more information, see:
 % [1] Unser, IEEE Signal Proc. Mag. 16(6), pp. 22-38, 1999
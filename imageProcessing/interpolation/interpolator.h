@@ -1,4 +1,10 @@
-/* B-spline based interpolation. Implementation for 1D and 2D signals
+/* B-spline based interpolation. Implementation for 1D, 2D and 3D signals
+ *
+ * Signals are linearly indexed with the first dimension contiguous: (x,y,z) -> x + y*nx + z*nx*ny.
+ * The spline coefficients are computed once, by the constructor; the Interpolator can then be
+ * used for any number of interpolations. With cubic splines, the partial derivatives of order 1
+ * and 2 of the interpolant can be evaluated along each dimension.
+ * The prefilter and the interpolation are distributed over threads (OpenMP).
  *
  * References
  * [1] Unser, IEEE Signal Proc. Mag. 16(6), pp. 22-38, 1999
@@ -10,90 +16,115 @@
 #ifndef INTERPOLATOR_H
 #define INTERPOLATOR_H
 
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "separableConvolution.h" // border extension
+
 namespace std {
 
 class Interpolator {
-    
+
  public:
-    
+
     typedef void (*SplineFctPtr)(const double t, double v[]);
-    
-    // Border conditions
+
+    // Border conditions (same values as in Convolver)
     static const int PERIODIC = 2;
     static const int MIRROR = 3;
-    
+
+    Interpolator(const double pixels[], const int nx, const int ny, const int nz, const int borderCondition, const int degree);
     Interpolator(const double pixels[], const int nx, const int ny, const int borderCondition, const int degree);
     Interpolator(const double pixels[], const int nx, const int ny, const int borderCondition);
     Interpolator(const double pixels[], const int nx, const int ny);
-    void init(const double pixels[], const int nx, const int ny, const int borderCondition, const int degree);
-    
-    ~Interpolator();
-    
-    double* getCoefficients() { return coefficients_; };
+    void init(const double pixels[], const int nx, const int ny, const int nz, const int borderCondition, const int degree);
+
+    double* getCoefficients() { return &coefficients_[0]; };
+    int getDims() const { return dims_; };
+    int getSize(const int d) const { return n_[d]; };
+
+    // Values (order 0) or partial derivatives (order 1 or 2, cubic splines only) along each
+    // dimension d < dims of the interpolant at the points (coords[0][i], coords[1][i], ...)
+    void interp(const double* const coords[], const int N, const int order[], double values[]) const;
     // 1D interpolation
-    void interp(const double x[], const int nxi, double values[], int n);
-    void interp(const double x[], const int nxi, double values[]);
+    void interp(const double x[], const int N, double values[]) const;
     // 2D interpolation
-    void interp(const double x[], const double y[], const int N, double values[], int n);
-    void interp(const double x[], const double y[], const int N, double values[]);
-    
+    void interp(const double x[], const double y[], const int N, double values[]) const;
+    // 3D interpolation
+    void interp(const double x[], const double y[], const double z[], const int N, double values[]) const;
+
  private:
-    int nx_, ny_, N_, dims_;
+    int n_[3];
+    size_t N_;
+    int dims_;
     int degree_; // degree of the spline. 1: linear, 2: quadratic, 3: cubic
     double a_, c0_;
-    
-    const double* pixels_;
-    double* coefficients_;
-    double* cp_, *cn_; // used for coefficient calculation
-    double* xi_, *yi_; // interpolation coordinates    
-    int nxi_, nyi_;
-    
+
+    vector<double> coefficients_;
+
     int borderCondition_;
-    
+
     SplineFctPtr splineFctPtr_;
-    
-    void getCausalInitValueX();
-    void getCausalInitValueY();
-    void getAntiCausalInitValueX();
-    void getAntiCausalInitValueY();
-    
+
+    // Number of adjacent lines filtered together along y and z
+    static const int LANES = 16;
+
+    // Weighted sum of samples of a line, for the init values of the recursive filters
+    struct InitTerms {
+        vector<size_t> idx;
+        vector<double> w;
+
+        void set(const vector<double>& weights) {
+            idx.clear();
+            w.clear();
+            for (size_t k=0;k<weights.size();++k) {
+                if (fabs(weights[k]) > 1e-18) {
+                    idx.push_back(k);
+                    w.push_back(weights[k]);
+                }
+            }
+        }
+    };
+
     void computeCoefficients();
-    int wrap(int i, int N);
-    
+    void getInitTerms(const int n, InitTerms& causal, InitTerms& antiCausal) const;
+    void filterLanes(double c[], const int n, const size_t stride, const int m,
+                     const InitTerms& causal, const InitTerms& antiCausal) const;
+    void getWeights(const double x, const int d, const int order, const size_t stride, double w[], size_t idx[]) const;
+
     static void getCubicSpline(const double t, double v[]);
+    static void getCubicSplineDerivative(const double t, double v[]);
+    static void getCubicSplineSecondDerivative(const double t, double v[]);
     static void getQuadraticSpline(const double t, double v[]);
+    static void getLinearSpline(const double t, double v[]);
 
 };
-    
-    //const double Interpolator::a_ = -2.0+sqrt(3.0);
-    //const double Interpolator::c0_ = 6.0;
-    
-    
-    void Interpolator::init(const double pixels[], const int nx, const int ny, const int borderCondition, const int degree) {
-
-        pixels_ = pixels;
-        nx_ = nx;
-        ny_ = ny;
-        N_ = nx*ny;
-        if (nx>1 && ny>1) {
+
+
+    void Interpolator::init(const double pixels[], const int nx, const int ny, const int nz, const int borderCondition, const int degree) {
+
+        n_[0] = nx;
+        n_[1] = ny;
+        n_[2] = nz;
+        N_ = (size_t)nx*ny*nz;
+        if (nz>1) {
+            dims_ = 3;
+        } else if (ny>1) {
             dims_ = 2;
         } else {
             dims_ = 1;
         }
         borderCondition_ = borderCondition;
         degree_ = degree;
-        
-        coefficients_ = new double[N_];
-        cp_ = new double[N_];
-        cn_ = new double[N_];
-        
-        splineFctPtr_ = &getCubicSpline; // default: cubic spline interpolation
-        
+
+        coefficients_.assign(pixels, pixels+N_);
+
         // set filter coefficients
         switch (degree_) {
             case 3:
                 a_ = -2.0+sqrt(3.0);
                 c0_ = 6.0;
+                splineFctPtr_ = &getCubicSpline;
                 break;
             case 2:
                 a_ = -3.0+2.0*sqrt(2.0);
@@ -101,306 +132,252 @@ class Interpolator {
                 splineFctPtr_ = &getQuadraticSpline;
                 break;
             default:
+                splineFctPtr_ = &getLinearSpline;
                 break;
         }
-        
+
         if (degree>1) {
             computeCoefficients();
-        } else {
-            memcpy(coefficients_, pixels_, N_*sizeof(double));
         }
     }
-    
-    
+
+
+    Interpolator::Interpolator(const double pixels[], const int nx, const int ny, const int nz, const int borderCondition, const int degree) {
+        init(pixels, nx, ny, nz, borderCondition, degree);
+    }
+
+
     Interpolator::Interpolator(const double pixels[], const int nx, const int ny, const int borderCondition, const int degree) {
-        init(pixels, nx, ny, borderCondition, degree);
+        init(pixels, nx, ny, 1, borderCondition, degree);
     }
-    
-    
+
+
     Interpolator::Interpolator(const double pixels[], const int nx, const int ny, const int borderCondition) {
-       init(pixels, nx, ny, borderCondition, 3); // Default: cubic spline
+       init(pixels, nx, ny, 1, borderCondition, 3); // Default: cubic spline
     }
-    
-    
+
+
     Interpolator::Interpolator(const double pixels[], const int nx, const int ny) {
-        init(pixels, nx, ny, MIRROR, 3);
+        init(pixels, nx, ny, 1, MIRROR, 3);
     }
-            
-    
-    Interpolator::~Interpolator() {
-        delete coefficients_;
-        delete cp_;
-        delete cn_;
-    }
-    
-    
+
+
+    // Prefilter: causal and anti-causal recursive filters along each dimension with more than one
+    // sample. Along x, the lines are distributed over threads; along y and z, blocks of LANES
+    // adjacent columns are filtered together, so that the recursions run over contiguous samples
+    // (vectorized) and the memory accesses remain sequential.
     void Interpolator::computeCoefficients() {
-        int i;
-        
-        // First filter on x-dimension
-        getCausalInitValueX();
-        for (int y=0;y<ny_;++y) {
-            for (int x=1;x<nx_;++x) {
-                i = x+y*nx_;
-                cp_[i] = pixels_[i] + a_*cp_[i-1];
+        size_t stride = 1;
+        for (int d=0;d<3;++d) {
+            int n = n_[d];
+            if (n>1) {
+                InitTerms causal, antiCausal;
+                getInitTerms(n, causal, antiCausal);
+                long nOuter = (long)(N_/(stride*n));
+                double* c = &coefficients_[0];
+                if (stride==1) {
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+                    for (long o=0;o<nOuter;++o) {
+                        filterLanes(c + o*(size_t)n, n, 1, 1, causal, antiCausal);
+                    }
+                } else {
+                    long nBlocks = (long)((stride+LANES-1)/LANES);
+                    long nItems = nOuter*nBlocks;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+                    for (long it=0;it<nItems;++it) {
+                        size_t o = (size_t)(it/nBlocks);
+                        size_t s = (size_t)(it%nBlocks)*LANES;
+                        int m = (int)std::min((size_t)LANES, stride-s);
+                        filterLanes(c + o*stride*n + s, n, stride, m, causal, antiCausal);
+                    }
+                }
             }
+            stride *= n;
         }
-        getAntiCausalInitValueX();
-        for (int y=0;y<ny_;++y) {
-            for (int x=nx_-2;x>=0;--x) {
-                i = x+y*nx_;
-                cn_[i] = a_*(cn_[i+1]-cp_[i]);
-            }
+    }
+
+
+    // Init values of the causal and anti-causal filters on a line of n samples, as weighted sums
+    // of the samples; the constant component c0 of the prefilter is included in the causal init value.
+    // Weights below 1e-18 are discarded, since the powers of 'a' decay geometrically.
+    void Interpolator::getInitTerms(const int n, InitTerms& causal, InitTerms& antiCausal) const {
+        double a = a_;
+        vector<double> w(n);
+        vector<double> ap(2*n-1); // powers of 'a'
+        ap[0] = 1.0;
+        for (int k=1;k<2*n-1;++k) {
+            ap[k] = ap[k-1]*a;
         }
-        
-        // If signal is 2D, compute coefficients on y-dimension
-        if (dims_==2) {
-            getCausalInitValueY();
-            for (int x=0;x<nx_;++x) {
-                for (int y=1;y<ny_;++y) {
-                    i = x+y*nx_;
-                    cp_[i] = cn_[i] + a_*cp_[i-nx_]; //i-1 on y becomes i-nx
-                }
+
+        if (borderCondition_ == MIRROR) {
+            for (int k=0;k<n;++k) {
+                w[k] = ap[k];
             }
-            getAntiCausalInitValueY();
-            for (int x=0;x<nx_;++x) {
-                for (int y=ny_-2;y>=0;--y) {
-                    i = x+y*nx_;
-                    cn_[i] = a_*(cn_[i+nx_]-cp_[i]);
-                }
+            for (int k=n-2;k>0;--k) { // mirror: loop backwards
+                w[k] += ap[2*n-2-k];
+            }
+            for (int k=0;k<n;++k) {
+                w[k] *= c0_/(1.0-ap[2*n-2]);
+            }
+        } else { // periodic: s[0] + a*s[N-1] + a^2*s[N-2] + ...
+            w[0] = c0_/(1.0-ap[n]);
+            for (int k=1;k<n;++k) {
+                w[n-k] = ap[k]*c0_/(1.0-ap[n]);
             }
         }
-            
-        // Multiply by constant component of prefilter
-        double c0 = c0_;
-        if (dims_==2) {
-            c0 *= c0;
-        }
-        for (int i=0;i<N_;++i) {
-            coefficients_[i] = c0*cn_[i];
+        causal.set(w);
+
+        if (borderCondition_ == MIRROR) { // [1], Box 2 (has errors)
+            std::fill(w.begin(), w.end(), 0.0);
+            w[n-1] = a/(a*a-1.0);
+            w[n-2] = a*a/(a*a-1.0);
+        } else { // periodic: s[N-1] + a*s[0] + a^2*s[1] + ...
+            w[n-1] = -a/(1.0-ap[n]);
+            for (int k=0;k<n-1;++k) {
+                w[k] = -a*ap[k+1]/(1.0-ap[n]);
+            }
         }
+        antiCausal.set(w);
     }
-    
-    
-    // 1D interpolation
-    // Note: degree of interpolating spline/coefficients can be different (i.e., when computing derivatives)
-    void Interpolator::interp(const double x[], const int N, double v[], int n) {
-        
-        SplineFctPtr getSpline = &getCubicSpline; // default
-        if (n==2) {
-            getSpline = &getQuadraticSpline;
-        }
-        
-        int xi;
-        double dx;
-        double b[4];
-        if (n==3 || n==2) {
-            for (int i=0;i<N;++i) {
-                xi = (int)floor(x[i]);
-                dx = x[i] - xi;
-                getSpline(dx, b);
-                v[i] = b[0]*coefficients_[wrap(xi-1,nx_)] + b[1]*coefficients_[wrap(xi,nx_)] + b[2]*coefficients_[wrap(xi+1,nx_)] + b[3]*coefficients_[wrap(xi+2,nx_)];
-            }
-        } else { // linear interpolation
-            int x0, x1;
-            for (int i=0;i<N;++i) {
-                x0 = (int)floor(x[i]);
-                dx = x[i] - x0;
-                x1 = wrap(x0+1, nx_);
-                x0 = wrap(x0, nx_);
-                v[i] = dx*coefficients_[x1] + (1.0-dx)*coefficients_[x0];
+
+
+    // Causal and anti-causal filters on m <= LANES adjacent lines of n samples, in place.
+    // Sample k of line l is c[l + k*stride].
+    void Interpolator::filterLanes(double c[], const int n, const size_t stride, const int m,
+                                   const InitTerms& causal, const InitTerms& antiCausal) const {
+        double a = a_;
+        double c0 = c0_;
+        double init[LANES];
+        int l;
+
+        // causal filter, with the constant component c0
+        std::fill(init, init+m, 0.0);
+        for (size_t t=0;t<causal.idx.size();++t) {
+            const double* p = c + causal.idx[t]*stride;
+            double w = causal.w[t];
+            for (l=0;l<m;++l) {
+                init[l] += w*p[l];
             }
         }
-    }
-    
-    
-    void Interpolator::interp(const double x[], const int N, double v[]) {
-        interp(x, N, v, degree_);
-    }
-    
-    
-    // 2D interpolation
-    void Interpolator::interp(const double x[], const double y[], const int N, double v[], int n) {
-        
-        SplineFctPtr getSpline = &getCubicSpline; // default
-        if (n==2) {
-            getSpline = &getQuadraticSpline;
+        for (l=0;l<m;++l) {
+            c[l] = init[l];
         }
-        
-        int xi, yi;
-        double dx, dy;
-
-        if (n==3 || n==2) {
-            double bx[4], by[4];
-            int row[4], col[4];
-            for (int i=0;i<N;++i) {
-                xi = (int)floor(x[i]);
-                yi = (int)floor(y[i]);
-                dx = x[i]-xi;
-                dy = y[i]-yi;
-                
-                // row index
-                row[0] = wrap(yi-1,ny_);
-                row[1] = wrap(yi,ny_);
-                row[2] = wrap(yi+1,ny_);
-                row[3] = wrap(yi+2,ny_);
-                
-                col[0] = wrap(xi-1,nx_);
-                col[1] = wrap(xi,nx_);
-                col[2] = wrap(xi+1,nx_);
-                col[3] = wrap(xi+2,nx_);
-                
-                // get x-interpolated value for each row
-                getSpline(dx, bx); // CHANGE TO FCT POINTER
-                getSpline(dy, by);
-                v[i] = by[0]*(bx[0]*coefficients_[col[0]+row[0]*nx_] + bx[1]*coefficients_[col[1]+row[0]*nx_] +
-                              bx[2]*coefficients_[col[2]+row[0]*nx_] + bx[3]*coefficients_[col[3]+row[0]*nx_]) + 
-                       by[1]*(bx[0]*coefficients_[col[0]+row[1]*nx_] + bx[1]*coefficients_[col[1]+row[1]*nx_] + 
-                              bx[2]*coefficients_[col[2]+row[1]*nx_] + bx[3]*coefficients_[col[3]+row[1]*nx_]) + 
-                       by[2]*(bx[0]*coefficients_[col[0]+row[2]*nx_] + bx[1]*coefficients_[col[1]+row[2]*nx_] + 
-                              bx[2]*coefficients_[col[2]+row[2]*nx_] + bx[3]*coefficients_[col[3]+row[2]*nx_]) + 
-                       by[3]*(bx[0]*coefficients_[col[0]+row[3]*nx_] + bx[1]*coefficients_[col[1]+row[3]*nx_] + 
-                              bx[2]*coefficients_[col[2]+row[3]*nx_] + bx[3]*coefficients_[col[3]+row[3]*nx_]);
-            }
-        } else { // linear interpolation
-            int x0, x1, y0, y1;
-            for (int i=0;i<N;++i) {
-                x0 = (int)floor(x[i]);
-                y0 = (int)floor(y[i]);
-                dx = x[i]-x0;
-                dy = y[i]-y0;
-                
-                x0 = wrap(x0, nx_);
-                x1 = wrap(x0+1, nx_);
-                y0 = wrap(y0, ny_);
-                y1 = wrap(y0+1, ny_);
-                
-                // x00 = x0+y0*nx
-                // x10 = x1+y0*nx
-                // x01 = x0+y1*nx
-                // x11 = x1+y1*nx
-                // top row:    dx*pixels_[x10] + (1.0-dx)*pixels_[x00];
-                // bottom row: dx*pixels_[x11] + (1.0-dx)*pixels_[x01];
-                v[i] = (1.0-dy)*(dx*pixels_[x1+y0*nx_] + (1.0-dx)*pixels_[x0+y0*nx_])
-                           + dy*(dx*pixels_[x1+y1*nx_] + (1.0-dx)*pixels_[x0+y1*nx_]);                
+        for (int k=1;k<n;++k) {
+            double* p = c + k*stride;
+            const double* q = p - stride;
+            for (l=0;l<m;++l) {
+                p[l] = c0*p[l] + a*q[l];
             }
         }
-    }
-    
-    
-    void Interpolator::interp(const double x[], const double y[], const int N, double v[]) {
-        interp(x, y, N, v, degree_);
-    }
-        
-        
-    void Interpolator::getCausalInitValueX() {
-        int i, offset;
-        if (borderCondition_ == MIRROR) {
-            for (int y=0;y<ny_;++y) { // loop through rows
-                i = y*nx_;
-                double ap = 1.0; // store powers of 'a'
-                cp_[i] = 0.0;
-                for (int k=0;k<nx_;++k) {
-                    cp_[i] += pixels_[i+k]*ap;
-                    ap *= a_;
-                }
-                for (int k=nx_-2;k>0;--k) { // mirror: loop backwards
-                    cp_[i] += pixels_[i+k]*ap;
-                    ap *= a_;
-                }
-                cp_[i] /= (1.0 - ap);
+
+        // anti-causal filter
+        std::fill(init, init+m, 0.0);
+        for (size_t t=0;t<antiCausal.idx.size();++t) {
+            const double* p = c + antiCausal.idx[t]*stride;
+            double w = antiCausal.w[t];
+            for (l=0;l<m;++l) {
+                init[l] += w*p[l];
             }
-        } else {
-            for (int y=0;y<ny_;++y) { // loop through rows
-                i = y*nx_;
-                offset = i+nx_;
-                double ap = a_; // store powers of 'a'
-                cp_[i] = pixels_[i];
-                for (int k=1;k<nx_;++k) {
-                    cp_[i] += pixels_[offset-k]*ap;
-                    ap *= a_;
-                }
-                cp_[i] /= (1.0 - ap);
+        }
+        double* last = c + (n-1)*stride;
+        for (l=0;l<m;++l) {
+            last[l] = init[l];
+        }
+        for (int k=n-2;k>=0;--k) {
+            double* p = c + k*stride;
+            const double* q = p + stride;
+            for (l=0;l<m;++l) {
+                p[l] = a*(q[l]-p[l]);
             }
         }
     }
-    
-    
-    void Interpolator::getCausalInitValueY() {
-        if (borderCondition_ == MIRROR) {
-            for (int x=0;x<nx_;++x) { // loop through columns
-                double ap = 1.0; // store powers of 'a'
-                cp_[x] = 0.0;
-                for (int k=0;k<ny_;++k) {
-                    cp_[x] += cn_[x+k*nx_]*ap;
-                    ap *= a_;
-                }
-                for (int k=ny_-2;k>0;--k) { // mirror: loop backwards
-                    cp_[x] += cn_[x+k*nx_]*ap;
-                    ap *= a_;                    
-                }
-                cp_[x] /= (1.0 - ap);
-            }
-        } else {
-            int offset;
-            for (int x=0;x<nx_;++x) {
-                offset = (ny_)*nx_+x;
-                double ap = a_;
-                cp_[x] = cn_[x];
-                for (int k=1;k<ny_;++k) {
-                    cp_[x] += cn_[offset-k*nx_]*ap;
-                    ap *= a_;
-                }
-                cp_[x] /= (1.0 - ap);
-            }
+
+
+    // Weights and indices (multiplied by 'stride') of the 4 coefficients that contribute to the
+    // interpolant (or its derivative) at position x along dimension d
+    void Interpolator::getWeights(const double x, const int d, const int order, const size_t stride, double w[], size_t idx[]) const {
+        int xi = (int)floor(x);
+        double dx = x-xi;
+        switch (order) {
+            case 1:
+                getCubicSplineDerivative(dx, w);
+                break;
+            case 2:
+                getCubicSplineSecondDerivative(dx, w);
+                break;
+            default:
+                splineFctPtr_(dx, w);
+                break;
+        }
+        for (int k=0;k<4;++k) {
+            idx[k] = stride*sepconv::borderIndex(xi-1+k, n_[d], borderCondition_);
         }
     }
-    
-    
-    void Interpolator::getAntiCausalInitValueX() {
-        int i;
-        if (borderCondition_ == MIRROR) {
-            for (int y=0;y<ny_;++y) { // loop through rows
-                i = (y+1)*nx_-1; // index of last point on row
-                cn_[i] = (a_/(a_*a_-1.0)) * (cp_[i] + a_*cp_[i-1]); // [1], Box 2 (has errors)
+
+
+    void Interpolator::interp(const double* const coords[], const int N, const int order[], double v[]) const {
+
+        const double* c = &coefficients_[0];
+        size_t stride1 = n_[0];
+        size_t stride2 = (size_t)n_[0]*n_[1];
+        int m1 = dims_>1 ? 4 : 1;
+        int m2 = dims_>2 ? 4 : 1;
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (int i=0;i<N;++i) {
+            double w[3][4] = {{0.0}, {1.0}, {1.0}};
+            size_t idx[3][4] = {{0}, {0}, {0}};
+            getWeights(coords[0][i], 0, order[0], 1, w[0], idx[0]);
+            if (dims_>1) {
+                getWeights(coords[1][i], 1, order[1], stride1, w[1], idx[1]);
+            }
+            if (dims_>2) {
+                getWeights(coords[2][i], 2, order[2], stride2, w[2], idx[2]);
             }
-        } else { // periodic
-            for (int y=0;y<ny_;++y) {
-                i = (y+1)*nx_-1;
-                double ap = a_;
-                cn_[i] = cp_[i];
-                for (int k=0;k<nx_-1;++k) {
-                    cn_[i] += ap*cp_[y*nx_+k];
-                    ap *= a_;
+
+            // tensor product: x-interpolated values are combined along y, then z
+            double vz = 0.0;
+            for (int kz=0;kz<m2;++kz) {
+                double vy = 0.0;
+                for (int ky=0;ky<m1;++ky) {
+                    const double* p = c + idx[2][kz] + idx[1][ky];
+                    vy += w[1][ky]*(w[0][0]*p[idx[0][0]] + w[0][1]*p[idx[0][1]] +
+                                    w[0][2]*p[idx[0][2]] + w[0][3]*p[idx[0][3]]);
                 }
-                cn_[i] *= -a_/(1.0-ap);
+                vz += w[2][kz]*vy;
             }
+            v[i] = vz;
         }
     }
-    
-    
-    void Interpolator::getAntiCausalInitValueY() {
-        int i;
-        int offset = (ny_-1)*nx_;
-        if (borderCondition_ == MIRROR) {
-            for (i=offset;i<N_;++i) { // loop through last row
-                cn_[i] = (a_/(a_*a_-1.0)) * (cp_[i] + a_*cp_[i-nx_]);
-            }
-        } else { // periodic
-            for (int x=0;x<nx_;++x) {
-                i = (ny_-1)*nx_+x; // index of last point on columns (= last row)
-                double ap = a_;
-                cn_[i] = cp_[i];
-                for (int k=0;k<ny_-1;++k) {
-                    cn_[i] += ap*cp_[k*nx_+x]; // s[N-1] + a*s[0] + a^2*s[2] + ...
-                    ap *= a_;
-                }
-                cn_[i] *= -a_/(1.0-ap);
-            }            
-        }
+
+
+    void Interpolator::interp(const double x[], const int N, double v[]) const {
+        const double* coords[] = {x};
+        const int order[] = {0};
+        interp(coords, N, order, v);
+    }
+
+
+    void Interpolator::interp(const double x[], const double y[], const int N, double v[]) const {
+        const double* coords[] = {x, y};
+        const int order[] = {0, 0};
+        interp(coords, N, order, v);
+    }
+
+
+    void Interpolator::interp(const double x[], const double y[], const double z[], const int N, double v[]) const {
+        const double* coords[] = {x, y, z};
+        const int order[] = {0, 0, 0};
+        interp(coords, N, order, v);
     }
-    
-    
+
+
     void Interpolator::getCubicSpline(const double t, double v[]) {
         double t1 = 1.0 - t;
         double t2 = t*t;
@@ -408,9 +385,28 @@ class Interpolator {
         v[1] = (2.0 / 3.0) + 0.5 * t2 * (t-2.0);
         v[3] = (t2 * t) / 6.0;
         v[2] = 1.0 - v[3] - v[1] - v[0];
-    }   
-    
-    
+    }
+
+
+    // 1st derivative of the cubic B-spline: B3'(t+1), B3'(t), B3'(t-1), B3'(t-2)
+    void Interpolator::getCubicSplineDerivative(const double t, double v[]) {
+        double t1 = 1.0 - t;
+        v[0] = -0.5 * t1 * t1;
+        v[1] = t * (1.5*t - 2.0);
+        v[3] = 0.5 * t * t;
+        v[2] = -v[0] - v[1] - v[3];
+    }
+
+
+    // 2nd derivative of the cubic B-spline
+    void Interpolator::getCubicSplineSecondDerivative(const double t, double v[]) {
+        v[0] = 1.0 - t;
+        v[1] = 3.0*t - 2.0;
+        v[2] = 1.0 - 3.0*t;
+        v[3] = t;
+    }
+
+
     void Interpolator::getQuadraticSpline(const double t, double v[]) {
         if (t<=0.5) {
             v[0] = (t-0.5)*(t-0.5)/2.0;
@@ -424,28 +420,14 @@ class Interpolator {
             v[2] = 1.0-v[3]-v[1];
         }
     }
-    
-    
-    // If rounded interpolation coordinates fall outside signal range, apply border conditions
-    int Interpolator::wrap(int i, int N) {
-        if (borderCondition_ == MIRROR) {
-            if (i<0) {
-                return -i;
-            } else if (i>=N) {
-                return 2*N-2 - i;
-            } else {
-                return i;
-            }
-        } else { // periodic
-            if (i<0) {
-                return i+N;
-            } else if (i>=N) {
-                return i-N;
-            } else {
-                return i;
-            }
-        }
+
+
+    void Interpolator::getLinearSpline(const double t, double v[]) {
+        v[0] = 0.0;
+        v[1] = 1.0 - t;
+        v[2] = t;
+        v[3] = 0.0;
     }
-    
+
 }
 #endif // INTERPOLATOR_H
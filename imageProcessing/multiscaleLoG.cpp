@@ -0,0 +1,255 @@
+/* [response scaleMap candidates] = multiscaleLoG(image, sigmaValues, spacing, borderCondition);
+ *
+ * Scale-normalized multiscale LoG filtering of 2D or 3D images, for filterMultiscaleLoGND.
+ * The image is smoothed incrementally from one scale to the next with discrete Gaussian kernels,
+ * and the response at each scale is folded into the minimum over scales. The memory usage does
+ * not depend on the number of scales.
+ *
+ * 'image' can be double or single; the response has the same class.
+ *
+ * Compilation:
+ * Mac/Linux: mex -I/usr/local/include -I../mex/include CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" multiscaleLoG.cpp
+ * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT /openmp" -I"..\mex\include" -output multiscaleLoG multiscaleLoG.cpp
+ */
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include "mex.h"
+#include "separableConvolution.h"
+
+using namespace std;
+
+
+// Half-kernel of the discrete Gaussian with variance t, T(n;t) = exp(-t)*I_n(t) (Lindeberg, 1990).
+// Unlike sampled Gaussians, these kernels form a semi-group: smoothing with variance t1, then t2,
+// is equivalent to smoothing with variance t1+t2. The modified Bessel functions are computed by
+// backward recurrence, I_{n-1} = I_{n+1} + 2n/t*I_n; the truncated kernel is normalized to unit sum.
+static void discreteGaussian(const double t, vector<double>& kernel) {
+    if (t<=0.0) {
+        kernel.assign(1, 1.0);
+        return;
+    }
+    int h = (int)ceil(4.0*sqrt(t))+1;
+    int N = h + 10 + (int)ceil(sqrt(t)); // start of the recurrence
+    vector<double> I(N+2, 0.0);
+    I[N] = 1e-300;
+    for (int n=N;n>0;--n) {
+        I[n-1] = I[n+1] + 2.0*n/t*I[n];
+        if (I[n-1] > 1e250) { // rescale
+            for (int i=n-1;i<=N;++i) {
+                I[i] *= 1e-250;
+            }
+        }
+    }
+    double sum = I[0];
+    for (int n=1;n<=h;++n) {
+        sum += 2.0*I[n];
+    }
+    kernel.resize(h+1);
+    for (int n=0;n<=h;++n) {
+        kernel[n] = I[n]/sum;
+    }
+}
+
+
+// Smoothing of the n[0] x n[1] x n[2] array 'data' with the variances t[0..2]; 'buffer' has the size of 'data'
+template<class T>
+static void smooth(vector<T>& data, vector<T>& buffer, const int* n, const double* t, const int border) {
+    vector<double> kernel;
+    for (int d=0;d<3;++d) {
+        if (n[d]>1 && t[d]>0.0) {
+            discreteGaussian(t[d], kernel);
+            sepconv::convolve(&data[0], n[0], n[1], n[2], d, &kernel[0], (int)kernel.size(), false, border, &buffer[0]);
+            data.swap(buffer);
+        }
+    }
+}
+
+
+// Scale-normalized LoG of 'data', sum_d t[d]*(data[x-e_d] - 2*data[x] + data[x+e_d]); the minimum
+// over scales and its index are updated in place
+template<class T>
+static void updateResponse(const T* data, const int* n, const double* t, const int border, const int scale,
+                           T* response, double* scaleMap) {
+    int nx = n[0], ny = n[1], nz = n[2];
+    size_t nxy = (size_t)nx*ny;
+    T tx = (T)t[0], ty = (T)t[1], tz = (T)t[2];
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int z=0;z<nz;++z) {
+        const T* czm = data + sepconv::borderIndex(z-1, nz, border)*nxy;
+        const T* czp = data + sepconv::borderIndex(z+1, nz, border)*nxy;
+        for (int y=0;y<ny;++y) {
+            size_t offset = z*nxy + (size_t)y*nx;
+            const T* c = data + offset;
+            const T* cym = data + z*nxy + (size_t)sepconv::borderIndex(y-1, ny, border)*nx;
+            const T* cyp = data + z*nxy + (size_t)sepconv::borderIndex(y+1, ny, border)*nx;
+            const T* zm = czm + (size_t)y*nx;
+            const T* zp = czp + (size_t)y*nx;
+            T* r = response + offset;
+            double* s = scaleMap + offset;
+            for (int x=0;x<nx;++x) {
+                int xm = x>0 ? x-1 : sepconv::borderIndex(-1, nx, border);
+                int xp = x<nx-1 ? x+1 : sepconv::borderIndex(nx, nx, border);
+                T c2 = 2*c[x];
+                T v = tx*(c[xm]+c[xp]-c2) + ty*(cym[x]+cyp[x]-c2) + tz*(zm[x]+zp[x]-c2);
+                if (scale==0 || v < r[x]) {
+                    r[x] = v;
+                    s[x] = scale;
+                }
+            }
+        }
+    }
+}
+
+
+// Negative local minima of the response in their 3x3(x3) neighborhood (linear indices, 0-based)
+template<class T>
+static void localMinima(const T* response, const int* n, vector<size_t>& candidates) {
+    int nx = n[0], ny = n[1], nz = n[2];
+    size_t nxy = (size_t)nx*ny;
+    vector<vector<size_t> > planes(nz);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int z=0;z<nz;++z) {
+        for (int y=0;y<ny;++y) {
+            for (int x=0;x<nx;++x) {
+                size_t i = z*nxy + (size_t)y*nx + x;
+                T v = response[i];
+                bool isMin = v < 0;
+                for (int dz=max(z-1,0);dz<=min(z+1,nz-1) && isMin;++dz) {
+                    for (int dy=max(y-1,0);dy<=min(y+1,ny-1) && isMin;++dy) {
+                        for (int dx=max(x-1,0);dx<=min(x+1,nx-1);++dx) {
+                            if (response[dz*nxy + (size_t)dy*nx + dx] < v) {
+                                isMin = false;
+                                break;
+                            }
+                        }
+                    }
+                }
+                if (isMin) {
+                    planes[z].push_back(i);
+                }
+            }
+        }
+    }
+    for (int z=0;z<nz;++z) {
+        candidates.insert(candidates.end(), planes[z].begin(), planes[z].end());
+    }
+}
+
+
+template<class T>
+static void filterMultiscale(int nlhs, mxArray *plhs[], const mxArray* image, const double* sigma, const int ns,
+                             const double* spacing, const int border) {
+
+    int nd = mxGetNumberOfDimensions(image);
+    const mwSize* dims = mxGetDimensions(image);
+    int n[3] = {(int)dims[0], (int)dims[1], nd==3 ? (int)dims[2] : 1};
+    size_t N = (size_t)n[0]*n[1]*n[2];
+
+    // scales in increasing order
+    vector<pair<double,int> > scales(ns);
+    for (int i=0;i<ns;++i) {
+        scales[i] = make_pair(sigma[i], i);
+    }
+    sort(scales.begin(), scales.end());
+
+    plhs[0] = mxCreateNumericArray(nd, dims, mxGetClassID(image), mxREAL);
+    T* response = (T*)mxGetData(plhs[0]);
+    mxArray* scaleArray = mxCreateNumericArray(nd, dims, mxDOUBLE_CLASS, mxREAL);
+    double* scaleMap = mxGetPr(scaleArray);
+
+    const T* input = (const T*)mxGetData(image);
+    vector<T> data(input, input+N);
+    vector<T> buffer(N);
+
+    double prev[3] = {0.0, 0.0, 0.0};
+    double t[3];
+    for (int i=0;i<ns;++i) {
+        // incremental smoothing from the previous scale (variances in pixels^2)
+        for (int d=0;d<3;++d) {
+            double s = d<nd ? scales[i].first/spacing[d] : 0.0;
+            t[d] = s*s - prev[d];
+            prev[d] = s*s;
+        }
+        smooth(data, buffer, n, t, border);
+        updateResponse(&data[0], n, prev, border, i, response, scaleMap);
+    }
+
+    // scale index (1-based) in the order of 'sigmaValues'
+    for (size_t i=0;i<N;++i) {
+        scaleMap[i] = scales[(int)scaleMap[i]].second + 1;
+    }
+
+    if (nlhs > 1) {
+        plhs[1] = scaleArray;
+    } else {
+        mxDestroyArray(scaleArray);
+    }
+
+    if (nlhs > 2) {
+        vector<size_t> candidates;
+        localMinima(response, n, candidates);
+        plhs[2] = mxCreateDoubleMatrix(candidates.size(), 1, mxREAL);
+        double* p = mxGetPr(plhs[2]);
+        for (size_t i=0;i<candidates.size();++i) {
+            p[i] = (double)(candidates[i]+1);
+        }
+    }
+}
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+    if (nrhs < 2 || nrhs > 4)
+        mexErrMsgTxt("Required inputs: image, sigmaValues. Optional: spacing, borderCondition ('symmetric' or 'replicate').");
+    if (nlhs > 3)
+        mexErrMsgTxt("Too many output arguments.");
+
+    int nd = mxGetNumberOfDimensions(prhs[0]);
+    if ((!mxIsDouble(prhs[0]) && !mxIsSingle(prhs[0])) || nd > 3)
+        mexErrMsgTxt("Input must be a 2D or 3D double or single array.");
+
+    int ns = (int)mxGetNumberOfElements(prhs[1]);
+    if (!mxIsDouble(prhs[1]) || ns==0)
+        mexErrMsgTxt("'sigmaValues' must be a non-empty double vector.");
+    double* sigma = mxGetPr(prhs[1]);
+    for (int i=0;i<ns;++i) {
+        if (!(sigma[i] > 0.0))
+            mexErrMsgTxt("'sigmaValues' must be positive.");
+    }
+
+    double spacing[3] = {1.0, 1.0, 1.0};
+    if (nrhs > 2 && !mxIsEmpty(prhs[2])) {
+        int np = (int)mxGetNumberOfElements(prhs[2]);
+        if (!mxIsDouble(prhs[2]) || (np!=1 && np!=nd))
+            mexErrMsgTxt("'spacing' must be a scalar or have one value per image dimension.");
+        for (int d=0;d<nd;++d) {
+            spacing[d] = mxGetPr(prhs[2])[np==1 ? 0 : d];
+            if (!(spacing[d] > 0.0))
+                mexErrMsgTxt("'spacing' must be positive.");
+        }
+    }
+
+    int border = sepconv::SYMMETRIC;
+    if (nrhs > 3) {
+        char* str = mxArrayToString(prhs[3]);
+        if (str==NULL || (strcmp(str, "symmetric")!=0 && strcmp(str, "replicate")!=0))
+            mexErrMsgTxt("'borderCondition' must be 'symmetric' or 'replicate'.");
+        if (strcmp(str, "replicate")==0) {
+            border = sepconv::REPLICATE;
+        }
+        mxFree(str);
+    }
+
+    if (mxIsDouble(prhs[0])) {
+        filterMultiscale<double>(nlhs, plhs, prhs[0], sigma, ns, spacing, border);
+    } else {
+        filterMultiscale<float>(nlhs, plhs, prhs[0], sigma, ns, spacing, border);
+    }
+}
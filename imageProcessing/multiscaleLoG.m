@@ -0,0 +1,23 @@
+%MULTISCALELOG Scale-normalized multiscale LoG filter (native engine of filterMultiscaleLoGND)
+%
+%  Usage:
+%    [response, scaleMap, candidates] = multiscaleLoG(im, sigmaValues, {spacing}, {borderCondition})
+%
+%  Inputs:
+%                im : 2D or 3D double or single array
+%       sigmaValues : standard deviations of the Gaussian, in the units of 'spacing'
+%         {spacing} : pixel spacing, scalar or one value per dimension. Default: 1
+% {borderCondition} : 'symmetric' (default) or 'replicate'
+%
+%  Outputs:
+%          response : minimum of sigma^2*LoG over the scales, same class as 'im'
+%          scaleMap : index of the scale (in 'sigmaValues') of the minimum
+%        candidates : linear indices of the negative local minima of 'response' in their
+%                     3x3(x3) neighborhood
+%
+%  The image is smoothed incrementally from one scale to the next with discrete Gaussian
+%  kernels (exact cascade), and the Laplacian is computed by second differences. Only the
+%  running minimum and its scale are kept: the memory usage does not depend on the number
+%  of scales. The computations are multi-threaded (OpenMP).
+%
+%  See also filterMultiscaleLoGND
@@ -0,0 +1,264 @@
+/* nms = nonMaxSuppression(res, theta, {sup});
+ * nms = nonMaxSuppression(res, u, v, w, {mode}, {sup});
+ *
+ * Non-maximum suppression of 2D and 3D filter responses, for nonMaximumSuppression and
+ * nonMaximumSuppression3D. The response is interpolated (linear) at the positions one pixel
+ * away from each pixel, on the fly: no coordinate grids or padded copies of the input are built.
+ * The border is extended symmetrically, as with padarray(..., 'symmetric').
+ *
+ * 2D: 'theta' is the orientation (grid conventions of steerableDetector); pixels smaller than the
+ *     response at +/-(cos(theta), sin(theta)) are set to 'sup'.
+ * 3D: (u,v,w) is a vector field (components along x, y, z: dimensions 2, 1, 3 of the arrays).
+ *     'surface' (default): pixels that are not strictly larger than the response at +/- the unit
+ *     vector are set to 'sup'. 'curve': (u,v,w) is the direction of the curve; pixels that are not
+ *     strictly larger than the response on the unit circle perpendicular to it are set to 'sup'.
+ *     If 'res' is empty, the response is the magnitude of (u,v,w).
+ *
+ * The inputs must be all double or all single; 'nms' has the same class.
+ *
+ * Compilation:
+ * Mac/Linux: mex -I/usr/local/include -I../mex/include CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" nonMaxSuppression.cpp
+ * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT /openmp" -I"..\mex\include" -output nonMaxSuppression nonMaxSuppression.cpp
+ */
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "mex.h"
+#include "separableConvolution.h"
+
+using namespace std;
+
+#define PI 3.141592653589793
+
+
+// Linear interpolation of the n[0] x n[1] x n[2] array f at (x,y,z), with symmetric borders
+template<class T>
+static double interpLinear(const T* f, const int* n, const double x, const double y, const double z) {
+    int x0 = (int)floor(x);
+    int y0 = (int)floor(y);
+    int z0 = (int)floor(z);
+    double dx = x-x0;
+    double dy = y-y0;
+    double dz = z-z0;
+    size_t nxy = (size_t)n[0]*n[1];
+    int xi[2] = {sepconv::borderIndex(x0, n[0], sepconv::SYMMETRIC), sepconv::borderIndex(x0+1, n[0], sepconv::SYMMETRIC)};
+    size_t yi[2] = {(size_t)sepconv::borderIndex(y0, n[1], sepconv::SYMMETRIC)*n[0],
+                    (size_t)sepconv::borderIndex(y0+1, n[1], sepconv::SYMMETRIC)*n[0]};
+    size_t zi[2] = {(size_t)sepconv::borderIndex(z0, n[2], sepconv::SYMMETRIC)*nxy,
+                    (size_t)sepconv::borderIndex(z0+1, n[2], sepconv::SYMMETRIC)*nxy};
+    double v[2];
+    for (int k=0;k<2;++k) {
+        const T* p0 = f + zi[k] + yi[0];
+        const T* p1 = f + zi[k] + yi[1];
+        v[k] = (1.0-dy)*((1.0-dx)*p0[xi[0]] + dx*p0[xi[1]]) + dy*((1.0-dx)*p1[xi[0]] + dx*p1[xi[1]]);
+    }
+    return (1.0-dz)*v[0] + dz*v[1];
+}
+
+
+// 2D: Matlab's rows (y) are the contiguous dimension
+template<class T>
+static void nms2D(const T* res, const T* theta, const int ny, const int nx, const T sup, T* nms) {
+    int n[3] = {ny, nx, 1};
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int x=0;x<nx;++x) {
+        for (int y=0;y<ny;++y) {
+            size_t i = y + (size_t)x*ny;
+            double ux = cos((double)theta[i]);
+            double uy = sin((double)theta[i]);
+            double A1 = interpLinear(res, n, y+uy, x+ux, 0.0);
+            double A2 = interpLinear(res, n, y-uy, x-ux, 0.0);
+            nms[i] = (res[i] < A1 || res[i] < A2) ? sup : res[i];
+        }
+    }
+}
+
+
+// Unit vectors u, v perpendicular to the unit vector 'd'
+static void orthonormalBasis(const double* d, double* u, double* v) {
+    // cross product with the axis least aligned with 'd'
+    if (fabs(d[0]) < 0.9) {
+        u[0] = 0.0; u[1] = d[2]; u[2] = -d[1];
+    } else {
+        u[0] = -d[2]; u[1] = 0.0; u[2] = d[0];
+    }
+    double norm = sqrt(u[0]*u[0] + u[1]*u[1] + u[2]*u[2]);
+    for (int k=0;k<3;++k) {
+        u[k] /= norm;
+    }
+    v[0] = d[1]*u[2] - d[2]*u[1];
+    v[1] = d[2]*u[0] - d[0]*u[2];
+    v[2] = d[0]*u[1] - d[1]*u[0];
+}
+
+
+// 3D: the array dimensions are (y, x, z); 'res' can be NULL (magnitude of the vector field)
+template<class T>
+static void nms3D(const T* res, const T* u, const T* v, const T* w, const int* dims, const bool curve,
+                  const T sup, T* nms) {
+
+    int ny = dims[0], nx = dims[1], nz = dims[2];
+    size_t nxy = (size_t)nx*ny;
+    int n[3] = {ny, nx, nz};
+
+    // without 'res', the magnitude is stored in the output, and the suppressed pixels are
+    // marked in 'keep' until all pixels have been processed
+    const T* f = res;
+    vector<unsigned char> keep;
+    if (f==NULL) {
+        long N = (long)(nxy*nz);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (long i=0;i<N;++i) {
+            nms[i] = sqrt(u[i]*u[i] + v[i]*v[i] + w[i]*w[i]);
+        }
+        f = nms;
+        keep.resize(N);
+    }
+
+    // points on the unit circle (curve mode)
+    const int nt = 10;
+    double cosT[nt], sinT[nt];
+    for (int t=0;t<nt;++t) {
+        cosT[t] = cos(t*2.0*PI/nt);
+        sinT[t] = sin(t*2.0*PI/nt);
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int z=0;z<nz;++z) {
+        double d[3], e1[3], e2[3];
+        for (int x=0;x<nx;++x) {
+            for (int y=0;y<ny;++y) {
+                size_t i = z*nxy + y + (size_t)x*ny;
+                double fi = f[i];
+                // direction in (y, x, z) order
+                d[0] = v[i];
+                d[1] = u[i];
+                d[2] = w[i];
+                double norm = sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+                bool isMax = norm > 0.0;
+                if (isMax) {
+                    d[0] /= norm;
+                    d[1] /= norm;
+                    d[2] /= norm;
+                    if (curve) {
+                        orthonormalBasis(d, e1, e2);
+                        for (int t=0;t<nt && isMax;++t) {
+                            isMax = fi > interpLinear(f, n, y + cosT[t]*e1[0] + sinT[t]*e2[0],
+                                                            x + cosT[t]*e1[1] + sinT[t]*e2[1],
+                                                            z + cosT[t]*e1[2] + sinT[t]*e2[2]);
+                        }
+                    } else {
+                        isMax = fi > interpLinear(f, n, y+d[0], x+d[1], z+d[2]) &&
+                                fi > interpLinear(f, n, y-d[0], x-d[1], z-d[2]);
+                    }
+                }
+                if (res==NULL) {
+                    keep[i] = isMax;
+                } else {
+                    nms[i] = isMax ? res[i] : sup;
+                }
+            }
+        }
+    }
+    if (res==NULL) {
+        size_t N = nxy*nz;
+        for (size_t i=0;i<N;++i) {
+            if (!keep[i]) {
+                nms[i] = sup;
+            }
+        }
+    }
+}
+
+
+template<class T>
+static void run(const mxArray *prhs[], const bool is3D, const bool curve, const double sup, mxArray* out) {
+    T* nms = (T*)mxGetData(out);
+    const T* res = mxIsEmpty(prhs[0]) ? NULL : (const T*)mxGetData(prhs[0]);
+    const mwSize* dims = mxGetDimensions(prhs[1]);
+    if (is3D) {
+        int d[3] = {(int)dims[0], (int)dims[1], mxGetNumberOfDimensions(prhs[1])==3 ? (int)dims[2] : 1};
+        nms3D(res, (const T*)mxGetData(prhs[1]), (const T*)mxGetData(prhs[2]), (const T*)mxGetData(prhs[3]), d, curve, (T)sup, nms);
+    } else {
+        nms2D(res, (const T*)mxGetData(prhs[1]), (int)dims[0], (int)dims[1], (T)sup, nms);
+    }
+}
+
+
+static bool sameSize(const mxArray* a, const mxArray* b) {
+    mwSize nd = mxGetNumberOfDimensions(a);
+    if (nd != mxGetNumberOfDimensions(b)) {
+        return false;
+    }
+    const mwSize* da = mxGetDimensions(a);
+    const mwSize* db = mxGetDimensions(b);
+    for (mwSize k=0;k<nd;++k) {
+        if (da[k]!=db[k]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+    if (nrhs < 2 || nrhs > 6)
+        mexErrMsgTxt("Usage: nms = nonMaxSuppression(res, theta, {sup}) or nonMaxSuppression(res, u, v, w, {'surface'|'curve'}, {sup}).");
+    if (nlhs > 1)
+        mexErrMsgTxt("Too many output arguments.");
+
+    bool is3D = nrhs >= 4 && !mxIsChar(prhs[3]) && mxGetNumberOfElements(prhs[3])!=1;
+    int nv = is3D ? 3 : 1; // number of orientation arrays
+    const mxArray* ref = prhs[1];
+    mxClassID classID = mxGetClassID(ref);
+    if (classID!=mxDOUBLE_CLASS && classID!=mxSINGLE_CLASS)
+        mexErrMsgTxt("The inputs must be double or single arrays.");
+    for (int k=0;k<=nv;++k) {
+        if (k==0 && is3D && mxIsEmpty(prhs[0])) { // magnitude of (u,v,w)
+            continue;
+        }
+        if (mxGetClassID(prhs[k])!=classID)
+            mexErrMsgTxt("The response and the orientation must have the same class.");
+        if (!sameSize(prhs[k], ref))
+            mexErrMsgTxt("The response and the orientation must have the same size.");
+    }
+    if (!is3D && mxGetNumberOfDimensions(ref)!=2)
+        mexErrMsgTxt("2D inputs: 'res' and 'theta' must be 2D arrays.");
+    if (is3D && mxGetNumberOfDimensions(ref)>3)
+        mexErrMsgTxt("3D inputs: 'u', 'v', 'w' must be 3D arrays.");
+
+    int supIdx = is3D ? 4 : 2;
+    bool curve = false;
+    if (is3D && nrhs > 4 && mxIsChar(prhs[4])) {
+        char* mode = mxArrayToString(prhs[4]);
+        bool valid = mode!=NULL && (strcmp(mode, "surface")==0 || strcmp(mode, "curve")==0);
+        curve = valid && strcmp(mode, "curve")==0;
+        mxFree(mode);
+        if (!valid)
+            mexErrMsgTxt("The mode must be 'surface' or 'curve'.");
+        supIdx = 5;
+    }
+    double sup = 0.0;
+    if (nrhs > supIdx) {
+        if (!mxIsNumeric(prhs[supIdx]) || mxGetNumberOfElements(prhs[supIdx])!=1)
+            mexErrMsgTxt("'sup' must be a scalar.");
+        sup = mxGetScalar(prhs[supIdx]);
+    }
+    if (nrhs > supIdx+1)
+        mexErrMsgTxt("Too many input arguments.");
+
+    plhs[0] = mxCreateNumericArray(mxGetNumberOfDimensions(ref), mxGetDimensions(ref), classID, mxREAL);
+    if (classID==mxDOUBLE_CLASS) {
+        run<double>(prhs, is3D, curve, sup, plhs[0]);
+    } else {
+        run<float>(prhs, is3D, curve, sup, plhs[0]);
+    }
+}
@@ -0,0 +1,22 @@
+%NONMAXSUPPRESSION Non-maximum suppression of 2D and 3D filter responses (native engine of nonMaximumSuppression and nonMaximumSuppression3D)
+%
+%  Usage:
+%    nms = nonMaxSuppression(res, theta, {sup})
+%    nms = nonMaxSuppression(res, u, v, w, {mode}, {sup})
+%
+%  Inputs:
+%          res : response (2D or 3D). In 3D, if empty, the magnitude of (u,v,w) is used
+%        theta : orientation map (2D), with the grid conventions of steerableDetector
+%      u, v, w : orientation vector field (3D), components along x, y, z (dimensions 2, 1, 3)
+%       {mode} : 'surface' (default): maxima along the direction of (u,v,w)
+%                'curve': maxima in the plane perpendicular to (u,v,w), e.g., for filaments
+%        {sup} : value of the suppressed pixels. Default: 0
+%
+%  Output:
+%          nms : non-maximum-suppressed response, same class as the inputs (double or single)
+%
+%  The response is interpolated linearly at the neighboring positions, with symmetric borders,
+%  without any coordinate grids or padded copies of the input. The computations are
+%  multi-threaded (OpenMP).
+%
+%  See also nonMaximumSuppression, nonMaximumSuppression3D, steerableDetector3D
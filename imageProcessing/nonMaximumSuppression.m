@@ -14,6 +14,12 @@ if(nargin < 3)
     sup = 0;
 end
 
+% native implementation: no padded copy or coordinate grids
+if exist('nonMaxSuppression', 'file')==3 && (isa(res, 'double') || isa(res, 'single'))
+    res = nonMaxSuppression(res, cast(th, class(res)), sup);
+    return
+end
+
 [ny,nx] = size(res);
 
 res = padarrayXT(res, [1 1], 'symmetric');
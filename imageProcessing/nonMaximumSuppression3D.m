@@ -26,6 +26,12 @@ if nargin < 3 || ndims(u) ~=3 || ndims(v) ~= 3 || ndims(w) ~= 3 || ~isequal(size
     error('The inputs u, v and w must all be 3-dimensional matrices of equal size!')
 end
 
+% native implementation: no padded copy or coordinate grids
+if exist('nonMaxSuppression', 'file')==3 && (isa(u, 'double') || isa(u, 'single'))
+    nms = nonMaxSuppression([], u, cast(v, class(u)), cast(w, class(u)));
+    return
+end
+
 [M,N,P] = size(u);
 
 %Calculate the magnitude of the vector field at each point
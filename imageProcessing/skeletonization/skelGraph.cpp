@@ -0,0 +1,367 @@
+/* [vertices, edges, edgeVoxels, edgeOffsets, edgeLengths] = skelGraph(skel, {spacing});
+ *
+ * Graph of a 26-connected 3D skeleton (e.g. from skeleton3D), for skel2graph.
+ *
+ * Voxels with 1 or more than 2 neighbors are vertex voxels, voxels with 2 neighbors are edge
+ * voxels. Vertices are the 26-connected clusters of vertex voxels, edges the 26-connected
+ * components of edge voxels; both are labeled in the order of their first voxel, as bwlabeln.
+ * Only the edges that touch exactly 2 vertices are returned.
+ *
+ * Outputs:
+ *   vertices    : nV x 3, mean coordinates (row, column, slice) of the vertex clusters
+ *   edges       : nE x 2, vertices connected by each edge (edges(:,1) < edges(:,2))
+ *   edgeVoxels  : linear indices of the edge voxels, ordered from edges(i,1) to edges(i,2) along
+ *                 each edge; the voxels of edge i are edgeVoxels(edgeOffsets(i):edgeOffsets(i+1)-1)
+ *   edgeOffsets : (nE+1) x 1
+ *   edgeLengths : nE x 1, length of the edges, from vertex voxel to vertex voxel, for the voxel
+ *                 size 'spacing' (row, column, slice; default: [1 1 1])
+ *
+ * Compilation:
+ * Mac/Linux: mex -I/usr/local/include CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" skelGraph.cpp
+ * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT /openmp" -output skelGraph skelGraph.cpp
+ */
+
+#include "mex.h"
+#include "matrix.h"
+
+#include "volNeighbors.h"
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+//Voxel classes
+#define VERTEX 1
+#define EDGE 2
+
+
+// Union-find over the skeleton voxels
+static int findRoot(vector<int>& parent, int a) {
+    while (parent[a] != a) {
+        parent[a] = parent[parent[a]];
+        a = parent[a];
+    }
+    return a;
+}
+
+static void unite(vector<int>& parent, int a, int b) {
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    // the smallest voxel is the root, for the label order
+    if (a < b) {
+        parent[b] = a;
+    } else if (b < a) {
+        parent[a] = b;
+    }
+}
+
+
+// Position of the voxel 'idx' (padded volume) in the list of skeleton voxels, -1 if not in the skeleton
+static inline int voxelPosition(const vector<size_t>& voxels, size_t idx) {
+    vector<size_t>::const_iterator it = lower_bound(voxels.begin(), voxels.end(), idx);
+    return (it != voxels.end() && *it == idx) ? (int)(it - voxels.begin()) : -1;
+}
+
+
+// Mex entrypoint for matlab use
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+    // Check input and output arguments
+
+    if (nrhs < 1 || nrhs > 2)
+        mexErrMsgTxt("Usage: [vertices, edges, edgeVoxels, edgeOffsets, edgeLengths] = skelGraph(skel, {spacing})");
+
+    if (nlhs > 5)
+        mexErrMsgTxt("Too many output arguments.");
+
+    if (!mxIsLogical(prhs[0]) || mxGetNumberOfDimensions(prhs[0]) > 3)
+        mexErrMsgTxt("The first input must be a 3D logical matrix!");
+
+    double spacing[3] = {1.0, 1.0, 1.0};
+    if (nrhs > 1) {
+        if (!mxIsDouble(prhs[1]) || mxGetNumberOfElements(prhs[1]) != 3)
+            mexErrMsgTxt("The spacing must be a vector of 3 values (row, column, slice)!");
+        const double* s = mxGetPr(prhs[1]);
+        for (int d=0; d < 3; d++) {
+            if (!(s[d] > 0.0))
+                mexErrMsgTxt("The spacing must be positive!");
+            spacing[d] = s[d];
+        }
+    }
+
+    const mwSize* matSize = mxGetDimensions(prhs[0]);
+    const mxLogical* skel = mxGetLogicals(prhs[0]);
+    int L = (int)matSize[0];
+    int M = (int)matSize[1];
+    int N = mxGetNumberOfDimensions(prhs[0]) == 3 ? (int)matSize[2] : 1;
+    size_t slsz = (size_t)L * M;
+
+    //Padded volume (1 voxel of background on each side): no bound checks for the neighbors
+    int Lp = L+2, Mp = M+2, Np = N+2;
+    size_t slszp = (size_t)Lp * Mp;
+    vector<unsigned char> vol(slszp * Np, 0);
+    long volNeighbors[NB_NEIGHBORS];
+    double stepLength[NB_NEIGHBORS];
+    volNeighborOffsets(Lp, Mp, volNeighbors);
+    volNeighborDistances(spacing, stepLength);
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int k=0; k < N; k++) {
+        for (int j=0; j < M; j++) {
+            for (int i=0; i < L; i++) {
+                if (skel[k*slsz + (size_t)j*L + i]) {
+                    vol[(k+1)*slszp + (size_t)(j+1)*Lp + i+1] = 1;
+                }
+            }
+        }
+    }
+
+    //Classify the voxels from their number of neighbors (isolated voxels are ignored)
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int k=1; k <= N; k++) {
+        for (int j=1; j <= M; j++) {
+            for (int i=1; i <= L; i++) {
+                size_t idx = k*slszp + (size_t)j*Lp + i;
+                if (vol[idx] == 0) {
+                    continue;
+                }
+                int nn = 0;
+                for (int ii=0; ii < NB_NEIGHBORS; ii++) {
+                    nn += vol[idx + volNeighbors[ii]] != 0;
+                }
+                vol[idx] = nn == 2 ? EDGE : (nn > 0 ? VERTEX : 0);
+            }
+        }
+    }
+
+    //Skeleton voxels, in the order of the linear indices
+    vector<size_t> voxels;
+    for (size_t idx=0; idx < vol.size(); idx++) {
+        if (vol[idx] != 0) {
+            voxels.push_back(idx);
+        }
+    }
+    int nVox = (int)voxels.size();
+
+    //Vertex clusters and edge components: union of each voxel with its preceding neighbors
+    //of the same class
+    vector<int> parent(nVox);
+    for (int p=0; p < nVox; p++) {
+        parent[p] = p;
+    }
+    for (int p=0; p < nVox; p++) {
+        size_t idx = voxels[p];
+        for (int ii=0; ii < NB_NEIGHBORS/2; ii++) {
+            size_t nidx = idx + volNeighbors[ii];
+            if (vol[nidx] == vol[idx]) {
+                unite(parent, p, voxelPosition(voxels, nidx));
+            }
+        }
+    }
+
+    //Labels (0-based, per class), in the order of the first voxel of each cluster
+    vector<int> label(nVox);
+    int nVerts = 0, nEdges = 0;
+    for (int p=0; p < nVox; p++) {
+        int r = findRoot(parent, p);
+        if (r == p) {
+            label[p] = vol[voxels[p]] == VERTEX ? nVerts++ : nEdges++;
+        } else {
+            label[p] = label[r];
+        }
+    }
+
+    //Vertex coordinates: mean of the cluster voxels
+    vector<double> vertSum(3*nVerts, 0.0);
+    vector<int> vertCount(nVerts, 0);
+    for (int p=0; p < nVox; p++) {
+        if (vol[voxels[p]] != VERTEX) {
+            continue;
+        }
+        size_t idx = voxels[p];
+        int v = label[p];
+        vertSum[3*v] += (double)(idx % Lp);
+        vertSum[3*v+1] += (double)((idx / Lp) % Mp);
+        vertSum[3*v+2] += (double)(idx / slszp);
+        vertCount[v]++;
+    }
+
+    //Voxels of each edge component
+    vector<int> compStart(nEdges+1, 0);
+    for (int p=0; p < nVox; p++) {
+        if (vol[voxels[p]] == EDGE) {
+            compStart[label[p]+1]++;
+        }
+    }
+    for (int e=0; e < nEdges; e++) {
+        compStart[e+1] += compStart[e];
+    }
+    vector<int> compVoxels(compStart[nEdges]);
+    vector<int> pos(compStart.begin(), compStart.end()-1);
+    for (int p=0; p < nVox; p++) {
+        if (vol[voxels[p]] == EDGE) {
+            compVoxels[pos[label[p]]++] = p;
+        }
+    }
+
+    //Vertices of each edge component, and path along the component
+    vector<int> edgeVert(2*nEdges, -1);
+    vector<int> path(compVoxels.size());
+    vector<int> pathLength(nEdges, 0);
+    vector<double> edgeLength(nEdges, 0.0);
+    vector<unsigned char> visited(nVox, 0);
+    bool invalid = false;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 64)
+#endif
+    for (int e=0; e < nEdges; e++) {
+        int* ev = &edgeVert[2*e];
+        int nv = 0;
+        for (int c=compStart[e]; c < compStart[e+1] && nv <= 2; c++) {
+            size_t idx = voxels[compVoxels[c]];
+            for (int ii=0; ii < NB_NEIGHBORS; ii++) {
+                size_t nidx = idx + volNeighbors[ii];
+                if (vol[nidx] != VERTEX) {
+                    continue;
+                }
+                int v = label[voxelPosition(voxels, nidx)];
+                if (nv > 0 && (v == ev[0] || (nv > 1 && v == ev[1]))) {
+                    continue;
+                }
+                if (nv == 2) {
+                    nv = 3;
+                    break;
+                }
+                ev[nv++] = v;
+            }
+        }
+        if (nv > 2) {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+            invalid = true;
+        }
+        if (nv != 2) {
+            ev[0] = ev[1] = -1;
+            continue;
+        }
+        if (ev[0] > ev[1]) {
+            swap(ev[0], ev[1]);
+        }
+
+        //Walk from the voxel touching the first vertex, to the closest unvisited neighbor;
+        //the length includes the steps from and to the vertex voxels
+        int* pe = &path[compStart[e]];
+        int cur = -1;
+        double toVertex = 0.0;
+        for (int c=compStart[e]; c < compStart[e+1] && cur < 0; c++) {
+            size_t idx = voxels[compVoxels[c]];
+            for (int ii=0; ii < NB_NEIGHBORS; ii++) {
+                size_t nidx = idx + volNeighbors[ii];
+                if (vol[nidx] == VERTEX && label[voxelPosition(voxels, nidx)] == ev[0] &&
+                    (cur < 0 || stepLength[ii] < toVertex)) {
+                    cur = compVoxels[c];
+                    toVertex = stepLength[ii];
+                }
+            }
+        }
+        double length = toVertex;
+        int n = 0;
+        while (cur >= 0) {
+            pe[n++] = cur;
+            visited[cur] = 1;
+            size_t idx = voxels[cur];
+            int next = -1;
+            double step = 0.0;
+            for (int ii=0; ii < NB_NEIGHBORS; ii++) {
+                size_t nidx = idx + volNeighbors[ii];
+                if (vol[nidx] != EDGE) {
+                    continue;
+                }
+                int q = voxelPosition(voxels, nidx);
+                if (!visited[q] && (next < 0 || stepLength[ii] < step)) {
+                    next = q;
+                    step = stepLength[ii];
+                }
+            }
+            if (next >= 0) {
+                length += step;
+            }
+            cur = next;
+        }
+        size_t last = voxels[pe[n-1]];
+        toVertex = -1.0;
+        for (int ii=0; ii < NB_NEIGHBORS; ii++) {
+            size_t nidx = last + volNeighbors[ii];
+            if (vol[nidx] == VERTEX && label[voxelPosition(voxels, nidx)] == ev[1] &&
+                (toVertex < 0.0 || stepLength[ii] < toVertex)) {
+                toVertex = stepLength[ii];
+            }
+        }
+        pathLength[e] = n;
+        edgeLength[e] = length + (toVertex > 0.0 ? toVertex : 0.0);
+    }
+
+    if (invalid)
+        mexErrMsgTxt("Problem with input matrix! Check that it is in fact a skeleton, and that it's connectivity matches the specified connectivity!");
+
+    //Outputs
+    plhs[0] = mxCreateDoubleMatrix(nVerts, 3, mxREAL);
+    double* vertices = mxGetPr(plhs[0]);
+    for (int v=0; v < nVerts; v++) {
+        for (int d=0; d < 3; d++) {
+            // padded, 0-based -> 1-based: unchanged
+            vertices[v + d*nVerts] = vertSum[3*v+d] / vertCount[v];
+        }
+    }
+
+    vector<int> kept;
+    vector<size_t> offsets(1, 0);
+    for (int e=0; e < nEdges; e++) {
+        if (edgeVert[2*e] >= 0) {
+            kept.push_back(e);
+            offsets.push_back(offsets.back() + pathLength[e]);
+        }
+    }
+    int nKept = (int)kept.size();
+
+    if (nlhs > 1) {
+        plhs[1] = mxCreateDoubleMatrix(nKept, 2, mxREAL);
+        double* edges = mxGetPr(plhs[1]);
+        for (int e=0; e < nKept; e++) {
+            edges[e] = edgeVert[2*kept[e]] + 1;
+            edges[e + nKept] = edgeVert[2*kept[e]+1] + 1;
+        }
+    }
+    if (nlhs > 2) {
+        plhs[2] = mxCreateDoubleMatrix(offsets.back(), 1, mxREAL);
+        double* edgeVoxels = mxGetPr(plhs[2]);
+        for (int e=0; e < nKept; e++) {
+            const int* pe = &path[compStart[kept[e]]];
+            for (int c=0; c < pathLength[kept[e]]; c++) {
+                size_t idx = voxels[pe[c]];
+                size_t i = idx % Lp - 1, j = (idx / Lp) % Mp - 1, k = idx / slszp - 1;
+                edgeVoxels[offsets[e] + c] = (double)(k*slsz + j*L + i + 1);
+            }
+        }
+    }
+    if (nlhs > 3) {
+        plhs[3] = mxCreateDoubleMatrix(nKept+1, 1, mxREAL);
+        double* o = mxGetPr(plhs[3]);
+        for (int e=0; e <= nKept; e++) {
+            o[e] = (double)(offsets[e] + 1);
+        }
+    }
+    if (nlhs > 4) {
+        plhs[4] = mxCreateDoubleMatrix(nKept, 1, mxREAL);
+        double* lengths = mxGetPr(plhs[4]);
+        for (int e=0; e < nKept; e++) {
+            lengths[e] = edgeLength[kept[e]];
+        }
+    }
+}//End mexFunction
@@ -1,280 +1,253 @@
 /*
+ * Thinning engine: the current border voxels are kept in a list, the 26-neighborhood of each
+ * voxel is packed into a 26-bit key, and the templates are evaluated from a lookup table
+ * (2^26 bits, built once per session) after permuting the key for the current direction.
+ * Within a subiteration, all deletions are decided on the same volume (this is the parallel
+ * algorithm of [1]), hence the border voxels are checked in parallel.
  *
  * Compilation:
- * Mac/Linux: mex -I/usr/local/include  skeleton3D.cpp
- * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT" -output skeleton3D skeleton3D.cpp
+ * Mac/Linux: mex -I/usr/local/include CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" skeleton3D.cpp
+ * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT /openmp" -output skeleton3D skeleton3D.cpp
  */
 
 #include "mex.h"
 #include "matrix.h"
 
 #include "skeleton3D.h"
+#include "volNeighbors.h"
 #include <stdlib.h>
+#include <vector>
 
-int volNeighbors[27] = {
-  0, 0, 0, 0, 0, 0, 0, 0, 0, 
-  0, 0, 0, 0, 0, 0, 0, 0, 0, 
-  0, 0, 0, 0, 0, 0, 0, 0, 0
+// Directions of the 6-neighbors tested for border points, in each of the 12 subiterations
+static const char borderDirections[12][2] = {
+    {UP, SOUTH},    // UP_SOUTH
+    {NORTH, EAST},  // NORTH_EAST
+    {WEST, DOWN},   // WEST_DOWN
+    {EAST, SOUTH},  // EAST_SOUTH
+    {UP, WEST},     // UP_WEST
+    {NORTH, DOWN},  // NORTH_DOWN
+    {SOUTH, WEST},  // SOUTH_WEST
+    {UP, NORTH},    // UP_NORTH
+    {EAST, DOWN},   // EAST_DOWN
+    {NORTH, WEST},  // NORTH_WEST
+    {UP, EAST},     // UP_EAST
+    {SOUTH, DOWN}   // SOUTH_DOWN
 };
 
+// Templates of the UP_SOUTH direction, indexed by the neighborhood key: bit ii (ii = i+3*j+9*k,
+// skipping the center, ii = 13) is set if the neighbor n[i][j][k] belongs to the object
+static std::vector<unsigned char> templateLUT;
 
+// Permutation of the key by TransformNeighborhood for each direction, one table per key byte
+static unsigned int keyTransform[12][4][256];
 
-inline void CopyNeighborhoodInBuffer(unsigned char *vol, int L, int M, int N, 
-				     int idx, bool nb[3][3][3])
-{
-  int nidx;
-  char i, j, k, ii;
-  
-  ii = 0;
-  for(k=0; k < 3; k++) {
-    for(j=0; j < 3; j++) {
-      for(i=0; i < 3; i++) {
-	nidx = idx + volNeighbors[ii];
-	
-	if(vol[nidx] != 0) {
-	  nb[i][j][k] = true;
-	}
-	else {
-	  nb[i][j][k] = false;
-	}
-	
-	ii++;
-      }
+
+static void initTables() {
+    if (!templateLUT.empty()) {
+        return;
+    }
+
+    // key permutations: transform each neighbor alone
+    bool n[3][3][3], USn[3][3][3];
+    int perm[26];
+    for (int dir=0; dir < 12; dir++) {
+        for (int ii=0; ii < 27; ii++) {
+            if (ii == 13) {
+                continue;
+            }
+            memset(n, 0, sizeof(n));
+            n[ii % 3][(ii/3) % 3][ii/9] = true;
+            TransformNeighborhood(n, dir, USn);
+            for (int jj=0; jj < 27; jj++) {
+                if (USn[jj % 3][(jj/3) % 3][jj/9]) {
+                    perm[neighborIndex(ii % 3, (ii/3) % 3, ii/9)] = neighborIndex(jj % 3, (jj/3) % 3, jj/9);
+                }
+            }
+        }
+        for (int b=0; b < 4; b++) {
+            for (int v=0; v < 256; v++) {
+                unsigned int key = 0;
+                for (int bit=0; bit < 8 && 8*b+bit < 26; bit++) {
+                    if (v & (1 << bit)) {
+                        key |= 1u << perm[8*b+bit];
+                    }
+                }
+                keyTransform[dir][b][v] = key;
+            }
+        }
+    }
+
+    // lookup table of the templates
+    std::vector<unsigned char> lut(1 << 23);
+    int nBytes = (int)lut.size();
+#ifdef _OPENMP
+#pragma omp parallel for private(n)
+#endif
+    for (int byte=0; byte < nBytes; byte++) {
+        unsigned char bits = 0;
+        for (int bit=0; bit < 8; bit++) {
+            unsigned int key = 8*byte + bit;
+            for (int ii=0; ii < 27; ii++) {
+                n[ii % 3][(ii/3) % 3][ii/9] = ii == 13 || (key >> (ii < 13 ? ii : ii-1)) & 1;
+            }
+            if (MatchesATemplate(n)) {
+                bits |= 1 << bit;
+            }
+        }
+        lut[byte] = bits;
     }
-  }
-  
-return;
+    templateLUT.swap(lut);
 }
 
+
 // Mex entrypoint for matlab use
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs,const mxArray *prhs[])
 {
     // Check input and output arguments
-    
+
     if (nrhs != 1)
         mexErrMsgTxt("This function accepts exactly 1 input argument - a binary 3D matrix!");
-    
+
     if (nlhs != 1)
-        mexErrMsgTxt("This function has exactly 1 output argument - a binary 3D matrix!");    
-    
+        mexErrMsgTxt("This function has exactly 1 output argument - a binary 3D matrix!");
+
     if (mxGetNumberOfDimensions(prhs[0]) != 3)
         mexErrMsgTxt("The input matrix must be 3D!");
-    
+
     if (!mxIsLogical(prhs[0]))
         mexErrMsgTxt("The input matrix must be logical!");
-    
+
     //Get size of input matrix
-    int const *matSize = mxGetDimensions(prhs[0]);
-    
+    const mwSize* matSize = mxGetDimensions(prhs[0]);
+
     //Initialize output array and in/out pointers
-    plhs[0] = mxCreateLogicalArray(3,matSize);    
-    bool* matIn = (bool*) mxGetPr(prhs[0]);                        
-    bool* skel = (bool*) mxGetPr(plhs[0]);      
-    
+    plhs[0] = mxCreateLogicalArray(3,matSize);
+    mxLogical* matIn = mxGetLogicals(prhs[0]);
+    mxLogical* skel = mxGetLogicals(plhs[0]);
+
     //Get matrix sizes for readability
-    int L = matSize[0];
-    int M = matSize[1];
-    int N = matSize[2];
-    int i, j, k;        
-    int sz, slsz, idx;
-    sz = L * M * N;
-    slsz = L * M;
-        
-    unsigned char *volmat = (unsigned char*) malloc(sz * sizeof(unsigned char)); //Volume for labelling borders, deleted voxels etc. Stored as char to minimize memory use
-    unsigned char *vol = volmat;//Pointer to volume matrix 
-    char dir; //Direction of deletion
-    //int nrPasses; //Number of deletion passes           
-    int nrDel; //number of deleted voxels
-    
-    bool nb[3][3][3];  //Neighborhood of current point
-    bool USn[3][3][3]; //Transformed neighborhoods
-        
-    
-    // initialize global neighbors array
-    // lower plane
-    volNeighbors[0] = (-slsz -L -1);
-    volNeighbors[1] = (-slsz -L +0);
-    volNeighbors[2] = (-slsz -L +1);
-    volNeighbors[3] = (-slsz +0 -1);
-    volNeighbors[4] = (-slsz +0 +0);
-    volNeighbors[5] = (-slsz +0 +1);
-    volNeighbors[6] = (-slsz +L -1);
-    volNeighbors[7] = (-slsz +L +0);
-    volNeighbors[8] = (-slsz +L +1);
-    // same plane
-    volNeighbors[9]  = (+0 -L -1);
-    volNeighbors[10] = (+0 -L +0);
-    volNeighbors[11] = (+0 -L +1);
-    volNeighbors[12] = (+0 +0 -1);
-    volNeighbors[13] = (+0 +0 +0);
-    volNeighbors[14] = (+0 +0 +1);
-    volNeighbors[15] = (+0 +L -1);
-    volNeighbors[16] = (+0 +L +0);
-    volNeighbors[17] = (+0 +L +1);
-    // upper plane
-    volNeighbors[18] = (+slsz -L -1);
-    volNeighbors[19] = (+slsz -L +0);
-    volNeighbors[20] = (+slsz -L +1);
-    volNeighbors[21] = (+slsz +0 -1);
-    volNeighbors[22] = (+slsz +0 +0);
-    volNeighbors[23] = (+slsz +0 +1);
-    volNeighbors[24] = (+slsz +L -1);
-    volNeighbors[25] = (+slsz +L +0);
-    volNeighbors[26] = (+slsz +L +1);       
-
-    //Label the starting object voxels in the volume using the input matrix
-    int nnz = 0;
-    for(idx=0; idx < sz; idx++) {
-        if(matIn[idx] != 0){
+    int L = (int)matSize[0];
+    int M = (int)matSize[1];
+    int N = (int)matSize[2];
+    size_t slsz = (size_t)L * M;
+    size_t sz = slsz * N;
+    int i, j, k;
+
+    initTables();
+
+    //Offsets of the 26 neighbors (key bit order) and of the 6 directions
+    long volNeighbors[NB_NEIGHBORS];
+    volNeighborOffsets(L, M, volNeighbors);
+    long dirOffset[18];
+    dirOffset[UP] = L;
+    dirOffset[DOWN] = -L;
+    dirOffset[EAST] = 1;
+    dirOffset[WEST] = -1;
+    dirOffset[NORTH] = (long)slsz;
+    dirOffset[SOUTH] = -(long)slsz;
+
+    //Volume for labelling objects and border voxels. Stored as char to minimize memory use
+    std::vector<unsigned char> vol(sz, 0);
+    for(size_t idx=0; idx < sz; idx++) {
+        if(matIn[idx] != 0) {
             vol[idx] = OBJECT;
-            //nnz++;
         }
-        else{
-            vol[idx] = 0;
+    }
+
+    //List of the border voxels: interior object voxels with a background 6-neighbor
+    //(only interior voxels are deleted, as in [2])
+    std::vector<size_t> border;
+    for(k=1; k < (N-1); k++) {
+        for(j=1; j < (M-1); j++) {
+            for(i=1; i < (L-1); i++) {
+                size_t idx = k * slsz + j * L + i;
+                if (vol[idx] == 0) {
+                    continue;
+                }
+                for (int d=UP; d <= SOUTH; d++) {
+                    if (vol[idx + dirOffset[d]] == 0) {
+                        vol[idx] = D_BORDER;
+                        border.push_back(idx);
+                        break;
+                    }
+                }
+            }
         }
     }
-    
-    //std::cout << "Number of object voxels = " << nnz << "\n";
 
-    nrDel = 1;
-    //nrPasses = 1;    
+    std::vector<unsigned char> simple;
+    std::vector<size_t> deleted;
+    int nrDel = 1; //number of deleted voxels in a pass
 
     //Loop through thinning until no more points can be deleted
     while(nrDel > 0) {
-        
-        //std::cout << "Pass" << nrPasses << "\n";
+
         nrDel = 0;
-        
-        //Go through each direction and mark boundary points in that direction
-        for(dir = 0; dir < 12; dir++) {
-            
-            switch(dir) {
-                
-                case UP_SOUTH:
-                    // UP
-                    markBoundaryInDirection(vol, L, M, N, UP);
-                    // SOUTH
-                    markBoundaryInDirection(vol, L, M, N, SOUTH);
-                    break;
-                case NORTH_EAST:
-                    // NORTH
-                    markBoundaryInDirection(vol, L, M, N, NORTH);
-                    // EAST
-                    markBoundaryInDirection(vol, L, M, N, EAST);
-                    break;
-                case WEST_DOWN:
-                    // WEST
-                    markBoundaryInDirection(vol, L, M, N, WEST);
-                    // DOWN
-                    markBoundaryInDirection(vol, L, M, N, DOWN);
-                    break;
-                case EAST_SOUTH:
-                    // EAST
-                    markBoundaryInDirection(vol, L, M, N, EAST);
-                    // SOUTH
-                    markBoundaryInDirection(vol, L, M, N, SOUTH);
-                    break;
-                case UP_WEST:
-                    // UP
-                    markBoundaryInDirection(vol, L, M, N, UP);
-                    // WEST
-                    markBoundaryInDirection(vol, L, M, N, WEST);
-                    break;
-                case NORTH_DOWN:
-                    // NORTH
-                    markBoundaryInDirection(vol, L, M, N, NORTH);
-                    // DOWN
-                    markBoundaryInDirection(vol, L, M, N, DOWN);
-                    break;
-                case SOUTH_WEST:
-                    // SOUTH
-                    markBoundaryInDirection(vol, L, M, N, SOUTH);
-                    // WEST
-                    markBoundaryInDirection(vol, L, M, N, WEST);
-                    break;
-                case UP_NORTH:
-                    // UP
-                    markBoundaryInDirection(vol, L, M, N, UP);
-                    // NORTH
-                    markBoundaryInDirection(vol, L, M, N, NORTH);
-                    break;
-                case EAST_DOWN:
-                    // EAST
-                    markBoundaryInDirection(vol, L, M, N, EAST);
-                    // DOWN
-                    markBoundaryInDirection(vol, L, M, N, DOWN);	
-                    break;
-                case NORTH_WEST:
-                    // NORTH
-                    markBoundaryInDirection(vol, L, M, N, NORTH);
-                    // WEST
-                    markBoundaryInDirection(vol, L, M, N, WEST);
-                    break;
-                case UP_EAST:
-                    // UP
-                    markBoundaryInDirection(vol, L, M, N, UP);
-                    // EAST
-                    markBoundaryInDirection(vol, L, M, N, EAST);
-                    break;
-                case SOUTH_DOWN:
-                    // SOUTH
-                    markBoundaryInDirection(vol, L, M, N, SOUTH);
-                    // DOWN
-                    markBoundaryInDirection(vol, L, M, N, DOWN);	
-                    break;
-            }                        
-            
-            //check each boundary point and remove it if it matches a template
-            for(k=1; k < (N-1); k++) {
-                for(j=1; j < (M-1); j++) {
-                    for(i=1; i < (L-1); i++) {
-                        
-                        //Convert 3D index to 1D index
-                        idx = k * slsz + j * L + i;
-	    
-                        //If it is a border point
-                        if(vol[idx] == D_BORDER) {                                                        
-                            
-                            // copy this point's neighborhood into buffer                              
-                            CopyNeighborhoodInBuffer(vol, L, M, N, idx, nb);
-                            
-                            //Get appropriate transformation of neighborhood for this direction
-                            TransformNeighborhood(nb, dir, USn);	      
-                            if(MatchesATemplate(USn)) {		  
-                                
-                                //If it matches a template, it is simple, so mark it as such
-                                vol[idx] = SIMPLE;
-                                nrDel++;
-                            }
-                        }
-                    }
+
+        for(char dir = 0; dir < 12; dir++) {
+
+            long off1 = dirOffset[(int)borderDirections[(int)dir][0]];
+            long off2 = dirOffset[(int)borderDirections[(int)dir][1]];
+            const unsigned int (*T)[256] = keyTransform[(int)dir];
+
+            //Check the border points in this direction: simple if the transformed neighborhood
+            //matches a template
+            long nb = (long)border.size();
+            simple.assign(nb, 0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1024)
+#endif
+            for (long b=0; b < nb; b++) {
+                size_t idx = border[b];
+                if (vol[idx + off1] != 0 && vol[idx + off2] != 0) {
+                    continue;
                 }
+                unsigned int key = 0;
+                for (int ii=0; ii < NB_NEIGHBORS; ii++) {
+                    key |= (unsigned int)(vol[idx + volNeighbors[ii]] != 0) << ii;
+                }
+                key = T[0][key & 0xFF] | T[1][(key >> 8) & 0xFF] | T[2][(key >> 16) & 0xFF] | T[3][key >> 24];
+                simple[b] = (templateLUT[key >> 3] >> (key & 7)) & 1;
             }
-            
-            //std::cout << "# border voxels = " << nN << "\n";
-            
-            //Delete all simple points, and re-label all the remaining points as object
-            for(idx=0; idx < sz; idx++) {
-                if(vol[idx] == SIMPLE) 
-                    vol[idx] = 0;
-                if(vol[idx] != 0) 
-                    vol[idx] = OBJECT;
+
+            //Delete all simple points, and remove them from the border list
+            deleted.clear();
+            size_t nKept = 0;
+            for (long b=0; b < nb; b++) {
+                if (simple[b]) {
+                    vol[border[b]] = 0;
+                    deleted.push_back(border[b]);
+                } else {
+                    border[nKept++] = border[b];
+                }
+            }
+            border.resize(nKept);
+            nrDel += (int)deleted.size();
+
+            //The interior object 6-neighbors of deleted points become border points
+            for (size_t d=0; d < deleted.size(); d++) {
+                for (int dd=UP; dd <= SOUTH; dd++) {
+                    size_t idx = deleted[d] + dirOffset[dd];
+                    if (vol[idx] != OBJECT) {
+                        continue;
+                    }
+                    i = (int)(idx % L);
+                    j = (int)((idx / L) % M);
+                    k = (int)(idx / slsz);
+                    if (i > 0 && i < L-1 && j > 0 && j < M-1 && k > 0 && k < N-1) {
+                        vol[idx] = D_BORDER;
+                        border.push_back(idx);
+                    }
+                }
             }
-            
-            //printf("done.\n");
         }//End direction loop
-        
-    //std::cout << "Number of deleted voxels : " <<nrDel << "\n";
-    //nrPasses++;
-        
+
     }//End thinning loop
-    
-//The remaining points are all non-simple and are therefore define object's skeleton
-//Return these points as output
-for(idx=0; idx < sz; idx++) {        
-    if(vol[idx] != 0) 
-        skel[idx] = 1;
-}
-    free(volmat);
-}//End mexFunction
 
+    //The remaining points are all non-simple and are therefore define object's skeleton
+    //Return these points as output
+    for(size_t idx=0; idx < sz; idx++) {
+        if(vol[idx] != 0)
+            skel[idx] = 1;
+    }
+}//End mexFunction
@@ -7,6 +7,11 @@
 % in [1]. The function was converted to a MEX function from the C++ code
 % found in the supplement of [2].
 %
+% Only the current border voxels are visited, their neighborhoods are
+% matched against the templates with a lookup table (8 MB, built at the
+% first call and kept until 'clear mex'), and the voxels of each
+% subiteration are checked in parallel (OpenMP).
+%
 % Input: 
 %
 %   mask - A 3D binary (logical) matrix.
@@ -34,6 +39,10 @@
 %
 %       mex skeleton3D.cpp
 %
+%   or, with OpenMP (Mac/Linux):
+%
+%       mex CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" skeleton3D.cpp
+%
 % Hunter Elliott
 % 6/2010
 %
\ No newline at end of file
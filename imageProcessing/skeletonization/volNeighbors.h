@@ -0,0 +1,50 @@
+// 26-neighborhood of the voxels of a L x M x N volume (Matlab order: L is the fastest dimension),
+// shared by skeleton3D and skelGraph.
+//
+// The neighbor (i,j,k) (each in 0..2, the voxel itself is (1,1,1)) has the index
+// ii = i + 3*j + 9*k, skipping the center: this is the bit of the neighbor in the
+// neighborhood keys of skeleton3D.
+//
+
+#ifndef VOL_NEIGHBORS_H
+#define VOL_NEIGHBORS_H
+
+#include <math.h>
+
+#define NB_NEIGHBORS 26
+
+// Index of the neighbor (i,j,k)
+inline int neighborIndex(int i, int j, int k) {
+  int ii = i + 3*j + 9*k;
+  return ii < 13 ? ii : ii-1;
+}
+
+// Offsets of the 26 neighbors in the volume
+inline void volNeighborOffsets(int L, int M, long offsets[NB_NEIGHBORS]) {
+  long slsz = (long)L * M;
+  for(int k=0; k < 3; k++) {
+    for(int j=0; j < 3; j++) {
+      for(int i=0; i < 3; i++) {
+        if (i != 1 || j != 1 || k != 1) {
+          offsets[neighborIndex(i, j, k)] = (k-1)*slsz + (j-1)*L + (i-1);
+        }
+      }
+    }
+  }
+}
+
+// Distances to the 26 neighbors, for a voxel size spacing[0] x spacing[1] x spacing[2]
+inline void volNeighborDistances(const double spacing[3], double distances[NB_NEIGHBORS]) {
+  for(int k=0; k < 3; k++) {
+    for(int j=0; j < 3; j++) {
+      for(int i=0; i < 3; i++) {
+        if (i != 1 || j != 1 || k != 1) {
+          double di = (i-1)*spacing[0], dj = (j-1)*spacing[1], dk = (k-1)*spacing[2];
+          distances[neighborIndex(i, j, k)] = sqrt(di*di + dj*dj + dk*dk);
+        }
+      }
+    }
+  }
+}
+
+#endif
@@ -6,8 +6,8 @@
  * Last modified: Nov 29, 2012
  *
  * Compilation:
- * Mac/Linux: mex -I/usr/local/include -I../../mex/include /usr/local/lib/libgsl.a /usr/local/lib/libgslcblas.a steerableDetector.cpp
- * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT" -I"..\..\..\extern\mex\include\gsl-1.15" -I"..\..\mex\include" "..\..\..\extern\mex\lib\gsl.lib" "..\..\..\extern\mex\lib\cblas.lib" -output steerableDetector steerableDetector.cpp
+ * Mac/Linux: mex -I/usr/local/include -I../../mex/include /usr/local/lib/libgsl.a /usr/local/lib/libgslcblas.a CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" steerableDetector.cpp
+ * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT /openmp" -I"..\..\..\extern\mex\include\gsl-1.15" -I"..\..\mex\include" "..\..\..\extern\mex\lib\gsl.lib" "..\..\..\extern\mex\lib\cblas.lib" -output steerableDetector steerableDetector.cpp
  */
 
 
@@ -15,9 +15,11 @@
 #include <math.h>
 #include <gsl/gsl_poly.h>
 #include <algorithm>
+#include <vector>
 
 #include "mex.h"
 #include "convolver.h"
+#include "c++/solver.hpp"
 
 using namespace std;
 
@@ -98,15 +100,19 @@ double* getWeights(int M, double sigma) {
 }
 
 
-void computeBaseTemplates(double* input, int nx, int ny, int M, int borderCondition, double sigma, double** templates) {
+template<class T>
+void computeBaseTemplates(const T* input, int nx, int ny, int M, int borderCondition, double sigma, T** templates) {
+    typedef typename Convolver<T>::SeparableKernel Kernel;
     
     int wWidth = (int)(4.0*sigma);
     int nk = wWidth+1;
     
-    double* aKernel = new double[nk];
-    double* bKernel = new double[nk];
+    // all convolutions are computed at the end (batch), each kernel needs its own array
+    double* kernels = new double[10*nk];
+    double* next = kernels;
+    double* aKernel;
+    double* bKernel;
     double* g = new double[nk];
-    double* buffer = new double[nx*ny];
     double d;
     double sigma2 = sigma*sigma;
     double sigma4 = sigma2*sigma2;
@@ -119,125 +125,144 @@ void computeBaseTemplates(double* input, int nx, int ny, int M, int borderCondit
         g[i] = exp(-(i*i)/(2.0*sigma2));
     }
     
-    // set up convolver
-    Convolver conv = Convolver(input, nx, ny, borderCondition);
+    vector<Kernel> batch;
     
     if (M == 1 || M == 3 || M == 5) {
         
         d = 2.0*PI*sigma4;
+        aKernel = next; next += nk;
         for (int i=0;i<nk;i++) {
             aKernel[i] = -i*g[i] / d;
         }
         
         // g_x
-        conv.convolveOddXEvenY(aKernel, nk, g, nk, templates[0]);
+        batch.push_back(Kernel(aKernel, nk, true, g, nk, false, templates[0]));
         
         // g_y
-        conv.convolveEvenXOddY(g, nk, aKernel, nk, templates[1]);
+        batch.push_back(Kernel(g, nk, false, aKernel, nk, true, templates[1]));
         
         if (M == 3 || M == 5) {
             
             d = 2.0*PI*sigma8;
+            aKernel = next; next += nk;
             for (int i=0;i<nk;i++) {
                 aKernel[i] = (3.0*i*sigma2 - i*i*i) * g[i] / d;
             }
             // g_xxx
-            conv.convolveOddXEvenY(aKernel, nk, g, nk, templates[2]);
+            batch.push_back(Kernel(aKernel, nk, true, g, nk, false, templates[2]));
             
             // g_yyy
-            conv.convolveEvenXOddY(g, nk, aKernel, nk, templates[5]);
+            batch.push_back(Kernel(g, nk, false, aKernel, nk, true, templates[5]));
+            aKernel = next; next += nk;
+            bKernel = next; next += nk;
             for (int i=0;i<nk;i++) {
                 aKernel[i] = (sigma2 - i*i) * g[i] / d;
                 bKernel[i] = i*g[i];
             }
             // gxxy
-            conv.convolveEvenXOddY(aKernel, nk, bKernel, nk, templates[3]);
+            batch.push_back(Kernel(aKernel, nk, false, bKernel, nk, true, templates[3]));
             // gxyy
-            conv.convolveOddXEvenY(bKernel, nk, aKernel, nk, templates[4]);
+            batch.push_back(Kernel(bKernel, nk, true, aKernel, nk, false, templates[4]));
         }
         if (M == 5) {
             
             d = 2.0*PI*sigma12;
+            aKernel = next; next += nk;
             for (int i=0;i<nk;i++) {
                 aKernel[i] = -i*(i*i*i*i - 10.0*i*i*sigma2 + 15.0*sigma4) * g[i] / d;
             }
             // gxxxxx
-            conv.convolveOddXEvenY(aKernel, nk, g, nk, templates[6]);
+            batch.push_back(Kernel(aKernel, nk, true, g, nk, false, templates[6]));
             // gyyyyy
-            conv.convolveEvenXOddY(g, nk, aKernel, nk, templates[11]);
+            batch.push_back(Kernel(g, nk, false, aKernel, nk, true, templates[11]));
+            aKernel = next; next += nk;
+            bKernel = next; next += nk;
             for (int i=0;i<nk;i++) {
                 aKernel[i] = (i*i*i*i - 6.0*i*i*sigma2 + 3.0*sigma4) * g[i] / d;
                 bKernel[i] = -i * g[i];
             }
             // g_xxxxy
-            conv.convolveEvenXOddY(aKernel, nk, bKernel, nk, templates[7]);
+            batch.push_back(Kernel(aKernel, nk, false, bKernel, nk, true, templates[7]));
             // g_xyyyy
-            conv.convolveOddXEvenY(bKernel, nk, aKernel, nk, templates[10]);
+            batch.push_back(Kernel(bKernel, nk, true, aKernel, nk, false, templates[10]));
+            aKernel = next; next += nk;
+            bKernel = next; next += nk;
             for (int i=0;i<nk;i++) {
                 aKernel[i] = i*(i*i - 3.0*sigma2) * g[i] / d;
                 bKernel[i] = (sigma2 - i*i) * g[i];
             }
             // g_xxxyy
-            conv.convolveOddXEvenY(aKernel, nk, bKernel, nk, templates[8]);
+            batch.push_back(Kernel(aKernel, nk, true, bKernel, nk, false, templates[8]));
             // g_xxyyy
-            conv.convolveEvenXOddY(bKernel, nk, aKernel, nk, templates[9]);
+            batch.push_back(Kernel(bKernel, nk, false, aKernel, nk, true, templates[9]));
         }
     } else { //(M == 2 || M == 4)
         
         d = 2.0*PI*sigma6;
+        aKernel = next; next += nk;
         for (int i=0;i<nk;i++) {
             aKernel[i] = (i*i - sigma2) * g[i] / d;
         }
         // g_xx
-        conv.convolveEvenXEvenY(aKernel, nk, g, nk, templates[0]);
+        batch.push_back(Kernel(aKernel, nk, false, g, nk, false, templates[0]));
         // g_yy
-        conv.convolveEvenXEvenY(g, nk, aKernel, nk, templates[2]);
+        batch.push_back(Kernel(g, nk, false, aKernel, nk, false, templates[2]));
+        aKernel = next; next += nk;
+        bKernel = next; next += nk;
         for (int i=0;i<nk;i++) {
             aKernel[i] = i * g[i];
             bKernel[i] = aKernel[i] / d;
         }
         // g_xy
-        conv.convolveOddXOddY(aKernel, nk, bKernel, nk, templates[1]);
+        batch.push_back(Kernel(aKernel, nk, true, bKernel, nk, true, templates[1]));
         
         if (M == 4) {
             
             d = 2.0*PI*sigma10;
+            aKernel = next; next += nk;
             for (int i=0;i<nk;i++) {
                 aKernel[i] = (i*i*i*i - 6.0*i*i*sigma2 + 3.0*sigma4) * g[i] / d;
             }
             // g_xxxx
-            conv.convolveEvenXEvenY(aKernel, nk, g, nk, templates[3]);
+            batch.push_back(Kernel(aKernel, nk, false, g, nk, false, templates[3]));
             // g_yyyy
-            conv.convolveEvenXEvenY(g, nk, aKernel, nk, templates[7]);
+            batch.push_back(Kernel(g, nk, false, aKernel, nk, false, templates[7]));
+            aKernel = next; next += nk;
+            bKernel = next; next += nk;
             for (int i=0;i<nk;i++) {
                 aKernel[i] = i * (i*i - 3.0*sigma2) * g[i] / d;
                 bKernel[i] = i * g[i];
             }
             // g_xxxy
-            conv.convolveOddXOddY(aKernel, nk, bKernel, nk, templates[4]);
+            batch.push_back(Kernel(aKernel, nk, true, bKernel, nk, true, templates[4]));
             // g_xyyy
-            conv.convolveOddXOddY(bKernel, nk, aKernel, nk, templates[6]);
+            batch.push_back(Kernel(bKernel, nk, true, aKernel, nk, true, templates[6]));
+            aKernel = next; next += nk;
+            bKernel = next; next += nk;
             for (int i=0;i<nk;i++) {
                 aKernel[i] = (sigma2 - i*i) * g[i];
                 bKernel[i] = aKernel[i] / d;
             }
             // g_xxyy
-            conv.convolveEvenXEvenY(aKernel, nk, bKernel, nk, templates[5]);
+            batch.push_back(Kernel(aKernel, nk, false, bKernel, nk, false, templates[5]));
         }
     }
     
+    // x-kernels that are equal up to a scale factor share their x-pass
+    Convolver<T> conv(input, nx, ny, borderCondition);
+    conv.convolve(batch);
+
     // free memory
-    delete[] aKernel;
-    delete[] bKernel;
+    delete[] kernels;
     delete[] g;
-    delete[] buffer;
 }
 
 
 
 
 // Point responses
-double pointRespM1(int i, double angle, double* alpha, double** templates) {
+template<class T>
+double pointRespM1(int i, double angle, double* alpha, T** templates) {
     
     double cosT = cos(angle);
     double sinT = sin(angle);
@@ -251,7 +276,8 @@ double pointRespM1(int i, double angle, double* alpha, double** templates) {
 }
 
 
-double pointRespM2(int i, double angle, double* alpha, double** templates) {
+template<class T>
+double pointRespM2(int i, double angle, double* alpha, T** templates) {
     
     double cosT = cos(angle);
     double sinT = sin(angle);
@@ -270,7 +296,8 @@ double pointRespM2(int i, double angle, double* alpha, double** templates) {
 }
 
 
-double pointRespM3(int i, double angle, double* alpha, double** templates) {
+template<class T>
+double pointRespM3(int i, double angle, double* alpha, T** templates) {
     
     double cosT = cos(angle);
     double sinT = sin(angle);
@@ -298,7 +325,8 @@ double pointRespM3(int i, double angle, double* alpha, double** templates) {
 }
 
 
-double pointRespM4(int i, double angle, double* alpha, double** templates) {
+template<class T>
+double pointRespM4(int i, double angle, double* alpha, T** templates) {
     
     double cosT = cos(angle);
     double sinT = sin(angle);
@@ -335,7 +363,8 @@ double pointRespM4(int i, double angle, double* alpha, double** templates) {
 
 
 
-double pointRespM5(int i, double angle, double* alpha, double** templates) {
+template<class T>
+double pointRespM5(int i, double angle, double* alpha, T** templates) {
     
     double cosT = cos(angle);
     double sinT = sin(angle);
@@ -384,65 +413,110 @@ double pointRespM5(int i, double angle, double* alpha, double** templates) {
 
 
 
-int getRealRoots(double* z, int nz, double* roots) {
-    int nr = nz/2; // total roots
+// Real roots of a[0] + a[1]*x + ... + a[deg]*x^deg, with a[deg] != 0 and deg <= 5.
+// Degrees up to 3 are solved analytically; quartics and quintics use the eigenvalues
+// of the companion matrix, with one workspace per degree that is reused for all pixels.
+class RootSolver {
 
-    int nrr = 0; // real roots
-    for (int k=0;k<nr;++k) {
-        if (z[2*k+1]==0.0)
-            nrr++;
+public:
+    RootSolver() {
+        for (int d=0;d<6;++d) {
+            w_[d] = NULL;
+        }
     }
-    roots = new double[nrr];
-    nrr = 0;
-    for (int k=0;k<nr;++k) {
-        if (z[2*k+1]==0.0)
-            roots[nrr++] = z[2*k];
+    
+    ~RootSolver() {
+        for (int d=0;d<6;++d) {
+            if (w_[d]!=NULL) {
+                gsl_poly_complex_workspace_free(w_[d]);
+            }
+        }
+    }
+    
+    int operator()(const double* a, int deg, double* roots) {
+        switch (deg) {
+            case 1:
+                solve_(a[1], a[0]);
+                break;
+            case 2:
+                solve_(a[2], a[1], a[0]);
+                break;
+            case 3:
+                solve_(a[3], a[2], a[1], a[0]);
+                break;
+            default: {
+                if (w_[deg]==NULL) {
+                    w_[deg] = gsl_poly_complex_workspace_alloc(deg+1);
+                }
+                double z[10];
+                gsl_poly_complex_solve(a, deg+1, w_[deg], z);
+                int nr = 0;
+                for (int k=0;k<deg;++k) {
+                    if (z[2*k+1]==0.0) {
+                        roots[nr++] = z[2*k];
+                    }
+                }
+                return nr;
+            }
+        }
+        for (int k=0;k<solve_.nroots();++k) {
+            roots[k] = solve_.root(k);
+        }
+        return solve_.nroots();
     }
-    return nrr;
-}
 
+private:
+    solver solve_;
+    gsl_poly_complex_workspace* w_[6];
+};
 
 
-void filterM1(double** templates, int nx, int ny, double* alpha, double* response, double* orientation) {
+
+template<class T>
+void filterM1(T** templates, int nx, int ny, double* alpha, double* response, double* orientation) {
     
-    double* gx = templates[0];
-    double* gy = templates[1];
+    T* gx = templates[0];
+    T* gy = templates[1];
     double a11 = alpha[0];
     
-    double* tRoots = new double[2];
-    double gxi, gyi;
-    
-    for (int i=0;i<nx*ny;++i) {
-        gxi = approxZero(gx[i]);
-        gyi = approxZero(gy[i]);
+    int N = nx*ny;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int i=0;i<N;++i) {
+        double gxi = approxZero(gx[i]);
+        double gyi = approxZero(gy[i]);
         
         orientation[i] = atan2(gyi,gxi);
         response[i] = a11*sqrt(gxi*gxi + gyi*gyi);
     }
-    delete[] tRoots;
 }
 
 
 
 
 // quadratic root solution
-void filterM2(double** templates, int nx, int ny, double* alpha, double* response, double* orientation) {
+template<class T>
+void filterM2(T** templates, int nx, int ny, double* alpha, double* response, double* orientation) {
     
-    double* gxx = templates[0];
-    double* gxy = templates[1];
-    double* gyy = templates[2];
+    T* gxx = templates[0];
+    T* gxy = templates[1];
+    T* gyy = templates[2];
     double a20 = alpha[0];
     double a22 = alpha[1];
     
-    double A, B, C;
     double a = a22-a20;
-    double temp;
+    int N = nx*ny;
    
-    for (int i=0;i<nx*ny;++i) {
-                
-        A = a*gxy[i];
-        B = a*(gxx[i]-gyy[i]);
-        C = -A;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int i=0;i<N;++i) {
+        
+        double temp, xRoots[2], tRoots[2];
+        double A = a*gxy[i];
+        double B = a*(gxx[i]-gyy[i]);
+        double C = -A;
 
         if (A == 0.0) { // -> linear
             if (B == 0.0) { // -> null, solve
@@ -468,10 +542,8 @@ void filterM2(double** templates, int nx, int ny, double* alpha, double* respons
                 }
             }
         } else { // solve quadratic
-            double* xRoots = new double[2];
             gsl_poly_solve_quadratic (A, B, C, &xRoots[0], &xRoots[1]);
             
-            double* tRoots = new double[2];
             tRoots[0] = atan(xRoots[0]);
             tRoots[1] = atan(xRoots[1]);
             response[i] = pointRespM2(i, tRoots[0], alpha, templates);
@@ -481,138 +553,113 @@ void filterM2(double** templates, int nx, int ny, double* alpha, double* respons
                 response[i] = temp;
                 orientation[i] = tRoots[1];
             }
-            delete[] xRoots;
-            delete[] tRoots;
         }
     }
 }
 
 
 
-void filterM3(double** templates, int nx, int ny, double* alpha, double* response, double* orientation) {
+template<class T>
+void filterM3(T** templates, int nx, int ny, double* alpha, double* response, double* orientation) {
     
-    double* gx = templates[0];
-    double* gy = templates[1];
-    double* gxxx = templates[2];
-    double* gxxy = templates[3];
-    double* gxyy = templates[4];
-    double* gyyy = templates[5];
+    T* gx = templates[0];
+    T* gy = templates[1];
+    T* gxxx = templates[2];
+    T* gxxy = templates[3];
+    T* gxyy = templates[4];
+    T* gyyy = templates[5];
     
     double a10 = alpha[0];
     double a30 = alpha[1];
     double a32 = alpha[2];
     
-    double A, B, C, D;
+    int N = nx*ny;
     
-    int nr, nt, deg;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        double A, B, C, D;
     
-    for (int i=0;i<nx*ny;++i) {
+        int nr, nt;
+        double a[4], roots[3], tRoots[6];
+        RootSolver solveRoots; // one workspace per thread
+    
+#ifdef _OPENMP
+#pragma omp for
+#endif
+        for (int i=0;i<N;++i) {
         
-        A = -a10*gx[i] + (2.0*a32-3.0*a30)*gxyy[i] - a32*gxxx[i]; // sin^3
-        B =  a10*gy[i] + (3.0*a30-2.0*a32)*gyyy[i] + (7.0*a32-6.0*a30)*gxxy[i]; // sin^2 cos
-        C = -a10*gx[i] + (2.0*a32-3.0*a30)*gxxx[i] + (6.0*a30-7.0*a32)*gxyy[i];
-        D =  a10*gy[i] + (3.0*a30-2.0*a32)*gxxy[i] + a32*gyyy[i];
+            A = -a10*gx[i] + (2.0*a32-3.0*a30)*gxyy[i] - a32*gxxx[i]; // sin^3
+            B =  a10*gy[i] + (3.0*a30-2.0*a32)*gyyy[i] + (7.0*a32-6.0*a30)*gxxy[i]; // sin^2 cos
+            C = -a10*gx[i] + (2.0*a32-3.0*a30)*gxxx[i] + (6.0*a30-7.0*a32)*gxyy[i];
+            D =  a10*gy[i] + (3.0*a30-2.0*a32)*gxxy[i] + a32*gyyy[i];
         
-        A = approxZero(A);
-        B = approxZero(B);
-        C = approxZero(C);
-        D = approxZero(D);
+            A = approxZero(A);
+            B = approxZero(B);
+            C = approxZero(C);
+            D = approxZero(D);
         
-        double* roots;
-        double* z;
-        if (A == 0.0) { // -> quadratic
-            if (B == 0.0) { // -> linear
-                if (C == 0.0) {// -> null, fixed solution
-                    deg = 1;
-                    z = new double[2*deg];
-                    z[0] = 0.0;
-                    z[1] = 0.0;
-                } else {
-                    deg = 1;
-                    double a[2] = {D, C};
-                    z = new double[2*deg];
-                    gsl_poly_complex_workspace* w = gsl_poly_complex_workspace_alloc(deg+1);
-                    gsl_poly_complex_solve(a, deg+1, w, z);
-                    gsl_poly_complex_workspace_free(w);
+            a[0] = D; a[1] = C; a[2] = B; a[3] = A;
+            if (A == 0.0) { // -> quadratic
+                if (B == 0.0) { // -> linear
+                    if (C == 0.0) {// -> null, fixed solution
+                        nr = 1;
+                        roots[0] = 0.0;
+                    } else {
+                        nr = solveRoots(a, 1, roots);
+                    }
+                } else { // B!=0
+                    nr = solveRoots(a, 2, roots);
                 }
-            } else { // B!=0
-                deg = 2;
-                double a[3] = {D, C, B};
-                z = new double[2*deg];
-                gsl_poly_complex_workspace* w = gsl_poly_complex_workspace_alloc(deg+1);
-                gsl_poly_complex_solve(a, deg+1, w, z);
-                gsl_poly_complex_workspace_free(w);
-            }
-        } else { // solve cubic
-            deg = 3;
-            double a[4] = {D, C, B, A};
-            z = new double[2*deg];
-            gsl_poly_complex_workspace* w = gsl_poly_complex_workspace_alloc(deg+1);
-            gsl_poly_complex_solve(a, deg+1, w, z);
-            gsl_poly_complex_workspace_free(w);
-        }
-    
-        nr = 0;
-        for (int k=0;k<deg;++k) {
-            if (z[2*k+1]==0.0)
-                nr++;
-        }
-        roots = new double[nr];
-        nr = 0;
-        for (int k=0;k<deg;++k) {
-            if (z[2*k+1]==0.0) {
-                roots[nr++] = z[2*k];
+            } else { // solve cubic
+                nr = solveRoots(a, 3, roots);
             }
-        }
         
-        double* tRoots;
-        if (nr == 0) {
-            nt = 4;
-            tRoots = new double[nt];
-            tRoots[0] = -PI/2.0;
-            tRoots[1] = 0.0;
-            tRoots[2] = PI/2.0;
-            tRoots[3] = PI;
-        } else {
-            nt = 2*nr;
-            tRoots = new double[nt];
-            for (int k=0;k<nr;k++) {
-                tRoots[k] = atan(roots[k]);
-                tRoots[k+nr] = opposite(tRoots[k]);
+            if (nr == 0) {
+                nt = 4;
+                tRoots[0] = -PI/2.0;
+                tRoots[1] = 0.0;
+                tRoots[2] = PI/2.0;
+                tRoots[3] = PI;
+            } else {
+                nt = 2*nr;
+                for (int k=0;k<nr;k++) {
+                    tRoots[k] = atan(roots[k]);
+                    tRoots[k+nr] = opposite(tRoots[k]);
+                }
             }
-        }
-        delete[] roots;
         
         
-        response[i] = pointRespM3(i, tRoots[0], alpha, templates);
-        orientation[i] = tRoots[0];
+            response[i] = pointRespM3(i, tRoots[0], alpha, templates);
+            orientation[i] = tRoots[0];
         
-        double temp;
-        for (int k=1;k<nt;k++) {
-            temp = pointRespM3(i, tRoots[k], alpha, templates);
-            if (temp > response[i]) {
-                response[i] = temp;
-                orientation[i] = tRoots[k];
+            double temp;
+            for (int k=1;k<nt;k++) {
+                temp = pointRespM3(i, tRoots[k], alpha, templates);
+                if (temp > response[i]) {
+                    response[i] = temp;
+                    orientation[i] = tRoots[k];
+                }
             }
         }
-        delete[] tRoots;
-        delete[] z;
     }
 }
 
 
 
 
-void filterM4(double** templates, int nx, int ny, double* alpha, double* response, double* orientation) {
+template<class T>
+void filterM4(T** templates, int nx, int ny, double* alpha, double* response, double* orientation) {
     
-    double* gxx = templates[0];
-    double* gxy = templates[1];
-    double* gyy = templates[2];
-    double* gxxxx = templates[3];
-    double* gxxxy = templates[4];
-    double* gxxyy = templates[5];
-    double* gxyyy = templates[6];
-    double* gyyyy = templates[7];
+    T* gxx = templates[0];
+    T* gxy = templates[1];
+    T* gyy = templates[2];
+    T* gxxxx = templates[3];
+    T* gxxxy = templates[4];
+    T* gxxyy = templates[5];
+    T* gxyyy = templates[6];
+    T* gyyyy = templates[7];
 
     double a20 = alpha[0];
     double a22 = alpha[1];
@@ -620,156 +667,113 @@ void filterM4(double** templates, int nx, int ny, double* alpha, double* respons
     double a42 = alpha[3];
     double a44 = alpha[4];
     
-    double A, B, C, D, E;
-    
-    int nr, deg;
-    double delta;
+    int N = nx*ny;
     
-    for (int i=0;i<nx*ny;i++) {
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        double A, B, C, D, E;
+    
+        int nr;
+        double delta;
+        double a[5], roots[4], tRoots[5];
+        RootSolver solveRoots; // one workspace per thread
+    
+#ifdef _OPENMP
+#pragma omp for
+#endif
+        for (int i=0;i<N;i++) {
         
-        A = (a22-a20)*gxy[i] + (a42-2.0*a40)*gxyyy[i] + (2.0*a44-a42)*gxxxy[i];
-        B = (a20-a22)*gyy[i] + (a22-a20)*gxx[i] + (2.0*a40-a42)*gyyyy[i] + 6.0*(a42-a40-a44)*gxxyy[i] + (2.0*a44-a42)*gxxxx[i];
-        C = 6.0*((a40-a42+ a44)*gxyyy[i] + (a42-a40-a44)*gxxxy[i]);
-        D = (a20-a22)*gyy[i] + (a22-a20)*gxx[i] + (a42-2.0*a44)*gyyyy[i] + 6.0*(a40-a42+a44)*gxxyy[i] + (a42-2.0*a40)*gxxxx[i];
-        E = (a20-a22)*gxy[i] + (a42-2.0*a44)*gxyyy[i] + (2.0*a40-a42)*gxxxy[i];
+            A = (a22-a20)*gxy[i] + (a42-2.0*a40)*gxyyy[i] + (2.0*a44-a42)*gxxxy[i];
+            B = (a20-a22)*gyy[i] + (a22-a20)*gxx[i] + (2.0*a40-a42)*gyyyy[i] + 6.0*(a42-a40-a44)*gxxyy[i] + (2.0*a44-a42)*gxxxx[i];
+            C = 6.0*((a40-a42+ a44)*gxyyy[i] + (a42-a40-a44)*gxxxy[i]);
+            D = (a20-a22)*gyy[i] + (a22-a20)*gxx[i] + (a42-2.0*a44)*gyyyy[i] + 6.0*(a40-a42+a44)*gxxyy[i] + (a42-2.0*a40)*gxxxx[i];
+            E = (a20-a22)*gxy[i] + (a42-2.0*a44)*gxyyy[i] + (2.0*a40-a42)*gxxxy[i];
         
-        A = approxZero(A);
-        C = approxZero(C);
-        E = approxZero(E);
+            A = approxZero(A);
+            C = approxZero(C);
+            E = approxZero(E);
         
-        double* roots;
-        double* z;
-        if (A == 0.0) { // -> cubic
-            if (B == 0.0) { // -> quadratic
-                if (C == 0.0) { // -> linear
-                    if (D == 0.0) { // solve null
-                        deg = 1;
-                        z = new double[2*deg];
-                        z[0] = 0.0;
-                        z[1] = 0.0;
-                    } else { // solve linear
-                        deg = 1;
-                        double a[2] = {E, D};
-                        z = new double[2*deg];
-                        gsl_poly_complex_workspace* w = gsl_poly_complex_workspace_alloc(deg+1);
-                        gsl_poly_complex_solve(a, deg+1, w, z);
-                        gsl_poly_complex_workspace_free(w);
+            a[0] = E; a[1] = D; a[2] = C; a[3] = B; a[4] = A;
+            if (A == 0.0) { // -> cubic
+                if (B == 0.0) { // -> quadratic
+                    if (C == 0.0) { // -> linear
+                        if (D == 0.0) { // solve null
+                            nr = 1;
+                            roots[0] = 0.0;
+                        } else { // solve linear
+                            nr = solveRoots(a, 1, roots);
+                        }
+                    } else { // solve quadratic
+                        nr = solveRoots(a, 2, roots);
                     }
-                } else { // solve quadratic
-                    deg = 2;
-                    double a[3] = {E, D, C};
-                    z = new double[2*deg];
-                    gsl_poly_complex_workspace* w = gsl_poly_complex_workspace_alloc(deg+1);
-                    gsl_poly_complex_solve(a, deg+1, w, z);
-                    gsl_poly_complex_workspace_free(w);
-                }
-            } else { // solve cubic
-                if ( (C == 0.0) && (E == 0.0) ) {
-                    delta = -D/B;
-                    if (delta > 0.0) {
-                        deg = 3;
-                        delta = sqrt(delta);
-                        z = new double[2*deg];
-                        z[0] = 0.0;
-                        z[1] = 0.0;
-                        z[2] = delta;
-                        z[3] = 0.0;
-                        z[4] = -delta;
-                        z[5] = 0.0;
+                } else { // solve cubic
+                    if ( (C == 0.0) && (E == 0.0) ) {
+                        delta = -D/B;
+                        if (delta > 0.0) {
+                            nr = 3;
+                            delta = sqrt(delta);
+                            roots[0] = 0.0;
+                            roots[1] = delta;
+                            roots[2] = -delta;
+                        } else {
+                            nr = 1;
+                            roots[0] = 0.0;
+                        }
                     } else {
-                        deg = 1;
-                        z = new double[2*deg];
-                        z[0] = 0.0;
-                        z[1] = 0.0;
+                        nr = solveRoots(a, 3, roots);
                     }
-                } else {
-                    deg = 3;
-                    double a[4] = {E, D, C, B};
-                    z = new double[2*deg];
-                    gsl_poly_complex_workspace* w = gsl_poly_complex_workspace_alloc(deg+1);
-                    gsl_poly_complex_solve(a, deg+1, w, z);
-                    gsl_poly_complex_workspace_free(w);
                 }
+            } else { // solve quartic
+                nr = solveRoots(a, 4, roots);
             }
-        } else { // solve quartic
-            deg = 4;
-            double a[5] = {E, D, C, B, A};
-            z = new double[2*deg];
-            gsl_poly_complex_workspace* w = gsl_poly_complex_workspace_alloc(deg+1);
-            gsl_poly_complex_solve(a, deg+1, w, z);
-            gsl_poly_complex_workspace_free(w);
-        }
-            
-        // # real roots
-        nr = 0;
-        for (int k=0;k<deg;++k) {
-            if (z[2*k+1]==0.0)
-                nr++;
-        }
-        roots = new double[nr];
-        nr = 0;
-        for (int k=0;k<deg;++k) {
-            if (z[2*k+1]==0.0) {
-                roots[nr++] = z[2*k];
-            }
-        }
-
         
-        double* tRoots;
-        if (nr == 0) { //orientation[i] = 0.0;
-            nr = 2;
-            tRoots = new double[nr];
-            tRoots[0] = 0.0;
-            tRoots[1] = PI/2.0;
-        } else {
-            if (roots[0] == 0.0) {
-                nr++;
-                tRoots = new double[nr];
-                for (int k=0;k<nr-1;k++) {
-                    tRoots[k] = atan(roots[k]);
-                }
-                tRoots[nr-1] = PI/2;
+            if (nr == 0) { //orientation[i] = 0.0;
+                nr = 2;
+                tRoots[0] = 0.0;
+                tRoots[1] = PI/2.0;
             } else {
-                tRoots = new double[nr];
                 for (int k=0;k<nr;k++) {
                     tRoots[k] = atan(roots[k]);
                 }
+                if (roots[0] == 0.0) {
+                    tRoots[nr++] = PI/2;
+                }
             }
-        }
-        delete[] roots;
               
-        response[i] = pointRespM4(i, tRoots[0], alpha, templates);
-        orientation[i] = tRoots[0];
+            response[i] = pointRespM4(i, tRoots[0], alpha, templates);
+            orientation[i] = tRoots[0];
        
-        double temp;
-        for (int k=1;k<nr;k++) {
-            temp = pointRespM4(i, tRoots[k], alpha, templates);
-            if (temp > response[i]) {
-                response[i] = temp;
-                orientation[i] = tRoots[k];
+            double temp;
+            for (int k=1;k<nr;k++) {
+                temp = pointRespM4(i, tRoots[k], alpha, templates);
+                if (temp > response[i]) {
+                    response[i] = temp;
+                    orientation[i] = tRoots[k];
+                }
             }
         }
-        delete[] z;
-        delete[] tRoots;
     }
 }
 
 
 
-void filterM5(double** templates, int nx, int ny, double* alpha, double* response, double* orientation) {
+template<class T>
+void filterM5(T** templates, int nx, int ny, double* alpha, double* response, double* orientation) {
     
-    double* gx = templates[0];
-    double* gy = templates[1];
-    double* gxxx = templates[2];
-    double* gxxy = templates[3];
-    double* gxyy = templates[4];
-    double* gyyy = templates[5];
-    double* gxxxxx = templates[6];
-    double* gxxxxy = templates[7];
-    double* gxxxyy = templates[8];
-    double* gxxyyy = templates[9];
-    double* gxyyyy = templates[10];
-    double* gyyyyy = templates[11];
+    T* gx = templates[0];
+    T* gy = templates[1];
+    T* gxxx = templates[2];
+    T* gxxy = templates[3];
+    T* gxyy = templates[4];
+    T* gyyy = templates[5];
+    T* gxxxxx = templates[6];
+    T* gxxxxy = templates[7];
+    T* gxxxyy = templates[8];
+    T* gxxyyy = templates[9];
+    T* gxyyyy = templates[10];
+    T* gyyyyy = templates[11];
     
     double a10 = alpha[0];
     double a30 = alpha[1];
@@ -777,146 +781,101 @@ void filterM5(double** templates, int nx, int ny, double* alpha, double* respons
     double a52 = alpha[3];
     double a54 = alpha[4];
     
-    double A, B, C, D, E, F;
-    int nr, nt, deg;
-    double delta;
+    int N = nx*ny;
     
-    for (int i=0;i<nx*ny;++i) {
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        double A, B, C, D, E, F;
+        int nr, nt;
+        double delta;
+        double a[6], roots[5], tRoots[10];
+        RootSolver solveRoots; // one workspace per thread
+    
+#ifdef _OPENMP
+#pragma omp for
+#endif
+        for (int i=0;i<N;++i) {
 
-        A = -a10*gx[i] + (2.0*a32-3.0*a30)*gxyy[i] - a32*gxxx[i] + (4.0*a54-3.0*a52)*gxxxyy[i] + 2.0*a52*gxyyyy[i] -a54*gxxxxx[i];
-        B = a10*gy[i] + (3.0*a30-2.0*a32)*gyyy[i] + (7.0*a32-6.0*a30)*gxxy[i] - 2.0*a52*gyyyyy[i] + (17.0*a52-12.0*a54)*gxxyyy[i] + (13.0*a54-6.0*a52)*gxxxxy[i];
-        C = -2.0*a10*gx[i] + (3.0*a30-5.0*a32)*gxyy[i] + (a32-3.0*a30)*gxxx[i] + (12.0*a54-17.0*a52)*gxyyyy[i] + (30.0*a52-34.0*a54)*gxxxyy[i] + (4.0*a54-3.0*a52)*gxxxxx[i];
-        D = 2.0*a10*gy[i] + (5.0*a32-3.0*a30)*gxxy[i] + (3.0*a30-a32)*gyyy[i] + (17.0*a52-12.0*a54)*gxxxxy[i] + (34.0*a54-30.0*a52)*gxxyyy[i] + (3.0*a52-4.0*a54)*gyyyyy[i];
-        E = -a10*gx[i] + (2.0*a32-3.0*a30)*gxxx[i] + (6.0*a30-7.0*a32)*gxyy[i] + 2.0*a52*gxxxxx[i] + (12.0*a54-17.0*a52)*gxxxyy[i] + (6.0*a52-13.0*a54)*gxyyyy[i];
-        F = a10*gy[i] + (3.0*a30-2.0*a32)*gxxy[i] + a32*gyyy[i] + (3.0*a52-4.0*a54)*gxxyyy[i] - 2.0*a52*gxxxxy[i]+ a54*gyyyyy[i];
-        
-        A = approxZero(A);
-        B = approxZero(B);
-        C = approxZero(C);
-        D = approxZero(D);
-        E = approxZero(E);
-        F = approxZero(F);
+            A = -a10*gx[i] + (2.0*a32-3.0*a30)*gxyy[i] - a32*gxxx[i] + (4.0*a54-3.0*a52)*gxxxyy[i] + 2.0*a52*gxyyyy[i] -a54*gxxxxx[i];
+            B = a10*gy[i] + (3.0*a30-2.0*a32)*gyyy[i] + (7.0*a32-6.0*a30)*gxxy[i] - 2.0*a52*gyyyyy[i] + (17.0*a52-12.0*a54)*gxxyyy[i] + (13.0*a54-6.0*a52)*gxxxxy[i];
+            C = -2.0*a10*gx[i] + (3.0*a30-5.0*a32)*gxyy[i] + (a32-3.0*a30)*gxxx[i] + (12.0*a54-17.0*a52)*gxyyyy[i] + (30.0*a52-34.0*a54)*gxxxyy[i] + (4.0*a54-3.0*a52)*gxxxxx[i];
+            D = 2.0*a10*gy[i] + (5.0*a32-3.0*a30)*gxxy[i] + (3.0*a30-a32)*gyyy[i] + (17.0*a52-12.0*a54)*gxxxxy[i] + (34.0*a54-30.0*a52)*gxxyyy[i] + (3.0*a52-4.0*a54)*gyyyyy[i];
+            E = -a10*gx[i] + (2.0*a32-3.0*a30)*gxxx[i] + (6.0*a30-7.0*a32)*gxyy[i] + 2.0*a52*gxxxxx[i] + (12.0*a54-17.0*a52)*gxxxyy[i] + (6.0*a52-13.0*a54)*gxyyyy[i];
+            F = a10*gy[i] + (3.0*a30-2.0*a32)*gxxy[i] + a32*gyyy[i] + (3.0*a52-4.0*a54)*gxxyyy[i] - 2.0*a52*gxxxxy[i]+ a54*gyyyyy[i];
         
-        double* roots;
-        double* z;
+            A = approxZero(A);
+            B = approxZero(B);
+            C = approxZero(C);
+            D = approxZero(D);
+            E = approxZero(E);
+            F = approxZero(F);
         
-        if (A == 0.0) { // quartic
-            if (B == 0.0) { // cubic
-                if (C == 0.0) { // quadratic
-                    if (D == 0.0) { // linear
-                        if (E == 0.0) { // null
-                            deg = 1;
-                            z = new double[2*deg];
-                            z[0] = 0.0;
-                            z[1] = 0.0;
-                        } else {
-                            deg = 1;
-                            double a[2] = {E, D};
-                            z = new double[2*deg];
-                            gsl_poly_complex_workspace* w = gsl_poly_complex_workspace_alloc(deg+1);
-                            gsl_poly_complex_solve(a, deg+1, w, z);
-                            gsl_poly_complex_workspace_free(w);
+            a[0] = F; a[1] = E; a[2] = D; a[3] = C; a[4] = B; a[5] = A;
+            if (A == 0.0) { // quartic
+                if (B == 0.0) { // cubic
+                    if (C == 0.0) { // quadratic
+                        if (D == 0.0) { // linear
+                            if (E == 0.0) { // null
+                                nr = 1;
+                                roots[0] = 0.0;
+                            } else {
+                                nr = solveRoots(a, 1, roots);
+                            }
+                        } else { // solve quadratic
+                            nr = solveRoots(a, 2, roots);
                         }
-                    } else { // solve quadratic
-                        deg = 2;
-                        double a[3] = {E, D, C};
-                        z = new double[2*deg];
-                        gsl_poly_complex_workspace* w = gsl_poly_complex_workspace_alloc(deg+1);
-                        gsl_poly_complex_solve(a, deg+1, w, z);
-                        gsl_poly_complex_workspace_free(w);
-                    }
-                } else { // solve cubic
-                    if ( (D == 0.0) && (F == 0.0) ) {
-                        delta = -E/C;
-                        if (delta > 0.0) {
-                            deg = 3;
-                            delta = sqrt(delta);
-                            z = new double[2*deg];
-                            z[0] = 0.0;
-                            z[1] = 0.0;
-                            z[2] = delta;
-                            z[3] = 0.0;
-                            z[4] = -delta;
-                            z[5] = 0.0;
+                    } else { // solve cubic
+                        if ( (D == 0.0) && (F == 0.0) ) {
+                            delta = -E/C;
+                            if (delta > 0.0) {
+                                nr = 3;
+                                delta = sqrt(delta);
+                                roots[0] = 0.0;
+                                roots[1] = delta;
+                                roots[2] = -delta;
+                            } else {
+                                nr = 1;
+                                roots[0] = 0.0;
+                            }
                         } else {
-                            deg = 1;
-                            z = new double[2*deg];
-                            z[0] = 0.0;
-                            z[1] = 0.0;
+                            nr = solveRoots(a, 3, roots);
                         }
-                    } else {
-                        deg = 3;
-                        double a[4] = {F, E, D, C};
-                        z = new double[2*deg];
-                        gsl_poly_complex_workspace* w = gsl_poly_complex_workspace_alloc(deg+1);
-                        gsl_poly_complex_solve(a, deg+1, w, z);
-                        gsl_poly_complex_workspace_free(w);
                     }
+                } else { // solve quartic
+                    nr = solveRoots(a, 4, roots);
                 }
-            } else { // solve quartic
-                deg = 4;
-                double a[5] = {F, E, D, C, B};
-                z = new double[2*deg];
-                gsl_poly_complex_workspace* w = gsl_poly_complex_workspace_alloc(deg+1);
-                gsl_poly_complex_solve(a, deg+1, w, z);
-                gsl_poly_complex_workspace_free(w);
+            } else {
+                nr = solveRoots(a, 5, roots);
             }
-        } else {
-            deg = 5;
-            double a[6] = {F, E, D, C, B, A};
-            z = new double[2*deg];
-            gsl_poly_complex_workspace* w = gsl_poly_complex_workspace_alloc(deg+1);
-            gsl_poly_complex_solve(a, deg+1, w, z);
-            gsl_poly_complex_workspace_free(w);
-        }
-
         
-        // # real roots
-        nr = 0;
-        for (int k=0;k<deg;++k) {
-            if (z[2*k+1]==0.0)
-                nr++;
-        }
-        roots = new double[nr];
-        nr = 0;
-        for (int k=0;k<deg;++k) {
-            if (z[2*k+1]==0.0) {
-                roots[nr++] = z[2*k];
-            }
-        }
-
-        
-        double* tRoots;
-        if (nr == 0) { //orientation[i] = 0.0;
-            nt = 4;
-            tRoots = new double[nt];
-            tRoots[0] = -PI/2.0;
-            tRoots[1] = 0.0;
-            tRoots[2] = PI/2.0;
-            tRoots[3] = PI;
-        } else {
-            nt = 2*nr;
-            tRoots = new double[nt];
-            for (int k=0;k<nr;k++) {
-                tRoots[k] = atan(roots[k]);
-                tRoots[k+nr] = opposite(tRoots[k]);
+            if (nr == 0) { //orientation[i] = 0.0;
+                nt = 4;
+                tRoots[0] = -PI/2.0;
+                tRoots[1] = 0.0;
+                tRoots[2] = PI/2.0;
+                tRoots[3] = PI;
+            } else {
+                nt = 2*nr;
+                for (int k=0;k<nr;k++) {
+                    tRoots[k] = atan(roots[k]);
+                    tRoots[k+nr] = opposite(tRoots[k]);
+                }
             }
-        }
-        delete[] roots;
               
-        response[i] = pointRespM5(i, tRoots[0], alpha, templates);
-        orientation[i] = tRoots[0];
+            response[i] = pointRespM5(i, tRoots[0], alpha, templates);
+            orientation[i] = tRoots[0];
        
-        double temp;
-        for (int k=1;k<nt;k++) {
-            temp = pointRespM5(i, tRoots[k], alpha, templates);
-            if (temp > response[i]) {
-                response[i] = temp;
-                orientation[i] = tRoots[k];
+            double temp;
+            for (int k=1;k<nt;k++) {
+                temp = pointRespM5(i, tRoots[k], alpha, templates);
+                if (temp > response[i]) {
+                    response[i] = temp;
+                    orientation[i] = tRoots[k];
+                }
             }
         }
-        delete[] z;
-        delete[] tRoots;
     }
 }
 
@@ -952,118 +911,57 @@ double interp(double* image, int nx, int ny, double x, double y) {
 
 void computeNMS(double* response, double* orientation, double* nms, int nx, int ny) {
     
-    double ux, uy, v1, v2;
-    
-    div_t divRes;
-    for (int i=0;i<nx*ny;++i) {
-        divRes = div(i, nx);
-        ux = cos(orientation[i]);
-        uy = sin(orientation[i]);        
-        v1 = interp(response, nx, ny, divRes.rem+ux, divRes.quot+uy);
-        v2 = interp(response, nx, ny, divRes.rem-ux, divRes.quot-uy);
-        if (v1 > response[i] || v2 > response[i]) {
-            nms[i] = 0.0;
-        } else {
-            nms[i] = response[i];
-        }        
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int y=0;y<ny;++y) {
+        double ux, uy, v1, v2;
+        for (int x=0;x<nx;++x) {
+            int i = x+y*nx;
+            ux = cos(orientation[i]);
+            uy = sin(orientation[i]);
+            v1 = interp(response, nx, ny, x+ux, y+uy);
+            v2 = interp(response, nx, ny, x-ux, y-uy);
+            if (v1 > response[i] || v2 > response[i]) {
+                nms[i] = 0.0;
+            } else {
+                nms[i] = response[i];
+            }
+        }
     }
 }
 
 
 
+// Transpose: out[j+i*n2] = in[i+j*n1], used to switch between Matlab's column-major and row-major order
+template<class TI, class TO>
+static void transpose(const TI* in, int n1, int n2, TO* out) {
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int j=0;j<n2;++j) {
+        for (int i=0;i<n1;++i) {
+            out[j+i*n2] = (TO)in[i+j*n1];
+        }
+    }
+}
 
 
 
-void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
-        
-    // check # inputs
-    if (nrhs < 3 || nrhs > 5)
-        mexErrMsgTxt("Required inputs arguments: image, filter order, sigma.\nOptional: # angles for rotations output; border condition (see help).");
-    if (nlhs > 4)
-        mexErrMsgTxt("Too many output arguments.");
-    
-    // check image
-    if (!mxIsDouble(prhs[0]) || mxGetNumberOfDimensions(prhs[0]) != 2)
-        mexErrMsgTxt("Input image must be a 2-D array.");
-    int nx = (int)mxGetN(prhs[0]); // cols
-    int ny = (int)mxGetM(prhs[0]);
-    int N = nx*ny;
-    double* input = mxGetPr(prhs[0]);    
-    // check for NaNs in input, as these will result in a crash
-    for (int i=0;i<N;++i) {
-        if (mxIsNaN(input[i])) {
-            mexErrMsgTxt("Input image contains NaNs.");
-            break;
-        }
-    }
 
-    // check order
-    if (!mxIsDouble(prhs[1]) || mxGetNumberOfElements(prhs[1]) != 1 || *mxGetPr(prhs[1])<1 || *mxGetPr(prhs[1])>5)
-        mexErrMsgTxt("The order 'M' must be an integer between 1 and 5.");
-    int M = (int) *mxGetPr(prhs[1]);
-    
-    // check sigma
-    if (!mxIsDouble(prhs[2]) || mxGetNumberOfElements(prhs[2]) != 1 || *mxGetPr(prhs[2]) <= 0.0)
-        mexErrMsgTxt("Sigma must be a strictly positive scalar value.");
-    double sigma = *mxGetPr(prhs[2]);
-    
-    // Set defaults for options
-    int borderCondition = 3;
-    int nt = 36;
-    
-    // check 1st option: angles or border condition
-    if (nrhs >= 4) {
-        for (int i=3;i<nrhs;++i) {
-            
-            if (mxIsDouble(prhs[i]) && *mxGetPr(prhs[i])>0) { // # angles
-                nt = (int) *mxGetPr(prhs[i]);
-            } else if (mxIsChar(prhs[i])) { // border condition
-                size_t nchar = mxGetNumberOfElements(prhs[i])+1;
-                char *ch = new char[nchar];
-                int f = mxGetString(prhs[i], ch,  nchar);
-                if (f!=0) {
-                    mexErrMsgTxt("Error parsing border condition.");
-                }
-                string str = ch;
-                delete ch;
-                int (*pf)(int) = tolower;
-                transform(str.begin(), str.end(), str.begin(), pf);
-                if (str.compare("mirror")==0) {
-                    borderCondition = 3;
-                } else if (str.compare("periodic")==0) {
-                    borderCondition = 2;
-                } else if (str.compare("replicate")==0) {
-                    borderCondition = 1;
-                } else if (str.compare("zeros")==0) {
-                    borderCondition = 0;
-                } else {
-                    mexErrMsgTxt("Unsupported border conditions.");
-                }
-            } else {
-                mexErrMsgTxt("Allowed options: # angles (must be ? 1) or border condition.");
-            }
-        }
-        
-    }
-    
-    
-    int L = 2*(int)(4.0*sigma)+1; // support of the Gaussian kernels
-    
-    if (L>nx || L>ny) {
-        mexPrintf("Sigma must be smaller than %.2f\n", (min(nx,ny)-1)/8.0);
-        mexErrMsgTxt("Sigma value results in filter support that is larger than image.");
-    }
+
+
+// Filtering of the ny x nx (column-major) image 'input'; the templates are computed in the precision of T
+template<class T, class TI>
+static void filterImage(int nlhs, mxArray *plhs[], const TI* input, const int nx, const int ny, const int M, const double sigma, const int borderCondition, const int nt) {
     
-    double* pixels = new double[N];
+    int N = nx*ny;
+    T* pixels = new T[N];
     
     // Process inputs
     
     // Switch matrix to row-major (Matlab uses column-major)
-    div_t divRes;
-    for (int i=0;i<N;++i) {
-        divRes = div(i, ny);
-        pixels[divRes.quot+divRes.rem*nx] = input[i];
-    }
+    transpose(input, ny, nx, pixels);
     
     
     // number of partial derivative templates
@@ -1071,9 +969,9 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
     
     
     // Allocate template memory
-    double** templates = new double*[nTemplates];
+    T** templates = new T*[nTemplates];
     for (int i=0;i<nTemplates;++i) {
-        templates[i] = new double[N];
+        templates[i] = new T[N];
     }
     double* response = new double[N];
     double* orientation = new double[N];
@@ -1107,33 +1005,21 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
     // Switch outputs back to column-major format
     
     if (nlhs > 0) {
-        for (int i=0;i<N;++i) {
-            divRes = div(i, nx);
-            pixels[divRes.quot+divRes.rem*ny] = response[i];
-        }
         plhs[0] = mxCreateDoubleMatrix(ny, nx, mxREAL);
-        memcpy(mxGetPr(plhs[0]), pixels, N*sizeof(double));
+        transpose(response, nx, ny, mxGetPr(plhs[0]));
     }
     
     if (nlhs > 1) { // return orientation map
-        for (int i=0;i<N;++i) {
-            divRes = div(i, nx);
-            pixels[divRes.quot+divRes.rem*ny] = orientation[i];
-        }
         plhs[1] = mxCreateDoubleMatrix(ny, nx, mxREAL);
-        memcpy(mxGetPr(plhs[1]), pixels, N*sizeof(double));
+        transpose(orientation, nx, ny, mxGetPr(plhs[1]));
     }
     
     if (nlhs > 2) { // Apply NMS
         double* nms = new double[N];
         computeNMS(response, orientation, nms, nx, ny);
-        for (int i=0;i<N;++i) {
-            divRes = div(i, nx);
-            pixels[divRes.quot+divRes.rem*ny] = nms[i];
-        }
-        delete[] nms;
         plhs[2] = mxCreateDoubleMatrix(ny, nx, mxREAL);
-        memcpy(mxGetPr(plhs[2]), pixels, N*sizeof(double));
+        transpose(nms, nx, ny, mxGetPr(plhs[2]));
+        delete[] nms;
     }
     
     if (nlhs > 3) { // return filterbank
@@ -1141,56 +1027,27 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
         plhs[3] = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
         double* p = mxGetPr(plhs[3]);
         
-        double dt;
-        
+        double (*pointResp)(int, double, double*, T**) = NULL;
+        double dt = 2.0*PI/nt;
         switch (M) {
-            case 1:
-                dt = 2.0*PI/nt;
-                for (int t=0;t<nt;++t) {
-                    for (int i=0;i<N;++i) {
-                        divRes = div(i, nx);
-                        p[t*N + divRes.quot+divRes.rem*ny] = pointRespM1(i, t*dt, alpha, templates);
-                    }
-                }
-                break;
-            case 2:
-                dt = PI/nt;
-                for (int t=0;t<nt;++t) {
-                    for (int i=0;i<N;++i) {
-                        divRes = div(i, nx);
-                        p[t*N + divRes.quot+divRes.rem*ny] = pointRespM2(i, t*dt, alpha, templates);
-                    }
-                }
-                break;
-            case 3:
-                dt = 2.0*PI/nt;
-                for (int t=0;t<nt;++t) {
-                    for (int i=0;i<N;++i) {
-                        divRes = div(i, nx);
-                        p[t*N + divRes.quot+divRes.rem*ny] = pointRespM3(i, t*dt, alpha, templates);
-                    }
-                }
-                break;
-            case 4:
-                dt = PI/nt;
-                for (int t=0;t<nt;++t) {
-                    for (int i=0;i<N;++i) {
-                        divRes = div(i, nx);
-                        p[t*N + divRes.quot+divRes.rem*ny] = pointRespM4(i, t*dt, alpha, templates);
-                    }
-                }
-                break;
-            case 5:
-                dt = 2.0*PI/nt;
-                for (int t=0;t<nt;++t) {
-                    for (int i=0;i<N;++i) {
-                        divRes = div(i, nx);
-                        p[t*N + divRes.quot+divRes.rem*ny] = pointRespM5(i, t*dt, alpha, templates);
-                    }
-                }
-                break;
+            case 1: pointResp = pointRespM1<T>; break;
+            case 2: pointResp = pointRespM2<T>; dt = PI/nt; break;
+            case 3: pointResp = pointRespM3<T>; break;
+            case 4: pointResp = pointRespM4<T>; dt = PI/nt; break;
+            case 5: pointResp = pointRespM5<T>; break;
         }
         
+        for (int t=0;t<nt;++t) {
+            double* pt = p + t*N;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+            for (int x=0;x<nx;++x) {
+                for (int y=0;y<ny;++y) {
+                    pt[y+x*ny] = pointResp(x+y*nx, t*dt, alpha, templates);
+                }
+            }
+        }
     }
     
     // Free memory
@@ -1205,6 +1062,103 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 }
 
 
+template<class T>
+static bool containsNaN(const T input[], const int N) {
+    for (int i=0;i<N;++i) {
+        if (input[i]!=input[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+        
+    // check # inputs
+    if (nrhs < 3 || nrhs > 5)
+        mexErrMsgTxt("Required inputs arguments: image, filter order, sigma.\nOptional: # angles for rotations output; border condition (see help).");
+    if (nlhs > 4)
+        mexErrMsgTxt("Too many output arguments.");
+    
+    // check image
+    if ((!mxIsDouble(prhs[0]) && !mxIsSingle(prhs[0]) && !mxIsUint16(prhs[0])) || mxGetNumberOfDimensions(prhs[0]) != 2)
+        mexErrMsgTxt("Input image must be a 2-D double, single, or uint16 array.");
+    int nx = (int)mxGetN(prhs[0]); // cols
+    int ny = (int)mxGetM(prhs[0]);
+    int N = nx*ny;
+    // check for NaNs in input, as these will result in a crash
+    if ((mxIsDouble(prhs[0]) && containsNaN((double*)mxGetData(prhs[0]), N)) ||
+        (mxIsSingle(prhs[0]) && containsNaN((float*)mxGetData(prhs[0]), N)))
+        mexErrMsgTxt("Input image contains NaNs.");
+
+    // check order
+    if (!mxIsDouble(prhs[1]) || mxGetNumberOfElements(prhs[1]) != 1 || *mxGetPr(prhs[1])<1 || *mxGetPr(prhs[1])>5)
+        mexErrMsgTxt("The order 'M' must be an integer between 1 and 5.");
+    int M = (int) *mxGetPr(prhs[1]);
+    
+    // check sigma
+    if (!mxIsDouble(prhs[2]) || mxGetNumberOfElements(prhs[2]) != 1 || *mxGetPr(prhs[2]) <= 0.0)
+        mexErrMsgTxt("Sigma must be a strictly positive scalar value.");
+    double sigma = *mxGetPr(prhs[2]);
+    
+    // Set defaults for options
+    int borderCondition = 3;
+    int nt = 36;
+    
+    // check 1st option: angles or border condition
+    if (nrhs >= 4) {
+        for (int i=3;i<nrhs;++i) {
+            
+            if (mxIsDouble(prhs[i]) && *mxGetPr(prhs[i])>0) { // # angles
+                nt = (int) *mxGetPr(prhs[i]);
+            } else if (mxIsChar(prhs[i])) { // border condition
+                size_t nchar = mxGetNumberOfElements(prhs[i])+1;
+                char *ch = new char[nchar];
+                int f = mxGetString(prhs[i], ch,  nchar);
+                if (f!=0) {
+                    mexErrMsgTxt("Error parsing border condition.");
+                }
+                string str = ch;
+                delete ch;
+                int (*pf)(int) = tolower;
+                transform(str.begin(), str.end(), str.begin(), pf);
+                if (str.compare("mirror")==0) {
+                    borderCondition = 3;
+                } else if (str.compare("periodic")==0) {
+                    borderCondition = 2;
+                } else if (str.compare("replicate")==0) {
+                    borderCondition = 1;
+                } else if (str.compare("zeros")==0) {
+                    borderCondition = 0;
+                } else {
+                    mexErrMsgTxt("Unsupported border conditions.");
+                }
+            } else {
+                mexErrMsgTxt("Allowed options: # angles (must be ? 1) or border condition.");
+            }
+        }
+        
+    }
+    
+    
+    int L = 2*(int)(4.0*sigma)+1; // support of the Gaussian kernels
+    
+    if (L>nx || L>ny) {
+        mexPrintf("Sigma must be smaller than %.2f\n", (min(nx,ny)-1)/8.0);
+        mexErrMsgTxt("Sigma value results in filter support that is larger than image.");
+    }
+    
+    if (mxIsDouble(prhs[0])) {
+        filterImage<double>(nlhs, plhs, (double*)mxGetData(prhs[0]), nx, ny, M, sigma, borderCondition, nt);
+    } else if (mxIsSingle(prhs[0])) {
+        filterImage<float>(nlhs, plhs, (float*)mxGetData(prhs[0]), nx, ny, M, sigma, borderCondition, nt);
+    } else {
+        filterImage<float>(nlhs, plhs, (unsigned short*)mxGetData(prhs[0]), nx, ny, M, sigma, borderCondition, nt);
+    }
+}
+
+
 // compiled with:
 // export DYLD_LIBRARY_PATH=/Applications/MATLAB_R2012b.app/bin/maci64 && g++ -Wall -g -DARRAY_ACCESS_INLINING -I. -L/Applications/MATLAB_R2012b.app/bin/maci64 -I../../mex/include/ -I/Applications/MATLAB_R2012b.app/extern/include steerableDetector.cpp -lmx -lmex -lgsl
 // tested with:
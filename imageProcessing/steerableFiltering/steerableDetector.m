@@ -1,7 +1,7 @@
 %[res, theta, nms, rotations] = steerableDetector(img, M, sigma) performs edge/ridge detection through a generalization of Canny's alorithm based on steerable filters
 %
 % Inputs: 
-%         img : input image
+%         img : input image (double, single, or uint16)
 %           M : order of the filter, between 1 and 5
 %             : Odd orders: edge detectors, M = 1 is equivalent to Canny's detector
 %             : Even orders: ridge detectors
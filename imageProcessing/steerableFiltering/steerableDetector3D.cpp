@@ -1,92 +1,184 @@
-/* [response orientation nms filterBank] = steerableDetector3D(image, filterOrder, sigma);
+/* [response orientation nms filterBank] = steerableDetector3D(image, filterOrder, sigma, zxRatio, slabSize, recursive);
  *
  * (c) Francois Aguet, 30/08/2012 (last modified 09/02/2012).
  *
+ * If 'slabSize' is specified, the templates are computed for slabs of 'slabSize' z-planes
+ * (plus the support of the z-kernels) and the orientation is stored in single precision.
+ * If 'recursive' is true, the Gaussian filters are computed recursively (recursiveGaussian.h),
+ * at a cost that does not depend on sigma.
+ *
  * Compilation:
- * Mac/Linux (dynamic): mex -I/usr/local/include -I../../mex/include -lgsl -lgslcblas steerableDetector3D.cpp
- * Mac/Linux (static): mex -I/usr/local/include -I../../mex/include /usr/local/lib/libgsl.a /usr/local/lib/libgslcblas.a steerableDetector3D.cpp
- * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT" -I"..\..\..\extern\mex\include\gsl-1.15" -I"..\..\mex\include" "..\..\..\extern\mex\lib\gsl.lib" "..\..\..\extern\mex\lib\cblas.lib" -output steerableDetector3D steerableDetector3D.cpp
+ * Mac/Linux: mex -I../../mex/include CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" steerableDetector3D.cpp
+ * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT /openmp" -I"..\..\mex\include" -output steerableDetector3D steerableDetector3D.cpp
  */
 
 
 #include <cstring>
-#include <gsl/gsl_poly.h>
-#include <gsl/gsl_math.h>
-#include <gsl/gsl_eigen.h>
 #include <algorithm>
 #include <vector>
 
 #include "mex.h"
 
-#include "convolver3D.h"
+#include "separableConvolution.h"
+#include "recursiveGaussian.h"
 
 using namespace std;
 
 #define PI 3.141592653589793
 
+// Eigen-decomposition of a symmetric 3x3 matrix by cyclic Jacobi rotations (Numerical Recipes, 11.1).
+// On return, the diagonal of 'A' contains the eigenvalues and the columns of 'V' the
+// corresponding eigenvectors. Converges to machine precision in a few sweeps.
+static void eigenSymm3(double A[3][3], double V[3][3]) {
+    
+    static const int P[3] = {0, 0, 1};
+    static const int Q[3] = {1, 2, 2};
+    
+    for (int i=0;i<3;++i) {
+        for (int j=0;j<3;++j) {
+            V[i][j] = i==j ? 1.0 : 0.0;
+        }
+    }
+    
+    double theta, t, c, s, g, arp, arq;
+    for (int sweep=0;sweep<50;++sweep) {
+        if (A[0][1]==0.0 && A[0][2]==0.0 && A[1][2]==0.0) {
+            break;
+        }
+        for (int k=0;k<3;++k) {
+            int p = P[k];
+            int q = Q[k];
+            int r = 3-p-q;
+            g = 100.0*fabs(A[p][q]);
+            // after 4 sweeps, skip the rotation if the off-diagonal element is negligible
+            if (sweep > 3 && fabs(A[p][p])+g == fabs(A[p][p]) && fabs(A[q][q])+g == fabs(A[q][q])) {
+                A[p][q] = A[q][p] = 0.0;
+                continue;
+            }
+            if (A[p][q]==0.0) {
+                continue;
+            }
+            theta = (A[q][q]-A[p][p]) / (2.0*A[p][q]);
+            if (fabs(theta)+g == fabs(theta)) { // theta^2 would overflow
+                t = 0.5/theta;
+            } else {
+                t = 1.0/(fabs(theta)+sqrt(theta*theta+1.0));
+                if (theta < 0.0) {
+                    t = -t;
+                }
+            }
+            c = 1.0/sqrt(t*t+1.0);
+            s = t*c;
+            
+            A[p][p] -= t*A[p][q];
+            A[q][q] += t*A[p][q];
+            A[p][q] = A[q][p] = 0.0;
+            arp = A[r][p];
+            arq = A[r][q];
+            A[r][p] = A[p][r] = c*arp - s*arq;
+            A[r][q] = A[q][r] = s*arp + c*arq;
+            for (int i=0;i<3;++i) {
+                arp = V[i][p];
+                arq = V[i][q];
+                V[i][p] = c*arp - s*arq;
+                V[i][q] = s*arp + c*arq;
+            }
+        }
+    }
+}
+
+
+
+// Switch between Matlab's column-major and row-major frames: out[x+y*nx+z*nx*ny] = in[y+x*ny+z*nx*ny]
+template<class T1, class T2>
+static void toRowMajor(const T1 in[], const int nx, const int ny, const int nz, T2 out[]) {
+    int nxy = nx*ny;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int z=0;z<nz;++z) {
+        for (int y=0;y<ny;++y) {
+            for (int x=0;x<nx;++x) {
+                out[x+y*nx+z*nxy] = in[y+x*ny+z*nxy];
+            }
+        }
+    }
+}
+
+template<class T1, class T2>
+static void toColumnMajor(const T1 in[], const int nx, const int ny, const int nz, T2 out[]) {
+    int nxy = nx*ny;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int z=0;z<nz;++z) {
+        for (int x=0;x<nx;++x) {
+            for (int y=0;y<ny;++y) {
+                out[y+x*ny+z*nxy] = in[x+y*nx+z*nxy];
+            }
+        }
+    }
+}
+
+
+
+// T: storage type of the orientation
+template<class T>
 class Filter {
     
 public:
-    Filter(const double voxels[], const int nx, const int ny, const int nz, const int M, const double sigma);
-    Filter(const double voxels[], const int nx, const int ny, const int nz, const int M, const double sigma, const double zxRatio);
+    template<class TI>
+    Filter(const TI input[], const int nx, const int ny, const int nz, const int M, const double sigma, const double zxRatio, const int slabSize, const bool recursive);
     ~Filter();
-    void init();
     
     double* getResponse();
-    double** getOrientation();
+    T* getOrientation(const int k);
     double* getNMS();
     
 private:
-    const double* voxels_;
     double* response_;
-    double** orientation_;
+    T* orientation_; // components x, y, z of size N_ each
     double* nms_;
     int nx_, ny_, nz_;
     int M_;
     double sigma_, sigmaZ_;
+    bool recursive_;
     int N_;
     double alpha_, sign_, c_;
     
+    // templates of the current slab
+    int nzs_, Ns_;
     double *gxx_, *gxy_, *gxz_, *gyy_, *gyz_, *gzz_;
     
-    void calculateTemplates();
+    void gaussian(const double input[], const int dim, const int order, double output[]);
+    void calculateTemplates(const double voxels[]);
+    void freeTemplates();
     double interpResponse(const double x, const double y, const double z);
     static int mirror(const int x, const int nx);
-    void normalize(double v[], const int k);
-    void cross(const double v1[], const double v2[], double r[]);
+    static void normalize(double v[], const int k);
+    static void cross(const double v1[], const double v2[], double r[]);
     
     void computeCurveNMS();
     void computeSurfaceNMS();
-    void run();
+    void run(const int z0, const int z1, const int zs);
     
-    void calculateTemplates0();
-    void run0();
+    void calculateTemplates0(const double voxels[]);
+    void run0(const int z0, const int z1, const int zs);
 };
 
-Filter::Filter(const double voxels[], const int nx, const int ny, const int nz, const int M, const double sigma) {
-    voxels_ = voxels;
-    nx_ = nx;
-    ny_ = ny;
-    nz_ = nz;
-    M_ = M;
-    sigma_ = sigma;
-    sigmaZ_ = sigma;
-    init();
-}
 
-Filter::Filter(const double voxels[], const int nx, const int ny, const int nz, const int M, const double sigma, const double zxRatio) {
-    voxels_ = voxels;
+// 'input' is in Matlab's column-major format
+template<class T>
+template<class TI>
+Filter<T>::Filter(const TI input[], const int nx, const int ny, const int nz, const int M, const double sigma, const double zxRatio, const int slabSize, const bool recursive) {
     nx_ = nx;
     ny_ = ny;
     nz_ = nz;
     M_ = M;
     sigma_ = sigma;
     sigmaZ_ = sigma/zxRatio;
-    init();
-}
-
-
-void Filter::init() {
+    recursive_ = recursive;
+    
     if (M_==1) {
         alpha_ = 2.0/3.0;
         sign_ = -1.0;
@@ -99,242 +191,240 @@ void Filter::init() {
     
     N_ = nx_*ny_*nz_;
     response_ = new double[N_];
-    orientation_ = new double*[N_];
-    for (int i=0;i<N_;++i) {
-        orientation_[i] = new double[3];
-    }
-    
-    gxx_ = new double[N_];
-    gyy_ = new double[N_];
-    gzz_ = new double[N_];
-    if (M_<3) {
-        gxy_ = new double[N_];
-        gxz_ = new double[N_];
-        gyz_ = new double[N_];
-        calculateTemplates();
-        run();
-    } else {
-        calculateTemplates0();
-        run0();
+    orientation_ = new T[3*N_];
+    nms_ = NULL;
+    gxx_ = gxy_ = gxz_ = gyy_ = gyz_ = gzz_ = NULL;
+    
+    // Process the volume in slabs of 'slabSize' planes, extended by the support of
+    // the z-kernels (the responses within the slab are then identical). The recursive filters
+    // have infinite support; their halo is truncated at 6*sigmaZ.
+    int nxy = nx_*ny_;
+    int h = (int)((recursive_ ? 6.0 : 3.0)*sigmaZ_);
+    int ns = (slabSize > 0 && slabSize < nz_) ? slabSize : nz_;
+    for (int z0=0;z0<nz_;z0+=ns) {
+        int z1 = min(z0+ns, nz_);
+        int zs = max(0, z0-h);
+        int ze = min(nz_, z1+h);
+        if (ze-zs < 2*h+1) { // minimum support of the z-convolutions
+            if (zs==0) {
+                ze = min(nz_, 2*h+1);
+            } else {
+                zs = max(0, ze-2*h-1);
+            }
+        }
+        nzs_ = ze-zs;
+        Ns_ = nxy*nzs_;
+        
+        double* voxels = new double[Ns_];
+        toRowMajor(input+zs*nxy, nx_, ny_, nzs_, voxels);
+        if (M_<3) {
+            calculateTemplates(voxels);
+            delete[] voxels;
+            run(z0, z1, zs);
+        } else {
+            calculateTemplates0(voxels);
+            delete[] voxels;
+            run0(z0, z1, zs);
+        }
+        freeTemplates();
     }
-    
-    nms_ = new double[N_];
-    memset(nms_, 0, N_*sizeof(double));
-    if (M_==1) {
-        computeCurveNMS();
-    } else if (M_==2) {
-        computeSurfaceNMS();
-    } else if (M_==3) {
-        computeSurfaceNMS();
-    }      
 }
 
 
-Filter::~Filter() {
+template<class T>
+Filter<T>::~Filter() {
     delete[] response_;
+    delete[] orientation_;
+    delete[] nms_;
+    freeTemplates();
+}
+
+
+template<class T>
+void Filter<T>::freeTemplates() {
     delete[] gxx_;
-    delete[] gzz_;
+    delete[] gxy_;
+    delete[] gxz_;
     delete[] gyy_;
-    if (M_<3) {
-        delete[] gxy_;
-        delete[] gxz_;
-        delete[] gyz_;
-    }
-    delete[] nms_;
-    for (int i=0;i<N_;++i) {
-        delete[] orientation_[i];
-    }
-    delete[] orientation_;
+    delete[] gyz_;
+    delete[] gzz_;
+    gxx_ = gxy_ = gxz_ = gyy_ = gyz_ = gzz_ = NULL;
 }
 
 
-void Filter::calculateTemplates0() {
+// Filters the current slab along dimension 'dim' with the 'order'-th derivative of a Gaussian.
+// The normalization by sqrt(2*PI)*sigma is omitted to keep the magnitude of the response
+// similar to the input; with recursive filters, the gain compensates for their normalization.
+template<class T>
+void Filter<T>::gaussian(const double input[], const int dim, const int order, double output[]) {
     
-    double *buffer = new double[N_];
+    double sigma = dim==2 ? sigmaZ_ : sigma_;
+    if (recursive_) {
+        sepconv::RecursiveGaussian f(sigma, order, true, sqrt(2.0*PI)*sigma);
+        sepconv::filterRecursive(input, nx_, ny_, nzs_, dim, f, sepconv::MIRROR, output);
+        return;
+    }
     
-    int wWidth = (int)(3.0*sigma_);
+    int wWidth = (int)(3.0*sigma);
     int kLength = wWidth+1;
-    double sigma2 = sigma_*sigma_;
-    
-    int wWidthZ = (int)(3.0*sigmaZ_);
-    int kLengthZ = wWidthZ+1;
-    double sigmaZ2 = sigmaZ_*sigmaZ_;
-    
-    // Compute Gaussian kernels
-    double *kernelG = new double[kLength];
-    double *kernelGx = new double[kLength];
-    
-    double *kernelG_z = new double[kLengthZ];
-    double *kernelGx_z = new double[kLengthZ];
-    
+    double sigma2 = sigma*sigma;
+    double *kernel = new double[kLength];
     double g;
     for (int i=0;i<=wWidth;++i) {
-        g = exp(-(i*i)/(2.0*sigma2)); // normalization by sqrt(2*PI)*sigma_ omitted
-        kernelG[i] = g;               // to keep magnitude of response similar to input
-        kernelGx[i] = -i/sigma2 * g;
+        g = exp(-(i*i)/(2.0*sigma2));
+        if (order==0) {
+            kernel[i] = g;
+        } else if (order==1) {
+            kernel[i] = -i/sigma2 * g;
+        } else {
+            kernel[i] = (i*i-sigma2)/(sigma2*sigma2) * g;
+        }
     }
+    sepconv::convolve(input, nx_, ny_, nzs_, dim, kernel, kLength, order==1, sepconv::MIRROR, output);
+    delete[] kernel;
+}
+
+
+template<class T>
+void Filter<T>::calculateTemplates0(const double voxels[]) {
     
-    for (int i=0;i<=wWidthZ;++i) {
-        g = exp(-(i*i)/(2.0*sigmaZ2));
-        kernelG_z[i] = g;
-        kernelGx_z[i] = -i/sigmaZ2 * g;
-    }
+    gxx_ = new double[Ns_];
+    gyy_ = new double[Ns_];
+    gzz_ = new double[Ns_];
+    double *buffer = new double[Ns_];
     
     // Convolutions
-    convolveOddX(voxels_, kernelGx, kLength, nx_, ny_, nz_, gxx_);
-    convolveEvenX(voxels_, kernelG, kLength, nx_, ny_, nz_, gyy_);
-    memcpy(gzz_, gyy_, N_*sizeof(double));
+    gaussian(voxels, 0, 1, gxx_);
+    gaussian(voxels, 0, 0, gyy_);
+    memcpy(gzz_, gyy_, Ns_*sizeof(double));
     
-    convolveEvenY(gxx_, kernelG, kLength, nx_, ny_, nz_, buffer);
-    convolveEvenZ(buffer, kernelG_z, kLengthZ, nx_, ny_, nz_, gxx_);
+    gaussian(gxx_, 1, 0, buffer);
+    gaussian(buffer, 2, 0, gxx_);
     
-    convolveOddY(gyy_, kernelGx, kLength, nx_, ny_, nz_, buffer);
-    convolveEvenZ(buffer, kernelG_z, kLengthZ, nx_, ny_, nz_, gyy_);
+    gaussian(gyy_, 1, 1, buffer);
+    gaussian(buffer, 2, 0, gyy_);
     
-    convolveEvenY(gzz_, kernelG, kLength, nx_, ny_, nz_, buffer);
-    convolveOddZ(buffer, kernelGx_z, kLengthZ, nx_, ny_, nz_, gzz_);
+    gaussian(gzz_, 1, 0, buffer);
+    gaussian(buffer, 2, 1, gzz_);
     
-    delete[] kernelG;
-    delete[] kernelGx;
-    delete[] kernelG_z;
-    delete[] kernelGx_z;
     delete[] buffer;
 }
 
 
-void Filter::calculateTemplates() {
-    
-    double *buffer = new double[N_];
-    
-    int wWidth = (int)(3.0*sigma_);
-    int kLength = wWidth+1;
-    double sigma2 = sigma_*sigma_;
-    double sigma4 = sigma2*sigma2;
-    
-    int wWidthZ = (int)(3.0*sigmaZ_);
-    int kLengthZ = wWidthZ+1;
-    double sigmaZ2 = sigmaZ_*sigmaZ_;
-    double sigmaZ4= sigmaZ2*sigmaZ2;
-    
-    // Compute Gaussian kernels
-    double *kernelG = new double[kLength];
-    double *kernelGx = new double[kLength];
-    double *kernelGxx = new double[kLength];
+template<class T>
+void Filter<T>::calculateTemplates(const double voxels[]) {
     
-    double *kernelG_z = new double[kLengthZ];
-    double *kernelGx_z = new double[kLengthZ];
-    double *kernelGxx_z = new double[kLengthZ];
-    
-    double g;
-    for (int i=0;i<=wWidth;++i) {
-        g = exp(-(i*i)/(2.0*sigma2)); // normalization by sqrt(2*PI)*sigma_ omitted
-        kernelG[i] = g;               // to keep magnitude of response similar to input
-        kernelGx[i] = -i/sigma2 * g;
-        kernelGxx[i] = (i*i-sigma2)/sigma4 * g;
-    }
-    
-    for (int i=0;i<=wWidthZ;++i) {
-        g = exp(-(i*i)/(2.0*sigmaZ2));
-        kernelG_z[i] = g;
-        kernelGx_z[i] = -i/sigmaZ2 * g;
-        kernelGxx_z[i] = (i*i-sigmaZ2)/sigmaZ4 * g;
-    }
+    gxx_ = new double[Ns_];
+    gxy_ = new double[Ns_];
+    gxz_ = new double[Ns_];
+    gyy_ = new double[Ns_];
+    gyz_ = new double[Ns_];
+    gzz_ = new double[Ns_];
+    double *buffer = new double[Ns_];
     
     // Convolve all along x
-    convolveEvenX(voxels_, kernelG, kLength, nx_, ny_, nz_, gyy_);
-    memcpy(gyz_, gyy_, N_*sizeof(double));
-    memcpy(gzz_, gyy_, N_*sizeof(double));
-    convolveOddX(voxels_, kernelGx, kLength, nx_, ny_, nz_, gxy_);
-    memcpy(gxz_, gxy_, N_*sizeof(double));
-    convolveEvenX(voxels_, kernelGxx, kLength, nx_, ny_, nz_, gxx_);
+    gaussian(voxels, 0, 0, gyy_);
+    memcpy(gyz_, gyy_, Ns_*sizeof(double));
+    memcpy(gzz_, gyy_, Ns_*sizeof(double));
+    gaussian(voxels, 0, 1, gxy_);
+    memcpy(gxz_, gxy_, Ns_*sizeof(double));
+    gaussian(voxels, 0, 2, gxx_);
     // gxx
-    convolveEvenY(gxx_, kernelG, kLength, nx_, ny_, nz_, buffer);
-    convolveEvenZ(buffer, kernelG_z, kLengthZ, nx_, ny_, nz_, gxx_);
+    gaussian(gxx_, 1, 0, buffer);
+    gaussian(buffer, 2, 0, gxx_);
     // gxy
-    convolveOddY(gxy_, kernelGx, kLength, nx_, ny_, nz_, buffer);
-    convolveEvenZ(buffer, kernelG_z, kLengthZ, nx_, ny_, nz_, gxy_);
+    gaussian(gxy_, 1, 1, buffer);
+    gaussian(buffer, 2, 0, gxy_);
     // gxz
-    convolveEvenY(gxz_, kernelG, kLength, nx_, ny_, nz_, buffer);
-    convolveOddZ(buffer, kernelGx_z, kLengthZ, nx_, ny_, nz_, gxz_);
+    gaussian(gxz_, 1, 0, buffer);
+    gaussian(buffer, 2, 1, gxz_);
     // gyy
-    convolveEvenY(gyy_, kernelGxx, kLength, nx_, ny_, nz_, buffer);
-    convolveEvenZ(buffer, kernelG_z, kLengthZ, nx_, ny_, nz_, gyy_);
+    gaussian(gyy_, 1, 2, buffer);
+    gaussian(buffer, 2, 0, gyy_);
     // gyz
-    convolveOddY(gyz_, kernelGx, kLength, nx_, ny_, nz_, buffer);
-    convolveOddZ(buffer, kernelGx_z, kLengthZ, nx_, ny_, nz_, gyz_);
+    gaussian(gyz_, 1, 1, buffer);
+    gaussian(buffer, 2, 1, gyz_);
     // gzz
-    convolveEvenY(gzz_, kernelG, kLength, nx_, ny_, nz_, buffer);
-    convolveEvenZ(buffer, kernelGxx_z, kLengthZ, nx_, ny_, nz_, gzz_);
-    
-    delete[] kernelG;
-    delete[] kernelGx;
-    delete[] kernelGxx;
-    delete[] kernelG_z;
-    delete[] kernelGx_z;
-    delete[] kernelGxx_z;
+    gaussian(gzz_, 1, 0, buffer);
+    gaussian(buffer, 2, 2, gzz_);
+    
     delete[] buffer;
 }
 
 
-void Filter::run() {
+// Computes the response for planes z0..z1-1; the templates start at plane zs
+template<class T>
+void Filter<T>::run(const int z0, const int z1, const int zs) {
     
-    double a, b, c, d, e, f;
+    int nxy = nx_*ny_;
+    int offset = zs*nxy;
+    T* ox = orientation_;
+    T* oy = orientation_ + N_;
+    T* oz = orientation_ + 2*N_;
     
-    for (int i=0;i<N_;++i) {
-        
-        a = sign_*(gyy_[i] + gzz_[i] - alpha_*gxx_[i]);
-        b = sign_*(gxx_[i] + gzz_[i] - alpha_*gyy_[i]);
-        c = sign_*(gxx_[i] + gyy_[i] - alpha_*gzz_[i]);
-        d = -sign_*(1.0+alpha_)*gxy_[i];
-        e = -sign_*(1.0+alpha_)*gxz_[i];
-        f = -sign_*(1.0+alpha_)*gyz_[i];
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int i=z0*nxy;i<z1*nxy;++i) {
         
-        double A[] = {a,d,e,
-                      d,b,f,
-                      e,f,c};
+        int j = i-offset;
+        double a = sign_*(gyy_[j] + gzz_[j] - alpha_*gxx_[j]);
+        double b = sign_*(gxx_[j] + gzz_[j] - alpha_*gyy_[j]);
+        double c = sign_*(gxx_[j] + gyy_[j] - alpha_*gzz_[j]);
+        double d = -sign_*(1.0+alpha_)*gxy_[j];
+        double e = -sign_*(1.0+alpha_)*gxz_[j];
+        double f = -sign_*(1.0+alpha_)*gyz_[j];
         
-        gsl_matrix_view m = gsl_matrix_view_array(A, 3, 3);
+        double A[3][3] = {{a,d,e},
+                          {d,b,f},
+                          {e,f,c}};
+        double V[3][3];
+        eigenSymm3(A, V);
         
-        gsl_vector *eval = gsl_vector_alloc(3);
-        gsl_matrix *evec = gsl_matrix_alloc(3,3);
+        // largest eigenvalue (last one in case of ties)
+        int k = 2;
+        if (A[1][1] > A[k][k]) k = 1;
+        if (A[0][0] > A[k][k]) k = 0;
         
-        gsl_eigen_symmv_workspace *w = gsl_eigen_symmv_alloc(3);
-        gsl_eigen_symmv (&m.matrix, eval, evec, w);
-        gsl_eigen_symmv_free(w);
-        gsl_eigen_symmv_sort(eval, evec, GSL_EIGEN_SORT_VAL_ASC); // largest eigenvalue
-        
-        response_[i] = gsl_vector_get(eval, 2) / c_;
-        orientation_[i][0] = gsl_matrix_get(evec, 0, 2);
-        orientation_[i][1] = gsl_matrix_get(evec, 1, 2);
-        orientation_[i][2] = gsl_matrix_get(evec, 2, 2);
-        
-        gsl_matrix_free(evec);
-        gsl_vector_free(eval);
+        response_[i] = A[k][k] / c_;
+        ox[i] = (T)V[0][k];
+        oy[i] = (T)V[1][k];
+        oz[i] = (T)V[2][k];
     }
 }
 
 // Solution for 1st order filter (detects interfaces); analogous to 2D edge detector
-void Filter::run0() {
-    
-    double res;
-    
-    for (int i=0;i<N_;++i) {
-        res = sqrt(gxx_[i]*gxx_[i] + gyy_[i]*gyy_[i] + gzz_[i]*gzz_[i]);
+template<class T>
+void Filter<T>::run0(const int z0, const int z1, const int zs) {
+    
+    int nxy = nx_*ny_;
+    int offset = zs*nxy;
+    T* ox = orientation_;
+    T* oy = orientation_ + N_;
+    T* oz = orientation_ + 2*N_;
+    
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int i=z0*nxy;i<z1*nxy;++i) {
+        int j = i-offset;
+        double res = sqrt(gxx_[j]*gxx_[j] + gyy_[j]*gyy_[j] + gzz_[j]*gzz_[j]);
         response_[i] = res;
         if (res!=0.0) {
-            orientation_[i][0] = gxx_[i]/res;
-            orientation_[i][1] = gyy_[i]/res;
-            orientation_[i][2] = gzz_[i]/res;
+            ox[i] = (T)(gxx_[j]/res);
+            oy[i] = (T)(gyy_[j]/res);
+            oz[i] = (T)(gzz_[j]/res);
         } else {
-            orientation_[i][0] = 1.0;
-            orientation_[i][1] = 0.0;
-            orientation_[i][2] = 0.0;
+            ox[i] = 1.0;
+            oy[i] = 0.0;
+            oz[i] = 0.0;
         }
     }
 }
 
 
-void Filter::normalize(double v[], const int k) {
+template<class T>
+void Filter<T>::normalize(double v[], const int k) {
     double n = 0.0;
     for (int i=0;i<k;++i) {
         n += v[i]*v[i];
@@ -346,24 +436,39 @@ void Filter::normalize(double v[], const int k) {
 }
 
 
-double* Filter::getResponse() {
+template<class T>
+double* Filter<T>::getResponse() {
     return response_;
 }
 
 
-double* Filter::getNMS() {
+// The NMS is only computed when requested
+template<class T>
+double* Filter<T>::getNMS() {
+    if (nms_==NULL) {
+        nms_ = new double[N_];
+        memset(nms_, 0, N_*sizeof(double));
+        if (M_==1) {
+            computeCurveNMS();
+        } else {
+            computeSurfaceNMS();
+        }
+    }
     return nms_;
 }
 
 
-double** Filter::getOrientation() {
-    return orientation_;
+// Component 'k' (0: x, 1: y, 2: z) of the orientation
+template<class T>
+T* Filter<T>::getOrientation(const int k) {
+    return orientation_ + k*N_;
 }
 
 
 
 // Mirror position for interpolation border conditions
-int Filter::mirror(const int x, const int nx) {
+template<class T>
+int Filter<T>::mirror(const int x, const int nx) {
     if (x >= 0 && x < nx) {
         return x;
     } else if (x < 0) {
@@ -374,7 +479,8 @@ int Filter::mirror(const int x, const int nx) {
 }
 
 
-double Filter::interpResponse(const double x, const double y, const double z) {
+template<class T>
+double Filter<T>::interpResponse(const double x, const double y, const double z) {
     int xi = (int)x;
     int yi = (int)y;
     int zi = (int)z;
@@ -397,16 +503,22 @@ double Filter::interpResponse(const double x, const double y, const double z) {
 }
 
 
-// Orientation is stored as a Nx3 (N = nx*ny*nz) array
-void Filter::computeSurfaceNMS() {
-    double A1, A2;
-    int i = 0;
+template<class T>
+void Filter<T>::computeSurfaceNMS() {
+    const T* ox = orientation_;
+    const T* oy = orientation_ + N_;
+    const T* oz = orientation_ + 2*N_;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
     for (int z=0;z<nz_;++z) {
+        double A1, A2;
+        int i = z*nx_*ny_;
         for (int y=0;y<ny_;++y) {
             for (int x=0;x<nx_;++x) {
-                if (!(orientation_[i][0]==0.0 && orientation_[i][1]==0.0 && orientation_[i][2]==0.0)) {
-                    A1 = interpResponse(x+orientation_[i][0], y+orientation_[i][1], z+orientation_[i][2]);
-                    A2 = interpResponse(x-orientation_[i][0], y-orientation_[i][1], z-orientation_[i][2]);
+                if (!(ox[i]==0.0 && oy[i]==0.0 && oz[i]==0.0)) {
+                    A1 = interpResponse(x+ox[i], y+oy[i], z+oz[i]);
+                    A2 = interpResponse(x-ox[i], y-oy[i], z-oz[i]);
                     if (response_[i] > A1 && response_[i] > A2) {
                         nms_[i] = response_[i];
                     }
@@ -419,41 +531,49 @@ void Filter::computeSurfaceNMS() {
 
 
 // Interpolate X points uniformly distributed on unit circle perpendicular to orientation
-void Filter::computeCurveNMS() {
-    double u[3];
-    double v[3];
+template<class T>
+void Filter<T>::computeCurveNMS() {
     double iv[3] = {1.0, 0.0, 0.0};
     double jv[3] = {0.0, 1.0, 0.0};
     
-    int nt = 10;
-    double theta[10];
+    const int nt = 10;
+    double cosT[nt], sinT[nt];
     double dt = 2.0*PI/nt;
     for (int t=0;t<nt;++t) {
-        theta[t] = t*dt;
+        cosT[t] = cos(t*dt);
+        sinT[t] = sin(t*dt);
     }
     
-    int i = 0;
-    double cosT, sinT, ival;
+    const T* ox = orientation_;
+    const T* oy = orientation_ + N_;
+    const T* oz = orientation_ + 2*N_;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
     for (int z=0;z<nz_;++z) {
+        double n[3], u[3], v[3];
+        double ival = 0.0;
+        int i = z*nx_*ny_;
         for (int y=0;y<ny_;++y) {
             for (int x=0;x<nx_;++x) {
-                if (!(orientation_[i][0]==0.0 && orientation_[i][1]==0.0 && orientation_[i][2]==0.0)) {
+                n[0] = ox[i];
+                n[1] = oy[i];
+                n[2] = oz[i];
+                if (!(n[0]==0.0 && n[1]==0.0 && n[2]==0.0)) {
                     
                     // vector perpendicular to 'n'
-                    if (orientation_[i][0]!=1.0) { // use 'i'
-                        cross(iv, orientation_[i], u);
+                    if (n[0]!=1.0) { // use 'i'
+                        cross(iv, n, u);
                     } else { // use 'j'
-                        cross(jv, orientation_[i], u);
+                        cross(jv, n, u);
                     }
                     normalize(u, 3);
-                    cross(orientation_[i], u, v);
+                    cross(n, u, v);
                     // u and v are orthogonal to the orientation vectors
                     
                     // interpolate at values given by (1, theta)
                     for (int t=0;t<nt;++t) {
-                        cosT = cos(theta[t]);
-                        sinT = sin(theta[t]);
-                        ival = interpResponse(x+cosT*u[0]+sinT*v[0], y+cosT*u[1]+sinT*v[1], z+cosT*u[2]+sinT*v[2]);
+                        ival = interpResponse(x+cosT[t]*u[0]+sinT[t]*v[0], y+cosT[t]*u[1]+sinT[t]*v[1], z+cosT[t]*u[2]+sinT[t]*v[2]);
                         if (ival >= response_[i]) {
                             break;
                         }
@@ -469,39 +589,91 @@ void Filter::computeCurveNMS() {
 }
 
 
-void Filter::cross(const double v1[], const double v2[], double r[]) {
+template<class T>
+void Filter<T>::cross(const double v1[], const double v2[], double r[]) {
     r[0] = v1[1]*v2[2]-v1[2]*v2[1];
     r[1] = v1[2]*v2[0]-v1[0]*v2[2];
     r[2] = v1[0]*v2[1]-v1[1]*v2[0];
 }
 
 
+template<class T, class TI>
+static void filterVolume(int nlhs, mxArray *plhs[], const TI input[], const mwSize dims[], const int M, const double sigma, const double zfactor, const int slabSize, const bool recursive) {
+    
+    int ny = (int)dims[0]; // reversed: (m,n) -> (y,x)
+    int nx = (int)dims[1];
+    int nz = (int)dims[2];
+    
+    Filter<T> filter(input, nx, ny, nz, M, sigma, zfactor, slabSize, recursive);
+    
+    // Switch outputs back to column-major format
+    if (nlhs > 0) {
+        plhs[0] = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+        toColumnMajor(filter.getResponse(), nx, ny, nz, mxGetPr(plhs[0]));
+    }
+    
+    if (nlhs > 1) { // return orientation map: structure theta, fields .x1, .x2, .x3
+        const char *fieldnames[] = {"x1", "x2", "x3"};
+        mwSize sdims[2] = {1, 1};
+        plhs[1] = mxCreateStructArray(2, sdims, 3, fieldnames);
+        // copy each coordinate to its field
+        for (int k=0;k<3;++k) {
+            mxArray *xk = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+            toColumnMajor(filter.getOrientation(k), nx, ny, nz, mxGetPr(xk));
+            mxSetFieldByNumber(plhs[1], 0, k, xk);
+        }
+    }
+    
+    if (nlhs > 2) { // return NMS
+        plhs[2] = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+        toColumnMajor(filter.getNMS(), nx, ny, nz, mxGetPr(plhs[2]));
+    }
+}
+
+
+template<class TI>
+static void processVolume(int nlhs, mxArray *plhs[], const TI input[], const mwSize dims[], const int M, const double sigma, const double zfactor, const int slabSize, const bool recursive) {
+    if (slabSize > 0) { // memory-lean mode: single precision orientation
+        filterVolume<float>(nlhs, plhs, input, dims, M, sigma, zfactor, slabSize, recursive);
+    } else {
+        filterVolume<double>(nlhs, plhs, input, dims, M, sigma, zfactor, slabSize, recursive);
+    }
+}
+
+
+template<class T>
+static bool containsNaN(const T input[], const size_t N) {
+    for (size_t i=0;i<N;++i) {
+        if (input[i]!=input[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
     
     // check # inputs
-    if (nrhs < 3 || nrhs > 4)
-        mexErrMsgTxt("Required inputs arguments: image, filter order, sigma. Optional: z-anisotropy factor.");
+    if (nrhs < 3 || nrhs > 6)
+        mexErrMsgTxt("Required inputs arguments: image, filter order, sigma. Optional: z-anisotropy factor, slab size, recursive.");
     if (nlhs > 4)
         mexErrMsgTxt("Too many output arguments.");
     
     // check image
-    if (!mxIsDouble(prhs[0]) || mxGetNumberOfDimensions(prhs[0]) != 3)
-        mexErrMsgTxt("Input must be a 3D array.");
+    if ((!mxIsDouble(prhs[0]) && !mxIsSingle(prhs[0]) && !mxIsUint16(prhs[0])) || mxGetNumberOfDimensions(prhs[0]) != 3)
+        mexErrMsgTxt("Input must be a 3D double, single, or uint16 array.");
     const mwSize* dims = mxGetDimensions(prhs[0]);
     
     int ny = (int)dims[0]; // reversed: (m,n) -> (y,x)
     int nx = (int)dims[1];
     int nz = (int)dims[2];
     
-    int N = nx*ny*nz;
-    double* input = mxGetPr(prhs[0]);
     // check for NaNs in input, as these will result in a crash
-    for (int i=0;i<N;++i) {
-        if (mxIsNaN(input[i])) {
-            mexErrMsgTxt("Input image contains NaNs.");
-            break;
-        }
-    }
+    size_t N = (size_t)nx*ny*nz;
+    if ((mxIsDouble(prhs[0]) && containsNaN((double*)mxGetData(prhs[0]), N)) ||
+        (mxIsSingle(prhs[0]) && containsNaN((float*)mxGetData(prhs[0]), N)))
+        mexErrMsgTxt("Input image contains NaNs.");
     
     // check order
     if (!mxIsDouble(prhs[1]) || mxGetNumberOfElements(prhs[1]) != 1 || *mxGetPr(prhs[1])!=(int)*mxGetPr(prhs[1]) || *mxGetPr(prhs[1])<1 || *mxGetPr(prhs[1])>3)
@@ -514,95 +686,47 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
     double sigma = *mxGetPr(prhs[2]);
     
     double zfactor = 1.0;
-    if (nrhs==4) {
+    if (nrhs>3 && !mxIsEmpty(prhs[3])) {
         if (!mxIsDouble(prhs[3]) || mxGetNumberOfElements(prhs[3]) != 1 || *mxGetPr(prhs[3]) <= 0.0)
             mexErrMsgTxt("The z-anisotropy factor must be positive.");
         zfactor = *mxGetPr(prhs[3]);
     }
     
-    int L = 2*(int)(3.0*sigma)+1; // support of the Gaussian kernels
-    int Lz = 2*(int)(3.0*sigma/zfactor)+1;
-    
-    if (L>nx || L>ny || Lz>nz) {
-        mexPrintf("Sigma must be smaller than %.2f\n", (min(min(nx,ny), nz)-1.0)/8.0);
-        mexErrMsgTxt("Sigma value results in filter support that is larger than image.");
+    int slabSize = 0;
+    if (nrhs>4 && !mxIsEmpty(prhs[4])) {
+        if (!mxIsDouble(prhs[4]) || mxGetNumberOfElements(prhs[4]) != 1 || *mxGetPr(prhs[4])!=(int)*mxGetPr(prhs[4]) || *mxGetPr(prhs[4]) < 1.0)
+            mexErrMsgTxt("The slab size must be a positive integer.");
+        slabSize = (int)*mxGetPr(prhs[4]);
     }
     
-    double* voxels = new double[N];
-    //Convert volume to row-major frames (Matlab uses column-major)
-    int nxy = nx*ny;
-    int z;
-    div_t divRes;
-    for (int i=0;i<N;++i) {
-        divRes = div(i, nxy);
-        z = divRes.quot;
-        divRes = div(divRes.rem, ny);
-        voxels[divRes.quot+divRes.rem*nx + z*nxy] = input[i];
+    bool recursive = false;
+    if (nrhs>5 && !mxIsEmpty(prhs[5])) {
+        if ((!mxIsLogical(prhs[5]) && !mxIsDouble(prhs[5])) || mxGetNumberOfElements(prhs[5]) != 1)
+            mexErrMsgTxt("'recursive' must be a logical scalar.");
+        recursive = mxIsLogicalScalarTrue(prhs[5]) || (mxIsDouble(prhs[5]) && *mxGetPr(prhs[5])!=0.0);
     }
     
-    Filter filter = Filter(voxels, nx, ny, nz, M, sigma, zfactor);
-    double *res = filter.getResponse();
-    
-    // Switch outputs back to column-major format
-    if (nlhs > 0) {
-        
-        for (int i=0;i<N;++i) {
-            divRes = div(i, nxy);
-            z = divRes.quot;
-            divRes = div(divRes.rem, nx);
-            voxels[divRes.quot+divRes.rem*ny + z*nxy] = res[i];
-        }
-        plhs[0] =  mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
-        memcpy(mxGetPr(plhs[0]), voxels, N*sizeof(double));
-    }
+    int L = 2*(int)(3.0*sigma)+1; // support of the Gaussian kernels
+    int Lz = 2*(int)(3.0*sigma/zfactor)+1;
     
-    if (nlhs > 1) { // return orientation map: structure theta, fields .x1, .x2, .x3
-        double **orientation = filter.getOrientation();
-        
-        const char *fieldnames[] = {"x1", "x2", "x3"};
-        mwSize sdims[2] = {1, 1};
-        plhs[1] = mxCreateStructArray(2, sdims, 3, fieldnames);
-        // copy each coordinate to its field
-        mxArray *x1 = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
-        mxArray *x2 = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
-        mxArray *x3 = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
-        double* px1 = mxGetPr(x1);
-        double* px2 = mxGetPr(x2);
-        double* px3 = mxGetPr(x3);
-        
-        for (int i=0;i<N;++i) {
-            divRes = div(i, nxy);
-            z = divRes.quot;
-            divRes = div(divRes.rem, nx);
-            px1[divRes.quot+divRes.rem*ny + z*nxy] = orientation[i][0];
-            px2[divRes.quot+divRes.rem*ny + z*nxy] = orientation[i][1];
-            px3[divRes.quot+divRes.rem*ny + z*nxy] = orientation[i][2];
-        }
-        mxSetFieldByNumber(plhs[1], 0, 0, x1);
-        mxSetFieldByNumber(plhs[1], 0, 1, x2);
-        mxSetFieldByNumber(plhs[1], 0, 2, x3);
+    if (!recursive && (L>nx || L>ny || Lz>nz)) {
+        mexPrintf("Sigma must be smaller than %.2f\n", (min(min(nx,ny), nz)-1.0)/8.0);
+        mexErrMsgTxt("Sigma value results in filter support that is larger than image.");
     }
     
-    if (nlhs > 2) { // return NMS
-        double *nms = filter.getNMS();
-        plhs[2] =  mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
-        double *nmsP = mxGetPr(plhs[2]);
-        for (int i=0;i<N;++i) {
-            divRes = div(i, nxy);
-            z = divRes.quot;
-            divRes = div(divRes.rem, nx);
-            nmsP[divRes.quot+divRes.rem*ny + z*nxy] = nms[i];
-        }
+    if (mxIsDouble(prhs[0])) {
+        processVolume(nlhs, plhs, (double*)mxGetData(prhs[0]), dims, M, sigma, zfactor, slabSize, recursive);
+    } else if (mxIsSingle(prhs[0])) {
+        processVolume(nlhs, plhs, (float*)mxGetData(prhs[0]), dims, M, sigma, zfactor, slabSize, recursive);
+    } else {
+        processVolume(nlhs, plhs, (unsigned short*)mxGetData(prhs[0]), dims, M, sigma, zfactor, slabSize, recursive);
     }
-    
-    // Free memory
-    delete[] voxels;
 }
 
 
 // compiled with:
 // export DYLD_LIBRARY_PATH=/Applications/MATLAB_R2014b.app/bin/maci64
-// g++ -Wall -g -DARRAY_ACCESS_INLINING -I. -L/Applications/MATLAB_R2014b.app/bin/maci64 -I../../mex/include/ -I/Applications/MATLAB_R2014b.app/extern/include steerableDetector3D.cpp -lmx -lmex -lgsl
+// g++ -Wall -g -DARRAY_ACCESS_INLINING -I. -L/Applications/MATLAB_R2014b.app/bin/maci64 -I../../mex/include/ -I/Applications/MATLAB_R2014b.app/extern/include steerableDetector3D.cpp -lmx -lmex
 // tested with:
 // valgrind --tool=memcheck --leak-check=full --show-reachable=yes ./a.out 2>&1 | grep steerable
 
@@ -616,7 +740,7 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
         voxels[i] = rand();
     }
     
-    Filter filter = Filter(voxels, nx, ny, nz, 1, 3.0);
+    Filter<double> filter(voxels, nx, ny, nz, 1, 3.0, 1.0, 0, false);
     
     delete[] voxels;
 }*/
@@ -1,7 +1,7 @@
-%[res, theta, nms] = steerableDetector3D(vol, M, sigma, zxRatio) performs curve/surface detection using 3D steerable filters
+%[res, theta, nms] = steerableDetector3D(vol, M, sigma, zxRatio, slabSize, recursive) performs curve/surface detection using 3D steerable filters
 %
 % Inputs: 
-%         vol : input volume
+%         vol : input volume (double, single, or uint16)
 %           M : filter type
 %               1: curve detector
 %               2: surface detector
@@ -9,6 +9,14 @@
 %       sigma : standard deviation of the Gaussian kernel on which the filters are based
 %   {zxRatio} : correction factor for z anisotropy (default: 1).
 %               Example: if the z sampling step is 5x larger than xy-sampling, set this value to 5.
+%  {slabSize} : if specified, the filters are computed for slabs of 'slabSize' z-planes at a time
+%               and the orientation is stored in single precision internally. The response is identical
+%               with the default (FIR) filters, and approximate with 'recursive' (the slabs then overlap
+%               by 6*sigma/zxRatio z-planes only, instead of the infinite support of the recursive filters).
+%               Use this option to limit the memory usage for large volumes.
+% {recursive} : if true, the Gaussian filters are computed with recursive (IIR) filters, whose cost
+%               does not depend on sigma (max. error ~2e-3 of the filter peak). Recommended for sigma > 4.
+%               Default: false.
 %
 % Outputs: 
 %         res : response to the filter
@@ -16,11 +24,12 @@
 %               .x1, .x2, .x3 fields
 %         nms : non-maximum-suppressed response
 %
-% Memory usage: ~17x size of 'vol'
+% Memory usage: ~12x size of 'vol', or ~3.5x size of 'vol' + ~8x size of a slab with 'slabSize'
+%               (not including the outputs)
 %
 % For more information, see:
 % F. Aguet et al., IEEE Proc. ICIP'05, pp. II 1158-1161, 2005.
 
 % Francois Aguet, 08/2012 (last modified 08/28/2012).
 
-function [res, theta, nms] = steerableDetector3D(vol, M, sigma, zxRatio) %#ok<STOUT,INUSD>
\ No newline at end of file
+function [res, theta, nms] = steerableDetector3D(vol, M, sigma, zxRatio, slabSize, recursive) %#ok<STOUT,INUSD>
\ No newline at end of file
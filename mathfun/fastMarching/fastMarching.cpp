@@ -1,5 +1,7 @@
 #include <mex.h>
 
+#include <cstring>
+
 #include <boost/graph/adjacency_list.hpp>
 
 #include <image.hpp>
@@ -31,8 +33,42 @@ struct edge_t
   double time;
 };
 
+// Options given as parameter/value pairs
+struct options_t
+{
+  options_t() : untidy(false), spacing(0), order(1) {}
+  // untidy priority queue for the trial set
+  bool untidy;
+  // grid spacing <x, y> or <x, y, z> (default: 1)
+  const double * spacing;
+  // order of the upwind scheme
+  int order;
+};
+
+// Compute front propagation, output U and R
+template <int n, typename Q, typename G>
+static void march(const int f_size[n], const image<n, double> & f, G & g,
+		  const options_t & opts, int nlhs, mxArray *plhs[])
+{
+  fast_marching<n, Q> fm(f_size, opts.spacing, opts.order);
+
+  fm.compute(f, g);
+
+  // Output U
+  if (nlhs > 0)
+    image2mxArray(fm.u(), plhs[0]);
+
+  // Output R
+  if (nlhs > 3)
+    {
+      // TODO: add 1 to the map.
+      image2mxArray(fm.r(), plhs[3]);
+    }
+}
+
 template <int n>
-static void dispatch(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+static void dispatch(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[],
+		     const options_t & opts)
 {
   // Graph type definition
   typedef boost::adjacency_list<boost::listS,
@@ -47,7 +83,7 @@ static void dispatch(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 
   graph_t g(x_size[0]);
 
-  if (nrhs == 3 && !mxIsEmpty(prhs[2]))
+  if (nrhs >= 3 && !mxIsEmpty(prhs[2]))
     {
       // Check max_degree argument
       if (mxGetM(prhs[2]) != x_size[0])
@@ -94,9 +130,14 @@ columns.");
 	mexErrMsgTxt("1st and 2nd argument's dimensions mismatch.");
       
       sizeWrapper<n>::convert(mxGetDimensions(prhs[1]), f_size);
-    }
 
-  fast_marching<n> fm(f_size);
+      // Check speed values
+      const double * f_ptr = mxGetPr(prhs[1]);
+
+      for (std::size_t i = 0; i < mxGetNumberOfElements(prhs[1]); ++i)
+	if (!(f_ptr[i] > 0))
+	  mexErrMsgTxt("2nd argument must be positive (no zeros or NaNs).");
+    }
 
   // Compute front propagation
 
@@ -107,11 +148,10 @@ columns.");
   else
     f.fill(mxGetPr(prhs[1]));
   
-  fm.compute(f, g);
-
-  // Output U
-  if (nlhs > 0)
-    image2mxArray(fm.u(), plhs[0]);
+  if (opts.untidy)
+    march<n, untidy_queue>(f_size, f, g, opts, nlhs, plhs);
+  else
+    march<n, indexed_heap>(f_size, f, g, opts, nlhs, plhs);
 
   // Output E
   if (nlhs > 1)
@@ -154,13 +194,6 @@ columns.");
 	  ptr++;
 	}
     }
-
-  // Output R
-  if (nlhs > 3)
-    {
-      // TODO: add 1 to the map.
-      image2mxArray(fm.r(), plhs[3]);
-    }
 }
 
 void mexFunction(int nlhs, mxArray *plhs[],
@@ -171,12 +204,58 @@ void mexFunction(int nlhs, mxArray *plhs[],
   if (nrhs < 1)
     mexErrMsgTxt("At least one input argument is required.");
   
-  if (nrhs > 3)
-    mexErrMsgTxt("Too many input arguments.");
-
   if (nlhs > 4)
     mexErrMsgTxt("Too many output arguments.");
 
+  // Parse parameter/value pairs
+
+  options_t opts;
+
+  if (nrhs > 3 && (nrhs - 3) % 2 != 0)
+    mexErrMsgTxt("Options must be given as parameter/value pairs.");
+
+  for (int i = 3; i < nrhs; i += 2)
+    {
+      char name[32], value[32];
+
+      if (mxGetString(prhs[i], name, sizeof(name)) != 0)
+	mexErrMsgTxt("Invalid parameter name.");
+
+      if (strcmp(name, "Queue") == 0)
+	{
+	  if (mxGetString(prhs[i + 1], value, sizeof(value)) != 0 ||
+	      (strcmp(value, "heap") != 0 && strcmp(value, "untidy") != 0))
+	    mexErrMsgTxt("'Queue' must be 'heap' or 'untidy'.");
+
+	  opts.untidy = strcmp(value, "untidy") == 0;
+	}
+      else if (strcmp(name, "Spacing") == 0)
+	{
+	  const mxArray * a = prhs[i + 1];
+
+	  if (!mxIsDouble(a) || mxGetNumberOfElements(a) != mxGetN(prhs[0]))
+	    mexErrMsgTxt("'Spacing' must have one element per dimension.");
+
+	  opts.spacing = mxGetPr(a);
+
+	  for (unsigned k = 0; k < mxGetNumberOfElements(a); ++k)
+	    if (!(opts.spacing[k] > 0))
+	      mexErrMsgTxt("'Spacing' must be positive.");
+	}
+      else if (strcmp(name, "Order") == 0)
+	{
+	  const mxArray * a = prhs[i + 1];
+
+	  if (!mxIsNumeric(a) || mxGetNumberOfElements(a) != 1 ||
+	      (mxGetScalar(a) != 1 && mxGetScalar(a) != 2))
+	    mexErrMsgTxt("'Order' must be 1 or 2.");
+
+	  opts.order = (int) mxGetScalar(a);
+	}
+      else
+	mexErrMsgTxt("Unknown parameter (valid: 'Queue', 'Spacing', 'Order').");
+    }
+
   // Get the dimension
 
   int dim = mxGetN(prhs[0]);
@@ -185,8 +264,8 @@ void mexFunction(int nlhs, mxArray *plhs[],
 
   switch (dim)
     {
-    case 2: dispatch<2>(nlhs, plhs, nrhs, prhs); break;
-    case 3: dispatch<3>(nlhs, plhs, nrhs, prhs); break;
+    case 2: dispatch<2>(nlhs, plhs, nrhs, prhs, opts); break;
+    case 3: dispatch<3>(nlhs, plhs, nrhs, prhs, opts); break;
     default: mexErrMsgTxt("Invalid points dimension (must be 2d or 3d).");
     }
 }
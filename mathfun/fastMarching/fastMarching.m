@@ -1,5 +1,5 @@
-function [U E S R] = fastMarching(X, F, maxDegree) %#ok<STOUT,INUSD>
-% [U E S R] = FASTMARCHING(X, F, maxDegree) resolves the Eikonal Equation
+function [U E S R] = fastMarching(X, F, maxDegree, varargin) %#ok<STOUT,INUSD>
+% [U E S R] = FASTMARCHING(X, F, maxDegree, ...) resolves the Eikonal Equation
 % |grad(U)|F = 1, where U(X(:)) = 0. During this process, a graph G =
 % (X, E) is created where an edge e is created between Xi and Xj as soon as
 % their associated front, i.e. propagating from Xi and Xj, are touching
@@ -15,10 +15,29 @@ function [U E S R] = fastMarching(X, F, maxDegree) %#ok<STOUT,INUSD>
 %    F          the speed function |grad(U)|F = 1. F must has the same
 %               dimension (2- or 3-dimension) than X. Default value is
 %               F(:) = 1 for every point.
+%               F must be positive (no zeros or NaNs).
 %
 %    maxDegree  it stands for the maximum number of edges for each vertex
 %               in G.
 %
+% Options ('specifier', value):
+%
+%    'Queue'    priority queue of the narrow band: 'heap' (default), a
+%               binary heap with decrease-key, or 'untidy', a bucket queue
+%               over quantized arrival times (Yatziv et al., 2006). 'untidy'
+%               is faster on large volumes; U can differ by up to about a
+%               quarter of the smallest step, 1/max(F).
+%
+%    'Spacing'  grid spacing along each dimension, following the
+%               coordinate order of X: [sx sy] or [sx sy sz]. Default:
+%               ones. Anisotropic volumes (e.g., confocal stacks with a
+%               larger z step) can be processed at their native
+%               resolution.
+%
+%    'Order'    order of the upwind finite differences: 1 (default) or 2
+%               (FMM2, second-order differences where two upwind points
+%               are known). 2 is more accurate for smooth speed functions.
+%
 % output:
 %
 %    U          the solution of the Eikonal Equation.
@@ -1,9 +1,11 @@
 #ifndef		FAST_MARCHING_HPP
 # define	FAST_MARCHING_HPP
 
-# include <map>
 # include <vector>
 # include <limits>
+# include <cmath>
+# include <cstddef>
+# include <algorithm>
 
 # include <image.hpp>
 # include <window.hpp>
@@ -21,7 +23,191 @@ struct Pow<B, 0>
   enum { ret = 1 };
 };
 
-template <int n>
+// Trial sets of the fast marching. Points are identified by their
+// linear index and keys are arrival times. Both queues provide:
+//
+//   reset(size, min_step, max_step)  empty the queue for indices in
+//                                    [0, size); min_step and max_step
+//                                    bound the increase of the arrival
+//                                    time between neighbor points.
+//   push(i, key)                     insert i (not in the queue).
+//   decrease(i, key)                 lower the key of i (in the queue).
+//   key(i)                           key of i (in the queue).
+//   pop(key)                         remove and return the index with
+//                                    the lowest key.
+
+// Binary heap with decrease-key: pos_[i] is the position of i in the
+// heap, -1 if i is not in the heap.
+class indexed_heap
+{
+public:
+  void reset(std::size_t size, double, double)
+  {
+    heap_.clear();
+    pos_.assign(size, -1);
+  }
+
+  bool empty() const { return heap_.empty(); }
+
+  void push(int i, double key)
+  {
+    node_t nd = { key, i };
+    heap_.push_back(nd);
+    up_(heap_.size() - 1);
+  }
+
+  void decrease(int i, double key)
+  {
+    heap_[pos_[i]].key = key;
+    up_(pos_[i]);
+  }
+
+  double key(int i) const { return heap_[pos_[i]].key; }
+
+  int pop(double & key)
+  {
+    int i = heap_[0].index;
+    key = heap_[0].key;
+    pos_[i] = -1;
+    heap_[0] = heap_.back();
+    heap_.pop_back();
+    if (!heap_.empty())
+      down_(0);
+    return i;
+  }
+
+private:
+  struct node_t
+  {
+    double key;
+    int index;
+  };
+
+  void up_(std::size_t k)
+  {
+    node_t nd = heap_[k];
+    while (k > 0)
+      {
+	std::size_t parent = (k - 1) >> 1;
+	if (!(nd.key < heap_[parent].key))
+	  break;
+	heap_[k] = heap_[parent];
+	pos_[heap_[k].index] = k;
+	k = parent;
+      }
+    heap_[k] = nd;
+    pos_[nd.index] = k;
+  }
+
+  void down_(std::size_t k)
+  {
+    node_t nd = heap_[k];
+    std::size_t size = heap_.size();
+    for (std::size_t child = 2 * k + 1; child < size; child = 2 * k + 1)
+      {
+	if (child + 1 < size && heap_[child + 1].key < heap_[child].key)
+	  ++child;
+	if (!(heap_[child].key < nd.key))
+	  break;
+	heap_[k] = heap_[child];
+	pos_[heap_[k].index] = k;
+	k = child;
+      }
+    heap_[k] = nd;
+    pos_[nd.index] = k;
+  }
+
+  std::vector<node_t> heap_;
+  std::vector<int> pos_;
+};
+
+// Untidy priority queue (Yatziv et al., "O(N) implementation of the
+// fast marching algorithm", J. Comput. Phys. 2006): a circular array
+// of buckets of width delta_ over the arrival times. Operations are
+// O(1); points are accepted in the order of their quantised arrival
+// time, hence an error in O(delta_). decrease() pushes a new entry;
+// outdated entries are skipped by pop() (key_[i] < 0: not in the
+// queue).
+class untidy_queue
+{
+public:
+  untidy_queue() : delta_(1.0), cur_(0), size_(0) {}
+
+  void reset(std::size_t size, double min_step, double max_step)
+  {
+    // a quarter of the smallest step, with at most 2^16 buckets
+    delta_ = std::max(0.25 * min_step, max_step / 65534.0);
+    buckets_.assign(static_cast<std::size_t>(std::ceil(max_step / delta_)) + 2,
+		    std::vector<node_t>());
+    key_.assign(size, -1.0);
+    cur_ = 0;
+    size_ = 0;
+  }
+
+  bool empty() const { return size_ == 0; }
+
+  void push(int i, double key)
+  {
+    ++size_;
+    decrease(i, key);
+  }
+
+  void decrease(int i, double key)
+  {
+    key_[i] = key;
+
+    // infinite keys go to the last bucket
+    double kb = key / delta_;
+    std::size_t last = cur_ + buckets_.size() - 1;
+    std::size_t b = kb < static_cast<double>(last) ?
+      std::max(static_cast<std::size_t>(std::max(kb, 0.0)), cur_) : last;
+
+    node_t nd = { key, i };
+    buckets_[b % buckets_.size()].push_back(nd);
+  }
+
+  double key(int i) const { return key_[i]; }
+
+  int pop(double & key)
+  {
+    while (true)
+      {
+	std::vector<node_t> & bucket = buckets_[cur_ % buckets_.size()];
+
+	while (!bucket.empty())
+	  {
+	    node_t nd = bucket.back();
+	    bucket.pop_back();
+
+	    if (key_[nd.index] == nd.key)
+	      {
+		key = nd.key;
+		key_[nd.index] = -1.0;
+		--size_;
+		return nd.index;
+	      }
+	  }
+	++cur_;
+      }
+  }
+
+private:
+  struct node_t
+  {
+    double key;
+    int index;
+  };
+
+  double delta_;
+  std::vector<std::vector<node_t> > buckets_;
+  std::vector<double> key_;
+  std::size_t cur_;	// absolute index of the current bucket
+  std::size_t size_;	// number of points in the queue
+};
+
+// Q: trial set, indexed_heap (exact) or untidy_queue (approximate,
+// O(1) operations).
+template <int n, typename Q = indexed_heap>
 class fast_marching
 {
 private:
@@ -29,8 +215,6 @@ private:
   static const unsigned char FAR	= 1;
   static const unsigned char TRIAL	= 2;
 
-  typedef std::multimap<double, vector<n, int> > trial_set_t;
-
   typedef window<n, (n << 1), int>		win1_t;
   typedef window<n, Pow<3,n>::ret - 1, int>	win2_t;
 
@@ -38,8 +222,23 @@ private:
   static const win2_t win2;
 
 public:
-  fast_marching(const int size[n]) : u_(size), r_(size), m_(size)
+  // spacing: grid spacing along each dimension (default: 1).
+  // order: 1 or 2, order of the upwind scheme (FMM2: second-order
+  // differences where two upwind points are known).
+  fast_marching(const int size[n], const double spacing[n] = 0,
+		int order = 1) : u_(size), r_(size), m_(size), order_(order)
   {
+    for (int i = 0; i < n; ++i)
+      h_[i] = spacing ? spacing[i] : 1.0;
+
+    // linear index: y is the fastest dimension, then x and z (Matlab)
+    stride_[1] = 1;
+    stride_[0] = size[1];
+    if (n > 2)
+      stride_[n - 1] = size[0] * size[1];
+    size_ = 1;
+    for (int i = 0; i < n; ++i)
+      size_ *= size[i];
   }
 
   const image<n, double> & u() const { return u_; }
@@ -62,7 +261,31 @@ public:
     r_.border_replicate(u_.margin());
     m_.border_replicate(u_.margin());
 
-    trial_.clear(); // safe. should be already empty.
+    // bounds of the arrival time increase between neighbors (untidy
+    // queue), over the finite potentials: points of null speed are
+    // never reached.
+    double min_pot = std::numeric_limits<double>::max();
+    double max_pot = 0;
+
+    for (std::size_t i = 0; i < size_; ++i)
+      {
+	double pot = 1.0 / fabs(f[point_(i)]);
+
+	if (pot > 0 && pot <= std::numeric_limits<double>::max())
+	  {
+	    min_pot = std::min(min_pot, pot);
+	    max_pot = std::max(max_pot, pot);
+	  }
+      }
+
+    if (max_pot == 0)
+      min_pot = max_pot = 1;
+
+    double min_h = *std::min_element(h_, h_ + n);
+    double max_h = *std::max_element(h_, h_ + n);
+
+    trial_.reset(size_, min_pot * min_h * (order_ == 2 ? 2.0 / 3.0 : 1.0),
+		 max_pot * max_h);
 
     // Initialization of actions, ancestors and status maps for
     // initial Points.
@@ -91,10 +314,9 @@ public:
 		switch (m_[q])
 		  {
 		  case FAR:
+		  case TRIAL:
 		    {
-		      upwind_update_(f, q);
-		      trial_.insert(std::make_pair(u_[q], q));
-		      m_[q] = TRIAL;
+		      update_trial_(f, q);
 		      break;
 		    }
 		  case ACCEPTED:
@@ -131,8 +353,9 @@ public:
 	// Move the Point with the lowest time arrival from trial to
 	// alive set.
 	
-	const vector<n,int> p = trial_.begin()->second;
-	trial_.erase(trial_.begin());
+	double u;
+	const vector<n,int> p = point_(trial_.pop(u));
+	u_[p] = u;
 	m_[p] = ACCEPTED;
 
 	// Here, we check if there is a saddle point between front
@@ -172,12 +395,15 @@ public:
 	  {
 	    const vector<n,int> q = p + win1.point(i);	    
 
-	    if (u_.contains(q) && m_[q] == FAR)
-	      {
-		upwind_update_(f, q);
-		trial_.insert(std::make_pair(u_[q], q));
-		m_[q] = TRIAL;
-	      }
+	    if (!u_.contains(q) || m_[q] == ACCEPTED)
+	      continue;
+
+	    // The arrival time of a TRIAL point can only decrease if u[p]
+	    // is lower, and lower than the other neighbor of q along
+	    // this dimension.
+	    if (m_[q] == FAR ||
+		(u < trial_.key(index_(q)) && u < u_[q + win1.point(i)]))
+	      update_trial_(f, q);
 	  }
       }
 
@@ -197,141 +423,189 @@ public:
   }
 
 private:
-  void upwind_update_(const image<n, double>& f, const vector<n,int>& p);
+  std::size_t index_(const vector<n,int>& p) const
+  {
+    std::size_t i = 0;
+    for (int k = 0; k < n; ++k)
+      i += p[k] * stride_[k];
+    return i;
+  }
 
-private:
-  image<n, double> u_;
-  image<n, int> r_;
-  image<n, unsigned char> m_;
+  vector<n,int> point_(std::size_t i) const
+  {
+    static const int order[3] = { 2, 0, 1 };
 
-  trial_set_t trial_;
-};
+    vector<n,int> p;
+    for (int k = 3 - n; k < 3; ++k)
+      {
+	p[order[k]] = i / stride_[order[k]];
+	i %= stride_[order[k]];
+      }
+    return p;
+  }
 
-template <>
-const fast_marching<2>::win1_t fast_marching<2>::win1 = neighb_c4<int>();
+  // Neighbor of p along dimension d with the lowest known arrival time
+  vector<n,int> upwind_neighbor_(const vector<n,int>& p, int d) const
+  {
+    vector<n,int> lo(p);
+    vector<n,int> hi(p);
 
-template <>
-const fast_marching<2>::win2_t fast_marching<2>::win2 = neighb_c8<int>();
+    lo[d]--;
+    hi[d]++;
 
-template <>
-const fast_marching<3>::win1_t fast_marching<3>::win1 = neighb_c6<int>();
+    return u_[lo] < u_[hi] ? lo : hi;
+  }
 
-template <>
-const fast_marching<3>::win2_t fast_marching<3>::win2 = neighb_c26<int>();
+  // Arrival time at p from its accepted neighbors; r is the front of
+  // the upwind neighbor.
+  double upwind_update_(const image<n, double>& f, const vector<n,int>& p,
+			int & r) const;
 
-template <>
-void fast_marching<2>::upwind_update_(const image<2,double> & f,
-				      const vector<2,int> & p)
-{
-  assert(fabs(f[p]) >= std::numeric_limits<double>::epsilon());
+  // Insert a FAR point q into the trial set, or lower the arrival time
+  // of a TRIAL point. Tentative arrival times are kept by the trial
+  // set: u_ is +inf until a point is accepted.
+  void update_trial_(const image<n, double>& f, const vector<n,int>& q)
+  {
+    int r;
+    double u = upwind_update_(f, q, r);
+    std::size_t i = index_(q);
 
-  double pot = 1.0 / f[p];
-    
-  vector<2,int> a(p);
-  vector<2,int> b(p);
+    // null speed: q is never reached
+    if (!(u < std::numeric_limits<double>::max()))
+      return;
 
-  if (u_(p[0] - 1, p[1]) < u_(p[0] + 1, p[1]))
-    a[0]--;
-  else
-    a[0]++;
+    if (m_[q] == FAR)
+      {
+	r_[q] = r;
+	m_[q] = TRIAL;
+	trial_.push(i, u);
+      }
+    else if (u < trial_.key(i))
+      {
+	r_[q] = r;
+	trial_.decrease(i, u);
+      }
+  }
 
-  if (u_(p[0], p[1] - 1) < u_(p[0], p[1] + 1))
-    b[1]--;
-  else
-    b[1]++;
+private:
+  image<n, double> u_;
+  image<n, int> r_;
+  image<n, unsigned char> m_;
 
-  double ua = u_[a];
-  double ub = u_[b];
+  double h_[n];
+  int order_;
 
-  if (ua > ub)
-    {
-      std::swap(ua, ub);
-      std::swap(a, b);
-    }
-    
-  assert(ua != std::numeric_limits<double>::max() ||
-	 ub != std::numeric_limits<double>::max());
+  std::size_t stride_[n];
+  std::size_t size_;
 
-  r_[p] = r_[a];
+  Q trial_;
+};
 
-  u_[p] = (pot > (ub - ua)) ? 0.5 *
-    (ub + ua + sqrt(2 * pot * pot - (ub - ua) * (ub - ua))) :
-    ua + pot;
-}
+template <int n>
+struct fast_marching_windows;
+
+template <>
+struct fast_marching_windows<2>
+{
+  static const window<2, 4, int> & win1() { return neighb_c4<int>(); }
+  static const window<2, 8, int> & win2() { return neighb_c8<int>(); }
+};
 
 template <>
-void fast_marching<3>::upwind_update_(const image<3, double> & f,
-				      const vector<3,int> & p)
+struct fast_marching_windows<3>
+{
+  static const window<3, 6, int> & win1() { return neighb_c6<int>(); }
+  static const window<3, 26, int> & win2() { return neighb_c26<int>(); }
+};
+
+template <int n, typename Q>
+const typename fast_marching<n, Q>::win1_t fast_marching<n, Q>::win1 =
+  fast_marching_windows<n>::win1();
+
+template <int n, typename Q>
+const typename fast_marching<n, Q>::win2_t fast_marching<n, Q>::win2 =
+  fast_marching_windows<n>::win2();
+
+// Upwind scheme. Along each dimension d, the known upwind neighbor
+// gives a difference w_d (u - v_d)^2, with w_d = 1 / h_d^2 and v_d its
+// arrival time u_1. At second order, if the next point along d is
+// known with u_2 <= u_1, w_d = 9 / (4 h_d^2) and v_d = (4 u_1 - u_2) /
+// 3. The v_d are sorted, and sum_{j<=k} w_j (u - v_j)^2 = pot^2 is
+// solved for the smallest k such that u <= v_{k+1}.
+template <int n, typename Q>
+double fast_marching<n, Q>::upwind_update_(const image<n, double> & f,
+					   const vector<n,int> & p,
+					   int & r) const
 {
   assert(fabs(f[p]) >= std::numeric_limits<double>::epsilon());
 
   double pot = 1.0 / f[p];
 
-  vector<3,int> a(p);
-  vector<3,int> b(p);
-  vector<3,int> c(p);
-
-  if (u_(p[0] - 1, p[1], p[2]) < u_(p[0] + 1, p[1], p[2]))
-    a[0]--;
-  else
-    a[0]++;
-
-  if (u_(p[0], p[1] - 1, p[2]) < u_(p[0], p[1] + 1, p[2]))
-    b[1]--;
-  else
-    b[1]++;
-
-  if (u_(p[0], p[1], p[2] - 1) < u_(p[0], p[1], p[2] + 1))
-    c[2]--;
-  else
-    c[2]++;
-
-  double ua = u_[a];
-  double ub = u_[b];
-  double uc = u_[c];
-  
-  if (ua > ub)
-    {
-      std::swap(ua, ub);
-      std::swap(a, b);
-    }
+  double v[n];
+  double w[n];
+  vector<n,int> a;
+  double ua = std::numeric_limits<double>::max();
 
-  if (ua > uc)
+  for (int d = 0; d < n; ++d)
     {
-      std::swap(ua, uc);
-      std::swap(a, c);
+      vector<n,int> q = upwind_neighbor_(p, d);
+      double u1 = u_[q];
+      double vd = u1;
+      double wd = 1.0 / (h_[d] * h_[d]);
+
+      if (d == 0 || u1 < ua)
+	{
+	  a = q;
+	  ua = u1;
+	}
+
+      if (order_ == 2 && u1 != std::numeric_limits<double>::max())
+	{
+	  vector<n,int> q2(q);
+	  q2[d] += q[d] - p[d];
+
+	  if (u_.contains(q2) && u_[q2] <= u1)
+	    {
+	      vd = (4.0 * u1 - u_[q2]) / 3.0;
+	      wd *= 2.25;
+	    }
+	}
+
+      int k = d;
+      for (; k > 0 && vd < v[k - 1]; --k)
+	{
+	  v[k] = v[k - 1];
+	  w[k] = w[k - 1];
+	}
+      v[k] = vd;
+      w[k] = wd;
     }
 
-  if (ub > uc)
-    {
-      std::swap(ub, uc);
-      std::swap(b, c);
-    }
+  assert(ua != std::numeric_limits<double>::max());
 
-  assert(ua != std::numeric_limits<double>::max() ||
-	 ub != std::numeric_limits<double>::max() ||
-	 uc != std::numeric_limits<double>::max());
+  r = r_[a];
 
-  r_[p] = r_[a];
-  
-  double beta = -2 * (ua + ub + uc);
-  double delta = beta * beta - 12 * (ua * ua + ub * ub + uc * uc - pot * pot);
+  double u = v[0] + pot / sqrt(w[0]);
+  double sw = w[0];
+  double swv = w[0] * v[0];
+  double swv2 = w[0] * v[0] * v[0];
 
-  if (delta >= 0)
+  for (int k = 1; k < n && u > v[k]; ++k)
     {
-      double u = (-beta + sqrt(delta)) / 6.0;
+      // sw u^2 - 2 swv u + swv2 - pot^2 = 0
+      sw += w[k];
+      swv += w[k] * v[k];
+      swv2 += w[k] * v[k] * v[k];
 
-      if (u > uc)
-	u_[p] = u;
-      else
-	u_[p] = (pot > (ub - ua)) ? 0.5 *
-	  (ub + ua + sqrt(2 * pot * pot - (ub - ua) * (ub - ua))) :
-	  ua + pot;
+      double delta = swv * swv - sw * (swv2 - pot * pot);
+
+      if (delta < 0)
+	break;
+
+      u = (swv + sqrt(delta)) / sw;
     }
-  else
-    u_[p] = (pot > (ub - ua)) ? 0.5 *
-      (ub + ua + sqrt(2 * pot * pot - (ub - ua) * (ub - ua))) :
-      ua + pot;
+
+  return u;
 }
 
 // template <typename InsertIterator>
@@ -1,65 +1,200 @@
 /* [pts, values] = gradientDescent(F,X,Y);
+ * [pts, values] = gradientDescent(F,X,Y,Z);
+ * [pts, values, offsets] = gradientDescent(F,X,Y,{Z},'csr');
  *
  * Sylvain Berlemont, 2010 (last modified Aug 3, 2011)
  *
+ * The gradient of F (central differences) is computed once, in single precision, and
+ * interpolated (bilinear/trilinear) along the paths; the paths are traced in parallel.
+ *
  * Compilation:
- * Mac/Linux: mex -I.  -I../../mex/include/c++ gradientDescent.cpp
- * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT" -I"." -I"..\..\mex\include\c++" -output gradientDescent gradientDescent.cpp
+ * Mac/Linux: mex -I.  -I../../mex/include/c++ CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" gradientDescent.cpp
+ * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT /openmp" -I"." -I"..\..\mex\include\c++" -output gradientDescent gradientDescent.cpp
  */
 
 #include <mex.h>
 
+#include <cmath>
+#include <cstring>
+#include <string>
 #include <vector>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+// Matlab arrays: y (rows) is the fastest dimension, then x and z
+class GradientField
+{
+public:
+    GradientField(const double* f, const int* dims, int nd) : f_(f), nd_(nd)
+    {
+        // size along x, y, z
+        n_[0] = dims[1];
+        n_[1] = dims[0];
+        n_[2] = nd == 3 ? dims[2] : 1;
+        stride_[1] = 1;
+        stride_[0] = n_[1];
+        stride_[2] = (size_t)n_[0]*n_[1];
+
+        size_t N = stride_[2]*n_[2];
+        g_.resize(N*nd_);
+
+        // central differences, replicated borders
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (int z = 0; z < n_[2]; ++z)
+        {
+            int c[3];
+            c[2] = z;
+            for (c[0] = 0; c[0] < n_[0]; ++c[0])
+            {
+                for (c[1] = 0; c[1] < n_[1]; ++c[1])
+                {
+                    size_t i = c[0]*stride_[0] + c[1] + z*stride_[2];
+                    for (int d = 0; d < nd_; ++d)
+                    {
+                        size_t lo = c[d] > 0 ? i - stride_[d] : i;
+                        size_t hi = c[d] < n_[d]-1 ? i + stride_[d] : i;
+                        g_[i*nd_ + d] = (float)(.5 * (f_[hi] - f_[lo]));
+                    }
+                }
+            }
+        }
+    }
 
-#include <image.hpp>
-#include <mx_wrapper.hpp>
+    int dims() const { return nd_; }
 
+    // The interpolation cell of p lies within F
+    bool contains(const double* p) const
+    {
+        for (int d = 0; d < nd_; ++d)
+        {
+            int i = (int)floor(p[d]);
+            if (i < 0 || i + 1 > n_[d]-1)
+                return false;
+        }
+        return true;
+    }
 
-static void gradientDescent(const image<2,double> & f,
-        const vector<2,double>& start,
-        std::vector< vector<2, double> > & pts,
+    // Interpolated value of F and, if g != NULL, of its gradient at p (clamped to F)
+    double interp(const double* p, double* g) const
+    {
+        size_t i0[3], i1[3];
+        double w[3];
+        for (int d = 0; d < 3; ++d)
+        {
+            double x = d < nd_ ? std::min(std::max(p[d], 0.0), (double)(n_[d]-1)) : 0.0;
+            int k = std::min((int)floor(x), n_[d]-1);
+            w[d] = x - k;
+            i0[d] = k*stride_[d];
+            i1[d] = std::min(k+1, n_[d]-1)*stride_[d];
+        }
+        double v = 0.0;
+        if (g != NULL)
+        {
+            std::fill(g, g+nd_, 0.0);
+        }
+        int nc = 1 << nd_;
+        for (int c = 0; c < nc; ++c)
+        {
+            size_t i = 0;
+            double wc = 1.0;
+            for (int d = 0; d < 3; ++d)
+            {
+                bool hi = d < nd_ && ((c >> d) & 1);
+                i += hi ? i1[d] : i0[d];
+                wc *= hi ? w[d] : 1.0 - w[d];
+            }
+            v += wc*f_[i];
+            if (g != NULL)
+            {
+                for (int d = 0; d < nd_; ++d)
+                {
+                    g[d] += wc*g_[i*nd_ + d];
+                }
+            }
+        }
+        return v;
+    }
+
+private:
+    const double* f_;
+    int nd_;
+    int n_[3];
+    size_t stride_[3];
+    std::vector<float> g_;      // gradient, interleaved channels
+};
+
+
+// Appends the points of the path starting at 'start' and their values to 'pts' and 'values';
+// returns the number of points
+static size_t gradientDescent(const GradientField& f,
+        const double* start,
+        size_t maxSteps,
+        std::vector<double> & pts,
         std::vector<double> & values)
-        
+
 {
     static const double eps = 1e-5;
-    
-    vector<2,double> q, p(start);
-    
-    double dx, dy;
-    
-    int i, j;
-    
-    do
+
+    int nd = f.dims();
+    double p[3], q[3], g[3];
+    std::copy(start, start+nd, p);
+
+    size_t m = 0;
+
+    while (true)
     {
-        i = (int) floor(p[0]);
-        j = (int) floor(p[1]);
-        
-        pts.push_back(p);
-        values.push_back(f[p]);
-        
-        q = p;
-        
-        dx = .5 * (f(p[0] + 1, p[1]) - f(p[0] - 1, p[1]));
-        dy = .5 * (f(p[0], p[1] + 1) - f(p[0], p[1] - 1));
-        
-        p[0] -= dx;
-        p[1] -= dy;
+        bool inside = f.contains(p);
+
+        pts.insert(pts.end(), p, p+nd);
+        values.push_back(f.interp(p, inside ? g : NULL));
+        ++m;
+
+        if (!inside || m >= maxSteps)
+            break;
+
+        double d2 = 0.0;
+        for (int d = 0; d < nd; ++d)
+        {
+            q[d] = p[d] - g[d];
+            d2 += g[d]*g[d];
+        }
+
+        if (sqrt(d2) <= eps)
+            break;
+
+        std::copy(q, q+nd, p);
     }
-    while (f.contains(i, j) && f.contains(i + 1, j + 1) &&
-            /*f[p] > eps && */dist(p, q) > eps);
+    return m;
 }
 
 void mexFunction(int nlhs, mxArray *plhs[],
         int nrhs, const mxArray *prhs[])
 {
     // Check number of input and output parameters
-    
-    if (nrhs != 3)
-        mexErrMsgTxt("Three input argument are required.");
-    
-    if (nlhs > 2)
+
+    bool csr = nrhs > 0 && mxIsChar(prhs[nrhs-1]);
+    if (csr)
+    {
+        char* opt = mxArrayToString(prhs[nrhs-1]);
+        bool valid = opt != NULL && strcmp(opt, "csr") == 0;
+        mxFree(opt);
+        if (!valid)
+            mexErrMsgTxt("The only option is 'csr'.");
+        --nrhs;
+    }
+
+    if (nrhs != 3 && nrhs != 4)
+        mexErrMsgTxt("Three (2D) or four (3D) input arguments are required.");
+
+    if (nlhs > (csr ? 3 : 2))
         mexErrMsgTxt("Too many output arguments.");
-    
+
     // Check the argument types
     if (!mxIsDouble(prhs[0]))
     {
@@ -67,81 +202,146 @@ void mexFunction(int nlhs, mxArray *plhs[],
         err_msg += mxGetClassName(prhs[0]);
         mexErrMsgTxt(err_msg.c_str());
     }
-    
+
     // Check the number of dimensions
-    if (mxGetNumberOfDimensions(prhs[0]) != 2)
-        mexErrMsgTxt("1st argument is not a 2-dimensional matrix.");
-    
-    if (mxGetNumberOfElements(prhs[1]) != mxGetNumberOfElements(prhs[2]))
-        mexErrMsgTxt("2nd and 3rd arguments must have the same size.");
-    
-    // Read the image
-    int f_size[2];
-    sizeWrapper<2>::convert(mxGetDimensions(prhs[0]), f_size);
-    image<2,double> f(f_size,2);
-    f.fill(mxGetPr(prhs[0]));
-    f.border_replicate(f.margin());
-    
-    // Compute gradient descent
+    int nd = nrhs - 1;
+    if ((int)mxGetNumberOfDimensions(prhs[0]) != nd)
+        mexErrMsgTxt(nd == 2 ? "1st argument is not a 2-dimensional matrix." :
+                               "1st argument is not a 3-dimensional matrix.");
+
     int n = mxGetNumberOfElements(prhs[1]);
-    
-    std::vector< std::vector< vector<2,double> > > pts_list(n);
-    std::vector< std::vector<double> > values_list(n);
-    
-    double* px = mxGetPr(prhs[1]);
-    double* py = mxGetPr(prhs[2]);
-    
+    for (int d = 1; d < nd; ++d)
+    {
+        if (!mxIsDouble(prhs[1+d]) || (int)mxGetNumberOfElements(prhs[1+d]) != n)
+            mexErrMsgTxt("The coordinate arguments must have the same size.");
+    }
+
+    // Gradient of the image
+    const mwSize* dims = mxGetDimensions(prhs[0]);
+    int f_dims[3] = {(int)dims[0], (int)dims[1], nd == 3 ? (int)dims[2] : 1};
+    GradientField f(mxGetPr(prhs[0]), f_dims, nd);
+
+    // a bound on the path length, against oscillations
+    size_t maxSteps = mxGetNumberOfElements(prhs[0]) + 1;
+
+    // Compute gradient descent: each thread appends its paths to its own buffers,
+    // 'thread', 'start' and 'length' locate the path of each point
+    const double* pc[3];
+    for (int d = 0; d < nd; ++d)
+        pc[d] = mxGetPr(prhs[1+d]);
+
+    int nt = 1;
+#ifdef _OPENMP
+    nt = omp_get_max_threads();
+#endif
+    std::vector< std::vector<double> > pts_buf(nt), values_buf(nt);
+    std::vector<int> thread(n, 0);
+    std::vector<size_t> start(n, 0), length(n, 0);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 16)
+#endif
     for (int i = 0; i < n; ++i)
     {
-        vector<2,double> pt;
-        pt[0] = px[i] - 1;
-        pt[1] = py[i] - 1;
-        
-        int x = (int) floor(pt[0]);
-        int y = (int) floor(pt[1]);
-        
-        if (f.contains(x, y) && f.contains(x + 1, y + 1))
-            gradientDescent(f,pt,pts_list[i],values_list[i]);
+        int t = 0;
+#ifdef _OPENMP
+        t = omp_get_thread_num();
+#endif
+        double pt[3];
+        for (int d = 0; d < nd; ++d)
+            pt[d] = pc[d][i] - 1;
+
+        thread[i] = t;
+        start[i] = values_buf[t].size();
+
+        if (f.contains(pt))
+            length[i] = gradientDescent(f, pt, maxSteps, pts_buf[t], values_buf[t]);
     }
-    
+
+    // Offsets of the paths in the concatenated output
+    std::vector<size_t> offsets(n+1, 0);
+    for (int i = 0; i < n; ++i)
+        offsets[i+1] = offsets[i] + length[i];
+    size_t M = offsets[n];
+
     // Output
+    if (csr)
+    {
+        double* P = NULL;
+        double* V = NULL;
+        if (nlhs > 0)
+        {
+            plhs[0] = mxCreateDoubleMatrix(M, nd, mxREAL);
+            P = mxGetPr(plhs[0]);
+        }
+        if (nlhs > 1)
+        {
+            plhs[1] = mxCreateDoubleMatrix(M, 1, mxREAL);
+            V = mxGetPr(plhs[1]);
+        }
+        for (int i = 0; i < n; ++i)
+        {
+            if (length[i] == 0)
+                continue;
+            const double* src = &pts_buf[thread[i]][0] + start[i]*nd;
+            for (size_t j = 0; j < length[i]; ++j)
+            {
+                size_t k = offsets[i] + j;
+                if (P != NULL)
+                {
+                    for (int d = 0; d < nd; ++d)
+                        P[k + d*M] = src[j*nd + d] + 1;
+                }
+                if (V != NULL)
+                    V[k] = values_buf[thread[i]][start[i] + j];
+            }
+        }
+        if (nlhs > 2)
+        {
+            plhs[2] = mxCreateDoubleMatrix(n+1, 1, mxREAL);
+            double* o = mxGetPr(plhs[2]);
+            for (int i = 0; i <= n; ++i)
+                o[i] = offsets[i] + 1;
+        }
+        return;
+    }
+
     if (nlhs > 0)
     {
         plhs[0] = mxCreateCellMatrix(n,1);
-        
+
         for (int i = 0; i < n; ++i)
         {
-            int m = pts_list[i].size();
-            
-            mxArray* tmp = mxCreateDoubleMatrix(m, 2, mxREAL);
+            int m = length[i];
+
+            mxArray* tmp = mxCreateDoubleMatrix(m, nd, mxREAL);
             double* p = mxGetPr(tmp);
-            
+            const double* src = m > 0 ? &pts_buf[thread[i]][0] + start[i]*nd : NULL;
+
             for (int j = 0; j < m; ++j)
             {
-                const vector<2,double> & pt = pts_list[i][j];
-                
-                p[j] = pt[0] + 1;
-                p[j + m] = pt[1] + 1;
+                for (int d = 0; d < nd; ++d)
+                    p[j + d*m] = src[j*nd + d] + 1;
             }
-            
+
             mxSetCell(plhs[0], i, tmp);
         }
     }
-    
+
     if (nlhs > 1)
     {
         plhs[1] = mxCreateCellMatrix(n,1);
-        
+
         for (int i = 0; i < n; ++i)
         {
-            int m = values_list[i].size();
-            
+            int m = length[i];
+
             mxArray* tmp = mxCreateDoubleMatrix(m, 1, mxREAL);
             double * p = mxGetPr(tmp);
-            
+
             for (int j = 0; j < m; ++j)
-                p[j] = values_list[i][j];
-            
+                p[j] = values_buf[thread[i]][start[i] + j];
+
             mxSetCell(plhs[1], i, tmp);
         }
     }
@@ -1,9 +1,13 @@
-function [pts,values] = gradientDescent(F,X,Y) %#ok<STOUT,INUSD>
+function [pts,values,offsets] = gradientDescent(F,X,Y,varargin) %#ok<STOUT,INUSD>
 % Usage: [pts,values] = gradientDescent(F,X,Y)
+%        [pts,values] = gradientDescent(F,X,Y,Z)
+%        [pts,values,offsets] = gradientDescent(F,X,Y,{Z},'csr')
 %
 % This function returns the paths along the steepest gradient of a 2D
-% function F, starting from point X,Y. The number of paths returns is
-% equivalent to size(X,1). vectors X and Y must be the same size.
+% or 3D function F, starting from point X,Y(,Z). The number of paths returns is
+% equivalent to numel(X). vectors X, Y (and Z) must be the same size.
+% All paths are traced at once, in parallel, from a gradient of F
+% computed once.
 %
 % Outputs:
 % pts          a cell array of size(X,1) elements. Each element is a 2D
@@ -15,6 +19,12 @@ function [pts,values] = gradientDescent(F,X,Y) %#ok<STOUT,INUSD>
 %              function F. Subpixellic values are obtained by bilinear
 %              interpolation.
 %
+% With 'csr', the paths are concatenated:
+% pts          [M x 2] or [M x 3] matrix of the points of all paths.
+% values       [M x 1] vector of the values of F.
+% offsets      [numel(X)+1 x 1] vector: the ith path is
+%              pts(offsets(i):offsets(i+1)-1,:).
+%
 % e.g:
 %
 % % Get a mask
@@ -0,0 +1,132 @@
+/* [lmIdx, lmVal] = locmaxnd(img, wdims, mask, threshold, clearBorder, keepFlat);
+ *
+ * Local maxima detection in 2D and 3D, based on a separable van Herk/Gil-Werman max-filter.
+ * See locmaxnd.m for documentation.
+ *
+ * Compilation:
+ * Mac/Linux: mex -I../../mex/include CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp" locmaxnd.cpp
+ * Windows: mex COMPFLAGS="$COMPFLAGS /TP /MT /openmp" -I"..\..\mex\include" -output locmaxnd locmaxnd.cpp
+ */
+
+#include <cmath>
+#include <vector>
+#include <limits>
+#include "mex.h"
+#include "maxFilter.h"
+
+using namespace std;
+
+
+template<typename T>
+void detect(const mxArray* img, const int nd, const int* dims, const int* r, const bool* mask,
+            const double threshold, const bool clearBorder, const bool keepFlat, vector<size_t>& idx, mxArray*& values) {
+
+    const T* input = (const T*)mxGetData(img);
+    size_t N = mxGetNumberOfElements(img);
+    T* buffer = new T[N];
+    T th = threshold < -numeric_limits<T>::max() ? -numeric_limits<T>::max() : (T)threshold;
+    findLocalMaxima(input, nd, dims, r, mask, th, clearBorder, keepFlat, buffer, idx);
+    delete[] buffer;
+
+    size_t nm = idx.size();
+    values = mxCreateNumericMatrix(nm, 1, mxGetClassID(img), mxREAL);
+    T* v = (T*)mxGetData(values);
+    for (size_t i=0;i<nm;++i) {
+        v[i] = input[idx[i]];
+    }
+}
+
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+    if (nrhs < 2 || nrhs > 6)
+        mexErrMsgTxt("Required inputs: image, window size. Optional: mask, threshold, clearBorder, keepFlat.");
+    if (nlhs > 2)
+        mexErrMsgTxt("Too many output arguments.");
+
+    if (!mxIsDouble(prhs[0]) && !mxIsSingle(prhs[0]))
+        mexErrMsgTxt("Input must be a double or single array.");
+    int nd = mxGetNumberOfDimensions(prhs[0]);
+    if (nd > 3)
+        mexErrMsgTxt("Input must be a 2D or 3D array.");
+    const mwSize* mdims = mxGetDimensions(prhs[0]);
+    int dims[3] = {(int)mdims[0], (int)mdims[1], nd==3 ? (int)mdims[2] : 1};
+    size_t N = mxGetNumberOfElements(prhs[0]);
+
+    // window size: [wx wy wz], i.e., (columns, rows, slices)
+    if (!mxIsDouble(prhs[1]))
+        mexErrMsgTxt("Window size must be a double scalar or vector.");
+    size_t nw = mxGetNumberOfElements(prhs[1]);
+    if (nw!=1 && nw!=(size_t)nd)
+        mexErrMsgTxt("Window size must be a scalar or a vector with one element per dimension.");
+    double* w = mxGetPr(prhs[1]);
+    double wx = w[0];
+    double wy = nw==1 ? w[0] : w[1];
+    double wz = nw==1 ? w[0] : (nd==3 ? w[2] : 1.0);
+    if (wx<1 || wy<1 || wz<1 || wx!=floor(wx) || wy!=floor(wy) || wz!=floor(wz) ||
+        (int)wx%2==0 || (int)wy%2==0 || (int)wz%2==0)
+        mexErrMsgTxt("Window dimensions must be odd integers.");
+    // (rows, columns, slices)
+    int r[3] = {(int)(wy-1)/2, (int)(wx-1)/2, (int)(wz-1)/2};
+
+    // mask
+    const bool* mask = NULL;
+    bool* maskBuffer = NULL;
+    if (nrhs > 2 && !mxIsEmpty(prhs[2])) {
+        if (mxGetNumberOfElements(prhs[2])!=N)
+            mexErrMsgTxt("The mask must have the same size as the input.");
+        if (mxIsLogical(prhs[2])) {
+            mask = mxGetLogicals(prhs[2]);
+        } else if (mxIsDouble(prhs[2])) {
+            double* m = mxGetPr(prhs[2]);
+            maskBuffer = new bool[N];
+            for (size_t i=0;i<N;++i) {
+                maskBuffer[i] = m[i]!=0.0;
+            }
+            mask = maskBuffer;
+        } else {
+            mexErrMsgTxt("The mask must be a logical or double array.");
+        }
+    }
+
+    double threshold = -numeric_limits<double>::infinity();
+    if (nrhs > 3 && !mxIsEmpty(prhs[3])) {
+        if (!mxIsDouble(prhs[3]) || mxGetNumberOfElements(prhs[3])!=1)
+            mexErrMsgTxt("The threshold must be a scalar.");
+        threshold = mxGetScalar(prhs[3]);
+    }
+
+    bool clearBorder = true;
+    if (nrhs > 4 && !mxIsEmpty(prhs[4])) {
+        clearBorder = mxGetScalar(prhs[4])!=0.0;
+    }
+
+    bool keepFlat = false;
+    if (nrhs > 5 && !mxIsEmpty(prhs[5])) {
+        keepFlat = mxGetScalar(prhs[5])!=0.0;
+    }
+
+    vector<size_t> idx;
+    mxArray* values;
+    if (mxIsDouble(prhs[0])) {
+        detect<double>(prhs[0], nd, dims, r, mask, threshold, clearBorder, keepFlat, idx, values);
+    } else {
+        detect<float>(prhs[0], nd, dims, r, mask, threshold, clearBorder, keepFlat, idx, values);
+    }
+    if (maskBuffer!=NULL) {
+        delete[] maskBuffer;
+    }
+
+    // 1-based linear indexes
+    size_t nm = idx.size();
+    plhs[0] = mxCreateDoubleMatrix(nm, 1, mxREAL);
+    double* lmIdx = mxGetPr(plhs[0]);
+    for (size_t i=0;i<nm;++i) {
+        lmIdx[i] = (double)(idx[i]+1);
+    }
+    if (nlhs > 1) {
+        plhs[1] = values;
+    } else {
+        mxDestroyArray(values);
+    }
+}
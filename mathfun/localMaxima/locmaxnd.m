@@ -0,0 +1,77 @@
+%[lmIdx, lmVal] = locmaxnd(img, wdims, mask, threshold, clearBorder, keepFlat) returns the local maxima of a 2D or 3D array
+%
+% Inputs:
+%           img : 2D or 3D input array (double or single)
+%         wdims : window size, scalar or vector [wx wy (wz)]. Dimensions must be odd integers.
+%        {mask} : logical array, only local maxima where mask~=0 are returned. Default: all.
+%   {threshold} : only local maxima >= threshold are returned. Default: -Inf.
+% {clearBorder} : {true}|false. Discard maxima within half a window of the array border.
+%    {keepFlat} : true|{false}. Keep maxima that are not unique within their window.
+%
+% Outputs:
+%         lmIdx : linear indexes of the local maxima, in ascending order
+%         lmVal : values of the local maxima
+%
+% Unlike locmax2d/locmax3d, the windows are truncated at the array borders.
+% This file is a reference implementation; the compiled MEX function (locmaxnd.cpp),
+% which uses a van Herk/Gil-Werman max-filter, takes precedence when available.
+%
+% See also locmax2d, locmax3d
+
+function [lmIdx, lmVal] = locmaxnd(img, wdims, mask, threshold, clearBorder, keepFlat)
+
+if nargin<3
+    mask = [];
+end
+if nargin<4 || isempty(threshold)
+    threshold = -Inf;
+end
+if nargin<5 || isempty(clearBorder)
+    clearBorder = true;
+end
+if nargin<6 || isempty(keepFlat)
+    keepFlat = false;
+end
+
+nd = ndims(img);
+if numel(wdims)==1
+    wdims = wdims*ones(1,nd);
+end
+if any(wdims<1 | mod(wdims,2)~=1)
+    error('Window dimensions must be odd integers.');
+end
+% window in (rows, columns, slices)
+w = ones(1,3);
+w(1:nd) = wdims([2 1 3:nd]);
+r = (w-1)/2;
+
+lm = imdilate(img, true(w(1:nd))); % pads with -Inf
+lmIdx = find(lm==img & img>=threshold);
+if ~isempty(mask)
+    lmIdx = lmIdx(mask(lmIdx)~=0);
+end
+
+[ny,nx,nz] = size(img);
+[y,x,z] = ind2sub([ny nx nz], lmIdx);
+if clearBorder
+    idx = y>r(1) & y<=ny-r(1) & x>r(2) & x<=nx-r(2) & z>r(3) & z<=nz-r(3);
+    lmIdx = lmIdx(idx);
+    y = y(idx); x = x(idx); z = z(idx);
+end
+
+if ~keepFlat
+    % count window elements equal to the maximum
+    v = img(lmIdx);
+    count = zeros(size(lmIdx));
+    for dz = -r(3):r(3)
+        for dx = -r(2):r(2)
+            for dy = -r(1):r(1)
+                yi = y+dy; xi = x+dx; zi = z+dz;
+                valid = yi>=1 & yi<=ny & xi>=1 & xi<=nx & zi>=1 & zi<=nz;
+                count(valid) = count(valid) + (img(sub2ind([ny nx nz], yi(valid), xi(valid), zi(valid)))==v(valid));
+            end
+        end
+    end
+    lmIdx = lmIdx(count==1);
+end
+lmVal = img(lmIdx);
@@ -0,0 +1,788 @@
+/* Batched nonlinear least-squares fitting of parametric models to image windows
+ *
+ * Common framework for the fitters in detectionAlgorithms (fitGaussian2D, fitGaussianMixture2D,
+ * fitAnisoGaussian2D, fitSegment2D, fitGaussian3D, fitGaussianMixture3D). Input parsing,
+ * NaN masking, the Levenberg-Marquardt iterations (GSL lmsder), convergence tests, covariance
+ * estimation, residual statistics and output packing are implemented here; a model only
+ * defines its parameter vector and evaluates the residuals and Jacobian (see FitModel).
+ *
+ * Usage in a MEX file:
+ *   void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+ *       fitWindows<MyModel>(nlhs, plhs, nrhs, prhs);
+ *   }
+ * with the inputs (image, prmVect, mode, {options}, {search}). If 'image' is a cell array of
+ * windows, 'prmVect' must be a matrix with one row per window (or a cell array of vectors),
+ * and all windows are fitted in parallel (OpenMP). Outputs are then returned as matrices with
+ * one row per window (parameters and their standard deviations), cell arrays (covariance
+ * matrices, Jacobians) and struct arrays (residuals). Windows with fewer valid pixels than
+ * parameters to estimate return NaN.
+ *
+ * GSL workspaces are allocated once per thread and reused for all windows with the same
+ * number of valid pixels and parameters.
+ */
+
+#ifndef BATCHFIT_H
+#define BATCHFIT_H
+
+#include <cmath>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <limits>
+
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_blas.h>
+#include <gsl/gsl_multifit_nlin.h>
+
+#include "mex.h"
+#include "stats.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+// Convergence: iterate until ...
+enum StopCriterion {
+    STOP_DELTA,                // ... the step size test is met
+    STOP_DELTA_AND_GRADIENT,   // ... both the step size and gradient tests are met
+    STOP_DELTA_OR_GRADIENT     // ... either test is met
+};
+
+// Format of the 'residuals' output
+enum ResidualFormat {
+    RES_ARRAY,                 // residual array only
+    RES_STRUCT_AD,             // struct with fields data, hAD (logical), mean, std, RSS
+    RES_STRUCT_AD_DOUBLE,      // idem, hAD as double
+    RES_STRUCT_KS              // struct with fields data, pval (K-S test), mean, std, RSS
+};
+
+
+// Image window with its valid (non-NaN) pixels
+class FitWindow {
+public:
+    const double* pixels;
+    int ny, nx, nz;
+    std::vector<int> idx;      // linear indexes of the valid pixels
+    std::vector<int> x, y, z;  // 0-based column, row, slice of the valid pixels
+
+    FitWindow() : pixels(NULL), ny(0), nx(0), nz(0) {}
+
+    void set(const double* p, const int nrows, const int ncols, const int nslices) {
+        pixels = p;
+        ny = nrows;
+        nx = ncols;
+        nz = nslices;
+        int N = numel();
+        idx.clear(); x.clear(); y.clear(); z.clear();
+        int nxy = nx*ny;
+        for (int i=0; i<N; ++i) {
+            if (p[i]==p[i]) { // not NaN
+                idx.push_back(i);
+                z.push_back(i/nxy);
+                x.push_back((i%nxy)/ny);
+                y.push_back(i%ny);
+            }
+        }
+    }
+
+    int numel() const { return nx*ny*nz; }
+    int nValid() const { return (int)idx.size(); }
+};
+
+
+// Search settings for mixture models: components are added until the F-test at level 'alpha'
+// is no longer significant, a component leaves the region defined by 'bounds' (model-specific),
+// or the model contains maxM components.
+struct FitOptions {
+    int maxIter;
+    double eAbs, eRel;
+    std::string mode;
+    int maxM;
+    double alpha;
+    std::vector<double> bounds;
+
+    FitOptions() : maxIter(500), eAbs(1e-8), eRel(1e-8), maxM(0), alpha(0.05) {}
+};
+
+
+// Fit of a single window
+struct FitResult {
+    std::vector<double> prm;        // full parameter vector
+    std::vector<int> estIdx;        // indexes of the estimated parameters
+    std::vector<double> residuals;  // model - data, for the valid pixels
+    std::vector<double> J;          // Jacobian, row-major (nValid x nparam)
+    std::vector<double> covar;      // covariance matrix (nparam x nparam)
+    std::vector<double> prmStd;     // standard deviations of the estimated parameters
+    double RSS, resMean, resStd, pval; // residual sum of squares, mean, std, and K-S p-value
+    unsigned char hAD;                 // A-D test result
+    bool valid;
+
+    FitResult() : RSS(0.0), resMean(0.0), resStd(0.0), pval(0.0), hAD(0), valid(false) {}
+    int nparam() const { return (int)estIdx.size(); }
+};
+
+
+// Base class for models. A model must define (hiding the defaults below where needed):
+//   static const int nd                        window dimensionality (2 or 3)
+//   static const int stop, residualFormat      StopCriterion and ResidualFormat
+//   static const bool expandStd                prmStd: all parameters (zeros if fixed) or estimated only
+//   static bool readParameters(const double* v, int n, std::vector<double>& prm)
+//   static bool selectParameters(const char* mode, int np, std::vector<int>& estIdx)
+//        returns false if no parameter is selected
+//   void evaluate(const FitWindow& w, const double* prm, int np, const int* estIdx, int nparam,
+//                 double* f, double* J)
+//        residuals f = model - data (size nValid) and Jacobian J (row-major, nValid x nparam),
+//        either may be NULL
+// Mixture models additionally define componentSize > 0 (parameters per component, stored first),
+// sharedSize (parameters common to all components, stored last), componentModes, searchFormat,
+// checkSearch(), initComponent() and inBounds().
+class FitModel {
+public:
+    static const int nd = 2;
+    static const int stop = STOP_DELTA_AND_GRADIENT;
+    static const int residualFormat = RES_STRUCT_AD;
+    static const bool expandStd = false;
+    static const int componentSize = 0;
+    static const int sharedSize = 0;
+
+    static const char* checkWindow(const FitWindow& /*w*/) { return NULL; }
+    static void finalize(double* /*prm*/, const int /*np*/) {}
+
+    // mode characters of the component parameters, and format of the search input
+    static const char* componentModes() { return ""; }
+    static const char* searchFormat() { return ""; }
+    // true if 'ns' is a valid number of elements for the search input
+    static bool checkSearch(const int /*ns*/) { return false; }
+    // initial values of a new component at valid pixel i, with amplitude A
+    static void initComponent(const FitWindow& /*w*/, const int /*i*/, const double /*A*/, double* /*comp*/) {}
+    // true if all components of prm are within bounds
+    static bool inBounds(const double* /*prm*/, const int /*ng*/, const std::vector<double>& /*bounds*/) { return true; }
+};
+
+
+// Per-thread GSL workspaces, reused across fits with identical dimensions
+class FitWorkspace {
+public:
+    FitWorkspace() {}
+
+    ~FitWorkspace() {
+        std::map<std::pair<size_t,size_t>, gsl_multifit_fdfsolver*>::iterator it;
+        for (it=solvers_.begin(); it!=solvers_.end(); ++it) {
+            gsl_multifit_fdfsolver_free(it->second);
+        }
+        std::map<size_t, gsl_vector*>::iterator gt;
+        for (gt=gradients_.begin(); gt!=gradients_.end(); ++gt) {
+            gsl_vector_free(gt->second);
+        }
+        std::map<size_t, gsl_matrix*>::iterator ct;
+        for (ct=covariances_.begin(); ct!=covariances_.end(); ++ct) {
+            gsl_matrix_free(ct->second);
+        }
+    }
+
+    gsl_multifit_fdfsolver* solver(const size_t n, const size_t p) {
+        std::pair<size_t,size_t> key(n, p);
+        std::map<std::pair<size_t,size_t>, gsl_multifit_fdfsolver*>::iterator it = solvers_.find(key);
+        if (it!=solvers_.end()) {
+            return it->second;
+        }
+        gsl_multifit_fdfsolver* s = gsl_multifit_fdfsolver_alloc(gsl_multifit_fdfsolver_lmsder, n, p);
+        solvers_[key] = s;
+        return s;
+    }
+
+    gsl_vector* gradient(const size_t p) {
+        std::map<size_t, gsl_vector*>::iterator it = gradients_.find(p);
+        if (it!=gradients_.end()) {
+            return it->second;
+        }
+        return gradients_[p] = gsl_vector_alloc(p);
+    }
+
+    gsl_matrix* covariance(const size_t p) {
+        std::map<size_t, gsl_matrix*>::iterator it = covariances_.find(p);
+        if (it!=covariances_.end()) {
+            return it->second;
+        }
+        return covariances_[p] = gsl_matrix_alloc(p, p);
+    }
+
+    std::vector<double> f, J;  // evaluation buffers
+
+private:
+    FitWorkspace(const FitWorkspace&);
+    FitWorkspace& operator=(const FitWorkspace&);
+
+    std::map<std::pair<size_t,size_t>, gsl_multifit_fdfsolver*> solvers_;
+    std::map<size_t, gsl_vector*> gradients_;
+    std::map<size_t, gsl_matrix*> covariances_;
+};
+
+
+template<class Model>
+class BatchFitter {
+
+public:
+    BatchFitter(const FitOptions& opts) : opts_(opts) {}
+
+    // Fits one window; the initial parameters and estIdx must be set in 'r'
+    void fit(const FitWindow& w, FitResult& r, const bool stats) {
+        r.valid = w.nValid() > r.nparam();
+        if (!r.valid) {
+            return;
+        }
+        optimize(w, r);
+        if (Model::componentSize > 0 && opts_.maxM > numComponents(r)) {
+            searchModelOrder(w, r);
+        }
+        Model::finalize(&r.prm[0], (int)r.prm.size());
+        if (stats) {
+            statistics(w, r);
+        }
+    }
+
+private:
+    struct Context {
+        BatchFitter* fitter;
+        const FitWindow* w;
+        FitResult* r;
+    };
+
+    const FitOptions& opts_;
+    Model model_;
+    FitWorkspace ws_;
+
+
+public:
+    // number of components of a mixture model
+    static int numComponents(const FitResult& r) {
+        return ((int)r.prm.size()-Model::sharedSize)/Model::componentSize;
+    }
+
+private:
+
+
+    // copy the current estimates into the parameter vector
+    static void update(const gsl_vector* x, FitResult& r) {
+        int nparam = r.nparam();
+        for (int k=0; k<nparam; ++k) {
+            r.prm[r.estIdx[k]] = gsl_vector_get(x, k);
+        }
+    }
+
+    void eval(const FitWindow& w, FitResult& r, gsl_vector* f, gsl_matrix* J) {
+        int n = w.nValid();
+        int p = r.nparam();
+        // evaluate directly into the GSL storage if it is contiguous
+        double* fp = NULL;
+        double* Jp = NULL;
+        if (f!=NULL) {
+            if (f->stride==1) {
+                fp = f->data;
+            } else {
+                ws_.f.resize(n);
+                fp = &ws_.f[0];
+            }
+        }
+        if (J!=NULL) {
+            if ((int)J->tda==p) {
+                Jp = J->data;
+            } else {
+                ws_.J.resize((size_t)n*p);
+                Jp = &ws_.J[0];
+            }
+        }
+        model_.evaluate(w, &r.prm[0], (int)r.prm.size(), &r.estIdx[0], p, fp, Jp);
+        if (f!=NULL && fp!=f->data) {
+            for (int i=0; i<n; ++i) {
+                gsl_vector_set(f, i, fp[i]);
+            }
+        }
+        if (J!=NULL && Jp!=J->data) {
+            for (int i=0; i<n; ++i) {
+                for (int k=0; k<p; ++k) {
+                    gsl_matrix_set(J, i, k, Jp[i*p+k]);
+                }
+            }
+        }
+    }
+
+    static int f(const gsl_vector* x, void* params, gsl_vector* f) {
+        Context* c = (Context*)params;
+        update(x, *c->r);
+        c->fitter->eval(*c->w, *c->r, f, NULL);
+        return GSL_SUCCESS;
+    }
+
+    static int df(const gsl_vector* x, void* params, gsl_matrix* J) {
+        Context* c = (Context*)params;
+        update(x, *c->r);
+        c->fitter->eval(*c->w, *c->r, NULL, J);
+        return GSL_SUCCESS;
+    }
+
+    static int fdf(const gsl_vector* x, void* params, gsl_vector* f, gsl_matrix* J) {
+        Context* c = (Context*)params;
+        update(x, *c->r);
+        c->fitter->eval(*c->w, *c->r, f, J);
+        return GSL_SUCCESS;
+    }
+
+
+    // Levenberg-Marquardt optimization of the parameters r.estIdx, starting from r.prm
+    void optimize(const FitWindow& w, FitResult& r) {
+        size_t n = w.nValid();
+        size_t p = r.nparam();
+
+        std::vector<double> xInit(p);
+        for (size_t k=0; k<p; ++k) {
+            xInit[k] = r.prm[r.estIdx[k]];
+        }
+        gsl_vector_view x = gsl_vector_view_array(&xInit[0], p);
+
+        Context c;
+        c.fitter = this;
+        c.w = &w;
+        c.r = &r;
+
+        gsl_multifit_function_fdf fn;
+        fn.f = &BatchFitter::f;
+        fn.df = &BatchFitter::df;
+        fn.fdf = &BatchFitter::fdf;
+        fn.n = n;
+        fn.p = p;
+        fn.params = &c;
+
+        gsl_multifit_fdfsolver* s = ws_.solver(n, p);
+        gsl_vector* gradt = ws_.gradient(p);
+        gsl_multifit_fdfsolver_set(s, &fn, &x.vector);
+
+        int status, status2 = GSL_SUCCESS;
+        int iter = 0;
+        bool done;
+        do {
+            iter++;
+            status = gsl_multifit_fdfsolver_iterate(s);
+            if (status) {
+                break;
+            }
+            status = gsl_multifit_test_delta(s->dx, s->x, opts_.eAbs, opts_.eRel);
+            if (Model::stop!=STOP_DELTA) {
+                gsl_multifit_gradient(s->J, s->f, gradt);
+                status2 = gsl_multifit_test_gradient(gradt, opts_.eAbs);
+            }
+            if (Model::stop==STOP_DELTA_OR_GRADIENT) {
+                done = status!=GSL_CONTINUE || status2!=GSL_CONTINUE;
+            } else {
+                done = status!=GSL_CONTINUE && status2!=GSL_CONTINUE;
+            }
+        } while (!done && iter < opts_.maxIter);
+
+        update(s->x, r);
+
+        // copy residuals and Jacobian
+        r.residuals.resize(n);
+        r.J.resize(n*p);
+        r.RSS = 0.0;
+        for (size_t i=0; i<n; ++i) {
+            r.residuals[i] = gsl_vector_get(s->f, i);
+            r.RSS += r.residuals[i]*r.residuals[i];
+            for (size_t k=0; k<p; ++k) {
+                r.J[i*p+k] = gsl_matrix_get(s->J, i, k);
+            }
+        }
+    }
+
+
+    // Model order search for mixture models: add components at the peak of the residual
+    // (data - model), initialized with the current solution, while the F-test is significant
+    void searchModelOrder(const FitWindow& w, FitResult& r) {
+        const int cs = Model::componentSize;
+        int n = w.nValid();
+        FitResult reduced;
+
+        while (numComponents(r) < opts_.maxM) {
+            std::swap(reduced.prm, r.prm);
+            std::swap(reduced.estIdx, r.estIdx);
+            std::swap(reduced.residuals, r.residuals);
+            std::swap(reduced.J, r.J);
+            reduced.RSS = r.RSS;
+
+            int k = (int)(std::min_element(reduced.residuals.begin(), reduced.residuals.end()) - reduced.residuals.begin());
+            r.prm.resize(reduced.prm.size()+cs);
+            Model::initComponent(w, k, -reduced.residuals[k], &r.prm[0]);
+            std::copy(reduced.prm.begin(), reduced.prm.end(), r.prm.begin()+cs);
+            Model::selectParameters(opts_.mode.c_str(), (int)r.prm.size(), r.estIdx);
+
+            bool valid = n > r.nparam();
+            double pval = 1.0;
+            if (valid) {
+                optimize(w, r);
+                int p_r = reduced.nparam();
+                int p_f = r.nparam();
+                int df2 = n - p_f - 1;
+                if (df2 > 0 && r.RSS > 0.0 && r.RSS < reduced.RSS) {
+                    double T = (reduced.RSS-r.RSS)/r.RSS * df2/(p_f-p_r);
+                    pval = 1.0 - fcdf(T, p_f-p_r, df2);
+                }
+            }
+            if (!valid || !(pval < opts_.alpha) || !Model::inBounds(&r.prm[0], numComponents(r), opts_.bounds)) {
+                // revert to the reduced model
+                std::swap(reduced.prm, r.prm);
+                std::swap(reduced.estIdx, r.estIdx);
+                std::swap(reduced.residuals, r.residuals);
+                std::swap(reduced.J, r.J);
+                r.RSS = reduced.RSS;
+                break;
+            }
+        }
+    }
+
+
+    // covariance, standard deviations, and residual statistics
+    void statistics(const FitWindow& w, FitResult& r) {
+        int n = w.nValid();
+        int p = r.nparam();
+
+        gsl_matrix_view J = gsl_matrix_view_array(&r.J[0], n, p);
+        gsl_matrix* covar = ws_.covariance(p);
+        gsl_multifit_covar(&J.matrix, 0.0, covar);
+        r.covar.resize(p*p);
+        r.prmStd.resize(p);
+        double iRSS = r.RSS/(n - p - 1);
+        for (int i=0; i<p; ++i) {
+            for (int k=0; k<p; ++k) {
+                r.covar[i*p+k] = gsl_matrix_get(covar, i, k);
+            }
+            r.prmStd[i] = sqrt(iRSS*r.covar[i*p+i]);
+        }
+
+        double mean = 0.0;
+        for (int i=0; i<n; ++i) {
+            mean += r.residuals[i];
+        }
+        r.resStd = sqrt((r.RSS-mean*mean/n)/(n-1));
+        r.resMean = mean/n;
+        if (Model::residualFormat==RES_STRUCT_KS) {
+            r.pval = ksone(&r.residuals[0], n, r.resMean, r.resStd);
+        } else if (Model::residualFormat!=RES_ARRAY) {
+            // A-D test, case 2: mean known
+            r.hAD = adtest(&r.residuals[0], n, 2, 0.0, r.resStd, 0.05);
+        }
+    }
+};
+
+
+// Output packing
+
+inline mxArray* createWindowArray(const FitWindow& w, const int nd) {
+    if (nd==3) {
+        mwSize dims[3] = {(mwSize)w.ny, (mwSize)w.nx, (mwSize)w.nz};
+        return mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+    }
+    return mxCreateDoubleMatrix(w.ny, w.nx, mxREAL);
+}
+
+// residuals at valid pixels, NaN elsewhere
+inline mxArray* packResiduals(const FitWindow& w, const FitResult& r, const int nd) {
+    mxArray* a = createWindowArray(w, nd);
+    double* res = mxGetPr(a);
+    int N = w.numel();
+    for (int i=0; i<N; ++i) {
+        res[i] = mxGetNaN();
+    }
+    if (r.valid) {
+        int n = w.nValid();
+        for (int i=0; i<n; ++i) {
+            res[w.idx[i]] = r.residuals[i];
+        }
+    }
+    return a;
+}
+
+// expand the Jacobian from (nValid x nparam), row-major, to (N x nparam), column-major
+inline mxArray* packJacobian(const FitWindow& w, const FitResult& r) {
+    int N = w.numel();
+    int n = w.nValid();
+    int p = r.nparam();
+    mxArray* a = mxCreateDoubleMatrix(N, p, mxREAL);
+    double* J = mxGetPr(a);
+    for (int i=0; i<N*p; ++i) {
+        J[i] = mxGetNaN();
+    }
+    if (r.valid) {
+        for (int k=0; k<p; ++k) {
+            for (int i=0; i<n; ++i) {
+                J[w.idx[i]+k*N] = r.J[i*p+k];
+            }
+        }
+    }
+    return a;
+}
+
+inline mxArray* packCovariance(const FitResult& r) {
+    int p = r.nparam();
+    mxArray* a = mxCreateDoubleMatrix(p, p, mxREAL);
+    double* C = mxGetPr(a);
+    for (int i=0; i<p*p; ++i) {
+        // symmetric, no need to transpose
+        C[i] = r.valid ? r.covar[i] : mxGetNaN();
+    }
+    return a;
+}
+
+// standard deviations, either of the estimated parameters, or expanded to all parameters
+// (no MEX API calls: also used on worker threads, see pointSourceDetectionMovie)
+inline void getStd(const FitResult& r, const bool expand, std::vector<double>& s) {
+    int p = r.nparam();
+    if (expand) {
+        s.assign(r.prm.size(), 0.0);
+        for (int k=0; k<p; ++k) {
+            s[r.estIdx[k]] = r.valid ? r.prmStd[k] : std::numeric_limits<double>::quiet_NaN();
+        }
+    } else {
+        s.assign(p, std::numeric_limits<double>::quiet_NaN());
+        if (r.valid) {
+            std::copy(r.prmStd.begin(), r.prmStd.end(), s.begin());
+        }
+    }
+}
+
+// single window: row vector; batch: matrix with one row per window if all rows have the same
+// length (e.g., the model order search may retain different numbers of components), otherwise
+// a cell array with the dimensions of 'shape'
+inline mxArray* packRows(const std::vector< std::vector<double> >& rows, const bool batch, bool asCell, const mxArray* shape) {
+    size_t nw = rows.size();
+    if (!batch) {
+        mxArray* v = mxCreateDoubleMatrix(1, rows[0].size(), mxREAL);
+        std::copy(rows[0].begin(), rows[0].end(), mxGetPr(v));
+        return v;
+    }
+    for (size_t i=1; i<nw && !asCell; ++i) {
+        asCell = rows[i].size()!=rows[0].size();
+    }
+    if (asCell) {
+        mxArray* c = mxCreateCellArray(mxGetNumberOfDimensions(shape), mxGetDimensions(shape));
+        for (size_t i=0; i<nw; ++i) {
+            mxArray* v = mxCreateDoubleMatrix(1, rows[i].size(), mxREAL);
+            std::copy(rows[i].begin(), rows[i].end(), mxGetPr(v));
+            mxSetCell(c, i, v);
+        }
+        return c;
+    }
+    size_t m = nw>0 ? rows[0].size() : 0;
+    mxArray* a = mxCreateDoubleMatrix(nw, m, mxREAL);
+    double* v = mxGetPr(a);
+    for (size_t i=0; i<nw; ++i) {
+        for (size_t k=0; k<m; ++k) {
+            v[i+k*nw] = rows[i][k];
+        }
+    }
+    return a;
+}
+
+
+template<class Model>
+mxArray* packResidualOutput(const std::vector<FitWindow>& windows, const std::vector<FitResult>& results,
+                            const bool batch, const mxArray* shape) {
+    size_t nw = windows.size();
+    if (Model::residualFormat==RES_ARRAY) {
+        if (!batch) {
+            return packResiduals(windows[0], results[0], Model::nd);
+        }
+        mxArray* c = mxCreateCellArray(mxGetNumberOfDimensions(shape), mxGetDimensions(shape));
+        for (size_t i=0; i<nw; ++i) {
+            mxSetCell(c, i, packResiduals(windows[i], results[i], Model::nd));
+        }
+        return c;
+    }
+    const char* fieldnames[] = {"data", Model::residualFormat==RES_STRUCT_KS ? "pval" : "hAD", "mean", "std", "RSS"};
+    mxArray* s;
+    if (batch) {
+        s = mxCreateStructArray(mxGetNumberOfDimensions(shape), mxGetDimensions(shape), 5, fieldnames);
+    } else {
+        mwSize dims[2] = {1, 1};
+        s = mxCreateStructArray(2, dims, 5, fieldnames);
+    }
+    for (size_t i=0; i<nw; ++i) {
+        const FitResult& r = results[i];
+        double nan = mxGetNaN();
+        mxSetFieldByNumber(s, i, 0, packResiduals(windows[i], r, Model::nd));
+        if (Model::residualFormat==RES_STRUCT_KS) {
+            mxSetFieldByNumber(s, i, 1, mxCreateDoubleScalar(r.valid ? r.pval : nan));
+        } else if (Model::residualFormat==RES_STRUCT_AD) {
+            mxSetFieldByNumber(s, i, 1, mxCreateLogicalScalar(r.hAD!=0));
+        } else {
+            mxSetFieldByNumber(s, i, 1, mxCreateDoubleScalar(r.valid ? r.hAD : nan));
+        }
+        mxSetFieldByNumber(s, i, 2, mxCreateDoubleScalar(r.valid ? r.resMean : nan));
+        mxSetFieldByNumber(s, i, 3, mxCreateDoubleScalar(r.valid ? r.resStd : nan));
+        mxSetFieldByNumber(s, i, 4, mxCreateDoubleScalar(r.valid ? r.RSS : nan));
+    }
+    return s;
+}
+
+
+// MEX entry point: [prmVect prmStd covarianceMatrix residuals Jacobian] = fit(image, prmVect, mode, {options}, {search})
+template<class Model>
+void fitWindows(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+    if (nrhs < 3) mexErrMsgTxt("Inputs should be: data, prmVect, mode.");
+    if (nrhs > 5) mexErrMsgTxt("Too many inputs.");
+    if (nlhs > 5) mexErrMsgTxt("Too many outputs.");
+
+    // windows
+    bool batch = mxIsCell(prhs[0]);
+    int nw = batch ? (int)mxGetNumberOfElements(prhs[0]) : 1;
+    std::vector<FitWindow> windows(nw);
+    for (int i=0; i<nw; ++i) {
+        const mxArray* a = batch ? mxGetCell(prhs[0], i) : prhs[0];
+        if (a==NULL || !mxIsDouble(a) || mxIsComplex(a)) mexErrMsgTxt("Data input must be double array.");
+        int ndims = (int)mxGetNumberOfDimensions(a);
+        if (Model::nd==3 && ndims!=3) mexErrMsgTxt("Input data must be 3D.");
+        if (Model::nd==2 && ndims!=2) mexErrMsgTxt("Input data must be 2D.");
+        const mwSize* dims = mxGetDimensions(a);
+        windows[i].set(mxGetPr(a), (int)dims[0], (int)dims[1], ndims==3 ? (int)dims[2] : 1);
+        const char* msg = Model::checkWindow(windows[i]);
+        if (msg!=NULL) mexErrMsgTxt(msg);
+    }
+
+    // initial parameters
+    if (!mxIsDouble(prhs[1]) && !mxIsCell(prhs[1])) mexErrMsgTxt("Parameter vector must be double array.");
+    bool prmCell = mxIsCell(prhs[1]);
+    if (prmCell && (!batch || (int)mxGetNumberOfElements(prhs[1])!=nw)) mexErrMsgTxt("Incorrect parameter vector format.");
+    if (!prmCell && batch && (int)mxGetM(prhs[1])!=nw) mexErrMsgTxt("The parameter matrix must contain one row per window.");
+    std::vector<FitResult> results(nw);
+    std::vector<double> v;
+    for (int i=0; i<nw; ++i) {
+        const double* p;
+        int n;
+        if (prmCell) {
+            const mxArray* a = mxGetCell(prhs[1], i);
+            if (a==NULL || !mxIsDouble(a)) mexErrMsgTxt("Incorrect parameter vector format.");
+            p = mxGetPr(a);
+            n = (int)mxGetNumberOfElements(a);
+        } else if (batch) {
+            n = (int)mxGetN(prhs[1]);
+            v.resize(n);
+            double* m = mxGetPr(prhs[1]);
+            for (int k=0; k<n; ++k) {
+                v[k] = m[i+k*nw];
+            }
+            p = n>0 ? &v[0] : NULL;
+        } else {
+            p = mxGetPr(prhs[1]);
+            n = (int)mxGetNumberOfElements(prhs[1]);
+        }
+        if (!Model::readParameters(p, n, results[i].prm)) mexErrMsgTxt("Incorrect parameter vector format.");
+    }
+
+    // mode
+    if (!mxIsChar(prhs[2])) mexErrMsgTxt("Mode needs to be a string.");
+    FitOptions opts;
+    char* mode = mxArrayToString(prhs[2]);
+    opts.mode = mode;
+    mxFree(mode);
+    for (size_t i=0; i<opts.mode.size(); ++i) {
+        opts.mode[i] = (char)tolower(opts.mode[i]);
+    }
+    for (int i=0; i<nw; ++i) {
+        if (!Model::selectParameters(opts.mode.c_str(), (int)results[i].prm.size(), results[i].estIdx)) {
+            mexErrMsgTxt("Unknown mode.");
+        }
+    }
+
+    // options
+    if (nrhs > 3 && !mxIsEmpty(prhs[3])) {
+        if (!mxIsDouble(prhs[3]) || mxGetNumberOfElements(prhs[3])!=3) mexErrMsgTxt("Options must must be double array with 3 elements.");
+        double *options = mxGetPr(prhs[3]);
+        opts.maxIter = (int)options[0];
+        opts.eAbs = options[1];
+        opts.eRel = options[2];
+    }
+
+    // model order search (mixture models): [maxM {alpha} {bounds}]
+    if (Model::componentSize > 0 && nrhs > 4 && !mxIsEmpty(prhs[4])) {
+        int ns = (int)mxGetNumberOfElements(prhs[4]);
+        if (!mxIsDouble(prhs[4]) || !Model::checkSearch(ns)) {
+            std::string msg = std::string("Search parameters must be a double array: ") + Model::searchFormat() + ".";
+            mexErrMsgTxt(msg.c_str());
+        }
+        double *search = mxGetPr(prhs[4]);
+        opts.maxM = (int)search[0];
+        if (ns > 1) opts.alpha = search[1];
+        if (ns > 2) opts.bounds.assign(search+2, search+ns);
+        bool componentMode = opts.mode.find_first_of(Model::componentModes())!=std::string::npos;
+        for (int i=0; i<nw; ++i) {
+            int ng = BatchFitter<Model>::numComponents(results[i]);
+            if (opts.maxM < ng) mexErrMsgTxt("The maximum number of components must be >= the number of components in prmVect.");
+            if (opts.maxM > ng && !componentMode) mexErrMsgTxt("The model order search requires the component parameters to be optimized.");
+        }
+    }
+
+    if (!batch && windows[0].nValid() <= results[0].nparam()) {
+        mexErrMsgTxt("The input must contain more valid data points than parameters to estimate.");
+    }
+
+    // fit windows in parallel, one set of workspaces per thread
+    bool stats = nlhs > 1;
+#ifdef _OPENMP
+#pragma omp parallel if(nw > 1)
+#endif
+    {
+        BatchFitter<Model> fitter(opts);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+        for (int i=0; i<nw; ++i) {
+            fitter.fit(windows[i], results[i], stats);
+        }
+    }
+
+    // outputs
+    std::vector< std::vector<double> > rows(nw);
+    for (int i=0; i<nw; ++i) {
+        rows[i] = results[i].prm;
+        if (!results[i].valid) {
+            rows[i].assign(rows[i].size(), mxGetNaN());
+        }
+    }
+    plhs[0] = packRows(rows, batch, prmCell, prhs[0]);
+    if (nlhs > 1) {
+        for (int i=0; i<nw; ++i) {
+            getStd(results[i], Model::expandStd, rows[i]);
+        }
+        plhs[1] = packRows(rows, batch, prmCell, prhs[0]);
+    }
+    if (nlhs > 2) {
+        if (batch) {
+            plhs[2] = mxCreateCellArray(mxGetNumberOfDimensions(prhs[0]), mxGetDimensions(prhs[0]));
+            for (int i=0; i<nw; ++i) {
+                mxSetCell(plhs[2], i, packCovariance(results[i]));
+            }
+        } else {
+            plhs[2] = packCovariance(results[0]);
+        }
+    }
+    if (nlhs > 3) {
+        plhs[3] = packResidualOutput<Model>(windows, results, batch, prhs[0]);
+    }
+    if (nlhs > 4) {
+        if (batch) {
+            plhs[4] = mxCreateCellArray(mxGetNumberOfDimensions(prhs[0]), mxGetDimensions(prhs[0]));
+            for (int i=0; i<nw; ++i) {
+                mxSetCell(plhs[4], i, packJacobian(windows[i], results[i]));
+            }
+        } else {
+            plhs[4] = packJacobian(windows[0], results[0]);
+        }
+    }
+}
+
+#endif
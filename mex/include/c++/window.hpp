@@ -9,6 +9,9 @@ template <unsigned N, unsigned S, typename T>
 class window
 {
 public:
+  // number of points, as a compile-time constant
+  static const unsigned SIZE = S;
+
   window() {}
 
   window(const vector<N,T> points[])
@@ -89,4 +89,117 @@ const wwindow<3,3,T,W> & chanfrein111_bkd()
 	return win;
 }
 
+// Full (symmetric) weighted neighborhoods for propagation in any
+// direction. Weights are integers; distances are obtained by dividing
+// by the axial weight.
+
+// 4-neighborhood, weight 1 (city block distance)
+template <typename T, typename W>
+inline
+const wwindow<2,4,T,W> & chanfrein11()
+{
+  static wwindow<2,4,T,W> win;
+  static bool first = true;
+
+  if (first)
+    {
+      const wwindow<2,2,T,W> & fwd = chanfrein11_fwd<T,W>();
+      for (unsigned i = 0; i < 2; ++i)
+	{
+	  win.point(i) = fwd.point(i);
+	  win.point(i + 2) = -fwd.point(i);
+	  win.weight(i) = win.weight(i + 2) = 1;
+	}
+      first = false;
+    }
+  return win;
+}
+
+// 6-neighborhood, weight 1
+template <typename T, typename W>
+inline
+const wwindow<3,6,T,W> & chanfrein111()
+{
+  static wwindow<3,6,T,W> win;
+  static bool first = true;
+
+  if (first)
+    {
+      const wwindow<3,3,T,W> & fwd = chanfrein111_fwd<T,W>();
+      for (unsigned i = 0; i < 3; ++i)
+	{
+	  win.point(i) = fwd.point(i);
+	  win.point(i + 3) = -fwd.point(i);
+	  win.weight(i) = win.weight(i + 3) = 1;
+	}
+      first = false;
+    }
+  return win;
+}
+
+// 5-7-11 chamfer (Borgefors, 1986): 5 for axial, 7 for diagonal and
+// 11 for knight moves (16 neighbors)
+template <typename T, typename W>
+inline
+const wwindow<2,16,T,W> & chanfrein5711()
+{
+  static wwindow<2,16,T,W> win;
+  static bool first = true;
+
+  if (first)
+    {
+      unsigned k = 0;
+      for (int x = -2; x <= 2; ++x)
+	for (int y = -2; y <= 2; ++y)
+	  {
+	    int ax = x < 0 ? -x : x;
+	    int ay = y < 0 ? -y : y;
+
+	    // skip the center and the points reached by a single
+	    // axial or diagonal move twice
+	    if ((ax == 0 && ay == 0) || (ax != 1 && ay != 1))
+	      continue;
+
+	    win.point(k)[0] = x;
+	    win.point(k)[1] = y;
+	    win.weight(k) = (ax + ay == 1) ? 5 : (ax + ay == 2) ? 7 : 11;
+	    ++k;
+	  }
+      first = false;
+    }
+  return win;
+}
+
+// 3-4-5 chamfer (Borgefors, 1996): 3 for face, 4 for edge and 5 for
+// vertex neighbors (26 neighbors)
+template <typename T, typename W>
+inline
+const wwindow<3,26,T,W> & chanfrein345()
+{
+  static wwindow<3,26,T,W> win;
+  static bool first = true;
+
+  if (first)
+    {
+      unsigned k = 0;
+      for (int x = -1; x <= 1; ++x)
+	for (int y = -1; y <= 1; ++y)
+	  for (int z = -1; z <= 1; ++z)
+	    {
+	      int m = (x != 0) + (y != 0) + (z != 0);
+
+	      if (m == 0)
+		continue;
+
+	      win.point(k)[0] = x;
+	      win.point(k)[1] = y;
+	      win.point(k)[2] = z;
+	      win.weight(k) = m + 2;
+	      ++k;
+	    }
+      first = false;
+    }
+  return win;
+}
+
 #endif /* WWINDOW_HPP */
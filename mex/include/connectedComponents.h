@@ -0,0 +1,66 @@
+/* Connected component labeling of 2D masks
+ * Data is linearly indexed in MATLAB column-major order: (y,x) -> y + x*ny.
+ * Components are 8-connected and labeled 1..n in order of their first pixel, as with bwlabel.
+ * The equivalences between the labels of neighboring pixels are resolved with a union-find
+ * structure in a single raster scan.
+ */
+
+#ifndef CONNECTEDCOMPONENTS_H
+#define CONNECTEDCOMPONENTS_H
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+
+// root of the tree containing pixel i
+inline int findRoot(const std::vector<int>& parent, int i) {
+    while (parent[i]!=i) {
+        i = parent[i];
+    }
+    return i;
+}
+
+
+// Labels the 8-connected components of 'mask' (ny x nx) into 'labels' (0: background);
+// returns the number of components
+inline int labelComponents(const std::vector<bool>& mask, const int ny, const int nx, std::vector<int>& labels) {
+    size_t N = (size_t)nx*ny;
+    std::vector<int> parent(N);
+    labels.assign(N, 0);
+    for (size_t i=0; i<N; ++i) {
+        parent[i] = (int)i;
+    }
+    for (int x=0; x<nx; ++x) {
+        for (int y=0; y<ny; ++y) {
+            int i = y + x*ny;
+            if (!mask[i]) {
+                continue;
+            }
+            // previously visited neighbors: (y-1,x), (y-1,x-1), (y,x-1), (y+1,x-1)
+            int nb[4] = {y>0 ? i-1 : -1, (y>0 && x>0) ? i-1-ny : -1, x>0 ? i-ny : -1, (y<ny-1 && x>0) ? i+1-ny : -1};
+            for (int k=0; k<4; ++k) {
+                if (nb[k]>=0 && mask[nb[k]]) {
+                    int a = findRoot(parent, i);
+                    int b = findRoot(parent, nb[k]);
+                    if (a!=b) {
+                        parent[std::max(a,b)] = std::min(a,b);
+                    }
+                }
+            }
+        }
+    }
+    int nl = 0;
+    for (size_t i=0; i<N; ++i) {
+        if (mask[i]) {
+            int r = findRoot(parent, (int)i);
+            if (labels[r]==0) {
+                labels[r] = ++nl;
+            }
+            labels[i] = labels[r];
+        }
+    }
+    return nl;
+}
+
+#endif
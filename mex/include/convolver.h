@@ -1,370 +1,186 @@
-/* Class for 2-D convolutions with even- or odd-symmetric kernels
+/* Class for 2-D convolutions with even- or odd-symmetric kernels, on float or double images
  * Supported border conditions: mirror, periodic, replicate of border pixels, or zeros
+ * The convolutions are computed with the engine in separableConvolution.h.
+ *
+ * Batched convolutions: convolve(batch) computes a set of separable convolutions. Kernels whose
+ * x-kernels are equal up to a scale factor share a single x-pass, followed by a single sweep
+ * that computes all of their y-passes (the scale factor is applied to the y-kernel).
+ *
+ * Note: the input image is not copied; it must remain valid while the Convolver is used.
  *
  * Copyright (C) 2012 Francois Aguet
- * 
+ *
  * Last modified: Mar 15, 2012
  */
 
 #ifndef CONVOLVER_H
 #define CONVOLVER_H
 
-#include <cstring> //memcpy
+#include <cmath>
+#include <vector>
+#include "separableConvolution.h"
 
 namespace std {
 
+template<class T>
 class Convolver {
-    
+
 public:
-    // define type for border condition function pointers    
-    typedef double (Convolver::*BorderConditionFunc)(const int idx, const int i, const int y);
-    
     // Border conditions
-    static const int ZEROS = 0;
-    static const int REPLICATE = 1;
-    static const int PERIODIC = 2;
-    static const int MIRROR = 3;
-    
-    Convolver(const double pixels[], const int nx, const int ny);
-    Convolver(const double pixels[], const int nx, const int ny, const int borderCondition);
-    
-    ~Convolver();
-    
-    void convolveEvenXEvenY(const double xkernel[], const int nx, const double ykernel[], const int ny, double output[]);
-    void convolveEvenXOddY(const double xkernel[], const int nx, const double ykernel[], const int ny, double output[]);
-    void convolveOddXEvenY(const double xkernel[], const int nx, const double ykernel[], const int ny, double output[]);
-    void convolveOddXOddY(const double xkernel[], const int nx, const double ykernel[], const int ny, double output[]);
-    
+    static const int ZEROS = sepconv::ZEROS;
+    static const int REPLICATE = sepconv::REPLICATE;
+    static const int PERIODIC = sepconv::PERIODIC;
+    static const int MIRROR = sepconv::MIRROR;
+
+    // Separable kernel of a batch, with its output
+    struct SeparableKernel {
+        SeparableKernel(const double xkernel[], const int nkx, const bool xodd,
+                        const double ykernel[], const int nky, const bool yodd, T output[]) :
+            xkernel(xkernel), nkx(nkx), xodd(xodd), ykernel(ykernel), nky(nky), yodd(yodd), output(output) {}
+
+        const double *xkernel;
+        int nkx;
+        bool xodd;
+        const double *ykernel;
+        int nky;
+        bool yodd;
+        T *output;
+    };
+
+    Convolver(const T pixels[], const int nx, const int ny);
+    Convolver(const T pixels[], const int nx, const int ny, const int borderCondition);
+
+    void convolveEvenXEvenY(const double xkernel[], const int nx, const double ykernel[], const int ny, T output[]);
+    void convolveEvenXOddY(const double xkernel[], const int nx, const double ykernel[], const int ny, T output[]);
+    void convolveOddXEvenY(const double xkernel[], const int nx, const double ykernel[], const int ny, T output[]);
+    void convolveOddXOddY(const double xkernel[], const int nx, const double ykernel[], const int ny, T output[]);
+
+    void convolve(const vector<SeparableKernel>& batch);
+
     int nx_, ny_;
-    double *pixels_;
-    double *buffer_;
+    const T *pixels_;
+    vector<T> buffer_;
     int borderCondition_;
-    
- protected:
-    // Border condition function pointers
-    BorderConditionFunc leftBCFunc_;
-    BorderConditionFunc rightBCFunc_;
-    BorderConditionFunc topBCFunc_;
-    BorderConditionFunc bottomBCFunc_;
-    
-    
+
 private:
-    // x,y-convolution methods
-    void convolveEvenX(const double kernel[], const int k);
-    void convolveEvenY(const double kernel[], const int k, double output[]);
-    void convolveOddX(const double kernel[], const int k);
-    void convolveOddY(const double kernel[], const int k, double output[]);
-    
-    
-    // Border condition methods
-    double leftBorderMirror(const int idx, const int i, const int y);
-    double rightBorderMirror(const int idx, const int i, const int y);
-    double topBorderMirror(const int idx, const int i, const int y);
-    double bottomBorderMirror(const int idx, const int i, const int y);
-    
-    double leftBorderPeriodic(const int idx, const int i, const int y);
-    double rightBorderPeriodic(const int idx, const int i, const int y);
-    double topBorderPeriodic(const int idx, const int i, const int y);
-    double bottomBorderPeriodic(const int idx, const int i, const int y);
-    
-    double leftBorderReplicate(const int idx, const int i, const int y);
-    double rightBorderReplicate(const int idx, const int i, const int y);
-    double topBorderReplicate(const int idx, const int i, const int y);
-    double bottomBorderReplicate(const int idx, const int i, const int y);
-    
-    double borderZeros(const int idx, const int i, const int y);
-    
+    // convolution along x goes to buffer, along y to output
+    void convolve(const double xkernel[], const int nkx, const bool xodd,
+                  const double ykernel[], const int nky, const bool yodd, T output[]);
+
+    static bool isScaled(const SeparableKernel& ref, const SeparableKernel& k, double& scale);
 };
-    
-    Convolver::Convolver(const double pixels[], const int nx, const int ny) {
-        nx_ = nx;
-        ny_ = ny;
-        pixels_ = new double[nx_*ny_];
-        memcpy(pixels_, pixels, nx_*ny_*sizeof(double));
-        buffer_ = new double[nx_*ny_];
-        
-        borderCondition_ = MIRROR;
-        
-        leftBCFunc_ = &Convolver::leftBorderMirror;
-        rightBCFunc_ = &Convolver::rightBorderMirror;
-        topBCFunc_ = &Convolver::topBorderMirror;
-        bottomBCFunc_ = &Convolver::bottomBorderMirror;
-    }
-    
-    Convolver::Convolver(const double pixels[], const int nx, const int ny, const int borderCondition) {
-        nx_ = nx;
-        ny_ = ny;
-        pixels_ = new double[nx_*ny_];
-        memcpy(pixels_, pixels, nx_*ny_*sizeof(double));
-        buffer_ = new double[nx_*ny_];
-        
-        borderCondition_ = borderCondition;
-        
-        switch (borderCondition) {
-            case ZEROS:
-                leftBCFunc_ = &Convolver::borderZeros;
-                rightBCFunc_ = &Convolver::borderZeros;
-                topBCFunc_ = &Convolver::borderZeros;
-                bottomBCFunc_ = &Convolver::borderZeros;
-                break;
-            case REPLICATE:
-                leftBCFunc_ = &Convolver::leftBorderReplicate;
-                rightBCFunc_ = &Convolver::rightBorderReplicate;
-                topBCFunc_ = &Convolver::topBorderReplicate;
-                bottomBCFunc_ = &Convolver::bottomBorderReplicate;
-                break;
-            case PERIODIC:
-                leftBCFunc_ = &Convolver::leftBorderPeriodic;
-                rightBCFunc_ = &Convolver::rightBorderPeriodic;
-                topBCFunc_ = &Convolver::topBorderPeriodic;
-                bottomBCFunc_ = &Convolver::bottomBorderPeriodic;
-                break;
-            case MIRROR:
-                leftBCFunc_ = &Convolver::leftBorderMirror;
-                rightBCFunc_ = &Convolver::rightBorderMirror;
-                topBCFunc_ = &Convolver::topBorderMirror;
-                bottomBCFunc_ = &Convolver::bottomBorderMirror;
-                break;
-            default:
-                break;
-        }
-    }
-    
-    Convolver::~Convolver() {
-        delete pixels_;
-        delete buffer_;
-    }
 
+    template<class T>
+    Convolver<T>::Convolver(const T pixels[], const int nx, const int ny) :
+        nx_(nx), ny_(ny), pixels_(pixels), buffer_(nx*ny), borderCondition_(MIRROR) {}
+
+    template<class T>
+    Convolver<T>::Convolver(const T pixels[], const int nx, const int ny, const int borderCondition) :
+        nx_(nx), ny_(ny), pixels_(pixels), buffer_(nx*ny), borderCondition_(borderCondition) {}
 
-    void Convolver::convolveEvenXEvenY(const double xkernel[], const int nx, const double ykernel[], const int ny, double output[]) {
-        
-        convolveEvenX(xkernel, nx);
-        convolveEvenY(ykernel, ny, output);
+
+    template<class T>
+    void Convolver<T>::convolveEvenXEvenY(const double xkernel[], const int nx, const double ykernel[], const int ny, T output[]) {
+        convolve(xkernel, nx, false, ykernel, ny, false, output);
     }
-    
-    void Convolver::convolveEvenXOddY(const double xkernel[], const int nx, const double ykernel[], const int ny, double output[]) {
-        
-        convolveEvenX(xkernel, nx);
-        convolveOddY(ykernel, ny, output);
+
+    template<class T>
+    void Convolver<T>::convolveEvenXOddY(const double xkernel[], const int nx, const double ykernel[], const int ny, T output[]) {
+        convolve(xkernel, nx, false, ykernel, ny, true, output);
     }
-    
-    void Convolver::convolveOddXEvenY(const double xkernel[], const int nx, const double ykernel[], const int ny, double output[]) {
-        
-        convolveOddX(xkernel, nx);
-        convolveEvenY(ykernel, ny, output);
+
+    template<class T>
+    void Convolver<T>::convolveOddXEvenY(const double xkernel[], const int nx, const double ykernel[], const int ny, T output[]) {
+        convolve(xkernel, nx, true, ykernel, ny, false, output);
     }
-    
-    void Convolver::convolveOddXOddY(const double xkernel[], const int nx, const double ykernel[], const int ny, double output[]) {
-        
-        convolveOddX(xkernel, nx);
-        convolveOddY(ykernel, ny, output);
+
+    template<class T>
+    void Convolver<T>::convolveOddXOddY(const double xkernel[], const int nx, const double ykernel[], const int ny, T output[]) {
+        convolve(xkernel, nx, true, ykernel, ny, true, output);
     }
-    
-    
-    
-    
-    // Convolution along x goes to buffer, along y to output
-    void Convolver::convolveEvenX(const double kernel[], const int k) {
-        
-        int k_1 = k-1;
-        
-        int idx = 0;
-        for (int y=0;y<ny_;++y) {
-            for (int x=0;x<k_1;++x) {
-                buffer_[idx] = kernel[0]*pixels_[idx];
-                for (int i=1;i<=x;++i) {
-                    buffer_[idx] += kernel[i]*(pixels_[idx-i]+pixels_[idx+i]);
-                }
-                for (int i=x+1;i<k;++i) {
-                    buffer_[idx] += kernel[i]*((this->*leftBCFunc_)(idx, i, y)+pixels_[idx+i]);
-                }
-                idx++;
-            }
-            for (int x=k_1;x<=nx_-k;++x) {
-                buffer_[idx] = kernel[0]*pixels_[idx];
-                for (int i=1;i<k;++i) {
-                    buffer_[idx] += kernel[i]*(pixels_[idx-i]+pixels_[idx+i]);
-                }
-                idx++;
-            }
-            for (int x=nx_-k_1;x<nx_;++x) {
-                buffer_[idx] = kernel[0]*pixels_[idx];
-                for (int i=1;i<nx_-x;++i) {
-                    buffer_[idx] += kernel[i]*(pixels_[idx-i]+pixels_[idx+i]);
-                }
-                for (int i=nx_-x;i<k;++i) {
-                    buffer_[idx] += kernel[i]*(pixels_[idx-i]+(this->*rightBCFunc_)(idx, i, y));
-                }
-                idx++;
-            }
-        }
+
+
+    template<class T>
+    void Convolver<T>::convolve(const double xkernel[], const int nkx, const bool xodd,
+                                const double ykernel[], const int nky, const bool yodd, T output[]) {
+        sepconv::convolve(pixels_, nx_, ny_, 1, 0, xkernel, nkx, xodd, borderCondition_, &buffer_[0]);
+        sepconv::convolve(&buffer_[0], nx_, ny_, 1, 1, ykernel, nky, yodd, borderCondition_, output);
     }
-    
-    
-    void Convolver::convolveEvenY(const double *kernel, const int k, double output[]) {
-        
-        int k_1 = k-1;
-        
-        int idx, inx;
-        for (int x=0;x<nx_;x++) {
-            for (int y=0;y<k_1;y++) {
-                idx = x+y*nx_;
-                output[idx] = kernel[0]*buffer_[idx];
-                for (int i=1;i<=y;i++) {
-                    inx = i*nx_;
-                    output[idx] += kernel[i]*(buffer_[idx-inx]+buffer_[idx+inx]);
-                }
-                for (int i=y+1;i<k;i++) {
-                    output[idx] += kernel[i]*((this->*topBCFunc_)(idx, i, y)+buffer_[idx+i*nx_]);
-                }
-            }
-            for (int y=k_1;y<=ny_-k;y++) {
-                idx = x+y*nx_;
-                output[idx] = kernel[0]*buffer_[idx];
-                for (int i=1;i<k;i++) {
-                    inx = i*nx_;
-                    output[idx] += kernel[i]*(buffer_[idx-inx]+buffer_[idx+inx]);
-                }
-            }
-            for (int y=ny_-k_1;y<ny_;y++) {
-                idx = x+y*nx_;
-                output[idx] = kernel[0]*buffer_[idx];
-                for (int i=1;i<ny_-y;i++) {
-                    inx = i*nx_;
-                    output[idx] += kernel[i]*(buffer_[idx-inx]+buffer_[idx+inx]);
-                }
-                for (int i=ny_-y;i<k;i++) {
-                    output[idx] += kernel[i]*(buffer_[idx-i*nx_]+(this->*bottomBCFunc_)(idx, i, y));
-                }
-            }
+
+
+    // true if the x-kernel of 'k' is equal to 'scale' times the x-kernel of 'ref'
+    template<class T>
+    bool Convolver<T>::isScaled(const SeparableKernel& ref, const SeparableKernel& k, double& scale) {
+        if (k.nkx != ref.nkx || k.xodd != ref.xodd) {
+            return false;
         }
-    }
-    
-    
-    void Convolver::convolveOddX(const double *kernel, const int k) {
-        
-        int k_1 = k-1;
-        
-        int idx = 0;
-        for (int y=0;y<ny_;y++) {
-            for (int x=0;x<k_1;x++) {
-                buffer_[idx] = 0.0; // kernel is symmetric, zero at center
-                for (int i=1;i<=x;i++) {
-                    buffer_[idx] += kernel[i]*(pixels_[idx-i]-pixels_[idx+i]);
-                }
-                for (int i=x+1;i<k;i++) {
-                    buffer_[idx] += kernel[i]*((this->*leftBCFunc_)(idx, i, y)-pixels_[idx+i]);
-                }
-                idx++;
-            }
-            for (int x=k_1;x<=nx_-k;x++) {
-                buffer_[idx] = 0.0;
-                for (int i=1;i<k;i++) { // value at 0 is 0
-                    buffer_[idx] += kernel[i]*(pixels_[idx-i]-pixels_[idx+i]); // conv -> flip
-                }
-                idx++;
+        int i0 = k.xodd ? 1 : 0; // center of odd kernels is not used
+        int imax = i0;
+        double kmax = 0.0;
+        for (int i=i0;i<k.nkx;++i) {
+            if (fabs(ref.xkernel[i]) > fabs(ref.xkernel[imax])) {
+                imax = i;
             }
-            for (int x=nx_-k_1;x<nx_;x++) {
-                buffer_[idx] = 0.0;
-                for (int i=1;i<nx_-x;i++) {
-                    buffer_[idx] += kernel[i]*(pixels_[idx-i]-pixels_[idx+i]);
-                }
-                for (int i=nx_-x;i<k;i++) {
-                    buffer_[idx] += kernel[i]*(pixels_[idx-i]-(this->*rightBCFunc_)(idx, i, y));
-                }
-                idx++;
+            kmax = max(kmax, fabs(k.xkernel[i]));
+        }
+        if (imax >= k.nkx || ref.xkernel[imax]==0.0) {
+            return false;
+        }
+        scale = k.xkernel[imax]/ref.xkernel[imax];
+        for (int i=i0;i<k.nkx;++i) {
+            if (fabs(k.xkernel[i] - scale*ref.xkernel[i]) > 1e-12*kmax) {
+                return false;
             }
         }
+        return true;
     }
-    
-    
-    void Convolver::convolveOddY(const double *kernel, const int k, double output[]) {
-        
-        int k_1 = k-1;
-        
-        int idx, inx;
-        for (int x=0;x<nx_;x++) {
-            for (int y=0;y<k_1;y++) {
-                idx = x+y*nx_;
-                output[idx] = 0.0;
-                for (int i=1;i<=y;i++) {
-                    inx = i*nx_;
-                    output[idx] += kernel[i]*(buffer_[idx-inx]-buffer_[idx+inx]);
-                }
-                for (int i=y+1;i<k;i++) {
-                    output[idx] += kernel[i]*((this->*topBCFunc_)(idx, i, y)-buffer_[idx+i*nx_]);
-                }
-            }
-            for (int y=k_1;y<=ny_-k;y++) {
-                idx = x+y*nx_;
-                output[idx] = 0.0;
-                for (int i=1;i<k;i++) {
-                    inx = i*nx_;
-                    output[idx] += kernel[i]*(buffer_[idx-inx]-buffer_[idx+inx]);
-                }
+
+
+    template<class T>
+    void Convolver<T>::convolve(const vector<SeparableKernel>& batch) {
+
+        int nb = batch.size();
+        vector<bool> done(nb, false);
+        vector<vector<double> > ykernels(nb);
+        vector<const double*> yk(nb);
+        vector<int> nky(nb);
+        bool* yodd = new bool[nb];
+        vector<T*> outputs(nb);
+        double scale;
+
+        for (int r=0;r<nb;++r) {
+            if (done[r]) {
+                continue;
             }
-            for (int y=ny_-k_1;y<ny_;y++) {
-                idx = x+y*nx_;
-                output[idx] = 0.0;
-                for (int i=1;i<ny_-y;i++) {
-                    inx = i*nx_;
-                    output[idx] += kernel[i]*(buffer_[idx-inx]-buffer_[idx+inx]);
-                }
-                for (int i=ny_-y;i<k;i++) {
-                    output[idx] += kernel[i]*(buffer_[idx-i*nx_]-(this->*bottomBCFunc_)(idx, i, y));
-                }
+            // group all kernels that share the x-pass of batch[r]
+            int ng = 0;
+            for (int i=r;i<nb;++i) {
+                if (done[i]) {
+                    continue;
+                }
+                if (i==r) {
+                    yk[ng] = batch[i].ykernel;
+                } else if (isScaled(batch[r], batch[i], scale)) {
+                    ykernels[ng].resize(batch[i].nky);
+                    for (int k=0;k<batch[i].nky;++k) {
+                        ykernels[ng][k] = scale*batch[i].ykernel[k];
+                    }
+                    yk[ng] = &ykernels[ng][0];
+                } else {
+                    continue;
+                }
+                nky[ng] = batch[i].nky;
+                yodd[ng] = batch[i].yodd;
+                outputs[ng] = batch[i].output;
+                done[i] = true;
+                ng++;
             }
+
+            sepconv::convolve(pixels_, nx_, ny_, 1, 0, batch[r].xkernel, batch[r].nkx, batch[r].xodd, borderCondition_, &buffer_[0]);
+            sepconv::convolveMulti(&buffer_[0], nx_, ny_, 1, 1, ng, &yk[0], &nky[0], yodd, borderCondition_, &outputs[0]);
         }
+        delete[] yodd;
     }
 
-    
-    
-    // Mirror border condition functions
-    double Convolver::leftBorderMirror(const int idx, const int i, const int y) {
-        return pixels_[i-idx+2*y*nx_];
-    }
-    double Convolver::rightBorderMirror(const int idx, const int i, const int y) {
-        return pixels_[2*(nx_*(y+1)-1)-idx-i]; // right over: idx+i. diff: idx+i-(nx-1)
-    }
-    double Convolver::topBorderMirror(const int idx, const int i, const int y) {
-        return buffer_[idx+(i-2*y)*nx_]; //x+y*nx - i*nx -> x+(i-y)*nx
-    }
-    double Convolver::bottomBorderMirror(const int idx, const int i, const int y) {
-        return buffer_[(2*(ny_-y-1)-i)*nx_+idx];
-    }
-    
-    // Periodic border condition functions
-    double Convolver::leftBorderPeriodic(const int idx, const int i, const int y) {
-        return pixels_[nx_+idx-i];
-    }
-    double Convolver::rightBorderPeriodic(const int idx, const int i, const int y) {
-        return pixels_[idx+i-nx_];
-    }
-    double Convolver::topBorderPeriodic(const int idx, const int i, const int y) {
-        return buffer_[nx_*(ny_-i)-1+idx]; // idx-i*nx -> nx*ny-1 + idx-i*nx 
-    }
-    double Convolver::bottomBorderPeriodic(const int idx, const int i, const int y) {
-        return buffer_[idx+(i-ny_)*nx_+1]; // idx+i*nx -> idx+i*nx - (nx*ny-1)
-    }
-    
-    // Replicate border condition functions
-    double Convolver::leftBorderReplicate(const int idx, const int i, const int y) {
-        return pixels_[y*nx_];
-    }
-    double Convolver::rightBorderReplicate(const int idx, const int i, const int y) {
-        return pixels_[nx_-1+y*nx_];
-    }
-    double Convolver::topBorderReplicate(const int idx, const int i, const int y) {
-        return buffer_[idx-y*nx_]; // = x
-    }
-    double Convolver::bottomBorderReplicate(const int idx, const int i, const int y) {
-        return buffer_[(ny_-y-1)*nx_+idx]; // = (ny-1)*nx + x
-    }
-    
-    // Zero border conditions
-    double Convolver::borderZeros(const int idx, const int i, const int y) {
-        return 0.0;
-    }    
-    
 } // namespace std
 #endif // CONVOLVER_H
@@ -0,0 +1,250 @@
+/* FFT-based 3-D convolution with a full (non-separable) kernel, computed by overlap-save
+ *
+ * Data and kernels are indexed as in Matlab: (i,j,k) -> i + j*n0 + k*n0*n1.
+ * The output is the central part of the convolution, as returned by convn(..., 'same'), i.e., the
+ * origin of the kernel is at floor(k/2). The input is extended with mirror borders (see
+ * separableConvolution.h); kernels can be longer than the data.
+ *
+ * The volume is split into blocks of N0 x N1 x N2 samples (N: product of the primes 2, 3, 5, 7),
+ * each yielding (N0-k0+1) x (N1-k1+1) x (N2-k2+1) output samples; the blocks are transformed with
+ * real-to-complex FFTs (FFTW) and distributed over threads. A volume that fits into a single block
+ * is transformed with multi-threaded FFTW plans instead.
+ * The plans and the spectrum of the kernel are kept by FFTConvolver3D: subsequent calls with the
+ * same volume size and kernel only compute the transforms of the blocks.
+ * Computations are carried out in double precision, for any type of input and output.
+ */
+
+#ifndef FFTCONVOLUTION_H
+#define FFTCONVOLUTION_H
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <fftw3.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "separableConvolution.h"
+
+namespace sepconv {
+
+class FFTConvolver3D {
+
+public:
+    FFTConvolver3D() : nThreads_(0), plan_(NULL), iplan_(NULL), spectrum_(NULL) {
+        for (int d=0;d<3;++d) {
+            n_[d] = k_[d] = N_[d] = 0;
+        }
+#ifdef _OPENMP
+        fftw_init_threads();
+#endif
+    }
+
+    ~FFTConvolver3D() {
+        clear();
+#ifdef _OPENMP
+        fftw_cleanup_threads();
+#endif
+    }
+
+    // Convolution of the n[0] x n[1] x n[2] volume 'input' with the k[0] x k[1] x k[2] kernel.
+    // 'input' and 'output' must not overlap.
+    template<class TI, class T>
+    void convolve(const TI* input, const size_t n[], const double* kernel, const size_t k[], T* output) {
+
+        if (n[0]==0 || n[1]==0 || n[2]==0) {
+            return;
+        }
+        setup(n, kernel, k);
+
+        int L[3], nb[3], c[3];
+        for (int d=0;d<3;++d) {
+            L[d] = N_[d]-(int)k_[d]+1;
+            nb[d] = ((int)n[d]+L[d]-1)/L[d];
+            c[d] = (int)k_[d]/2;
+        }
+        size_t nr = (size_t)N_[0]*N_[1]*N_[2];
+        size_t nc = (size_t)(N_[0]/2+1)*N_[1]*N_[2];
+        size_t n01 = n[0]*n[1];
+        long nBlocks = (long)nb[0]*nb[1]*nb[2];
+
+#ifdef _OPENMP
+#pragma omp parallel if(nBlocks > 1)
+#endif
+        {
+            double* block = fftw_alloc_real(nr);
+            fftw_complex* spec = fftw_alloc_complex(nc);
+            std::vector<int> idx0(N_[0]);
+            int j0, j1, j2;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+            for (long b=0;b<nBlocks;++b) {
+                int t0 = (int)(b % nb[0])*L[0];
+                int t1 = (int)((b/nb[0]) % nb[1])*L[1];
+                int t2 = (int)(b/((long)nb[0]*nb[1]))*L[2];
+
+                // input samples t-c-k+1 ... t-c-k+N of the (extended) volume
+                int s0 = t0+c[0]-(int)k_[0]+1;
+                int s1 = t1+c[1]-(int)k_[1]+1;
+                int s2 = t2+c[2]-(int)k_[2]+1;
+                for (j0=0;j0<N_[0];++j0) {
+                    idx0[j0] = borderIndex(s0+j0, (int)n[0], MIRROR);
+                }
+                for (j2=0;j2<N_[2];++j2) {
+                    const TI* p2 = input + borderIndex(s2+j2, (int)n[2], MIRROR)*n01;
+                    for (j1=0;j1<N_[1];++j1) {
+                        const TI* p = p2 + borderIndex(s1+j1, (int)n[1], MIRROR)*n[0];
+                        double* q = block + ((size_t)j2*N_[1]+j1)*N_[0];
+                        for (j0=0;j0<N_[0];++j0) {
+                            q[j0] = (double)p[idx0[j0]];
+                        }
+                    }
+                }
+
+                fftw_execute_dft_r2c(plan_, block, spec);
+                for (size_t i=0;i<nc;++i) {
+                    double re = spec[i][0]*spectrum_[i][0] - spec[i][1]*spectrum_[i][1];
+                    spec[i][1] = spec[i][0]*spectrum_[i][1] + spec[i][1]*spectrum_[i][0];
+                    spec[i][0] = re;
+                }
+                fftw_execute_dft_c2r(iplan_, spec, block);
+
+                // valid part of the circular convolution: samples k-1 ... N-1
+                int m0 = std::min(L[0], (int)n[0]-t0);
+                int m1 = std::min(L[1], (int)n[1]-t1);
+                int m2 = std::min(L[2], (int)n[2]-t2);
+                for (j2=0;j2<m2;++j2) {
+                    for (j1=0;j1<m1;++j1) {
+                        const double* q = block + ((size_t)(j2+k_[2]-1)*N_[1] + j1+k_[1]-1)*N_[0] + k_[0]-1;
+                        T* p = output + (t2+j2)*n01 + (t1+j1)*n[0] + t0;
+                        for (j0=0;j0<m0;++j0) {
+                            p[j0] = (T)q[j0];
+                        }
+                    }
+                }
+            }
+            fftw_free(spec);
+            fftw_free(block);
+        }
+    }
+
+private:
+    size_t n_[3], k_[3];        // volume and kernel size of the current plans and spectrum
+    int N_[3];                  // block size
+    int nThreads_;              // number of threads of the plans
+    std::vector<double> kernel_;
+    fftw_plan plan_, iplan_;
+    fftw_complex* spectrum_;    // spectrum of the kernel, scaled by 1/(N0*N1*N2)
+
+    FFTConvolver3D(const FFTConvolver3D&);
+    FFTConvolver3D& operator=(const FFTConvolver3D&);
+
+    void clear() {
+        if (plan_!=NULL) {
+            fftw_destroy_plan(plan_);
+            fftw_destroy_plan(iplan_);
+        }
+        fftw_free(spectrum_);
+        plan_ = iplan_ = NULL;
+        spectrum_ = NULL;
+    }
+
+    // Smallest integer >= n whose prime factors are 2, 3, 5, 7
+    static int nextSmooth(int n) {
+        for (;;++n) {
+            int m = n;
+            while (m%2==0) m /= 2;
+            while (m%3==0) m /= 3;
+            while (m%5==0) m /= 5;
+            while (m%7==0) m /= 7;
+            if (m==1) {
+                return n;
+            }
+        }
+    }
+
+    // Block size along a dimension of n samples, for a kernel of k samples: minimizes the
+    // cost of the transforms, (number of blocks)*N*log(N), from blocks of about 2*k samples
+    // (and at least 16) to a single block
+    static int blockSize(const int n, const int k) {
+        int nmax = nextSmooth(n+k-1);
+        int best = nmax;
+        double cmin = ceil((double)n/(nmax-k+1))*nmax*log((double)nmax);
+        for (int N=nextSmooth(std::max(2*k-1, 16));N<nmax;N=nextSmooth(N+1)) {
+            double cost = ceil((double)n/(N-k+1))*N*log((double)N);
+            if (cost < cmin) {
+                cmin = cost;
+                best = N;
+            }
+        }
+        return best;
+    }
+
+    // Plans and kernel spectrum for the volume size n and the kernel; reused when unchanged
+    void setup(const size_t n[], const double* kernel, const size_t k[]) {
+
+        size_t nk = k[0]*k[1]*k[2];
+        bool sameSize = true;
+        for (int d=0;d<3;++d) {
+            sameSize = sameSize && n[d]==n_[d] && k[d]==k_[d];
+        }
+        if (sameSize && plan_!=NULL && std::equal(kernel, kernel+nk, kernel_.begin())) {
+            return;
+        }
+
+        int N[3], nb = 1;
+        for (int d=0;d<3;++d) {
+            N[d] = blockSize((int)n[d], (int)k[d]);
+            nb *= ((int)n[d]+N[d]-(int)k[d])/(N[d]-(int)k[d]+1);
+        }
+        int nThreads = 1;
+#ifdef _OPENMP
+        if (nb==1) { // a single block: multi-threaded transforms
+            nThreads = omp_get_max_threads();
+        }
+#endif
+        size_t nr = (size_t)N[0]*N[1]*N[2];
+        size_t nc = (size_t)(N[0]/2+1)*N[1]*N[2];
+
+        if (plan_==NULL || N[0]!=N_[0] || N[1]!=N_[1] || N[2]!=N_[2] || nThreads!=nThreads_) {
+            clear();
+            std::copy(N, N+3, N_);
+            nThreads_ = nThreads;
+            // FFTW_MEASURE overwrites the arrays: the plans are created on the spectrum buffer
+            double* block = fftw_alloc_real(nr);
+            spectrum_ = fftw_alloc_complex(nc);
+#ifdef _OPENMP
+            fftw_plan_with_nthreads(nThreads);
+#endif
+            // row-major in FFTW: dimension 0 is the last (contiguous) one
+            plan_ = fftw_plan_dft_r2c_3d(N[2], N[1], N[0], block, spectrum_, FFTW_MEASURE);
+            iplan_ = fftw_plan_dft_c2r_3d(N[2], N[1], N[0], spectrum_, block, FFTW_MEASURE);
+            fftw_free(block);
+        }
+        std::copy(n, n+3, n_);
+        std::copy(k, k+3, k_);
+        kernel_.assign(kernel, kernel+nk);
+
+        // kernel spectrum, including the normalization of the inverse transform
+        double* block = fftw_alloc_real(nr);
+        std::fill(block, block+nr, 0.0);
+        double scale = 1.0/(double)nr;
+        for (size_t u2=0;u2<k[2];++u2) {
+            for (size_t u1=0;u1<k[1];++u1) {
+                for (size_t u0=0;u0<k[0];++u0) {
+                    block[(u2*N[1]+u1)*N[0]+u0] = scale*kernel[(u2*k[1]+u1)*k[0]+u0];
+                }
+            }
+        }
+        fftw_execute_dft_r2c(plan_, block, spectrum_);
+        fftw_free(block);
+    }
+};
+
+} // namespace sepconv
+
+#endif // FFTCONVOLUTION_H
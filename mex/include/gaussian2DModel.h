@@ -0,0 +1,112 @@
+/* 2D Gaussian model for batchFit.h
+ *
+ * Parameters: [x y A sigma c] (mode characters "xyasc"), with the position relative to the
+ * center of the window: I(x,y) = A*exp(-((x-x0)^2+(y-y0)^2)/(2*sigma^2)) + c.
+ * The window must be square with an odd side.
+ *
+ * Used by fitGaussian2D and pointSourceDetectionMovie.
+ */
+
+#ifndef GAUSSIAN2DMODEL_H
+#define GAUSSIAN2DMODEL_H
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "batchFit.h"
+
+
+class Gaussian2D : public FitModel {
+
+public:
+    static const int nd = 2;
+    static const int stop = STOP_DELTA_AND_GRADIENT;
+    static const int residualFormat = RES_STRUCT_AD;
+    static const int nParams = 5;
+
+    static const char* modes() { return "xyasc"; }
+
+    static const char* checkWindow(const FitWindow& w) {
+        if (w.nx != w.ny) return "Input image must be a square.";
+        if (!(w.nx % 2)) return "The side of the input image must be odd.";
+        return NULL;
+    }
+
+    static bool readParameters(const double* v, const int n, std::vector<double>& prm) {
+        if (n!=nParams) return false;
+        prm.assign(v, v+nParams);
+        return true;
+    }
+
+    static bool selectParameters(const char* mode, const int /*np*/, std::vector<int>& estIdx) {
+        estIdx.clear();
+        for (int i=0; i<nParams; ++i) {
+            if (strchr(mode, modes()[i])!=NULL) {
+                estIdx.push_back(i);
+            }
+        }
+        return !estIdx.empty();
+    }
+
+    static void finalize(double* prm, const int /*np*/) {
+        prm[3] = fabs(prm[3]);
+    }
+
+    void evaluate(const FitWindow& w, const double* prm, const int /*np*/, const int* estIdx, const int nparam,
+                  double* f, double* J) {
+
+        int nx = w.nx;
+        int b = nx/2, i, k;
+
+        double xp = prm[0];
+        double yp = prm[1];
+        double A = prm[2];
+        double sigma = fabs(prm[3]);
+        double c = prm[4];
+
+        double sigma2 = sigma*sigma;
+        double sigma3 = sigma2*sigma;
+        double d = 2.0*sigma2;
+
+        // separable Gaussian kernel
+        gx_.resize(nx);
+        gy_.resize(nx);
+        double xi, yi;
+        for (i=0; i<nx; ++i) {
+            k = i-b;
+            xi = k-xp;
+            yi = k-yp;
+            gx_[i] = exp(-xi*xi/d);
+            gy_[i] = exp(-yi*yi/d);
+        }
+
+        double g, *Ji;
+        int nValid = w.nValid();
+        for (i=0; i<nValid; ++i) {
+            g = gx_[w.x[i]]*gy_[w.y[i]];
+            if (f!=NULL) {
+                f[i] = A*g+c - w.pixels[w.idx[i]];
+            }
+            if (J!=NULL) {
+                xi = w.x[i]-b - xp;
+                yi = w.y[i]-b - yp;
+                Ji = J + i*nparam;
+                for (k=0; k<nparam; ++k) {
+                    switch (estIdx[k]) {
+                        case 0: Ji[k] = A/sigma2*xi*g; break;
+                        case 1: Ji[k] = A/sigma2*yi*g; break;
+                        case 2: Ji[k] = g; break;
+                        case 3: Ji[k] = (xi*xi + yi*yi)*A/sigma3*g; break;
+                        case 4: Ji[k] = 1.0; break;
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    std::vector<double> gx_, gy_; // 1-D separated components of the Gaussian
+};
+
+#endif
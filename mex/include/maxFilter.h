@@ -0,0 +1,190 @@
+/* Separable max-filter and local maxima detection for 2D/3D data
+ * Data is linearly indexed: (i,j,k) -> i + j*n0 + k*n0*n1 (i.e., MATLAB column-major order)
+ * The max-filter is computed with the van Herk/Gil-Werman algorithm, which requires
+ * 3 comparisons per sample and dimension, independently of the window size.
+ * Border condition: windows are truncated at the borders (equivalent to -Inf padding).
+ *
+ * Compile with OpenMP support (-fopenmp) to process lines in parallel.
+ */
+
+#ifndef MAXFILTER_H
+#define MAXFILTER_H
+
+#include <cstddef>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+// Max-filter of a single line of length n, read with stride 'stride' from 'input', written
+// with the same stride to 'output'. 'g' and 'h' are work buffers of length n+2*r.
+template<typename T>
+void maxFilterLine(const T* input, const size_t stride, const int n, const int r, T* output, T* g, T* h) {
+    const int w = 2*r+1;
+    const int m = n+2*r;
+    const T lowest = -std::numeric_limits<T>::max();
+
+    // padded line, stored in g
+    for (int i=0;i<r;++i) {
+        g[i] = lowest;
+        g[m-1-i] = lowest;
+    }
+    for (int i=0;i<n;++i) {
+        g[i+r] = input[i*stride];
+    }
+    // backward (suffix) max within blocks of length w -> h
+    for (int b=0;b<m;b+=w) {
+        int e = std::min(b+w, m)-1;
+        h[e] = g[e];
+        for (int i=e-1;i>=b;--i) {
+            h[i] = std::max(g[i], h[i+1]);
+        }
+    }
+    // forward (prefix) max within blocks of length w, in-place in g
+    for (int i=1;i<m;++i) {
+        if (i%w!=0) {
+            g[i] = std::max(g[i], g[i-1]);
+        }
+    }
+    // window [i, i+2r] in padded coordinates spans at most two blocks
+    for (int i=0;i<n;++i) {
+        output[i*stride] = std::max(h[i], g[i+2*r]);
+    }
+}
+
+
+// Separable max-filter along the first nd (<=3) dimensions of 'input'.
+// dims: size of the array (n0, n1, n2), r: half-window size for each dimension.
+// 'output' may point to the same memory as 'input'.
+template<typename T>
+void maxFilter(const T* input, const int nd, const int* dims, const int* r, T* output) {
+    int n[3] = {1, 1, 1};
+    for (int d=0;d<nd;++d) {
+        n[d] = dims[d];
+    }
+    size_t N = (size_t)n[0]*n[1]*n[2];
+    if (output!=input) {
+        std::copy(input, input+N, output);
+    }
+    size_t stride[3] = {1, (size_t)n[0], (size_t)n[0]*n[1]};
+
+    for (int d=0;d<nd;++d) {
+        if (r[d]<1 || n[d]<2) {
+            continue;
+        }
+        // lines along dimension d are indexed by the two remaining dimensions
+        int d1 = (d+1)%3;
+        int d2 = (d+2)%3;
+        int nLines = n[d1]*n[d2];
+        int m = n[d]+2*r[d];
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            std::vector<T> g(m), h(m);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+            for (int l=0;l<nLines;++l) {
+                int i1 = l%n[d1];
+                int i2 = l/n[d1];
+                T* line = output + i1*stride[d1] + i2*stride[d2];
+                maxFilterLine(line, stride[d], n[d], r[d], line, &g[0], &h[0]);
+            }
+        }
+    }
+}
+
+
+// Returns true if another sample within the window centered on (i0,i1,i2) is equal to 'value'
+template<typename T>
+bool isFlatMaximum(const T* input, const int* n, const int* r, const int i0, const int i1, const int i2, const T value) {
+    int a0 = std::max(i0-r[0], 0), b0 = std::min(i0+r[0], n[0]-1);
+    int a1 = std::max(i1-r[1], 0), b1 = std::min(i1+r[1], n[1]-1);
+    int a2 = std::max(i2-r[2], 0), b2 = std::min(i2+r[2], n[2]-1);
+    int count = 0;
+    for (int k=a2;k<=b2;++k) {
+        for (int j=a1;j<=b1;++j) {
+            const T* p = input + (size_t)n[0]*(j + (size_t)n[1]*k);
+            for (int i=a0;i<=b0;++i) {
+                if (p[i]==value && ++count>1) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+
+// Local maxima of 'input' in a window of half-size r (per dimension), returned as linear
+// indices in ascending (column-major) order. The selection is fused with the optional
+// admissibility tests:
+//        mask : only samples where mask!=0 are retained (ignored if NULL)
+//   threshold : only samples >= threshold are retained
+// clearBorder : samples within r of the border are discarded
+//    keepFlat : if false, maxima that are not unique within their window are discarded
+// 'buffer' must hold N elements; on output it contains the max-filtered input.
+template<typename T>
+void findLocalMaxima(const T* input, const int nd, const int* dims, const int* r,
+                     const bool* mask, const T threshold, const bool clearBorder, const bool keepFlat,
+                     T* buffer, std::vector<size_t>& indexes) {
+
+    int n[3] = {1, 1, 1};
+    int rr[3] = {0, 0, 0};
+    for (int d=0;d<nd;++d) {
+        n[d] = dims[d];
+        rr[d] = r[d];
+    }
+    maxFilter(input, nd, dims, r, buffer);
+
+    int b[3] = {0, 0, 0};
+    if (clearBorder) {
+        b[0] = rr[0]; b[1] = rr[1]; b[2] = rr[2];
+    }
+    int nLines = n[1]*n[2];
+
+    int nThreads = 1;
+#ifdef _OPENMP
+    nThreads = omp_get_max_threads();
+#endif
+    std::vector< std::vector<size_t> > local(nThreads);
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        int tid = 0;
+#ifdef _OPENMP
+        tid = omp_get_thread_num();
+#pragma omp for schedule(static)
+#endif
+        for (int l=0;l<nLines;++l) {
+            int j = l%n[1];
+            int k = l/n[1];
+            if (j<b[1] || j>=n[1]-b[1] || k<b[2] || k>=n[2]-b[2]) {
+                continue;
+            }
+            size_t offset = (size_t)l*n[0];
+            for (int i=b[0];i<n[0]-b[0];++i) {
+                size_t idx = offset+i;
+                T v = input[idx];
+                if (v==buffer[idx] && v>=threshold && (mask==NULL || mask[idx]) &&
+                    (keepFlat || !isFlatMaximum(input, n, rr, i, j, k, v))) {
+                    local[tid].push_back(idx);
+                }
+            }
+        }
+    }
+    // static scheduling assigns contiguous blocks in thread order: concatenation preserves ordering
+    indexes.clear();
+    for (int t=0;t<nThreads;++t) {
+        indexes.insert(indexes.end(), local[t].begin(), local[t].end());
+    }
+}
+
+#endif
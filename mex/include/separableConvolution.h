@@ -0,0 +1,247 @@
+/* Separable convolution engine for 1-D, 2-D and 3-D data with even- or odd-symmetric kernels
+ *
+ * Used by Convolver (convolver.h), the functions in convolver3D.h and conv3fast.
+ * Data is linearly indexed: (x,y,z) -> x + y*nx + z*nx*ny.
+ * Kernels are half-kernels k[0..nk-1], with k[0] at the center:
+ *   even: out[x] = k[0]*in[x] + sum_i k[i]*(in[x-i] + in[x+i])
+ *   odd:  out[x] =              sum_i k[i]*(in[x-i] - in[x+i])   (k[0] is ignored)
+ * Supported border conditions: zeros, replicate, periodic, mirror, and symmetric (mirror with
+ * the border sample repeated, as 'symmetric' in Matlab). Borders are extended repeatedly,
+ * i.e., kernels can be longer than the data.
+ *
+ * Along x, each line is copied into a padded buffer together with its border extension;
+ * along y and z, the output is accumulated row by row (plane by plane) over tiles of the
+ * contiguous dimension(s), with the border rows selected from an index table. Borders are
+ * thus only handled on the strips where the kernel overlaps them, and the inner loops run over
+ * contiguous samples without any tests, so that the compiler vectorizes them (e.g., with
+ * -O3 -mavx2 -mfma). Lines and tiles are distributed over threads (OpenMP).
+ * Several kernels can be applied along y or z in a single sweep over the input (convolveMulti).
+ * Implemented for float and double data; the input can be of another type (e.g., uint16), which is
+ * converted on the fly. Kernels are always given in double precision.
+ */
+
+#ifndef SEPARABLECONVOLUTION_H
+#define SEPARABLECONVOLUTION_H
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+namespace sepconv {
+
+// Border conditions (same values as in Convolver)
+static const int ZEROS = 0;
+static const int REPLICATE = 1;
+static const int PERIODIC = 2;
+static const int MIRROR = 3;
+static const int SYMMETRIC = 4;
+
+// Tile length (in samples) along the contiguous dimension(s); a tile of the output and of
+// the 2*nk-1 input rows it depends on remain in cache
+static const int TILE = 1024;
+
+
+// Index of sample j (-inf < j < inf) on a line of n samples, -1 for a zero sample
+inline int borderIndex(int j, const int n, const int border) {
+    if (j>=0 && j<n) {
+        return j;
+    }
+    switch (border) {
+        case ZEROS:
+            return -1;
+        case REPLICATE:
+            return j<0 ? 0 : n-1;
+        case PERIODIC:
+            j %= n;
+            return j<0 ? j+n : j;
+        case SYMMETRIC:
+            j %= 2*n;
+            if (j<0) {
+                j += 2*n;
+            }
+            return j<n ? j : 2*n-1-j;
+        default: { // MIRROR, the border sample is not repeated
+            if (n==1) {
+                return 0;
+            }
+            int p = 2*n-2;
+            j %= p;
+            if (j<0) {
+                j += p;
+            }
+            return j<n ? j : p-j;
+        }
+    }
+}
+
+
+// out[x] = k0*c[x] (even) or 0 (odd), x = 0..m-1
+template<class T, class TI>
+inline void initTile(T* out, const TI* c, const T k0, const int m, const bool odd) {
+    if (odd) {
+        std::fill(out, out+m, T(0));
+    } else {
+        for (int x=0;x<m;++x) {
+            out[x] = k0*(T)c[x];
+        }
+    }
+}
+
+// out[x] += ki*(a[x] +/- b[x]), x = 0..m-1
+template<class T, class TI>
+inline void addTile(T* out, const TI* a, const TI* b, const T ki, const int m, const bool odd) {
+    if (odd) {
+        for (int x=0;x<m;++x) {
+            out[x] += ki*((T)a[x]-(T)b[x]);
+        }
+    } else {
+        for (int x=0;x<m;++x) {
+            out[x] += ki*((T)a[x]+(T)b[x]);
+        }
+    }
+}
+
+
+// Convolution along contiguous lines of n samples
+template<class TI, class T>
+void convolveLines(const TI* input, const int n, const size_t nLines, const double kernel[], const int nk, const bool odd, const int border, T* output) {
+
+    if (n==0 || nLines==0) {
+        return;
+    }
+    int h = nk-1;
+    std::vector<T> k(kernel, kernel+nk);
+
+    // border extension: source index of padded samples 0..h-1 and n+h..n+2h-1
+    std::vector<int> left(h), right(h);
+    for (int i=0;i<h;++i) {
+        left[i] = borderIndex(i-h, n, border);
+        right[i] = borderIndex(n+i, n, border);
+    }
+
+    long nl = (long)nLines;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        std::vector<T> pad(n+2*h);
+        T* c = &pad[h];
+#ifdef _OPENMP
+#pragma omp for
+#endif
+        for (long l=0;l<nl;++l) {
+            const TI* in = input + l*(size_t)n;
+            T* out = output + l*(size_t)n;
+
+            for (int x=0;x<n;++x) {
+                c[x] = (T)in[x];
+            }
+            for (int i=0;i<h;++i) {
+                pad[i] = left[i]<0 ? T(0) : (T)in[left[i]];
+                c[n+i] = right[i]<0 ? T(0) : (T)in[right[i]];
+            }
+
+            for (int x0=0;x0<n;x0+=TILE) {
+                int m = std::min(TILE, n-x0);
+                initTile(out+x0, c+x0, k[0], m, odd);
+                for (int i=1;i<nk;++i) {
+                    addTile(out+x0, c+x0-i, c+x0+i, k[i], m, odd);
+                }
+            }
+        }
+    }
+}
+
+
+// Convolution along the middle dimension of data organized as [nOuter][n][stride], with
+// nKernels kernels in a single sweep (one output per kernel)
+template<class TI, class T>
+void convolveStrided(const TI* input, const int n, const size_t stride, const size_t nOuter,
+                     const int nKernels, const double* const kernels[], const int nk[], const bool odd[],
+                     const int border, T* const outputs[]) {
+
+    if (n==0 || stride==0 || nOuter==0 || nKernels==0) {
+        return;
+    }
+    int h = *std::max_element(nk, nk+nKernels)-1;
+    std::vector<std::vector<T> > k(nKernels);
+    for (int q=0;q<nKernels;++q) {
+        k[q].assign(kernels[q], kernels[q]+nk[q]);
+    }
+
+    // source row of rows j = -h..n+h-1
+    std::vector<int> table(n+2*h);
+    for (int j=-h;j<n+h;++j) {
+        table[j+h] = borderIndex(j, n, border);
+    }
+    std::vector<TI> zeros(std::min((size_t)TILE, stride), TI(0));
+
+    long nTiles = (long)((stride+TILE-1)/TILE);
+    long nItems = (long)nOuter*n*nTiles;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (long it=0;it<nItems;++it) {
+        long t = it % nTiles;
+        int j = (int)((it/nTiles) % n);
+        size_t o = (size_t)(it/(nTiles*n));
+        size_t x0 = t*(size_t)TILE;
+        int m = (int)std::min((size_t)TILE, stride-x0);
+
+        const TI* in = input + o*n*stride + x0;
+        size_t offset = (o*n + j)*stride + x0;
+        const int* tj = &table[j+h];
+
+        int q;
+        for (q=0;q<nKernels;++q) {
+            initTile(outputs[q]+offset, in + j*stride, k[q][0], m, odd[q]);
+        }
+        // each pair of input rows is loaded once for all kernels
+        for (int i=1;i<=h;++i) {
+            const TI* a = tj[-i]<0 ? &zeros[0] : in + tj[-i]*stride;
+            const TI* b = tj[i]<0 ? &zeros[0] : in + tj[i]*stride;
+            for (q=0;q<nKernels;++q) {
+                if (i<nk[q]) {
+                    addTile(outputs[q]+offset, a, b, k[q][i], m, odd[q]);
+                }
+            }
+        }
+    }
+}
+
+
+// Convolution of an nx x ny x nz array along dimension 'dim' (0: x, 1: y, 2: z).
+// 'input' and 'output' must not overlap.
+template<class TI, class T>
+void convolve(const TI* input, const int nx, const int ny, const int nz, const int dim,
+              const double kernel[], const int nk, const bool odd, const int border, T* output) {
+    switch (dim) {
+        case 0:
+            convolveLines(input, nx, (size_t)ny*nz, kernel, nk, odd, border, output);
+            break;
+        case 1:
+            convolveStrided(input, ny, (size_t)nx, (size_t)nz, 1, &kernel, &nk, &odd, border, &output);
+            break;
+        default:
+            convolveStrided(input, nz, (size_t)nx*ny, (size_t)1, 1, &kernel, &nk, &odd, border, &output);
+            break;
+    }
+}
+
+
+// Convolutions of an nx x ny x nz array along dimension 'dim' (1: y, 2: z) with nKernels kernels,
+// computed in a single sweep over the input. 'input' must not overlap any of the outputs.
+template<class TI, class T>
+void convolveMulti(const TI* input, const int nx, const int ny, const int nz, const int dim,
+                   const int nKernels, const double* const kernels[], const int nk[], const bool odd[],
+                   const int border, T* const outputs[]) {
+    if (dim==1) {
+        convolveStrided(input, ny, (size_t)nx, (size_t)nz, nKernels, kernels, nk, odd, border, outputs);
+    } else {
+        convolveStrided(input, nz, (size_t)nx*ny, (size_t)1, nKernels, kernels, nk, odd, border, outputs);
+    }
+}
+
+} // namespace sepconv
+
+#endif // SEPARABLECONVOLUTION_H
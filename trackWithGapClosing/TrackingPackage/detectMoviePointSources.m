@@ -141,44 +141,59 @@ for i = 1:numel(p.ChannelIndex)
     movieInfo(1 : nFrames)= struct('xCoord', [], 'yCoord', [],...
         'amp', [], 'sigmaX', [], 'sigmaY', [], 'bkg', []);
     
-    for j= 1:nFrames
-        
-        currImage = double(movieData.channels_(iChan).loadImage(j));
+    if exist('pointSourceDetectionMovie', 'file')==3 && ~detP.FitMixtures
+        % frame-parallel native implementation, overlaps reading and detection
+        readFcn = @(j) movieData.channels_(iChan).loadImage(j);
         if ~isempty(p.MaskProcessIndex) && ~isempty(p.MaskChannelIndex)
-            currMask = maskProc.loadChannelOutput(p.MaskChannelIndex(i),j) & roiMask(:,:,j);
-            detP.Mask =  currMask;
+            iMaskChan = p.MaskChannelIndex(i);
+            maskFcn = @(j) maskProc.loadChannelOutput(iMaskChan,j) & roiMask(:,:,j);
         else
-            detP.Mask = roiMask(:,:,j);
+            maskFcn = @(j) roiMask(:,:,j);
+        end
+        movieInfo = orderfields(pointSourceDetectionMovie(readFcn, maskFcn, nFrames, p.filterSigma(iChan), detP));
+        if ishandle(wtBar)
+            waitbar(i/nChan, wtBar, sprintf(logMsg(iChan)));
         end
+    else
+        for j= 1:nFrames
+        
+            currImage = double(movieData.channels_(iChan).loadImage(j));
+            if ~isempty(p.MaskProcessIndex) && ~isempty(p.MaskChannelIndex)
+                currMask = maskProc.loadChannelOutput(p.MaskChannelIndex(i),j) & roiMask(:,:,j);
+                detP.Mask =  currMask;
+            else
+                detP.Mask = roiMask(:,:,j);
+            end
         
-        % Call main detection function
-        pstruct = pointSourceDetection(currImage,p.filterSigma(iChan),detP);
+            % Call main detection function
+            pstruct = pointSourceDetection(currImage,p.filterSigma(iChan),detP);
         
-        if ~isempty(pstruct) &&...
-                ~isequal(fieldnames(pstruct), fieldnames(movieInfo(j)))
-            allFields = fieldnames(pstruct);
-            for iField = 1:numel(allFields)
-                movieInfo(j).(allFields{iField}) = pstruct.(allFields{iField}); %#ok<AGROW>
+            if ~isempty(pstruct) &&...
+                    ~isequal(fieldnames(pstruct), fieldnames(movieInfo(j)))
+                allFields = fieldnames(pstruct);
+                for iField = 1:numel(allFields)
+                    movieInfo(j).(allFields{iField}) = pstruct.(allFields{iField}); %#ok<AGROW>
+                end
+                movieInfo = orderfields(movieInfo);
             end
-            movieInfo = orderfields(movieInfo);
-        end
-        % add xCoord, yCoord, amp fields for compatibilty  with tracker
-        if ~isempty(pstruct)
+            % add xCoord, yCoord, amp fields for compatibilty  with tracker
+            if ~isempty(pstruct)
             
-            pstruct.xCoord = [pstruct.x' pstruct.x_pstd'];
-            pstruct.yCoord = [pstruct.y' pstruct.y_pstd'];
-            pstruct.amp = [pstruct.A' pstruct.A_pstd'];
-            pstruct.sigmaX = [pstruct.s' pstruct.s_pstd'];
-            pstruct.sigmaY = [pstruct.s' pstruct.s_pstd'];
-            pstruct.bkg = [pstruct.c' pstruct.c_pstd'];
+                pstruct.xCoord = [pstruct.x' pstruct.x_pstd'];
+                pstruct.yCoord = [pstruct.y' pstruct.y_pstd'];
+                pstruct.amp = [pstruct.A' pstruct.A_pstd'];
+                pstruct.sigmaX = [pstruct.s' pstruct.s_pstd'];
+                pstruct.sigmaY = [pstruct.s' pstruct.s_pstd'];
+                pstruct.bkg = [pstruct.c' pstruct.c_pstd'];
             
-            movieInfo(j) = orderfields(pstruct); %#ok<AGROW>
-        end
+                movieInfo(j) = orderfields(pstruct); %#ok<AGROW>
+            end
         
-        if mod(j,5)==1 && ishandle(wtBar)
-            tj=toc;
-            nj = (i-1)*nFrames+ j;
-            waitbar(nj/nTot,wtBar,sprintf([logMsg(iChan) timeMsg(tj*nTot/nj-tj)]));
+            if mod(j,5)==1 && ishandle(wtBar)
+                tj=toc;
+                nj = (i-1)*nFrames+ j;
+                waitbar(nj/nTot,wtBar,sprintf([logMsg(iChan) timeMsg(tj*nTot/nj-tj)]));
+            end
         end
     end
     save(outFilePaths{1,iChan}, 'movieInfo');
@@ -18,6 +18,10 @@ function D=bwdistsc(bw,aspect)
 % is significantly faster. Otherwise BWDISTSC uses internal algorithm 
 % to perform 2D scans.
 %
+% When the compiled euclideanDistanceTransform (imageProcessing) is
+% available, arrays (not cell arrays) are transformed by it: an exact,
+% linear-time transform that is parallel over the image lines.
+%
 %     Yuriy Mishchenko  JFRC HHMI Chklovskii Lab  JUL 2007
 
 % This code is free for use or modifications, just please give credit 
@@ -51,6 +55,12 @@ if(iscell(bw)) shape=[size(bw{1}),length(bw)]; else shape=size(bw); end
 if(length(shape)<3) shape(length(shape)+1:3)=1; end
 if(length(aspect)<3) aspect(length(aspect)+1:3)=1; end
 
+% native transform
+if(~iscell(bw) && exist('euclideanDistanceTransform','file')==3)
+    D=euclideanDistanceTransform(bw,aspect);
+    return
+end
+
 % allocate space
 D=cell(1,shape(3)); for k=1:shape(3) D{k}=zeros(shape(1:2)); end
 